@@ -0,0 +1,213 @@
+// Copyright (c) 2018 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockrelaycache.h"
+
+#include "blockencodings.h"
+#include "memusage.h"
+#include "netmessagemaker.h"
+#include "primitives/block.h"
+#include "streams.h"
+#include "version.h"
+
+CBlockRelayCache::CBlockRelayCache(size_t nMaxBytesIn) : nMaxBytes(nMaxBytesIn), nUsage(0)
+{
+}
+
+bool CBlockRelayCache::Insert(const uint256& hash, std::vector<unsigned char>&& vBlock)
+{
+    {
+        LOCK(cs);
+        if (Find(hash))
+            return true;
+    }
+
+    // Parse the block once, outside the lock, to find its transactions
+    Entry entry;
+    entry.fHasWitness = false;
+    try {
+        CDataStream ss((const char*)vBlock.data(), (const char*)vBlock.data() + vBlock.size(), SER_NETWORK, PROTOCOL_VERSION);
+        CBlockHeader header;
+        ss >> header;
+        if (header.GetHash() != hash)
+            return false;
+        uint64_t nTx = ReadCompactSize(ss);
+        if (nTx > vBlock.size())
+            return false;
+        entry.vTxPos.reserve(nTx);
+        entry.vTxHasWitness.reserve(nTx);
+        for (uint64_t i = 0; i < nTx; i++) {
+            uint32_t nBegin = vBlock.size() - ss.size();
+            CMutableTransaction tx;
+            ss >> tx;
+            entry.vTxPos.emplace_back(nBegin, vBlock.size() - ss.size());
+            entry.vTxHasWitness.push_back(tx.HasWitness());
+            entry.fHasWitness |= tx.HasWitness();
+        }
+        if (!ss.empty())
+            return false;
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    CSerializedNetMsg msg;
+    msg.command = NetMsgType::BLOCK;
+    msg.data = std::move(vBlock);
+    entry.msgBlock[true] = MakeSharedNetMsg(std::move(msg));
+    if (!entry.fHasWitness) {
+        // Without witness data both serializations are the same
+        entry.msgBlock[false] = entry.msgBlock[true];
+    }
+    entry.nUsage = entry.msgBlock[true]->size() + memusage::DynamicUsage(entry.vTxPos) + memusage::DynamicUsage(entry.vTxHasWitness);
+    if (entry.nUsage > nMaxBytes)
+        return false;
+
+    LOCK(cs);
+    if (Find(hash))
+        return true;
+    lruList.push_front(hash);
+    entry.itLRU = lruList.begin();
+    nUsage += entry.nUsage;
+    mapEntries.emplace(hash, std::move(entry));
+    Evict();
+    return true;
+}
+
+bool CBlockRelayCache::Contains(const uint256& hash) const
+{
+    LOCK(cs);
+    return mapEntries.count(hash) != 0;
+}
+
+CSharedNetMsg CBlockRelayCache::GetBlockMsg(const uint256& hash, bool fWitness)
+{
+    LOCK(cs);
+    Entry* entry = Find(hash);
+    if (!entry)
+        return nullptr;
+    CSharedNetMsg& msgBlock = entry->msgBlock[fWitness];
+    if (!msgBlock) {
+        // Only the serialization without witness data can be missing. The header and
+        // transaction count are the same, and so are the transactions without witnesses.
+        const std::vector<unsigned char>& vRaw = entry->msgBlock[true]->data;
+        CSerializedNetMsg msg;
+        msg.command = NetMsgType::BLOCK;
+        msg.data.reserve(vRaw.size());
+        msg.data.assign(vRaw.begin(), vRaw.begin() + (entry->vTxPos.empty() ? vRaw.size() : entry->vTxPos[0].first));
+        for (size_t i = 0; i < entry->vTxPos.size(); i++)
+            AppendTransaction(*entry, i, false, msg.data);
+        msgBlock = MakeSharedNetMsg(std::move(msg));
+        AddUsage(*entry, msgBlock);
+    }
+    return msgBlock;
+}
+
+CSharedNetMsg CBlockRelayCache::GetCompactBlockMsg(const uint256& hash, bool fWitness)
+{
+    LOCK(cs);
+    Entry* entry = Find(hash);
+    if (!entry)
+        return nullptr;
+    CSharedNetMsg& msgCompactBlock = entry->msgCompactBlock[fWitness];
+    if (!msgCompactBlock) {
+        // Short ids need the transaction hashes, so this one takes the whole block
+        const std::vector<unsigned char>& vRaw = entry->msgBlock[true]->data;
+        CDataStream ss((const char*)vRaw.data(), (const char*)vRaw.data() + vRaw.size(), SER_NETWORK, PROTOCOL_VERSION);
+        CBlock block;
+        ss >> block;
+        CBlockHeaderAndShortTxIDs cmpctblock(block, fWitness);
+        int nSendFlags = fWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
+        msgCompactBlock = MakeSharedNetMsg(CNetMsgMaker(PROTOCOL_VERSION).Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
+        AddUsage(*entry, msgCompactBlock);
+    }
+    return msgCompactBlock;
+}
+
+bool CBlockRelayCache::GetBlockTxnMsg(const BlockTransactionsRequest& req, bool fWitness, CSharedNetMsg& msgRet)
+{
+    LOCK(cs);
+    Entry* entry = Find(req.blockhash);
+    if (!entry)
+        return false;
+    msgRet.reset();
+    for (uint16_t index : req.indexes) {
+        if (index >= entry->vTxPos.size())
+            return true;
+    }
+
+    CSerializedNetMsg msg;
+    msg.command = NetMsgType::BLOCKTXN;
+    {
+        CVectorWriter writer(SER_NETWORK, PROTOCOL_VERSION, msg.data, 0, req.blockhash);
+        WriteCompactSize(writer, req.indexes.size());
+    }
+    for (uint16_t index : req.indexes)
+        AppendTransaction(*entry, index, fWitness, msg.data);
+    msgRet = MakeSharedNetMsg(std::move(msg));
+    return true;
+}
+
+void CBlockRelayCache::Clear()
+{
+    LOCK(cs);
+    mapEntries.clear();
+    lruList.clear();
+    nUsage = 0;
+}
+
+size_t CBlockRelayCache::Size() const
+{
+    LOCK(cs);
+    return mapEntries.size();
+}
+
+size_t CBlockRelayCache::DynamicMemoryUsage() const
+{
+    LOCK(cs);
+    return nUsage;
+}
+
+CBlockRelayCache::Entry* CBlockRelayCache::Find(const uint256& hash)
+{
+    AssertLockHeld(cs);
+    auto it = mapEntries.find(hash);
+    if (it == mapEntries.end())
+        return nullptr;
+    lruList.splice(lruList.begin(), lruList, it->second.itLRU);
+    return &it->second;
+}
+
+void CBlockRelayCache::AddUsage(Entry& entry, const CSharedNetMsg& msg)
+{
+    AssertLockHeld(cs);
+    entry.nUsage += msg->size();
+    nUsage += msg->size();
+    Evict();
+}
+
+void CBlockRelayCache::Evict()
+{
+    AssertLockHeld(cs);
+    // The most recently used entry is always kept, callers may still be working on it
+    while (nUsage > nMaxBytes && lruList.size() > 1) {
+        auto it = mapEntries.find(lruList.back());
+        nUsage -= it->second.nUsage;
+        mapEntries.erase(it);
+        lruList.pop_back();
+    }
+}
+
+void CBlockRelayCache::AppendTransaction(const Entry& entry, size_t i, bool fWitness, std::vector<unsigned char>& out) const
+{
+    const std::vector<unsigned char>& vRaw = entry.msgBlock[true]->data;
+    const std::pair<uint32_t, uint32_t>& pos = entry.vTxPos[i];
+    if (fWitness || !entry.vTxHasWitness[i]) {
+        out.insert(out.end(), vRaw.begin() + pos.first, vRaw.begin() + pos.second);
+        return;
+    }
+    CDataStream ss((const char*)vRaw.data() + pos.first, (const char*)vRaw.data() + pos.second, SER_NETWORK, PROTOCOL_VERSION);
+    CMutableTransaction tx;
+    ss >> tx;
+    CVectorWriter(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS, out, out.size(), tx);
+}
@@ -0,0 +1,77 @@
+// Copyright (c) 2018 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKRELAYCACHE_H
+#define BITCOIN_BLOCKRELAYCACHE_H
+
+#include "net.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <list>
+#include <map>
+#include <vector>
+
+class BlockTransactionsRequest;
+
+/**
+ * LRU cache of recent blocks in their serialized form, for serving them to peers.
+ *
+ * Blocks are added as the raw bytes stored on disk, which are the block message
+ * payload with witness data. The block is parsed once, to find where each
+ * transaction starts, and the block, cmpctblock and blocktxn messages are then
+ * built from those bytes and shared between all peers they are sent to.
+ */
+class CBlockRelayCache
+{
+public:
+    explicit CBlockRelayCache(size_t nMaxBytesIn);
+
+    /** Add a block in disk format. Fails if it does not parse or does not hash to hash. */
+    bool Insert(const uint256& hash, std::vector<unsigned char>&& vBlock);
+    bool Contains(const uint256& hash) const;
+
+    /** block message, or nullptr if the block is not cached */
+    CSharedNetMsg GetBlockMsg(const uint256& hash, bool fWitness);
+    /** cmpctblock message, or nullptr if the block is not cached */
+    CSharedNetMsg GetCompactBlockMsg(const uint256& hash, bool fWitness);
+    /**
+     * blocktxn message answering req. Returns false if the block is not cached.
+     * msg is set to nullptr if req asks for a transaction the block does not have.
+     */
+    bool GetBlockTxnMsg(const BlockTransactionsRequest& req, bool fWitness, CSharedNetMsg& msg);
+
+    void Clear();
+    size_t Size() const;
+    size_t DynamicMemoryUsage() const;
+
+private:
+    struct Entry {
+        // Indexed by whether witness data is included. msgBlock[true] holds the raw block.
+        CSharedNetMsg msgBlock[2];
+        CSharedNetMsg msgCompactBlock[2];
+        // Begin and end of each transaction in the raw block
+        std::vector<std::pair<uint32_t, uint32_t>> vTxPos;
+        // Transactions that carry witness data, and so serialize differently without it
+        std::vector<bool> vTxHasWitness;
+        bool fHasWitness;
+        size_t nUsage;
+        std::list<uint256>::iterator itLRU;
+    };
+
+    mutable CCriticalSection cs;
+    size_t nMaxBytes;
+    size_t nUsage;
+    std::map<uint256, Entry> mapEntries;
+    // Most recently used first
+    std::list<uint256> lruList;
+
+    Entry* Find(const uint256& hash);
+    void AddUsage(Entry& entry, const CSharedNetMsg& msg);
+    void Evict();
+    /** Append transaction i of the block, with or without its witness data */
+    void AppendTransaction(const Entry& entry, size_t i, bool fWitness, std::vector<unsigned char>& out) const;
+};
+
+#endif // BITCOIN_BLOCKRELAYCACHE_H
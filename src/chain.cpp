@@ -4,6 +4,69 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chain.h"
+#include "memusage.h"
+
+#include <string.h>
+#include <type_traits>
+
+// Arena memory is released without running destructors
+static_assert(std::is_trivially_destructible<CBlockIndex>::value, "CBlockIndex must be trivially destructible");
+static_assert(std::is_trivially_destructible<CBlockStakeData>::value, "CBlockStakeData must be trivially destructible");
+
+/**
+ * CBlockIndexArena implementation
+ */
+void* CBlockIndexArena::Allocate(size_t nSize)
+{
+    // Keep every allocation aligned for the types stored in the arena
+    static const size_t nAlign = alignof(CBlockIndex) > alignof(CBlockStakeData) ? alignof(CBlockIndex) : alignof(CBlockStakeData);
+    nSize = (nSize + nAlign - 1) & ~(nAlign - 1);
+    if (nSize > CHUNK_SIZE) {
+        // Oversized allocations get a chunk of their own. The current chunk stays at the back
+        vChunks.emplace(vChunks.begin(), new unsigned char[nSize]);
+        return vChunks.front().get();
+    }
+    if (nChunkUsed + nSize > CHUNK_SIZE) {
+        vChunks.emplace_back(new unsigned char[CHUNK_SIZE]);
+        nChunkUsed = 0;
+    }
+    void* p = vChunks.back().get() + nChunkUsed;
+    nChunkUsed += nSize;
+    return p;
+}
+
+const CBlockStateRoots* CBlockIndexArena::InternStateRoots(const uint256& hashStateRoot, const uint256& hashUTXORoot)
+{
+    if (hashStateRoot.IsNull() && hashUTXORoot.IsNull())
+        return nullptr;
+    CBlockStateRoots roots;
+    roots.hashStateRoot = hashStateRoot;
+    roots.hashUTXORoot = hashUTXORoot;
+    // Elements of an unordered_set keep their address when the set rehashes
+    return &*setStateRoots.insert(roots).first;
+}
+
+CBlockStakeData* CBlockIndexArena::NewStakeData(const COutPoint& prevoutStake, const std::vector<unsigned char>& vchBlockSig)
+{
+    CBlockStakeData* pdata = new (Allocate(sizeof(CBlockStakeData) + vchBlockSig.size())) CBlockStakeData();
+    pdata->prevoutStake = prevoutStake;
+    pdata->nBlockSigSize = vchBlockSig.size();
+    if (!vchBlockSig.empty())
+        memcpy(pdata + 1, vchBlockSig.data(), vchBlockSig.size());
+    return pdata;
+}
+
+void CBlockIndexArena::Clear()
+{
+    vChunks.clear();
+    nChunkUsed = CHUNK_SIZE;
+    setStateRoots.clear();
+}
+
+size_t CBlockIndexArena::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(vChunks) + vChunks.size() * CHUNK_SIZE + memusage::DynamicUsage(setStateRoots);
+}
 
 /**
  * CChain implementation
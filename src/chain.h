@@ -12,6 +12,9 @@
 #include "tinyformat.h"
 #include "uint256.h"
 
+#include <memory>
+#include <new>
+#include <unordered_set>
 #include <vector>
 
 /**
@@ -167,6 +170,75 @@ enum BlockStatus: uint32_t {
  * candidates to be the next block. A blockindex may have multiple pprev pointing
  * to it, but at most one of them can be part of the currently active branch.
  */
+class CBlockIndex;
+
+/** Contract state roots after a block (qtum). Shared by all index entries with the same roots. */
+struct CBlockStateRoots
+{
+    uint256 hashStateRoot;
+    uint256 hashUTXORoot;
+
+    friend bool operator==(const CBlockStateRoots& a, const CBlockStateRoots& b)
+    {
+        return a.hashStateRoot == b.hashStateRoot && a.hashUTXORoot == b.hashUTXORoot;
+    }
+};
+
+/** Proof-of-stake fields of a block index entry. The block signature follows it in memory. */
+struct CBlockStakeData
+{
+    COutPoint prevoutStake;
+    uint256 hashProof;
+    uint32_t nBlockSigSize;
+
+    const unsigned char* BlockSig() const
+    {
+        return reinterpret_cast<const unsigned char*>(this + 1);
+    }
+};
+
+/**
+ * Storage for block index entries and their out of line data.
+ * Entries are carved from large contiguous chunks instead of being allocated one by one,
+ * and are only ever released all together by Clear(), as the block index never removes
+ * single entries. State roots are interned, since most blocks leave them unchanged.
+ * Must be accessed with cs_main held.
+ */
+class CBlockIndexArena
+{
+private:
+    struct StateRootsHasher
+    {
+        size_t operator()(const CBlockStateRoots& roots) const
+        {
+            return roots.hashStateRoot.GetCheapHash() ^ roots.hashUTXORoot.GetCheapHash();
+        }
+    };
+
+    static const size_t CHUNK_SIZE = 1 << 20;
+
+    std::vector<std::unique_ptr<unsigned char[]>> vChunks;
+    size_t nChunkUsed;
+    std::unordered_set<CBlockStateRoots, StateRootsHasher> setStateRoots;
+
+    void* Allocate(size_t nSize);
+
+public:
+    CBlockIndexArena() : nChunkUsed(CHUNK_SIZE) {}
+
+    /** Construct a new block index entry */
+    template <typename... Args>
+    CBlockIndex* New(Args&&... args);
+
+    const CBlockStateRoots* InternStateRoots(const uint256& hashStateRoot, const uint256& hashUTXORoot);
+    CBlockStakeData* NewStakeData(const COutPoint& prevoutStake, const std::vector<unsigned char>& vchBlockSig);
+
+    /** Release everything. All entries handed out become invalid. */
+    void Clear();
+
+    size_t DynamicMemoryUsage() const;
+};
+
 class CBlockIndex
 {
 public:
@@ -215,16 +287,14 @@ public:
     unsigned int nTime;
     unsigned int nBits;
     unsigned int nNonce;
-    uint256 hashStateRoot; // qtum
-    uint256 hashUTXORoot; // qtum
-    // block signature - proof-of-stake protect the block by signing the block using a stake holder private key
-    std::vector<unsigned char> vchBlockSig;
     uint256 nStakeModifier;
-    // proof-of-stake specific fields
-    COutPoint prevoutStake;
-    uint256 hashProof; // qtum
     uint64_t nMoneySupply;
 
+    //! state roots, out of line (qtum)
+    const CBlockStateRoots* pStateRoots;
+    //! proof-of-stake fields and block signature, out of line. nullptr for proof-of-work blocks
+    CBlockStakeData* pStakeData;
+
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
     int32_t nSequenceId;
 
@@ -253,13 +323,10 @@ public:
         nTime          = 0;
         nBits          = 0;
         nNonce         = 0;
-        hashStateRoot  = uint256(); // qtum
-        hashUTXORoot   = uint256(); // qtum
-        vchBlockSig.clear();
         nStakeModifier = uint256();
-        hashProof = uint256();
-        prevoutStake.SetNull();
         nMoneySupply = 0;
+        pStateRoots = nullptr;
+        pStakeData = nullptr;
     }
 
     CBlockIndex()
@@ -267,7 +334,7 @@ public:
         SetNull();
     }
 
-    CBlockIndex(const CBlockHeader& block)
+    CBlockIndex(const CBlockHeader& block, CBlockIndexArena& arena)
     {
         SetNull();
 
@@ -277,12 +344,56 @@ public:
         nBits          = block.nBits;
         nNonce         = block.nNonce;
         nMoneySupply   = 0;
-        hashStateRoot  = block.hashStateRoot; // qtum
-        hashUTXORoot   = block.hashUTXORoot; // qtum
         nStakeModifier = uint256();
-        hashProof = uint256(); 
-        prevoutStake   = block.prevoutStake; // qtum
-        vchBlockSig    = block.vchBlockSig; // qtum
+        SetStateRoots(arena, block.hashStateRoot, block.hashUTXORoot); // qtum
+        SetStakeData(arena, block.prevoutStake, block.vchBlockSig); // qtum
+    }
+
+    uint256 GetHashStateRoot() const
+    {
+        return pStateRoots ? pStateRoots->hashStateRoot : uint256();
+    }
+
+    uint256 GetHashUTXORoot() const
+    {
+        return pStateRoots ? pStateRoots->hashUTXORoot : uint256();
+    }
+
+    void SetStateRoots(CBlockIndexArena& arena, const uint256& hashStateRoot, const uint256& hashUTXORoot)
+    {
+        pStateRoots = arena.InternStateRoots(hashStateRoot, hashUTXORoot);
+    }
+
+    COutPoint GetPrevoutStake() const
+    {
+        return pStakeData ? pStakeData->prevoutStake : COutPoint();
+    }
+
+    std::vector<unsigned char> GetBlockSig() const
+    {
+        if (!pStakeData)
+            return std::vector<unsigned char>();
+        return std::vector<unsigned char>(pStakeData->BlockSig(), pStakeData->BlockSig() + pStakeData->nBlockSigSize);
+    }
+
+    //! Only proof-of-stake blocks get out of line stake data. Proof-of-work blocks are never signed.
+    void SetStakeData(CBlockIndexArena& arena, const COutPoint& prevoutStake, const std::vector<unsigned char>& vchBlockSig)
+    {
+        pStakeData = prevoutStake.IsNull() ? nullptr : arena.NewStakeData(prevoutStake, vchBlockSig);
+    }
+
+    //! The proof hash of a proof-of-work block is its own hash
+    uint256 GetHashProof() const
+    {
+        if (pStakeData)
+            return pStakeData->hashProof;
+        return phashBlock ? *phashBlock : uint256();
+    }
+
+    void SetHashProof(const uint256& hashProof)
+    {
+        if (pStakeData)
+            pStakeData->hashProof = hashProof;
     }
 
     CDiskBlockPos GetBlockPos() const {
@@ -313,10 +424,10 @@ public:
         block.nTime          = nTime;
         block.nBits          = nBits;
         block.nNonce         = nNonce;
-        block.hashStateRoot  = hashStateRoot; // qtum
-        block.hashUTXORoot   = hashUTXORoot; // qtum
-        block.vchBlockSig    = vchBlockSig;
-        block.prevoutStake   = prevoutStake;
+        block.hashStateRoot  = GetHashStateRoot(); // qtum
+        block.hashUTXORoot   = GetHashUTXORoot(); // qtum
+        block.vchBlockSig    = GetBlockSig();
+        block.prevoutStake   = GetPrevoutStake();
         return block;
     }
 
@@ -358,7 +469,7 @@ public:
 
     bool IsProofOfStake() const
     {
-        return !prevoutStake.IsNull();
+        return pStakeData != nullptr;
     }
 
     std::string ToString() const
@@ -400,6 +511,12 @@ public:
     const CBlockIndex* GetAncestor(int height) const;
 };
 
+template <typename... Args>
+CBlockIndex* CBlockIndexArena::New(Args&&... args)
+{
+    return new (Allocate(sizeof(CBlockIndex))) CBlockIndex(std::forward<Args>(args)...);
+}
+
 arith_uint256 GetBlockProof(const CBlockIndex& block);
 /** Return the time it would take to redo the work difference between from and to, assuming the current hashrate corresponds to the difficulty at tip, in seconds. */
 int64_t GetBlockProofEquivalentTime(const CBlockIndex& to, const CBlockIndex& from, const CBlockIndex& tip, const Consensus::Params&);
@@ -412,6 +529,13 @@ class CDiskBlockIndex : public CBlockIndex
 {
 public:
     uint256 hashPrev;
+    uint256 hashStateRoot; // qtum
+    uint256 hashUTXORoot; // qtum
+    // block signature - proof-of-stake protect the block by signing the block using a stake holder private key
+    std::vector<unsigned char> vchBlockSig;
+    // proof-of-stake specific fields
+    COutPoint prevoutStake;
+    uint256 hashProof; // qtum
 
     CDiskBlockIndex() {
         hashPrev = uint256();
@@ -419,6 +543,11 @@ public:
 
     explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex) {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
+        hashStateRoot = pindex->GetHashStateRoot();
+        hashUTXORoot = pindex->GetHashUTXORoot();
+        vchBlockSig = pindex->GetBlockSig();
+        prevoutStake = pindex->GetPrevoutStake();
+        hashProof = pindex->GetHashProof();
     }
 
     ADD_SERIALIZE_METHODS;
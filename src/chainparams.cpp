@@ -175,6 +175,7 @@ public:
                                     COINBASE_MATURITY;
 
         consensus.nFixUTXOCacheHFHeight=100000;
+        consensus.nFixX86StateHFHeight=0x7fffffff; // not scheduled yet
     }
 };
 
@@ -274,6 +275,7 @@ public:
                                     COINBASE_MATURITY;
 
         consensus.nFixUTXOCacheHFHeight=84500;
+        consensus.nFixX86StateHFHeight=0x7fffffff; // not scheduled yet
     }
 };
 
@@ -349,6 +351,7 @@ public:
         consensus.nFirstMPoSBlock = 5000;
 
         consensus.nFixUTXOCacheHFHeight=0;
+        consensus.nFixX86StateHFHeight=0;
 
         base58Prefixes[PUBKEY_ADDRESS] = std::vector<unsigned char>(1,120); //q
         base58Prefixes[SCRIPT_ADDRESS] = std::vector<unsigned char>(1,110); //m
@@ -8,6 +8,13 @@
 #include "sync.h"
 
 #include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <stdint.h>
+#include <thread>
 #include <vector>
 
 #include <boost/thread/condition_variable.hpp>
@@ -16,157 +23,422 @@
 template <typename T>
 class CCheckQueueControl;
 
-/** 
+/** A type-erased unit of work, as it is passed between the threads of a CCheckScheduler. */
+class CCheckTask
+{
+public:
+    virtual void Run() = 0;
+
+protected:
+    ~CCheckTask() {}
+};
+
+/**
+ * Chase-Lev work-stealing deque of tasks.
+ * One thread (the owner) pushes and pops at the bottom, any thread may steal
+ * from the top. None of the operations take a lock.
+ */
+class CCheckDeque
+{
+private:
+    struct Buffer {
+        int64_t mask;
+        std::unique_ptr<std::atomic<CCheckTask*>[]> items;
+
+        explicit Buffer(int64_t size) : mask(size - 1), items(new std::atomic<CCheckTask*>[size]) {}
+        CCheckTask* Get(int64_t i) const { return items[i & mask].load(std::memory_order_relaxed); }
+        void Put(int64_t i, CCheckTask* task) { items[i & mask].store(task, std::memory_order_relaxed); }
+    };
+
+    std::atomic<int64_t> top;
+    std::atomic<int64_t> bottom;
+    std::atomic<Buffer*> buffer;
+
+    //! Buffers replaced by a larger one. A thief may still be reading from
+    //! them, so they are only freed with the deque. Owner only.
+    std::vector<std::unique_ptr<Buffer>> vBuffers;
+
+public:
+    //! Largest number of tasks another thread takes at once.
+    const int64_t nStealMax;
+
+    //! Whether a thread or queue currently owns this deque. Protected by the scheduler's mutex.
+    bool fInUse;
+
+    //! Whether this deque belongs to a worker thread rather than a queue.
+    const bool fWorker;
+
+    CCheckDeque(int64_t nStealMaxIn, bool fWorkerIn) : top(0), bottom(0), nStealMax(nStealMaxIn), fInUse(true), fWorker(fWorkerIn)
+    {
+        vBuffers.emplace_back(new Buffer(256));
+        buffer.store(vBuffers.back().get(), std::memory_order_relaxed);
+    }
+
+    //! Approximate number of tasks in the deque.
+    int64_t Size() const
+    {
+        int64_t b = bottom.load(std::memory_order_acquire);
+        int64_t t = top.load(std::memory_order_acquire);
+        return b - t;
+    }
+
+    //! Add a task at the bottom. Owner only.
+    void Push(CCheckTask* task)
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Buffer* buf = buffer.load(std::memory_order_relaxed);
+        if (b - t > buf->mask) {
+            Buffer* grown = new Buffer(2 * (buf->mask + 1));
+            for (int64_t i = t; i < b; i++)
+                grown->Put(i, buf->Get(i));
+            vBuffers.emplace_back(grown);
+            buffer.store(grown, std::memory_order_release);
+            buf = grown;
+        }
+        buf->Put(b, task);
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    //! Take the most recently pushed task, or nullptr if empty. Owner only.
+    CCheckTask* Pop()
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Buffer* buf = buffer.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        CCheckTask* task = buf->Get(b);
+        if (t == b) {
+            // Last task: race the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                task = nullptr;
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    //! Take the oldest task, or nullptr if empty or another thread got it first.
+    CCheckTask* Steal()
+    {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return nullptr;
+        CCheckTask* task = buffer.load(std::memory_order_acquire)->Get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return task;
+    }
+};
+
+/**
+ * Pool of worker threads executing CCheckTasks by work stealing.
+ * Each worker thread, and each CCheckQueue using the pool, owns a
+ * CCheckDeque. Queues push their tasks onto their own deque without taking a
+ * lock; idle workers steal half of the tasks of some other deque (up to its
+ * nStealMax) onto theirs, where they can be stolen again. Threads that find
+ * no work anywhere park on a condition variable, which is only signalled
+ * when some thread is known to be parked.
+ * Several CCheckQueues, of any task type, can share one scheduler.
+ */
+class CCheckScheduler
+{
+public:
+    //! Rounds of looking for work before a thread parks
+    static const int SPIN_ROUNDS = 64;
+
+private:
+    static const int MAX_DEQUES = 256;
+
+    //! Every deque ever handed out. Entries are only added, never removed.
+    std::atomic<CCheckDeque*> deques[MAX_DEQUES];
+    std::atomic<int> nDeques;
+
+    //! Number of parked worker threads
+    std::atomic<int> nSleeping;
+
+    //! Protects deque ownership, and parked workers wait on cond with it
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    std::vector<std::unique_ptr<CCheckDeque>> vDeques;
+
+    bool HasWork() const
+    {
+        int n = nDeques.load(std::memory_order_acquire);
+        for (int i = 0; i < n; i++) {
+            if (deques[i].load(std::memory_order_relaxed)->Size() > 0)
+                return true;
+        }
+        return false;
+    }
+
+    struct DequeReleaser {
+        CCheckScheduler& scheduler;
+        CCheckDeque* deque;
+        ~DequeReleaser() { scheduler.ReleaseDeque(deque); }
+    };
+
+    struct Sleeping {
+        std::atomic<int>& nSleeping;
+        explicit Sleeping(std::atomic<int>& n) : nSleeping(n) { nSleeping.fetch_add(1, std::memory_order_seq_cst); }
+        ~Sleeping() { nSleeping.fetch_sub(1, std::memory_order_relaxed); }
+    };
+
+public:
+    CCheckScheduler() : nDeques(0), nSleeping(0)
+    {
+        for (auto& deque : deques)
+            deque.store(nullptr, std::memory_order_relaxed);
+    }
+
+    CCheckScheduler(const CCheckScheduler&) = delete;
+    CCheckScheduler& operator=(const CCheckScheduler&) = delete;
+
+    //! Get a deque for a new worker thread or queue, reusing a released one if possible.
+    CCheckDeque* AcquireDeque(int64_t nStealMax, bool fWorker)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        for (auto& deque : vDeques) {
+            if (!deque->fInUse && deque->fWorker == fWorker && deque->nStealMax == nStealMax) {
+                deque->fInUse = true;
+                return deque.get();
+            }
+        }
+        int n = nDeques.load(std::memory_order_relaxed);
+        assert(n < MAX_DEQUES);
+        vDeques.emplace_back(new CCheckDeque(nStealMax, fWorker));
+        deques[n].store(vDeques.back().get(), std::memory_order_relaxed);
+        nDeques.store(n + 1, std::memory_order_release);
+        return vDeques.back().get();
+    }
+
+    //! Give back an empty deque.
+    void ReleaseDeque(CCheckDeque* deque)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        deque->fInUse = false;
+    }
+
+    //! Wake up to n parked workers, after tasks were pushed.
+    void Notify(size_t n)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (n == 0 || nSleeping.load(std::memory_order_relaxed) == 0)
+            return;
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (n == 1)
+            cond.notify_one();
+        else
+            cond.notify_all();
+    }
+
+    /**
+     * Steal tasks from a deque other than own. Returns one of them, and
+     * pushes any others onto own. Returns nullptr if no work was found.
+     */
+    CCheckTask* Steal(CCheckDeque* own, uint32_t& rand)
+    {
+        int n = nDeques.load(std::memory_order_acquire);
+        rand ^= rand << 13;
+        rand ^= rand >> 17;
+        rand ^= rand << 5;
+        for (int i = 0; i < n; i++) {
+            CCheckDeque* victim = deques[(rand + i) % n].load(std::memory_order_relaxed);
+            if (victim == own)
+                continue;
+            int64_t nSize = victim->Size();
+            if (nSize <= 0)
+                continue;
+            CCheckTask* task = victim->Steal();
+            if (task == nullptr)
+                continue;
+            int64_t nTake = std::min(victim->nStealMax, (nSize + 1) / 2);
+            int64_t nTaken = 1;
+            for (; nTaken < nTake; nTaken++) {
+                CCheckTask* extra = victim->Steal();
+                if (extra == nullptr)
+                    break;
+                own->Push(extra);
+            }
+            if (nTaken > 1)
+                Notify(1);
+            return task;
+        }
+        return nullptr;
+    }
+
+    //! Worker thread. Returns when the thread is interrupted while parked.
+    void Thread()
+    {
+        CCheckDeque* own = AcquireDeque(std::numeric_limits<int64_t>::max(), true);
+        DequeReleaser releaser{*this, own};
+        uint32_t rand = (uint32_t)(uintptr_t)own | 1;
+        int nRounds = 0;
+        while (true) {
+            CCheckTask* task = own->Pop();
+            if (task == nullptr)
+                task = Steal(own, rand);
+            if (task != nullptr) {
+                task->Run();
+                nRounds = 0;
+                continue;
+            }
+            if (++nRounds < SPIN_ROUNDS) {
+                std::this_thread::yield();
+                continue;
+            }
+            nRounds = 0;
+            boost::unique_lock<boost::mutex> lock(mutex);
+            Sleeping sleeping(nSleeping);
+            // Pairs with the fence in Notify: either it sees us sleeping, or we see its tasks
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!HasWork())
+                cond.wait(lock);
+        }
+    }
+};
+
+/**
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
   * operator(), returning a bool.
   *
   * One thread (the master) is assumed to push batches of verifications
-  * onto the queue, where they are processed by N-1 worker threads. When
-  * the master is done adding work, it temporarily joins the worker pool
-  * as an N'th worker, until all jobs are done.
+  * onto the queue, where they are processed by the worker threads of the
+  * queue's CCheckScheduler. When the master is done adding work, it
+  * temporarily joins the workers, until all jobs are done.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
-    boost::mutex mutex;
+    struct Task : public CCheckTask {
+        CCheckQueue* queue;
+        T check;
 
-    //! Worker threads block on this when out of work
-    boost::condition_variable condWorker;
+        explicit Task(CCheckQueue* queueIn) : queue(queueIn) {}
 
-    //! Master thread blocks on this when out of work
-    boost::condition_variable condMaster;
-
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
+        void Run() override
+        {
+            CCheckQueue* q = queue;
+            if (q->fAllOk.load(std::memory_order_relaxed) && !check())
+                q->fAllOk.store(false, std::memory_order_relaxed);
+            {
+                // Free what the check holds on this thread, before it counts as done
+                T empty;
+                empty.swap(check);
+            }
+            q->Done();
+        }
+    };
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
+    //! Scheduler created for this queue, if it was not given one
+    std::unique_ptr<CCheckScheduler> schedulerOwned;
+    CCheckScheduler& scheduler;
 
-    //! The total number of workers (including the master).
-    int nTotal;
+    //! The master's deque
+    CCheckDeque* deque;
 
-    //! The temporary evaluation result.
-    bool fAllOk;
+    //! Storage for the tasks of the current round. Master only; elements never move.
+    std::deque<Task> tasks;
 
-    /**
-     * Number of verifications that haven't completed yet.
-     * This includes elements that are no longer queued, but still in the
-     * worker's own batches.
-     */
-    unsigned int nTodo;
+    //! Number of verifications that haven't completed yet.
+    std::atomic<unsigned int> nTodo;
 
-    //! Whether we're shutting down.
-    bool fQuit;
+    //! The temporary evaluation result.
+    std::atomic<bool> fAllOk;
 
-    //! The maximum number of elements to be processed in one batch
-    unsigned int nBatchSize;
+    //! Master thread blocks on this when out of work
+    boost::mutex mutex;
+    boost::condition_variable condMaster;
 
-    /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster = false)
+    void Done()
     {
-        boost::condition_variable& cond = fMaster ? condMaster : condWorker;
-        std::vector<T> vChecks;
-        vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
-        do {
-            {
-                boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if ((fMaster || fQuit) && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
-                }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
-            }
-            // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
-        } while (true);
+        if (nTodo.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            condMaster.notify_one();
+        }
     }
 
 public:
     //! Mutex to ensure only one concurrent CCheckQueueControl
     boost::mutex ControlMutex;
 
-    //! Create a new check queue
-    CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), fQuit(false), nBatchSize(nBatchSizeIn) {}
+    //! Create a new check queue with its own scheduler, run by Thread().
+    //! At most nBatchSizeIn checks are taken from the master at once.
+    explicit CCheckQueue(unsigned int nBatchSizeIn) : schedulerOwned(new CCheckScheduler()), scheduler(*schedulerOwned), nTodo(0), fAllOk(true)
+    {
+        deque = scheduler.AcquireDeque(nBatchSizeIn, false);
+    }
+
+    //! Create a new check queue whose checks are run by the workers of schedulerIn.
+    CCheckQueue(unsigned int nBatchSizeIn, CCheckScheduler& schedulerIn) : scheduler(schedulerIn), nTodo(0), fAllOk(true)
+    {
+        deque = scheduler.AcquireDeque(nBatchSizeIn, false);
+    }
 
     //! Worker thread
     void Thread()
     {
-        Loop();
+        scheduler.Thread();
     }
 
     //! Wait until execution finishes, and return whether all evaluations were successful.
     bool Wait()
     {
-        return Loop(true);
+        uint32_t rand = (uint32_t)(uintptr_t)deque | 1;
+        int nRounds = 0;
+        while (nTodo.load(std::memory_order_acquire) != 0) {
+            CCheckTask* task = deque->Pop();
+            if (task == nullptr)
+                task = scheduler.Steal(deque, rand);
+            if (task != nullptr) {
+                task->Run();
+                nRounds = 0;
+                continue;
+            }
+            if (++nRounds < CCheckScheduler::SPIN_ROUNDS) {
+                std::this_thread::yield();
+                continue;
+            }
+            // Whatever is left is being run by the workers
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (nTodo.load(std::memory_order_acquire) != 0)
+                condMaster.wait(lock);
+        }
+        tasks.clear();
+        bool fRet = fAllOk.load(std::memory_order_relaxed);
+        // reset the status for new work later
+        fAllOk.store(true, std::memory_order_relaxed);
+        return fRet;
     }
 
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
+        nTodo.fetch_add(vChecks.size(), std::memory_order_relaxed);
         for (T& check : vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
+            tasks.emplace_back(this);
+            check.swap(tasks.back().check);
+            deque->Push(&tasks.back());
         }
-        nTodo += vChecks.size();
-        if (vChecks.size() == 1)
-            condWorker.notify_one();
-        else if (vChecks.size() > 1)
-            condWorker.notify_all();
+        scheduler.Notify(vChecks.size());
     }
 
     ~CCheckQueue()
     {
+        scheduler.ReleaseDeque(deque);
     }
 
 };
 
-/** 
+/**
  * RAII-style controller object for a CCheckQueue that guarantees the passed
  * queue is finished before continuing.
  */
@@ -11,6 +11,7 @@
 #include "core_memusage.h"
 #include "hash.h"
 #include "memusage.h"
+#include "pooledmap.h"
 #include "serialize.h"
 #include "uint256.h"
 
@@ -125,7 +126,7 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+typedef pooledmap<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -249,6 +250,13 @@ public:
      */
     const Coin& AccessCoin(const COutPoint &output) const;
 
+    /**
+     * Cache a coin the caller read from the backing view itself, the way
+     * AccessCoin would have on a miss. Does nothing if the outpoint already has
+     * an entry, so a stale read can never replace a more recent version.
+     */
+    void CacheFetchedCoin(const COutPoint &outpoint, Coin&& coin);
+
     /**
      * Add a coin. Set potential_overwrite to true if a non-pruned version may
      * already exist.
@@ -69,6 +69,9 @@ struct Params {
     int nFirstMPoSBlock;
     int nMPoSRewardRecipients;
     int nFixUTXOCacheHFHeight;
+    /** Block height at which x86 contract executions read state written by their callers, only spend the sender's
+     *  AAL output on successful transfers and order condensing vouts strictly by address */
+    int nFixX86StateHFHeight;
 };
 } // namespace Consensus
 
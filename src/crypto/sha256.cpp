@@ -10,13 +10,26 @@
 #include <atomic>
 
 #if defined(__x86_64__) || defined(__amd64__)
-#if defined(EXPERIMENTAL_ASM)
 #include <cpuid.h>
+#if defined(EXPERIMENTAL_ASM)
 namespace sha256_sse4
 {
 void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
 }
 #endif
+#if defined(ENABLE_SHANI) && !defined(BUILD_BITCOIN_INTERNAL)
+namespace sha256_shani
+{
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
+void Transform_2way(unsigned char* out, const unsigned char* in);
+}
+#endif
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+namespace sha256d64_avx2
+{
+void Transform_8way(unsigned char* out, const unsigned char* in);
+}
+#endif
 #endif
 
 // Internal implementation code.
@@ -172,23 +185,139 @@ bool SelfTest(TransformType tr) {
     return true;
 }
 
+typedef void (*TransformD64Type)(unsigned char*, const unsigned char*);
+
+/** Double-SHA256 of a single 64-byte input, using a given single-block transform. */
+template<TransformType tr>
+void TransformD64Wrapper(unsigned char* out, const unsigned char* in)
+{
+    // The second block of the first hash is the padding of a 64-byte message.
+    static const unsigned char padding1[64] = {
+        0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0
+    };
+    // The second hash is over 32 bytes, padded to a single block.
+    unsigned char buffer2[64] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0
+    };
+    uint32_t s[8];
+    sha256::Initialize(s);
+    tr(s, in, 1);
+    tr(s, padding1, 1);
+    for (int i = 0; i < 8; ++i) {
+        WriteBE32(buffer2 + 4 * i, s[i]);
+    }
+    sha256::Initialize(s);
+    tr(s, buffer2, 1);
+    for (int i = 0; i < 8; ++i) {
+        WriteBE32(out + 4 * i, s[i]);
+    }
+}
+
 TransformType Transform = sha256::Transform;
+TransformD64Type TransformD64 = TransformD64Wrapper<sha256::Transform>;
+TransformD64Type TransformD64_2way = nullptr;
+TransformD64Type TransformD64_8way = nullptr;
+
+/** Check the multi-way double-SHA256 implementations against the generic one. */
+bool SelfTestD64()
+{
+    unsigned char in[64 * 8];
+    unsigned char expected[32 * 8];
+    unsigned char out[32 * 8];
+    for (size_t i = 0; i < sizeof(in); ++i) {
+        in[i] = (unsigned char)(i * 7 + (i >> 6));
+    }
+    for (int i = 0; i < 8; ++i) {
+        TransformD64Wrapper<sha256::Transform>(expected + 32 * i, in + 64 * i);
+    }
+    for (int i = 0; i < 8; ++i) {
+        TransformD64(out + 32 * i, in + 64 * i);
+    }
+    if (memcmp(out, expected, sizeof(out))) return false;
+    if (TransformD64_2way) {
+        memset(out, 0, sizeof(out));
+        for (int i = 0; i < 8; i += 2) {
+            TransformD64_2way(out + 32 * i, in + 64 * i);
+        }
+        if (memcmp(out, expected, sizeof(out))) return false;
+    }
+    if (TransformD64_8way) {
+        memset(out, 0, sizeof(out));
+        TransformD64_8way(out, in);
+        if (memcmp(out, expected, sizeof(out))) return false;
+    }
+    return true;
+}
+
+#if defined(__x86_64__) || defined(__amd64__)
+/** Check whether the OS saves the AVX registers on context switches. */
+bool AVXEnabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+#endif
 
 } // namespace
 
 std::string SHA256AutoDetect()
 {
-#if defined(EXPERIMENTAL_ASM) && (defined(__x86_64__) || defined(__amd64__))
+    std::string ret = "standard";
+#if defined(__x86_64__) || defined(__amd64__)
     uint32_t eax, ebx, ecx, edx;
-    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx >> 19) & 1) {
+    bool have_sse4 = false;
+    bool have_avx = false;
+    bool have_avx2 = false;
+    bool have_shani = false;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        have_sse4 = (ecx >> 19) & 1;
+        // AVX also needs XSAVE support and the OS having enabled the YMM state.
+        have_avx = ((ecx >> 27) & 1) && ((ecx >> 28) & 1) && AVXEnabled();
+    }
+    if (have_sse4 && __get_cpuid_max(0, nullptr) >= 7) {
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+        have_shani = (ebx >> 29) & 1;
+    }
+    (void)have_sse4;
+    (void)have_avx;
+    (void)have_avx2;
+    (void)have_shani;
+
+#if defined(ENABLE_SHANI) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_shani) {
+        // The SHA extensions beat the SSE4 and AVX2 code, also for many hashes in parallel.
+        Transform = sha256_shani::Transform;
+        TransformD64 = TransformD64Wrapper<sha256_shani::Transform>;
+        TransformD64_2way = sha256_shani::Transform_2way;
+        ret = "shani(1way,2way)";
+        have_sse4 = false;
+        have_avx2 = false;
+    }
+#endif
+
+#if defined(EXPERIMENTAL_ASM)
+    if (have_sse4) {
         Transform = sha256_sse4::Transform;
-        assert(SelfTest(Transform));
-        return "sse4";
+        TransformD64 = TransformD64Wrapper<sha256_sse4::Transform>;
+        ret = "sse4(1way)";
     }
 #endif
 
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx2 && have_avx) {
+        TransformD64_8way = sha256d64_avx2::Transform_8way;
+        ret += ",avx2(8way)";
+    }
+#endif
+#endif
+
     assert(SelfTest(Transform));
-    return "standard";
+    assert(SelfTestD64());
+    return ret;
 }
 
 ////// SHA-256
@@ -247,3 +376,29 @@ CSHA256& CSHA256::Reset()
     sha256::Initialize(s);
     return *this;
 }
+
+void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
+{
+    if (TransformD64_8way) {
+        while (blocks >= 8) {
+            TransformD64_8way(out, in);
+            out += 256;
+            in += 512;
+            blocks -= 8;
+        }
+    }
+    if (TransformD64_2way) {
+        while (blocks >= 2) {
+            TransformD64_2way(out, in);
+            out += 64;
+            in += 128;
+            blocks -= 2;
+        }
+    }
+    while (blocks) {
+        TransformD64(out, in);
+        out += 32;
+        in += 64;
+        --blocks;
+    }
+}
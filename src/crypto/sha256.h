@@ -9,7 +9,12 @@
 #include <stdlib.h>
 #include <string>
 
-/** A hasher class for SHA-256. */
+/** A hasher class for SHA-256.
+ *  Blocks are processed by the single-block transform picked by SHA256AutoDetect
+ *  (SHA-NI when available), so everything hashing one message at a time, like
+ *  txids, block hashes and the x86 SHA256 syscall, uses it. The multi-lane
+ *  backends only hash independent 64-byte inputs, see SHA256D64.
+ */
 class CSHA256
 {
 private:
@@ -31,4 +36,12 @@ public:
  */
 std::string SHA256AutoDetect();
 
+/** Compute multiple double-SHA256's of 64-byte blobs.
+ *  output:  pointer to a blocks*32 byte output buffer
+ *  input:   pointer to a blocks*64 byte input buffer
+ *  blocks:  the number of hashes to compute.
+ *  The output may overlap the input, as long as it does not start after it.
+ */
+void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
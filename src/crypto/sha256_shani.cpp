@@ -0,0 +1,260 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// SHA-256 using the Intel SHA extensions, based on the public domain
+// https://github.com/noloader/SHA-Intrinsics/blob/master/sha256-x86.c.
+
+#ifdef ENABLE_SHANI
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <immintrin.h>
+
+namespace {
+
+alignas(16) const uint32_t K[64] = {
+    0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+    0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+    0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+    0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+    0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+    0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+    0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+    0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul,
+};
+
+alignas(16) const uint32_t INIT[8] = {0x6a09e667ul, 0xbb67ae85ul, 0x3c6ef372ul, 0xa54ff53aul, 0x510e527ful, 0x9b05688cul, 0x1f83d9abul, 0x5be0cd19ul};
+
+/** Message words of the padding block of a 64-byte message. */
+alignas(16) const uint32_t PADDING64[16] = {0x80000000ul, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 512};
+
+/** Message words 8..15 of a padded 32-byte message. */
+alignas(16) const uint32_t PADDING32[8] = {0x80000000ul, 0, 0, 0, 0, 0, 0, 256};
+
+/** Byte order swap within each 32-bit word. */
+alignas(16) const uint8_t MASK[16] = {0x03, 0x02, 0x01, 0x00, 0x07, 0x06, 0x05, 0x04, 0x0b, 0x0a, 0x09, 0x08, 0x0f, 0x0e, 0x0d, 0x0c};
+
+/** Four rounds. state0 holds ABEF and state1 CDGH; k is the offset of the round constants. */
+void inline __attribute__((always_inline)) QuadRound(__m128i& state0, __m128i& state1, __m128i m, int k)
+{
+    const __m128i msg = _mm_add_epi32(m, _mm_load_si128((const __m128i*)(K + k)));
+    state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+    state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0e));
+}
+
+/** First half of the message expansion: m0 = sigma0 part of the words four groups later. */
+void inline __attribute__((always_inline)) ShiftMessageA(__m128i& m0, __m128i m1)
+{
+    m0 = _mm_sha256msg1_epu32(m0, m1);
+}
+
+/** Second half of the message expansion: finish m given the two groups before it. */
+void inline __attribute__((always_inline)) ShiftMessageC(__m128i& m, __m128i prev, __m128i prev2)
+{
+    m = _mm_sha256msg2_epu32(_mm_add_epi32(m, _mm_alignr_epi8(prev, prev2, 4)), prev);
+}
+
+/** Convert the state from ABCD/EFGH to the ABEF/CDGH layout used by the SHA instructions. */
+void inline __attribute__((always_inline)) Shuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0xB1);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0x1B);
+    s0 = _mm_alignr_epi8(t1, t2, 0x08);
+    s1 = _mm_blend_epi16(t2, t1, 0xF0);
+}
+
+/** Inverse of Shuffle. */
+void inline __attribute__((always_inline)) Unshuffle(__m128i& s0, __m128i& s1)
+{
+    const __m128i t1 = _mm_shuffle_epi32(s0, 0x1B);
+    const __m128i t2 = _mm_shuffle_epi32(s1, 0xB1);
+    s0 = _mm_blend_epi16(t1, t2, 0xF0);
+    s1 = _mm_alignr_epi8(t2, t1, 0x08);
+}
+
+__m128i inline __attribute__((always_inline)) Load(const unsigned char* in)
+{
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)in), _mm_load_si128((const __m128i*)MASK));
+}
+
+void inline __attribute__((always_inline)) Save(unsigned char* out, __m128i s)
+{
+    _mm_storeu_si128((__m128i*)out, _mm_shuffle_epi8(s, _mm_load_si128((const __m128i*)MASK)));
+}
+
+/** Process one block given as message words m0..m3, and add the result into the state. */
+void inline __attribute__((always_inline)) Compress(__m128i& s0, __m128i& s1, __m128i m0, __m128i m1, __m128i m2, __m128i m3)
+{
+    const __m128i so0 = s0;
+    const __m128i so1 = s1;
+    QuadRound(s0, s1, m0, 0);
+    QuadRound(s0, s1, m1, 4);
+    QuadRound(s0, s1, m2, 8);
+    ShiftMessageA(m0, m1);
+    QuadRound(s0, s1, m3, 12);
+    ShiftMessageA(m1, m2);
+    for (int k = 16; k < 48; k += 16) {
+        ShiftMessageC(m0, m3, m2);
+        QuadRound(s0, s1, m0, k);
+        ShiftMessageA(m2, m3);
+        ShiftMessageC(m1, m0, m3);
+        QuadRound(s0, s1, m1, k + 4);
+        ShiftMessageA(m3, m0);
+        ShiftMessageC(m2, m1, m0);
+        QuadRound(s0, s1, m2, k + 8);
+        ShiftMessageA(m0, m1);
+        ShiftMessageC(m3, m2, m1);
+        QuadRound(s0, s1, m3, k + 12);
+        ShiftMessageA(m1, m2);
+    }
+    ShiftMessageC(m0, m3, m2);
+    QuadRound(s0, s1, m0, 48);
+    ShiftMessageA(m2, m3);
+    ShiftMessageC(m1, m0, m3);
+    QuadRound(s0, s1, m1, 52);
+    ShiftMessageA(m3, m0);
+    ShiftMessageC(m2, m1, m0);
+    QuadRound(s0, s1, m2, 56);
+    ShiftMessageC(m3, m2, m1);
+    QuadRound(s0, s1, m3, 60);
+    s0 = _mm_add_epi32(s0, so0);
+    s1 = _mm_add_epi32(s1, so1);
+}
+
+/** Compress for two independent states at once, so the dependency chains of both overlap. */
+void inline __attribute__((always_inline)) Compress2(__m128i& as0, __m128i& as1, __m128i& bs0, __m128i& bs1,
+    __m128i am0, __m128i am1, __m128i am2, __m128i am3, __m128i bm0, __m128i bm1, __m128i bm2, __m128i bm3)
+{
+    const __m128i aso0 = as0, aso1 = as1;
+    const __m128i bso0 = bs0, bso1 = bs1;
+    QuadRound(as0, as1, am0, 0);
+    QuadRound(bs0, bs1, bm0, 0);
+    QuadRound(as0, as1, am1, 4);
+    QuadRound(bs0, bs1, bm1, 4);
+    QuadRound(as0, as1, am2, 8);
+    QuadRound(bs0, bs1, bm2, 8);
+    ShiftMessageA(am0, am1);
+    ShiftMessageA(bm0, bm1);
+    QuadRound(as0, as1, am3, 12);
+    QuadRound(bs0, bs1, bm3, 12);
+    ShiftMessageA(am1, am2);
+    ShiftMessageA(bm1, bm2);
+    for (int k = 16; k < 48; k += 16) {
+        ShiftMessageC(am0, am3, am2);
+        ShiftMessageC(bm0, bm3, bm2);
+        QuadRound(as0, as1, am0, k);
+        QuadRound(bs0, bs1, bm0, k);
+        ShiftMessageA(am2, am3);
+        ShiftMessageA(bm2, bm3);
+        ShiftMessageC(am1, am0, am3);
+        ShiftMessageC(bm1, bm0, bm3);
+        QuadRound(as0, as1, am1, k + 4);
+        QuadRound(bs0, bs1, bm1, k + 4);
+        ShiftMessageA(am3, am0);
+        ShiftMessageA(bm3, bm0);
+        ShiftMessageC(am2, am1, am0);
+        ShiftMessageC(bm2, bm1, bm0);
+        QuadRound(as0, as1, am2, k + 8);
+        QuadRound(bs0, bs1, bm2, k + 8);
+        ShiftMessageA(am0, am1);
+        ShiftMessageA(bm0, bm1);
+        ShiftMessageC(am3, am2, am1);
+        ShiftMessageC(bm3, bm2, bm1);
+        QuadRound(as0, as1, am3, k + 12);
+        QuadRound(bs0, bs1, bm3, k + 12);
+        ShiftMessageA(am1, am2);
+        ShiftMessageA(bm1, bm2);
+    }
+    ShiftMessageC(am0, am3, am2);
+    ShiftMessageC(bm0, bm3, bm2);
+    QuadRound(as0, as1, am0, 48);
+    QuadRound(bs0, bs1, bm0, 48);
+    ShiftMessageA(am2, am3);
+    ShiftMessageA(bm2, bm3);
+    ShiftMessageC(am1, am0, am3);
+    ShiftMessageC(bm1, bm0, bm3);
+    QuadRound(as0, as1, am1, 52);
+    QuadRound(bs0, bs1, bm1, 52);
+    ShiftMessageA(am3, am0);
+    ShiftMessageA(bm3, bm0);
+    ShiftMessageC(am2, am1, am0);
+    ShiftMessageC(bm2, bm1, bm0);
+    QuadRound(as0, as1, am2, 56);
+    QuadRound(bs0, bs1, bm2, 56);
+    ShiftMessageC(am3, am2, am1);
+    ShiftMessageC(bm3, bm2, bm1);
+    QuadRound(as0, as1, am3, 60);
+    QuadRound(bs0, bs1, bm3, 60);
+    as0 = _mm_add_epi32(as0, aso0);
+    as1 = _mm_add_epi32(as1, aso1);
+    bs0 = _mm_add_epi32(bs0, bso0);
+    bs1 = _mm_add_epi32(bs1, bso1);
+}
+
+void inline __attribute__((always_inline)) LoadInit(__m128i& s0, __m128i& s1)
+{
+    s0 = _mm_load_si128((const __m128i*)INIT);
+    s1 = _mm_load_si128((const __m128i*)(INIT + 4));
+    Shuffle(s0, s1);
+}
+
+__m128i inline __attribute__((always_inline)) LoadWords(const uint32_t* words)
+{
+    return _mm_load_si128((const __m128i*)words);
+}
+
+} // namespace
+
+namespace sha256_shani
+{
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    __m128i s0 = _mm_loadu_si128((const __m128i*)s);
+    __m128i s1 = _mm_loadu_si128((const __m128i*)(s + 4));
+    Shuffle(s0, s1);
+
+    while (blocks--) {
+        Compress(s0, s1, Load(chunk), Load(chunk + 16), Load(chunk + 32), Load(chunk + 48));
+        chunk += 64;
+    }
+
+    Unshuffle(s0, s1);
+    _mm_storeu_si128((__m128i*)s, s0);
+    _mm_storeu_si128((__m128i*)(s + 4), s1);
+}
+
+void Transform_2way(unsigned char* out, const unsigned char* in)
+{
+    __m128i as0, as1, bs0, bs1;
+
+    // First hash: the 64-byte input, followed by its padding block.
+    LoadInit(as0, as1);
+    LoadInit(bs0, bs1);
+    Compress2(as0, as1, bs0, bs1,
+        Load(in), Load(in + 16), Load(in + 32), Load(in + 48),
+        Load(in + 64), Load(in + 80), Load(in + 96), Load(in + 112));
+    Compress2(as0, as1, bs0, bs1,
+        LoadWords(PADDING64), LoadWords(PADDING64 + 4), LoadWords(PADDING64 + 8), LoadWords(PADDING64 + 12),
+        LoadWords(PADDING64), LoadWords(PADDING64 + 4), LoadWords(PADDING64 + 8), LoadWords(PADDING64 + 12));
+
+    // Second hash: the 32-byte first hash is the first half of a single padded block.
+    Unshuffle(as0, as1);
+    Unshuffle(bs0, bs1);
+    __m128i am0 = as0, am1 = as1, bm0 = bs0, bm1 = bs1;
+    LoadInit(as0, as1);
+    LoadInit(bs0, bs1);
+    Compress2(as0, as1, bs0, bs1,
+        am0, am1, LoadWords(PADDING32), LoadWords(PADDING32 + 4),
+        bm0, bm1, LoadWords(PADDING32), LoadWords(PADDING32 + 4));
+
+    Unshuffle(as0, as1);
+    Unshuffle(bs0, bs1);
+    Save(out, as0);
+    Save(out + 16, as1);
+    Save(out + 32, bs0);
+    Save(out + 48, bs1);
+}
+}
+
+#endif
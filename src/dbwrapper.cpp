@@ -14,6 +14,8 @@
 #include <memenv.h>
 #include <stdint.h>
 #include <algorithm>
+#include <exception>
+#include <numeric>
 
 class CBitcoinLevelDBLogger : public leveldb::Logger {
 public:
@@ -155,6 +157,174 @@ CDBWrapper::~CDBWrapper()
     options.env = nullptr;
 }
 
+CDBSnapshot::CDBSnapshot(const CDBWrapper &_parent) : parent(_parent)
+{
+    snapshot = parent.pdb->GetSnapshot();
+    readoptions = parent.readoptions;
+    readoptions.snapshot = snapshot;
+}
+
+CDBSnapshot::~CDBSnapshot()
+{
+    parent.pdb->ReleaseSnapshot(snapshot);
+}
+
+CDBReadPool dbReadPool;
+
+//! Whether the current thread is one of the read pool's
+static thread_local bool fReadPoolThread = false;
+
+void CDBReadPool::Start(int threads)
+{
+    Stop();
+    std::unique_lock<std::mutex> lock(cs);
+    fStop = false;
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back(&TraceThread<std::function<void()>>, "dbread", std::function<void()>(std::bind(&CDBReadPool::ThreadRead, this)));
+    }
+}
+
+void CDBReadPool::Stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        fStop = true;
+        cond.notify_all();
+    }
+    for (std::thread& worker : workers) {
+        if (worker.joinable())
+            worker.join();
+    }
+    std::unique_lock<std::mutex> lock(cs);
+    workers.clear();
+}
+
+int CDBReadPool::Concurrency()
+{
+    if (fReadPoolThread)
+        return 1;
+    std::unique_lock<std::mutex> lock(cs);
+    return fStop ? 1 : workers.size() + 1;
+}
+
+bool CDBReadPool::Enqueue(std::function<void()>&& job)
+{
+    if (fReadPoolThread)
+        return false;
+    std::unique_lock<std::mutex> lock(cs);
+    if (fStop || workers.empty())
+        return false;
+    queue.push_back(std::move(job));
+    cond.notify_one();
+    return true;
+}
+
+void CDBReadPool::ThreadRead()
+{
+    fReadPoolThread = true;
+    std::unique_lock<std::mutex> lock(cs);
+    while (true) {
+        while (!fStop && queue.empty()) {
+            cond.wait(lock);
+        }
+        // Jobs already queued still run, someone is waiting for them
+        if (queue.empty())
+            return;
+        std::function<void()> job = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
+
+//! Minimum number of keys worth handing to another thread in ReadMany
+static const size_t READMANY_MIN_RUN = 16;
+//! Number of steps the iterator of a ReadMany run takes forward before seeking instead
+static const int READMANY_MAX_NEXT = 8;
+
+void CDBWrapper::ReadRaw(const std::vector<CDataStream>& keys, std::vector<std::string>& values, std::vector<char>& found, bool fSeek) const
+{
+    values.assign(keys.size(), std::string());
+    found.assign(keys.size(), 0);
+    if (keys.empty())
+        return;
+
+    std::vector<leveldb::Slice> vSlices;
+    vSlices.reserve(keys.size());
+    for (const CDataStream& key : keys) {
+        vSlices.emplace_back(key.data(), key.size());
+    }
+    std::vector<size_t> vOrder(keys.size());
+    std::iota(vOrder.begin(), vOrder.end(), 0);
+    std::sort(vOrder.begin(), vOrder.end(), [&vSlices](size_t a, size_t b) { return vSlices[a].compare(vSlices[b]) < 0; });
+
+    // All runs read from the same state of the database
+    const leveldb::Snapshot* snapshot = pdb->GetSnapshot();
+    leveldb::ReadOptions options = readoptions;
+    options.snapshot = snapshot;
+
+    auto readRun = [&](size_t nBegin, size_t nEnd) {
+        if (!fSeek) {
+            for (size_t n = nBegin; n < nEnd; n++) {
+                size_t i = vOrder[n];
+                leveldb::Status status = pdb->Get(options, vSlices[i], &values[i]);
+                if (!status.ok()) {
+                    if (status.IsNotFound())
+                        continue;
+                    LogPrintf("LevelDB read failure: %s\n", status.ToString());
+                    dbwrapper_private::HandleError(status);
+                }
+                found[i] = 1;
+            }
+            return;
+        }
+        std::unique_ptr<leveldb::Iterator> it(pdb->NewIterator(options));
+        for (size_t n = nBegin; n < nEnd; n++) {
+            size_t i = vOrder[n];
+            const leveldb::Slice& key = vSlices[i];
+            int nNext = 0;
+            while (it->Valid() && it->key().compare(key) < 0 && nNext < READMANY_MAX_NEXT) {
+                it->Next();
+                nNext++;
+            }
+            if (!it->Valid() ? nNext == 0 : it->key().compare(key) < 0)
+                it->Seek(key);
+            if (it->Valid() && it->key() == key) {
+                values[i].assign(it->value().data(), it->value().size());
+                found[i] = 1;
+            }
+        }
+        dbwrapper_private::HandleError(it->status());
+    };
+
+    size_t nRuns = std::max<size_t>(1, std::min<size_t>(dbReadPool.Concurrency(), keys.size() / READMANY_MIN_RUN));
+    size_t nRunSize = (keys.size() + nRuns - 1) / nRuns;
+    std::vector<std::future<void>> vRuns;
+    for (size_t nBegin = nRunSize; nBegin < keys.size(); nBegin += nRunSize) {
+        size_t nEnd = std::min(keys.size(), nBegin + nRunSize);
+        vRuns.push_back(dbReadPool.Submit([&readRun, nBegin, nEnd]() { readRun(nBegin, nEnd); }));
+    }
+    // The other runs refer to this frame, so wait for all of them before passing on an error
+    std::exception_ptr error;
+    try {
+        readRun(0, std::min(keys.size(), nRunSize));
+    } catch (...) {
+        error = std::current_exception();
+    }
+    for (std::future<void>& run : vRuns) {
+        try {
+            run.get();
+        } catch (...) {
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+    pdb->ReleaseSnapshot(snapshot);
+    if (error)
+        std::rethrow_exception(error);
+}
+
 bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
 {
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
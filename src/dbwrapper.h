@@ -13,12 +13,25 @@
 #include "utilstrencodings.h"
 #include "version.h"
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 
+//! -dbreadthreads default (number of threads reading from the databases for ReadMany and ReadAsync)
+static const int DEFAULT_DB_READ_THREADS = 4;
+static const int MAX_DB_READ_THREADS = 32;
+
 class dbwrapper_error : public std::runtime_error
 {
 public:
@@ -173,9 +186,54 @@ public:
 
 };
 
+/**
+ * Small pool of threads for database reads, so that lookups which don't depend
+ * on each other can wait for the disk at the same time.
+ * Jobs submitted while the pool is not running, or from one of its own threads,
+ * are run on the submitting thread instead.
+ */
+class CDBReadPool
+{
+private:
+    std::mutex cs;
+    std::condition_variable cond;
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> queue;
+    bool fStop;
+
+    void ThreadRead();
+    //! Queue a job, returns false if it has to be run by the caller
+    bool Enqueue(std::function<void()>&& job);
+
+public:
+    CDBReadPool() : fStop(false) {}
+    ~CDBReadPool() { Stop(); }
+
+    void Start(int threads);
+    //! Runs the jobs still queued, then stops the threads
+    void Stop();
+
+    //! Number of threads that can take part in a read right now, including the caller
+    int Concurrency();
+
+    template <typename F>
+    std::future<typename std::result_of<F()>::type> Submit(F job)
+    {
+        typedef typename std::result_of<F()>::type R;
+        std::shared_ptr<std::packaged_task<R()>> task = std::make_shared<std::packaged_task<R()>>(std::move(job));
+        std::future<R> ret = task->get_future();
+        if (!Enqueue([task]{ (*task)(); }))
+            (*task)();
+        return ret;
+    }
+};
+
+extern CDBReadPool dbReadPool;
+
 class CDBWrapper
 {
     friend const std::vector<unsigned char>& dbwrapper_private::GetObfuscateKey(const CDBWrapper &w);
+    friend class CDBSnapshot;
 private:
     //! custom environment this database is using (may be nullptr in case of default environment)
     leveldb::Env* penv;
@@ -209,6 +267,42 @@ private:
 
     std::vector<unsigned char> CreateObfuscateKey() const;
 
+    //! look up serialized keys, from the read pool if it is running
+    void ReadRaw(const std::vector<CDataStream>& keys, std::vector<std::string>& values, std::vector<char>& found, bool fSeek) const;
+
+    template <typename V>
+    bool DeserializeValue(const std::string& strValue, V& value) const
+    {
+        try {
+            CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue.Xor(obfuscate_key);
+            ssValue >> value;
+        } catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+
+    //! read key at the given options, which may carry a snapshot
+    template <typename K, typename V>
+    bool Read(const leveldb::ReadOptions& options, const K& key, V& value) const
+    {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey << key;
+        leveldb::Slice slKey(ssKey.data(), ssKey.size());
+
+        std::string strValue;
+        leveldb::Status status = pdb->Get(options, slKey, &strValue);
+        if (!status.ok()) {
+            if (status.IsNotFound())
+                return false;
+            LogPrintf("LevelDB read failure: %s\n", status.ToString());
+            dbwrapper_private::HandleError(status);
+        }
+        return DeserializeValue(strValue, value);
+    }
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
@@ -224,27 +318,68 @@ public:
     template <typename K, typename V>
     bool Read(const K& key, V& value) const
     {
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
-        ssKey << key;
-        leveldb::Slice slKey(ssKey.data(), ssKey.size());
+        return Read(readoptions, key, value);
+    }
 
-        std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
-        if (!status.ok()) {
-            if (status.IsNotFound())
-                return false;
-            LogPrintf("LevelDB read failure: %s\n", status.ToString());
-            dbwrapper_private::HandleError(status);
+    /**
+     * Read several keys at once, from one consistent state of the database.
+     * values[i] and found[i] are set for keys[i]; returns the number of keys found.
+     * The keys are looked up in sorted order, split in runs read concurrently
+     * on the read pool.
+     * @param[in] fSeek  Walk each run with one iterator instead of point lookups.
+     *                   Neighbouring keys then share LevelDB blocks, which pays off
+     *                   when the keys are clustered, e.g. share a prefix. Point
+     *                   lookups use the bloom filters, which is better for keys
+     *                   spread over the whole database.
+     */
+    template <typename K, typename V>
+    size_t ReadMany(const std::vector<K>& keys, std::vector<V>& values, std::vector<bool>& found, bool fSeek = false) const
+    {
+        std::vector<CDataStream> vKeys;
+        vKeys.reserve(keys.size());
+        for (const K& key : keys) {
+            vKeys.emplace_back(SER_DISK, CLIENT_VERSION);
+            vKeys.back().reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+            vKeys.back() << key;
         }
-        try {
-            CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
-            ssValue.Xor(obfuscate_key);
-            ssValue >> value;
-        } catch (const std::exception&) {
-            return false;
+        std::vector<std::string> vValues;
+        std::vector<char> vFound;
+        ReadRaw(vKeys, vValues, vFound, fSeek);
+
+        size_t nFound = 0;
+        values.resize(keys.size());
+        found.assign(keys.size(), false);
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (vFound[i] && DeserializeValue(vValues[i], values[i])) {
+                found[i] = true;
+                nFound++;
+            }
         }
-        return true;
+        return nFound;
+    }
+
+    /**
+     * Read key on the read pool. The future returns what Read would, and value
+     * is set when it is ready, so value must outlive it.
+     */
+    template <typename K, typename V>
+    std::future<bool> ReadAsync(const K& key, V& value) const
+    {
+        std::shared_ptr<CDataStream> ssKey = std::make_shared<CDataStream>(SER_DISK, CLIENT_VERSION);
+        ssKey->reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        *ssKey << key;
+        return dbReadPool.Submit([this, ssKey, &value]() {
+            leveldb::Slice slKey(ssKey->data(), ssKey->size());
+            std::string strValue;
+            leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+            if (!status.ok()) {
+                if (status.IsNotFound())
+                    return false;
+                LogPrintf("LevelDB read failure: %s\n", status.ToString());
+                dbwrapper_private::HandleError(status);
+            }
+            return DeserializeValue(strValue, value);
+        });
     }
 
     template <typename K, typename V>
@@ -340,4 +475,30 @@ public:
 
 };
 
+/**
+ * Read-only view of a CDBWrapper as it was when the snapshot was taken.
+ * Writes made to the database afterwards are not visible through it.
+ * Must be destroyed before the CDBWrapper it was taken from.
+ */
+class CDBSnapshot
+{
+private:
+    const CDBWrapper &parent;
+    const leveldb::Snapshot *snapshot;
+    leveldb::ReadOptions readoptions;
+
+public:
+    explicit CDBSnapshot(const CDBWrapper &_parent);
+    ~CDBSnapshot();
+
+    CDBSnapshot(const CDBSnapshot&) = delete;
+    CDBSnapshot& operator=(const CDBSnapshot&) = delete;
+
+    template <typename K, typename V>
+    bool Read(const K& key, V& value) const
+    {
+        return parent.Read(readoptions, key, value);
+    }
+};
+
 #endif // BITCOIN_DBWRAPPER_H
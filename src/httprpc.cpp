@@ -7,6 +7,8 @@
 #include "base58.h"
 #include "chainparams.h"
 #include "httpserver.h"
+#include "qtum/contractcallpool.h"
+#include "rpc/jsonstream.h"
 #include "rpc/protocol.h"
 #include "rpc/server.h"
 #include "random.h"
@@ -17,6 +19,8 @@
 #include "crypto/hmac_sha256.h"
 #include <stdio.h>
 
+#include <algorithm>
+
 #include <boost/algorithm/string.hpp> // boost::trim
 
 /** WWW-Authenticate to present with 401 Unauthorized response */
@@ -193,6 +197,12 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 
             UniValue result = tableRPC.execute(jreq);
 
+            // Reply was serialized by the handler, and is sent now that it released its locks
+            if (jreq.isStreamed) {
+                HTTPReplyJSONPieces(req, std::move(jreq.vStreamedReply));
+                return true;
+            }
+
             if (jreq.isLongPolling) {
                 jreq.PollReply(result);
                 return true;
@@ -219,6 +229,40 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
     return true;
 }
 
+/** Pick the worker pool for a JSON-RPC request from the methods it calls.
+ * The body is only scanned for "method" keys, as it is parsed on the worker anyway.
+ * A batch runs on the pool of its slowest method.
+ */
+static HTTPWorkClass JSONRPCWorkClass(HTTPRequest* req, const std::string &)
+{
+    std::pair<const char*, size_t> body = req->PeekBody();
+    if (!body.first)
+        return HTTP_WORK_DEFAULT;
+    const std::string key = "\"method\"";
+    const char* pend = body.first + body.second;
+    bool fFound = false;
+    bool fAllSnapshot = true;
+    for (const char* p = std::search(body.first, pend, key.begin(), key.end()); p != pend; p = std::search(p, pend, key.begin(), key.end())) {
+        p += key.size();
+        while (p != pend && (isspace((unsigned char)*p) || *p == ':'))
+            p++;
+        if (p == pend || *p != '"')
+            continue;
+        const char* pbegin = ++p;
+        p = std::find(p, pend, '"');
+        if (p == pend)
+            break;
+        RPCExecClass execClass = tableRPC.execClass(std::string(pbegin, p));
+        if (execClass == RPC_EXEC_CONTRACTCALL)
+            execClass = contractCallPool.IsRunning() ? RPC_EXEC_SNAPSHOT : RPC_EXEC_DEFAULT;
+        if (execClass == RPC_EXEC_LONGPOLL)
+            return HTTP_WORK_LONGPOLL;
+        fFound = true;
+        fAllSnapshot &= execClass == RPC_EXEC_SNAPSHOT;
+    }
+    return fFound && fAllSnapshot ? HTTP_WORK_READONLY : HTTP_WORK_DEFAULT;
+}
+
 static bool InitRPCAuthentication()
 {
     if (gArgs.GetArg("-rpcpassword", "") == "")
@@ -243,10 +287,10 @@ bool StartHTTPRPC()
     if (!InitRPCAuthentication())
         return false;
 
-    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC, JSONRPCWorkClass);
 #ifdef ENABLE_WALLET
     // ifdef can be removed once we switch to better endpoint support and API versioning
-    RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC);
+    RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC, JSONRPCWorkClass);
 #endif
     assert(EventBase());
     httpRPCTimerInterface = new HTTPRPCTimerInterface(EventBase());
@@ -6,6 +6,7 @@
 
 #include "chainparamsbase.h"
 #include "compat.h"
+#include "mpmcqueue.h"
 #include "util.h"
 #include "utilstrencodings.h"
 #include "netbase.h"
@@ -63,17 +64,19 @@ private:
 
 /** Simple work queue for distributing work over multiple threads.
  * Work items are simply callable objects.
+ * Items are passed through a lock-free queue, so submitting a request never waits
+ * for a worker; the mutex is only taken to put idle workers to sleep and wake them.
  */
 template <typename WorkItem>
 class WorkQueue
 {
 private:
-    /** Mutex protects entire object */
+    MPMCQueue<std::unique_ptr<WorkItem>> queue;
+    /** Mutex protects numThreads and sleeping workers */
     std::mutex cs;
     std::condition_variable cond;
-    std::deque<std::unique_ptr<WorkItem>> queue;
-    bool running;
-    size_t maxDepth;
+    std::atomic<bool> running;
+    std::atomic<int> numIdle;
     int numThreads;
 
     /** RAII object to keep track of number of running worker threads */
@@ -95,8 +98,9 @@ private:
     };
 
 public:
-    WorkQueue(size_t _maxDepth) : running(true),
-                                 maxDepth(_maxDepth),
+    WorkQueue(size_t _maxDepth) : queue(_maxDepth),
+                                 running(true),
+                                 numIdle(0),
                                  numThreads(0)
     {
     }
@@ -109,28 +113,35 @@ public:
     /** Enqueue a work item */
     bool Enqueue(WorkItem* item)
     {
-        std::unique_lock<std::mutex> lock(cs);
-        if (queue.size() >= maxDepth) {
+        std::unique_ptr<WorkItem> ptr(item);
+        if (!queue.TryPush(std::move(ptr))) {
+            ptr.release(); // caller keeps ownership
             return false;
         }
-        queue.emplace_back(std::unique_ptr<WorkItem>(item));
-        cond.notify_one();
+        // Pairs with the fence in Run: either a worker going to sleep sees the item,
+        // or we see that worker as idle and wake it
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (numIdle.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(cs);
+            cond.notify_one();
+        }
         return true;
     }
     /** Thread function */
     void Run()
     {
         ThreadCounter count(*this);
-        while (true) {
+        while (running) {
             std::unique_ptr<WorkItem> i;
-            {
+            if (!queue.TryPop(i)) {
                 std::unique_lock<std::mutex> lock(cs);
-                while (running && queue.empty())
+                numIdle.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                while (running && !queue.TryPop(i))
                     cond.wait(lock);
+                numIdle.fetch_sub(1, std::memory_order_relaxed);
                 if (!running)
                     break;
-                i = std::move(queue.front());
-                queue.pop_front();
             }
             (*i)();
         }
@@ -154,13 +165,14 @@ public:
 struct HTTPPathHandler
 {
     HTTPPathHandler() {}
-    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler):
-        prefix(_prefix), exactMatch(_exactMatch), handler(_handler)
+    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler, HTTPRequestClassifier _classifier):
+        prefix(_prefix), exactMatch(_exactMatch), handler(_handler), classifier(_classifier)
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    HTTPRequestClassifier classifier;
 };
 
 /** HTTP module state */
@@ -171,8 +183,11 @@ static struct event_base* eventBase = 0;
 struct evhttp* eventHTTP = 0;
 //! List of subnets to allow RPC connections from
 static std::vector<CSubNet> rpc_allow_subnets;
-//! Work queue for handling longer requests off the event loop thread
-static WorkQueue<HTTPClosure>* workQueue = 0;
+//! Work queues for handling longer requests off the event loop thread, one per worker pool.
+//! Classes without threads of their own run on the HTTP_WORK_DEFAULT queue.
+static WorkQueue<HTTPClosure>* workQueues[HTTP_WORK_CLASSES] = {};
+//! Number of worker threads for each queue
+static int workQueueThreads[HTTP_WORK_CLASSES] = {};
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
@@ -287,6 +302,8 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
+        HTTPWorkClass workClass = i->classifier ? i->classifier(hreq.get(), path) : HTTP_WORK_DEFAULT;
+        WorkQueue<HTTPClosure>* workQueue = workQueues[workClass] ? workQueues[workClass] : workQueues[HTTP_WORK_DEFAULT];
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
         assert(workQueue);
         if (workQueue->Enqueue(item.get()))
@@ -425,9 +442,15 @@ bool InitHTTPServer()
 
     LogPrint(BCLog::HTTP, "Initialized HTTP server\n");
     int workQueueDepth = std::max((long)gArgs.GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
-    LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
+    LogPrintf("HTTP: creating work queues of depth %d\n", workQueueDepth);
 
-    workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
+    workQueueThreads[HTTP_WORK_DEFAULT] = std::max((long)gArgs.GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
+    workQueueThreads[HTTP_WORK_READONLY] = std::max((long)gArgs.GetArg("-rpcreadthreads", DEFAULT_HTTP_READ_THREADS), 0L);
+    workQueueThreads[HTTP_WORK_LONGPOLL] = std::max((long)gArgs.GetArg("-rpcpollthreads", DEFAULT_HTTP_POLL_THREADS), 0L);
+    for (int i = 0; i < HTTP_WORK_CLASSES; i++) {
+        if (workQueueThreads[i] > 0)
+            workQueues[i] = new WorkQueue<HTTPClosure>(workQueueDepth);
+    }
     // tranfer ownership to eventBase/HTTP via .release()
     eventBase = base_ctr.release();
     eventHTTP = http_ctr.release();
@@ -454,15 +477,17 @@ std::future<bool> threadResult;
 bool StartHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Starting HTTP server\n");
-    int rpcThreads = std::max((long)gArgs.GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
-    LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
+    LogPrintf("HTTP: starting %d worker threads, %d for read-only requests and %d for long polls\n",
+        workQueueThreads[HTTP_WORK_DEFAULT], workQueueThreads[HTTP_WORK_READONLY], workQueueThreads[HTTP_WORK_LONGPOLL]);
     std::packaged_task<bool(event_base*, evhttp*)> task(ThreadHTTP);
     threadResult = task.get_future();
     threadHTTP = std::thread(std::move(task), eventBase, eventHTTP);
 
-    for (int i = 0; i < rpcThreads; i++) {
-        std::thread rpc_worker(HTTPWorkQueueRun, workQueue);
-        rpc_worker.detach();
+    for (int c = 0; c < HTTP_WORK_CLASSES; c++) {
+        for (int i = 0; i < workQueueThreads[c]; i++) {
+            std::thread rpc_worker(HTTPWorkQueueRun, workQueues[c]);
+            rpc_worker.detach();
+        }
     }
     return true;
 }
@@ -478,18 +503,22 @@ void InterruptHTTPServer()
         // Reject requests on current connections
         evhttp_set_gencb(eventHTTP, http_reject_request_cb, nullptr);
     }
-    if (workQueue)
-        workQueue->Interrupt();
+    for (WorkQueue<HTTPClosure>* workQueue : workQueues) {
+        if (workQueue)
+            workQueue->Interrupt();
+    }
 }
 
 void StopHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Stopping HTTP server\n");
-    if (workQueue) {
-        LogPrint(BCLog::HTTP, "Waiting for HTTP worker threads to exit\n");
-        workQueue->WaitExit();
-        delete workQueue;
-        workQueue = nullptr;
+    for (WorkQueue<HTTPClosure>*& workQueue : workQueues) {
+        if (workQueue) {
+            LogPrint(BCLog::HTTP, "Waiting for HTTP worker threads to exit\n");
+            workQueue->WaitExit();
+            delete workQueue;
+            workQueue = nullptr;
+        }
     }
     if (eventBase) {
         LogPrint(BCLog::HTTP, "Waiting for HTTP event thread to exit\n");
@@ -657,6 +686,18 @@ std::string HTTPRequest::ReadBody()
     return rv;
 }
 
+std::pair<const char*, size_t> HTTPRequest::PeekBody()
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return std::make_pair(nullptr, 0);
+    size_t size = evbuffer_get_length(buf);
+    const char* data = (const char*)evbuffer_pullup(buf, size);
+    if (!data)
+        return std::make_pair(nullptr, 0);
+    return std::make_pair(data, size);
+}
+
 bool HTTPRequest::ReplySent() {
     return replySent;
 }
@@ -719,10 +760,35 @@ void HTTPRequest::Chunk(const std::string& chunk) {
 void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
 {
     assert(!replySent && req);
-    // Send event to main http thread to send reply message
     struct evbuffer* evb = evhttp_request_get_output_buffer(req);
     assert(evb);
     evbuffer_add(evb, strReply.data(), strReply.size());
+    SendReply(nStatus);
+}
+
+void HTTPRequest::WriteReply(int nStatus, std::vector<std::string>&& pieces)
+{
+    assert(!replySent && req);
+    struct evbuffer* evb = evhttp_request_get_output_buffer(req);
+    assert(evb);
+    for (std::string& piece : pieces) {
+        if (piece.empty())
+            continue;
+        // The data stays where it is until it was written to the client, then the cleanup callback frees it
+        std::string* data = new std::string(std::move(piece));
+        if (evbuffer_add_reference(evb, data->data(), data->size(), [](const void*, size_t, void* extra) {
+                delete static_cast<std::string*>(extra);
+            }, data) != 0) {
+            evbuffer_add(evb, data->data(), data->size());
+            delete data;
+        }
+    }
+    SendReply(nStatus);
+}
+
+void HTTPRequest::SendReply(int nStatus)
+{
+    // Send event to main http thread to send reply message
     auto req_copy = req;
     HTTPEvent* ev = new HTTPEvent(eventBase, true, nullptr, [req_copy, nStatus]{
         evhttp_send_reply(req_copy, nStatus, nullptr, nullptr);
@@ -783,10 +849,10 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod()
     }
 }
 
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPRequestClassifier &classifier)
 {
     LogPrint(BCLog::HTTP, "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
-    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
+    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler, classifier));
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
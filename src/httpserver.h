@@ -6,12 +6,15 @@
 #define BITCOIN_HTTPSERVER_H
 
 #include <string>
+#include <vector>
 #include <stdint.h>
 #include <functional>
 #include <mutex>
 #include <condition_variable>
 
 static const int DEFAULT_HTTP_THREADS=4;
+static const int DEFAULT_HTTP_READ_THREADS=4;
+static const int DEFAULT_HTTP_POLL_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
 
@@ -38,13 +41,27 @@ void StopHTTPServer();
  * libevent doesn't support debug logging.*/
 bool UpdateHTTPServerLogging(bool enable);
 
+/** Worker pools requests are run on, so that slow requests cannot hold up quick ones */
+enum HTTPWorkClass
+{
+    /** Requests that may lock or change the chain state (-rpcthreads) */
+    HTTP_WORK_DEFAULT,
+    /** Short read-only requests that do not take cs_main (-rpcreadthreads) */
+    HTTP_WORK_READONLY,
+    /** Requests that wait for new blocks or logs (-rpcpollthreads) */
+    HTTP_WORK_LONGPOLL,
+    HTTP_WORK_CLASSES
+};
+
 /** Handler for requests to a certain HTTP path */
 typedef std::function<bool(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
+/** Picks the worker pool for a request. Runs on the event loop thread, so it must be quick. */
+typedef std::function<HTTPWorkClass(HTTPRequest* req, const std::string &)> HTTPRequestClassifier;
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
- * be invoked.
+ * be invoked. Without a classifier, requests run on the default pool.
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPRequestClassifier &classifier = HTTPRequestClassifier());
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
@@ -69,6 +86,8 @@ private:
 
     void startDetectClientClose();
     void waitClientClose();
+    /** Hand the request with its output buffer to the main http thread to send the reply */
+    void SendReply(int nStatus);
 
 public:
     HTTPRequest(struct evhttp_request* req);
@@ -112,6 +131,12 @@ public:
      */
     std::string ReadBody();
 
+    /**
+     * Get request body without consuming it.
+     * The data stays valid until the body is read.
+     */
+    std::pair<const char*, size_t> PeekBody();
+
     /**
      * Write output header.
      *
@@ -129,6 +154,13 @@ public:
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
 
+    /**
+     * Write HTTP reply with the concatenation of pieces as body.
+     * The pieces are handed to libevent without copying, and freed once they
+     * were written to the client.
+     */
+    void WriteReply(int nStatus, std::vector<std::string>&& pieces);
+
     /**
      * Start chunk transfer. Assume to be 200.
      */
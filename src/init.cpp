@@ -46,6 +46,11 @@
 #include "wallet/wallet.h"
 #endif
 #include "warnings.h"
+#include "qtum/contracttrace.h"
+#include "qtum/storageprefetch.h"
+#include "qtum/contractcallpool.h"
+#include "qtum/templateoptimizer.h"
+#include "qtum/contractpreexec.h"
 #include <stdint.h>
 #include <stdio.h>
 #include <memory>
@@ -240,6 +245,7 @@ void Shutdown()
         if (pcoinsTip != nullptr) {
             FlushStateToDisk();
         }
+        dbReadPool.Stop();
         delete pcoinsTip;
         pcoinsTip = nullptr;
         delete pcoinscatcher;
@@ -252,6 +258,10 @@ void Shutdown()
         pstorageresult = nullptr;
         delete peventdb;
         peventdb = nullptr;
+        storagePrefetcher.Stop();
+        contractPreExecutor.Stop();
+        contractCallPool.Stop();
+        contractTrace.Close();
         delete globalState.release();
         globalSealEngine.reset();
     }
@@ -367,6 +377,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize));
     }
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-dbreadthreads=<n>", strprintf(_("Number of threads reading from the databases when several lookups can be made at once (0 to %d, default: %d)"), MAX_DB_READ_THREADS, DEFAULT_DB_READ_THREADS));
     if (showDebug)
         strUsage += HelpMessageOpt("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file on startup"));
@@ -387,6 +398,13 @@ std::string HelpMessage(HelpMessageMode mode)
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >%u = automatically prune block files to stay under the specified target size in MiB)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
     strUsage += HelpMessageOpt("-record-log-opcodes", strprintf(_("Logs all EVM LOG opcode operations to the file vmExecLogs.json")));
+    strUsage += HelpMessageOpt("-contractcallthreads=<n>", strprintf(_("Number of threads running read-only contract calls from RPC against a snapshot of the chain tip, without taking the main lock (0 to %d, default: %d)"), MAX_CONTRACTCALL_THREADS, DEFAULT_CONTRACTCALL_THREADS));
+    strUsage += HelpMessageOpt("-contractcallqueue=<n>", strprintf(_("Maximum number of read-only contract calls waiting for a contract call thread (default: %d)"), DEFAULT_CONTRACTCALL_QUEUE));
+    strUsage += HelpMessageOpt("-contractcallcache=<n>", strprintf(_("Number of read-only contract call results the contract call threads keep until the next block, 0 to disable (default: %d)"), DEFAULT_CONTRACTCALL_CACHE));
+    strUsage += HelpMessageOpt("-contractpreexec", strprintf(_("Execute the x86 contracts of transactions entering the mempool on the contract call threads, to learn their gas use and storage access before they are mined. Requires -contractcallthreads (default: %u)"), DEFAULT_CONTRACT_PREEXEC));
+    strUsage += HelpMessageOpt("-contractprefetch", strprintf(_("Remember the storage keys read by each x86 contract and read them in the background before the contract is executed again (default: %u)"), DEFAULT_CONTRACT_PREFETCH));
+    strUsage += HelpMessageOpt("-contracttrace=<file>", _("Write a binary record of every contract execution into a memory-mapped ring file (relative paths are relative to the data directory)"));
+    strUsage += HelpMessageOpt("-contracttracesize=<n>", strprintf(_("Size of the -contracttrace ring file in MiB (default: %u)"), DEFAULT_CONTRACTTRACE_SIZE));
     strUsage += HelpMessageOpt("-reindex-chainstate", _("Rebuild chain state from the currently indexed blocks"));
     strUsage += HelpMessageOpt("-reindex", _("Rebuild chain state and block index from the blk*.dat files on disk"));
 #ifndef WIN32
@@ -447,6 +465,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubcontractevent=<address>", _("Enable publish contract events of connected blocks in <address>"));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
@@ -519,6 +538,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-staker-min-tx-gas-price=<amt>", _("Any contract execution with a gas price below this will not be included in a block (defaults to the value specified by the DGP)"));
     strUsage += HelpMessageOpt("-staker-max-tx-gas-limit=<n>", _("Any contract execution with a gas limit over this amount will not be included in a block (defaults to soft block gas limit)"));
     strUsage += HelpMessageOpt("-staker-soft-block-gas-limit=<n>", _("After this amount of gas is surpassed in a block, no more contract executions will be added to the block (defaults to consensus-critical maximum block gas limit)"));
+    strUsage += HelpMessageOpt("-staker-optimize-contracts", strprintf(_("Choose the contract transactions for a block by the gas they used when last executed, and only execute those (default: %u)"), DEFAULT_STAKER_OPTIMIZE_CONTRACTS));
 
     if (showDebug)
         strUsage += HelpMessageOpt("-blockversion=<n>", "Override block version to test forking scenarios");
@@ -536,7 +556,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-rpcserialversion", strprintf(_("Sets the serialization of raw transaction or block hex returned in non-verbose mode, non-segwit(0) or segwit(1) (default: %d)"), DEFAULT_RPC_SERIALIZE_VERSION));
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
     if (showDebug) {
-        strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
+        strUsage += HelpMessageOpt("-rpcreadthreads=<n>", strprintf("Set the number of threads to service read-only RPC calls that do not need the chain lock, 0 to use the -rpcthreads threads (default: %d)", DEFAULT_HTTP_READ_THREADS));
+        strUsage += HelpMessageOpt("-rpcpollthreads=<n>", strprintf("Set the number of threads to service long-polling RPC calls such as waitforlogs, 0 to use the -rpcthreads threads (default: %d)", DEFAULT_HTTP_POLL_THREADS));
+        strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queues to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
         strUsage += HelpMessageOpt("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT));
     }
 
@@ -938,12 +960,15 @@ bool AppInitParameterInteraction()
     }
 
     // Make sure enough file descriptors are available
-    int nBind = std::max(nUserBind, size_t(1));
     nUserMaxConnections = gArgs.GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     nMaxConnections = std::max(nUserMaxConnections, 0);
 
     // Trim requested connection counts, to fit into system limitations
+#ifndef USE_EPOLL
+    // select() can't watch sockets above FD_SETSIZE; with epoll only the descriptor limit applies
+    int nBind = std::max(nUserBind, size_t(1));
     nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS)), 0);
+#endif
     nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS + MAX_ADDNODE_CONNECTIONS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -1275,6 +1300,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
             threadGroup.create_thread(&ThreadScriptCheck);
     }
 
+    int nDBReadThreads = std::max(0, std::min<int>(gArgs.GetArg("-dbreadthreads", DEFAULT_DB_READ_THREADS), MAX_DB_READ_THREADS));
+    LogPrintf("Using %d threads for database reads\n", nDBReadThreads);
+    dbReadPool.Start(nDBReadThreads);
+
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
@@ -1462,6 +1491,8 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 delete pcoinscatcher;
                 delete pblocktree;
                 delete pstorageresult;
+                storagePrefetcher.Stop();
+                contractCallPool.Stop();
                 delete pdeltaDB;
                 delete peventdb;
                 globalState.reset();
@@ -1471,6 +1502,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
                 pdeltaDB = new DeltaDB(nBlockTreeDBCache, false, fReset);
                 peventdb = new EventDB(nBlockTreeDBCache, false, fReset);
+                if (gArgs.GetBoolArg("-contractprefetch", DEFAULT_CONTRACT_PREFETCH)) {
+                    storagePrefetcher.Start(pdeltaDB);
+                }
 
                 if (fReset) {
                     pblocktree->WriteReindexing(true);
@@ -1574,8 +1608,8 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 }
 
                 if(chainActive.Tip() != nullptr){
-                    globalState->setRoot(uintToh256(chainActive.Tip()->hashStateRoot));
-                    globalState->setRootUTXO(uintToh256(chainActive.Tip()->hashUTXORoot));
+                    globalState->setRoot(uintToh256(chainActive.Tip()->GetHashStateRoot()));
+                    globalState->setRootUTXO(uintToh256(chainActive.Tip()->GetHashUTXORoot()));
                 } else {
                     globalState->setRoot(dev::sha3(dev::rlp("")));
                     globalState->setRootUTXO(uintToh256(chainparams.GenesisBlock().hashUTXORoot));
@@ -1585,6 +1619,11 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 globalState->dbUtxo().commit();
 
                 fRecordLogOpcodes = gArgs.IsArgSet("-record-log-opcodes");
+                if (gArgs.IsArgSet("-contracttrace")) {
+                    fs::path pathTrace = fs::absolute(gArgs.GetArg("-contracttrace", ""), GetDataDir());
+                    size_t nTraceSize = std::max<int64_t>(gArgs.GetArg("-contracttracesize", DEFAULT_CONTRACTTRACE_SIZE), 1) << 20;
+                    contractTrace.Open(pathTrace, nTraceSize);
+                }
                 fIsVMlogFile = fs::exists(GetDataDir() / "vmExecLogs.json");
                 ///////////////////////////////////////////////////////////
 
@@ -1639,6 +1678,11 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                         break;
                     }
                 }
+
+                if (!BuildContractIndex()) {
+                    strLoadError = _("Error building the contract address index");
+                    break;
+                }
             } catch (const std::exception& e) {
                 LogPrintf("%s\n", e.what());
                 strLoadError = _("Error opening block database");
@@ -1680,6 +1724,19 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         LogPrintf(" block index %15dms\n", GetTimeMillis() - nStart);
     }
 
+    int nContractCallThreads = std::min<int>(gArgs.GetArg("-contractcallthreads", DEFAULT_CONTRACTCALL_THREADS), MAX_CONTRACTCALL_THREADS);
+    if (nContractCallThreads > 0) {
+        contractCallPool.Start(nContractCallThreads, std::max<int64_t>(gArgs.GetArg("-contractcallqueue", DEFAULT_CONTRACTCALL_QUEUE), 1),
+                               std::max<int64_t>(gArgs.GetArg("-contractcallcache", DEFAULT_CONTRACTCALL_CACHE), 0));
+        LOCK(cs_main);
+        contractCallPool.UpdateTip(chainActive.Tip(), pdeltaDB, globalState.get());
+        if (gArgs.GetBoolArg("-contractpreexec", DEFAULT_CONTRACT_PREEXEC)) {
+            contractPreExecutor.Start(chainActive.Tip());
+        }
+    } else if (gArgs.GetBoolArg("-contractpreexec", DEFAULT_CONTRACT_PREEXEC)) {
+        InitWarning(_("-contractpreexec is ignored without -contractcallthreads"));
+    }
+
     fs::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
     CAutoFile est_filein(fsbridge::fopen(est_path, "rb"), SER_DISK, CLIENT_VERSION);
     // Allowed to fail as this file IS missing on first startup.
@@ -6,6 +6,7 @@
 #define BITCOIN_MEMUSAGE_H
 
 #include "indirectmap.h"
+#include "pooledmap.h"
 
 #include <stdlib.h>
 
@@ -130,6 +131,18 @@ static inline size_t IncrementalDynamicUsage(const indirectmap<X, Y>& m)
     return MallocUsage(sizeof(stl_tree_node<std::pair<const X*, Y> >));
 }
 
+// pooledmap knows its allocations exactly: the table, the chunk list and every chunk of nodes
+
+template<typename X, typename Y, typename Z>
+static inline size_t DynamicUsage(const pooledmap<X, Y, Z>& m)
+{
+    size_t usage = MallocUsage(m.bucket_size() * m.bucket_count()) + MallocUsage(m.chunk_header_size() * m.chunk_count());
+    for (size_t i = 0; i < m.allocated_chunks(); i++) {
+        usage += MallocUsage(m.node_size() * m.chunk_nodes(i));
+    }
+    return usage;
+}
+
 template<typename X>
 static inline size_t DynamicUsage(const std::unique_ptr<X>& p)
 {
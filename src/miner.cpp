@@ -28,6 +28,8 @@
 #include "utilmoneystr.h"
 #include "validationinterface.h"
 #include "wallet/wallet.h"
+#include "qtum/templateoptimizer.h"
+#include "qtum/contractpreexec.h"
 
 #include <algorithm>
 #include <queue>
@@ -246,7 +248,18 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     int nPackagesSelected = 0;
     int nDescendantsUpdated = 0;
     pblock->hashPrevBlock  = pindexPrev->GetBlockHash();
-    addPackageTxs(nPackagesSelected, nDescendantsUpdated, minGasPrice);
+    if (gArgs.GetBoolArg("-staker-optimize-contracts", DEFAULT_STAKER_OPTIMIZE_CONTRACTS)) {
+        std::vector<CTxMemPool::setEntries> contractPackages;
+        addPackageTxs(nPackagesSelected, nDescendantsUpdated, minGasPrice, &contractPackages);
+        if (addContractPackages(contractPackages, minGasPrice) > 0) {
+            // Fill the room left with transactions depending on the contracts just added,
+            // the contract packages that weren't chosen are set aside again
+            contractPackages.clear();
+            addPackageTxs(nPackagesSelected, nDescendantsUpdated, minGasPrice, &contractPackages);
+        }
+    } else {
+        addPackageTxs(nPackagesSelected, nDescendantsUpdated, minGasPrice);
+    }
     //pblock->hashStateRoot = uint256(h256Touint(dev::h256(globalState->rootHash())));
     //pblock->hashUTXORoot = uint256(h256Touint(dev::h256(globalState->rootHashUTXO())));
     //globalState->setRoot(oldHashStateRoot);
@@ -445,6 +458,7 @@ bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64
     
     dev::h256 oldHashStateRoot(globalState->rootHash());
     dev::h256 oldHashUTXORoot(globalState->rootHashUTXO());
+    size_t nOldRefundOutputs = refundOutputs.size();
     // operate on local vars first, then later apply to `this`
     uint64_t nBlockWeight = this->nBlockWeight;
     uint64_t nBlockSigOpsCost = this->nBlockSigOpsCost;
@@ -454,6 +468,8 @@ bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64
     if(!(tx.HasCreateOrCall())){
         return true;
     }
+    //overlap storage reads with the sender and gas checks below
+    PrefetchContractStorage(tx);
 
     if(!CheckSenderScript(pcoinsTip, tx)){
         return false;
@@ -518,6 +534,8 @@ bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64
         if(!executor.execute(result, false)){
             globalState->setRoot(oldHashStateRoot);
             globalState->setRootUTXO(oldHashUTXORoot);
+            refundOutputs.resize(nOldRefundOutputs);
+            contractGasEstimates.RecordFailure(tx.GetHash(), pblock->hashPrevBlock);
             //todo revert deltadb
             return false;
         }
@@ -540,6 +558,10 @@ bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64
                 refundOutputs.push_back(CTxOut(result.refundSender, script));
             }else{
                 //TODO
+                //this output was already executed, so revert state and refunds like an execution failure
+                globalState->setRoot(oldHashStateRoot);
+                globalState->setRootUTXO(oldHashUTXORoot);
+                refundOutputs.resize(nOldRefundOutputs);
                 return false;
                 //return state.DoS(100, error("can't yet handle non-pubkeyhash refunds"));
             }
@@ -551,6 +573,14 @@ bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64
         }
 
 
+    }
+    contractGasEstimates.RecordExecution(tx.GetHash(), gasUsedSum, (CAmount)(gasFeeSum - qtumUsedSum));
+    if(totalUsedGas + gasUsedSum > softBlockGasLimit){
+        //no more contract executions once the soft block gas limit is reached
+        globalState->setRoot(oldHashStateRoot);
+        globalState->setRootUTXO(oldHashUTXORoot);
+        refundOutputs.resize(nOldRefundOutputs);
+        return false;
     }
     //rebuild coinbase/stake to include new refund outputs
     int proofTx = pblock->IsProofOfStake() ? 1 : 0;
@@ -565,6 +595,9 @@ bool BlockAssembler::AttemptToAddContractToBlock(CTxMemPool::txiter iter, uint64
         //contract will not be added to block, so revert state to before we tried
         globalState->setRoot(oldHashStateRoot);
         globalState->setRootUTXO(oldHashUTXORoot);
+        //the coinbase/stake was already rebuilt with this contract's refunds, so rebuild it without them
+        refundOutputs.resize(nOldRefundOutputs);
+        RebuildRefundTransaction();
         return false;
     }
 
@@ -769,7 +802,8 @@ void BlockAssembler::SortForBlock(const CTxMemPool::setEntries& package, CTxMemP
 // Each time through the loop, we compare the best transaction in
 // mapModifiedTxs with the next transaction in the mempool to decide what
 // transaction package to work on next.
-void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpdated, uint64_t minGasPrice)
+void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpdated, uint64_t minGasPrice,
+                                   std::vector<CTxMemPool::setEntries>* pContractPackages)
 {
     // mapModifiedTx will store sorted packages after they are modified
     // because some of their txs are already in the block
@@ -883,6 +917,28 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
             continue;
         }
 
+        // Leave packages with contracts to the template optimizer
+        if (pContractPackages) {
+            bool fHasContract = false;
+            for (const CTxMemPool::txiter it : ancestors) {
+                if (it->GetTx().HasCreateOrCall()) {
+                    fHasContract = true;
+                    break;
+                }
+            }
+            if (fHasContract) {
+                // A package can show up again here once some of its ancestors are added
+                if (!failedTx.count(iter) && pContractPackages->size() < MAX_TEMPLATE_CONTRACT_PACKAGES) {
+                    pContractPackages->push_back(ancestors);
+                }
+                if (fUsingModified) {
+                    mapModifiedTx.get<ancestor_score_or_gas_price>().erase(modit);
+                }
+                failedTx.insert(iter);
+                continue;
+            }
+        }
+
         // This transaction will make it in; reset the failed counter.
         nConsecutiveFailed = 0;
 
@@ -930,6 +986,103 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
     }
 }
 
+int BlockAssembler::addContractPackages(const std::vector<CTxMemPool::setEntries>& contractPackages, uint64_t minGasPrice)
+{
+    // Describe every transaction not in the block yet by the room it takes up and what it earns.
+    // Contract transactions are estimated from their last execution, or their full gas limit if they
+    // weren't executed yet. Gas that is refunded to the sender isn't earned.
+    std::map<CTxMemPool::txiter, size_t, CompareCTxMemPoolIter> txIndexes;
+    std::vector<TemplateTx> templateTxs;
+    std::vector<std::vector<size_t>> templatePackages;
+    std::vector<const CTxMemPool::setEntries*> packages;
+    for (const CTxMemPool::setEntries& package : contractPackages) {
+        std::vector<size_t> indexes;
+        bool fSkip = false;
+        for (const CTxMemPool::txiter it : package) {
+            if (inBlock.count(it))
+                continue;
+            auto pos = txIndexes.find(it);
+            if (pos == txIndexes.end()) {
+                TemplateTx templateTx;
+                templateTx.value = it->GetModifiedFee();
+                templateTx.weight = it->GetTxWeight();
+                templateTx.sigOpsCost = it->GetSigOpCost();
+                templateTx.gas = 0;
+                if (it->GetTx().HasCreateOrCall()) {
+                    templateTx.gas = it->GetGasLimit();
+                    ContractPreExecutor::Result preexec;
+                    ContractGasEstimates::Estimate estimate;
+                    if (contractPreExecutor.Lookup(it->GetTx().GetHash(), preexec) && preexec.tip == pblock->hashPrevBlock) {
+                        // Executed on top of the same block, without conflicts with other transactions
+                        templateTx.gas = preexec.gasUsed;
+                        templateTx.value -= preexec.refund;
+                    } else if (contractGasEstimates.Lookup(it->GetTx().GetHash(), estimate)) {
+                        if (estimate.failed && estimate.failedOn == pblock->hashPrevBlock) {
+                            // Would fail again on top of the same block
+                            fSkip = true;
+                            break;
+                        }
+                        if (!estimate.failed) {
+                            templateTx.gas = estimate.gasUsed;
+                            templateTx.value -= estimate.refund;
+                        }
+                    }
+                }
+                pos = txIndexes.emplace(it, templateTxs.size()).first;
+                templateTxs.push_back(templateTx);
+            }
+            indexes.push_back(pos->second);
+        }
+        if (!fSkip && !indexes.empty()) {
+            templatePackages.push_back(std::move(indexes));
+            packages.push_back(&package);
+        }
+    }
+
+    TemplateLimits limits;
+    limits.weight = nBlockMaxWeight > nBlockWeight ? nBlockMaxWeight - nBlockWeight : 0;
+    limits.sigOpsCost = std::max<int64_t>(0, (int64_t)dgpMaxBlockSigOps - (int64_t)nBlockSigOpsCost);
+    limits.gas = softBlockGasLimit > totalUsedGas ? softBlockGasLimit - totalUsedGas : 0;
+    std::vector<size_t> selected = SelectTemplatePackages(templateTxs, templatePackages, limits);
+
+    // Execute only the chosen packages. Estimates can be off, so they are still checked as they are added
+    int nAdded = 0;
+    for (size_t i : selected) {
+        CTxMemPool::setEntries package = *packages[i];
+        onlyUnconfirmed(package);
+        if (package.empty())
+            continue;
+        uint64_t packageSize = 0;
+        int64_t packageSigOpsCost = 0;
+        for (const CTxMemPool::txiter it : package) {
+            packageSize += it->GetTxSize();
+            packageSigOpsCost += it->GetSigOpCost();
+        }
+        if (!TestPackage(packageSize, packageSigOpsCost))
+            continue;
+
+        std::vector<CTxMemPool::txiter> sortedEntries;
+        SortForBlock(package, *package.rbegin(), sortedEntries);
+        bool wasAdded = true;
+        for (const CTxMemPool::txiter it : sortedEntries) {
+            if (nTimeLimit != 0 && GetAdjustedTime() >= nTimeLimit) {
+                return nAdded;
+            }
+            if (it->GetTx().HasCreateOrCall()) {
+                wasAdded = AttemptToAddContractToBlock(it, minGasPrice);
+                if (!wasAdded)
+                    break;
+            } else {
+                AddToBlock(it);
+            }
+        }
+        if (wasAdded)
+            ++nAdded;
+    }
+    LogPrint(BCLog::BENCH, "%s: %u of %u contract packages chosen, %d added\n", __func__, selected.size(), templatePackages.size(), nAdded);
+    return nAdded;
+}
+
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
 {
     // Update nExtraNonce
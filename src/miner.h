@@ -264,8 +264,14 @@ private:
     // Methods for how to add transactions to a block.
     /** Add transactions based on feerate including unconfirmed ancestors
       * Increments nPackagesSelected / nDescendantsUpdated with corresponding
-      * statistics from the package selection (for logging statistics). */
-    void addPackageTxs(int &nPackagesSelected, int &nDescendantsUpdated, uint64_t minGasPrice);
+      * statistics from the package selection (for logging statistics).
+      * If pContractPackages is given, packages with contract transactions are
+      * added to it instead of to the block. */
+    void addPackageTxs(int &nPackagesSelected, int &nDescendantsUpdated, uint64_t minGasPrice,
+                       std::vector<CTxMemPool::setEntries>* pContractPackages = nullptr);
+    /** Add the contract packages set aside by addPackageTxs that fit the block best, according to
+      * earlier executions. Only the chosen packages are executed. Returns the number of packages added. */
+    int addContractPackages(const std::vector<CTxMemPool::setEntries>& contractPackages, uint64_t minGasPrice);
 
     /** Rebuild the coinbase/coinstake transaction to account for new gas refunds **/
     void RebuildRefundTransaction();
@@ -0,0 +1,111 @@
+// Copyright (c) 2018 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_MPMCQUEUE_H
+#define BITCOIN_MPMCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+/**
+ * Bounded lock-free queue for any number of producers and consumers.
+ *
+ * Elements live in a ring of cells, each with a sequence number telling
+ * whether it is free for the producer or filled for the consumer at the
+ * current position. Producers and consumers claim positions with a compare
+ * and swap on their own counter, so neither side ever blocks the other and a
+ * full or empty queue is reported instead of waited on.
+ *
+ * T must be default constructible and movable.
+ */
+template <typename T>
+class MPMCQueue
+{
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    static const size_t CACHE_LINE = 64;
+
+    const size_t capacity;
+    std::unique_ptr<Cell[]> cells;
+    // Padding keeps the producer and consumer positions on separate cache lines
+    char pad0[CACHE_LINE];
+    std::atomic<size_t> enqueuePos;
+    char pad1[CACHE_LINE - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> dequeuePos;
+    char pad2[CACHE_LINE - sizeof(std::atomic<size_t>)];
+
+public:
+    explicit MPMCQueue(size_t _capacity) : capacity(_capacity > 0 ? _capacity : 1), cells(new Cell[capacity]), enqueuePos(0), dequeuePos(0)
+    {
+        for (size_t i = 0; i < capacity; i++)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MPMCQueue(const MPMCQueue&) = delete;
+    MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+    /** Add item. Returns false, leaving item untouched, if the queue is full. */
+    bool TryPush(T&& item)
+    {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos % capacity];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            if (seq == pos) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (seq < pos) {
+                // The consumer one lap behind has not emptied this cell yet
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(item);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Take the oldest item. Returns false if the queue is empty. */
+    bool TryPop(T& item)
+    {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos % capacity];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            if (seq == pos + 1) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (seq < pos + 1) {
+                return false;
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        item = std::move(cell->data);
+        cell->data = T();
+        cell->sequence.store(pos + capacity, std::memory_order_release);
+        return true;
+    }
+
+    size_t Capacity() const { return capacity; }
+
+    /** Number of items queued. Only a snapshot while other threads use the queue. */
+    size_t Size() const
+    {
+        size_t head = dequeuePos.load(std::memory_order_acquire);
+        size_t tail = enqueuePos.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
+};
+
+#endif // BITCOIN_MPMCQUEUE_H
@@ -26,6 +26,11 @@
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <sys/uio.h>
+#endif
+
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
 #endif
 
 #ifdef USE_UPNP
@@ -44,6 +49,16 @@
 // We add a random period time (0 to 1 seconds) to feeler connections to prevent synchronization.
 #define FEELER_SLEEP_WINDOW 1
 
+// Maximum number of buffers gathered into one sendmsg() call
+static const int SEND_IOV_MAX = 64;
+
+#ifdef USE_EPOLL
+// Maximum number of socket events handled per epoll_wait() call
+static const int EPOLL_MAX_EVENTS = 1024;
+// Maximum number of recv() calls for one peer before the other sockets get a turn
+static const int EPOLL_MAX_READS = 16;
+#endif
+
 #if !defined(HAVE_MSG_NOSIGNAL)
 #define MSG_NOSIGNAL 0
 #endif
@@ -847,27 +862,79 @@ size_t CConnman::SocketSendData(CNode *pnode) const
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
-        assert(data.size() > pnode->nSendOffset);
+        assert((*it)->size() > pnode->nSendOffset);
+        size_t nGathered = 0;
         int nBytes = 0;
+#ifdef WIN32
+        // No scatter-gather send here, write the unsent part of the header or the payload
+        const CNetMessageBuffer& msg = **it;
+        const unsigned char* pchData;
+        if (pnode->nSendOffset < msg.header.size()) {
+            pchData = msg.header.data() + pnode->nSendOffset;
+            nGathered = msg.header.size() - pnode->nSendOffset;
+        } else {
+            pchData = msg.data.data() + (pnode->nSendOffset - msg.header.size());
+            nGathered = msg.size() - pnode->nSendOffset;
+        }
+        {
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                break;
+            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(pchData), nGathered, MSG_NOSIGNAL | MSG_DONTWAIT);
+        }
+#else
+        // Hand the unsent headers and payloads of as many queued messages as possible to
+        // the kernel in one call, straight from the (possibly shared) message buffers
+        struct iovec iov[SEND_IOV_MAX];
+        int nIov = 0;
+        size_t nOffset = pnode->nSendOffset;
+        for (auto itGather = it; itGather != pnode->vSendMsg.end() && nIov + 2 <= SEND_IOV_MAX; ++itGather) {
+            const CNetMessageBuffer& msg = **itGather;
+            if (nOffset < msg.header.size()) {
+                iov[nIov].iov_base = const_cast<unsigned char*>(msg.header.data()) + nOffset;
+                iov[nIov].iov_len = msg.header.size() - nOffset;
+                nGathered += iov[nIov++].iov_len;
+                nOffset = 0;
+            } else {
+                nOffset -= msg.header.size();
+            }
+            if (nOffset < msg.data.size()) {
+                iov[nIov].iov_base = const_cast<unsigned char*>(msg.data.data()) + nOffset;
+                iov[nIov].iov_len = msg.data.size() - nOffset;
+                nGathered += iov[nIov++].iov_len;
+            }
+            nOffset = 0;
+        }
+        struct msghdr msghdr;
+        memset(&msghdr, 0, sizeof(msghdr));
+        msghdr.msg_iov = iov;
+        msghdr.msg_iovlen = nIov;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+            nBytes = sendmsg(pnode->hSocket, &msghdr, MSG_NOSIGNAL | MSG_DONTWAIT);
         }
+#endif
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            size_t nAdvance = nBytes;
+            while (nAdvance > 0) {
+                size_t nLeft = (*it)->size() - pnode->nSendOffset;
+                if (nAdvance < nLeft) {
+                    pnode->nSendOffset += nAdvance;
+                    break;
+                }
+                nAdvance -= nLeft;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+                pnode->nSendSize -= (*it)->size();
                 it++;
-            } else {
-                // could not send full message; stop sending more
+            }
+            pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+            if ((size_t)nBytes < nGathered) {
+                // could not send everything; stop sending more
                 break;
             }
         } else {
@@ -1114,77 +1181,331 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
 
     LogPrint(BCLog::NET, "connection from %s accepted\n", addr.ToString());
 
+    // Registered before the node is published, as from then on the socket handler may disconnect and delete it
+    RegisterNodeSocket(pnode);
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
 }
 
+void CConnman::DisconnectNodes()
+{
+    {
+        LOCK(cs_vNodes);
+        // Disconnect unused nodes
+        std::vector<CNode*> vNodesCopy = vNodes;
+        for (CNode* pnode : vNodesCopy)
+        {
+            if (pnode->fDisconnect)
+            {
+                // remove from vNodes
+                vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
+
+                // release outbound grant (if any)
+                pnode->grantOutbound.Release();
+
+                // close socket and cleanup
+                pnode->CloseSocketDisconnect();
+
+                // hold in disconnected pool until all refs are released
+                pnode->Release();
+                vNodesDisconnected.push_back(pnode);
+            }
+        }
+    }
+    {
+        // Delete disconnected nodes
+        std::list<CNode*> vNodesDisconnectedCopy = vNodesDisconnected;
+        for (CNode* pnode : vNodesDisconnectedCopy)
+        {
+            // wait until threads are done using it
+            if (pnode->GetRefCount() <= 0) {
+                bool fDelete = false;
+                {
+                    TRY_LOCK(pnode->cs_inventory, lockInv);
+                    if (lockInv) {
+                        TRY_LOCK(pnode->cs_vSend, lockSend);
+                        if (lockSend) {
+                            fDelete = true;
+                        }
+                    }
+                }
+                if (fDelete) {
+                    vNodesDisconnected.remove(pnode);
+                    DeleteNode(pnode);
+                }
+            }
+        }
+    }
+}
+
+void CConnman::NotifyNumConnectionsChanged()
+{
+    size_t vNodesSize;
+    {
+        LOCK(cs_vNodes);
+        vNodesSize = vNodes.size();
+    }
+    if(vNodesSize != nPrevNodeCount) {
+        nPrevNodeCount = vNodesSize;
+        if(clientInterface)
+            clientInterface->NotifyNumConnectionsChanged(nPrevNodeCount);
+    }
+}
+
+void CConnman::InactivityCheck(CNode *pnode)
+{
+    int64_t nTime = GetSystemTimeInSeconds();
+    if (nTime - pnode->nTimeConnected > 60)
+    {
+        if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
+        {
+            LogPrint(BCLog::NET, "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->GetId());
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
+        {
+            LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
+        {
+            LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
+            pnode->fDisconnect = true;
+        }
+        else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
+        {
+            LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
+            pnode->fDisconnect = true;
+        }
+        else if (!pnode->fSuccessfullyConnected)
+        {
+            LogPrintf("version handshake timeout from %d\n", pnode->GetId());
+            pnode->fDisconnect = true;
+        }
+    }
+}
+
+bool CConnman::SocketRecvData(CNode *pnode)
+{
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    int nBytes = 0;
+    {
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket == INVALID_SOCKET)
+            return false;
+        nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    }
+    if (nBytes > 0)
+    {
+        bool notify = false;
+        if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify)) {
+            pnode->CloseSocketDisconnect();
+            RecordBytesRecv(nBytes);
+            return false;
+        }
+        RecordBytesRecv(nBytes);
+        if (notify) {
+            size_t nSizeAdded = 0;
+            auto it(pnode->vRecvMsg.begin());
+            for (; it != pnode->vRecvMsg.end(); ++it) {
+                if (!it->complete())
+                    break;
+                nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
+            }
+            {
+                LOCK(pnode->cs_vProcessMsg);
+                pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
+                pnode->nProcessQueueSize += nSizeAdded;
+                pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
+            }
+            WakeMessageHandler();
+        }
+        return true;
+    }
+    else if (nBytes == 0)
+    {
+        // socket closed gracefully
+        if (!pnode->fDisconnect) {
+            LogPrint(BCLog::NET, "socket closed\n");
+        }
+        pnode->CloseSocketDisconnect();
+    }
+    else if (nBytes < 0)
+    {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+        {
+            if (!pnode->fDisconnect)
+                LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
+            pnode->CloseSocketDisconnect();
+        }
+    }
+    return false;
+}
+
+#ifdef USE_EPOLL
+void CConnman::RegisterNodeSocket(CNode *pnode)
+{
+    // Interest is registered once for the lifetime of the socket. The kernel drops the
+    // registration when the socket is closed, and the node is only ever deleted by the
+    // socket handler thread after that, so a CNode* handed back by epoll_wait is always live.
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = pnode;
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET)
+        return;
+    if (epoll_ctl(hEpoll, EPOLL_CTL_ADD, pnode->hSocket, &event) == SOCKET_ERROR) {
+        LogPrintf("epoll_ctl for peer=%d failed: %s\n", pnode->GetId(), NetworkErrorString(WSAGetLastError()));
+        pnode->fDisconnect = true;
+    }
+}
+
 void CConnman::ThreadSocketHandler()
 {
-    unsigned int nPrevNodeCount = 0;
+    std::vector<struct epoll_event> vEvents(EPOLL_MAX_EVENTS);
+    // Readable sockets that have not been drained yet, each holding a reference to its node.
+    // Edge-triggered registrations only fire again once new data arrives, so a socket stays
+    // here while the node is paused, has unsent data, or used up its read budget.
+    std::vector<CNode*> vRecvReady;
+    bool fRecvRunnable = false;
+    int64_t nLastInactivityCheck = 0;
     while (!interruptNet)
     {
+        DisconnectNodes();
+        NotifyNumConnectionsChanged();
+
         //
-        // Disconnect nodes
+        // Wait for socket events
         //
-        {
-            LOCK(cs_vNodes);
-            // Disconnect unused nodes
-            std::vector<CNode*> vNodesCopy = vNodes;
-            for (CNode* pnode : vNodesCopy)
-            {
-                if (pnode->fDisconnect)
-                {
-                    // remove from vNodes
-                    vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
+        int nEvents = epoll_wait(hEpoll, vEvents.data(), vEvents.size(), fRecvRunnable ? 0 : 50);
+        if (interruptNet)
+            return;
 
-                    // release outbound grant (if any)
-                    pnode->grantOutbound.Release();
+        if (nEvents == SOCKET_ERROR)
+        {
+            int nErr = WSAGetLastError();
+            if (nErr != WSAEINTR) {
+                LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(nErr));
+                if (!interruptNet.sleep_for(std::chrono::milliseconds(50)))
+                    return;
+            }
+            nEvents = 0;
+        }
 
-                    // close socket and cleanup
-                    pnode->CloseSocketDisconnect();
+        bool fAccept = false;
+        for (int i = 0; i < nEvents; i++)
+        {
+            CNode* pnode = static_cast<CNode*>(vEvents[i].data.ptr);
+            if (pnode == nullptr) {
+                fAccept = true;
+                continue;
+            }
 
-                    // hold in disconnected pool until all refs are released
-                    pnode->Release();
-                    vNodesDisconnected.push_back(pnode);
+            //
+            // Send
+            //
+            if (vEvents[i].events & EPOLLOUT)
+            {
+                LOCK(pnode->cs_vSend);
+                size_t nBytes = SocketSendData(pnode);
+                if (nBytes) {
+                    RecordBytesSent(nBytes);
                 }
             }
+
+            if ((vEvents[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) && !pnode->fRecvReady) {
+                pnode->fRecvReady = true;
+                pnode->AddRef();
+                vRecvReady.push_back(pnode);
+            }
         }
+
+        //
+        // Accept new connections
+        //
+        if (fAccept)
         {
-            // Delete disconnected nodes
-            std::list<CNode*> vNodesDisconnectedCopy = vNodesDisconnected;
-            for (CNode* pnode : vNodesDisconnectedCopy)
+            // Listen sockets are non-blocking and level-triggered, so trying one
+            // without a pending connection is harmless and the rest are picked up
+            // on the next wait.
+            for (const ListenSocket& hListenSocket : vhListenSocket)
             {
-                // wait until threads are done using it
-                if (pnode->GetRefCount() <= 0) {
-                    bool fDelete = false;
-                    {
-                        TRY_LOCK(pnode->cs_inventory, lockInv);
-                        if (lockInv) {
-                            TRY_LOCK(pnode->cs_vSend, lockSend);
-                            if (lockSend) {
-                                fDelete = true;
-                            }
-                        }
+                if (hListenSocket.socket != INVALID_SOCKET)
+                    AcceptConnection(hListenSocket);
+            }
+        }
+
+        //
+        // Receive
+        //
+        // As in the select() loop, a node with unsent data is not read from until
+        // its send buffer drained, to make use of TCP flow control.
+        fRecvRunnable = false;
+        size_t nKeep = 0;
+        for (CNode* pnode : vRecvReady)
+        {
+            if (interruptNet)
+                return;
+
+            bool fDrained = pnode->fDisconnect;
+            if (!fDrained && !pnode->fPauseRecv)
+            {
+                bool fSendPending;
+                {
+                    LOCK(pnode->cs_vSend);
+                    fSendPending = !pnode->vSendMsg.empty();
+                }
+                if (!fSendPending)
+                {
+                    bool fMore = true;
+                    for (int nReads = 0; fMore && nReads < EPOLL_MAX_READS && !pnode->fPauseRecv; nReads++) {
+                        fMore = SocketRecvData(pnode);
                     }
-                    if (fDelete) {
-                        vNodesDisconnected.remove(pnode);
-                        DeleteNode(pnode);
+                    fDrained = !fMore || pnode->fDisconnect;
+                    if (!fDrained && !pnode->fPauseRecv) {
+                        fRecvRunnable = true;
                     }
                 }
             }
+
+            if (fDrained) {
+                pnode->fRecvReady = false;
+                pnode->Release();
+            } else {
+                vRecvReady[nKeep++] = pnode;
+            }
         }
-        size_t vNodesSize;
+        vRecvReady.resize(nKeep);
+
+        //
+        // Inactivity checking
+        //
+        int64_t nTime = GetSystemTimeInSeconds();
+        if (nTime != nLastInactivityCheck)
         {
+            nLastInactivityCheck = nTime;
             LOCK(cs_vNodes);
-            vNodesSize = vNodes.size();
-        }
-        if(vNodesSize != nPrevNodeCount) {
-            nPrevNodeCount = vNodesSize;
-            if(clientInterface)
-                clientInterface->NotifyNumConnectionsChanged(nPrevNodeCount);
+            for (CNode* pnode : vNodes)
+                InactivityCheck(pnode);
         }
+    }
+}
+#else
+void CConnman::RegisterNodeSocket(CNode *pnode)
+{
+}
+
+void CConnman::ThreadSocketHandler()
+{
+    while (!interruptNet)
+    {
+        DisconnectNodes();
+        NotifyNumConnectionsChanged();
 
         //
         // Find which sockets have data to receive
@@ -1310,57 +1631,7 @@ void CConnman::ThreadSocketHandler()
             }
             if (recvSet || errorSet)
             {
-                // typical socket buffer is 8K-64K
-                char pchBuf[0x10000];
-                int nBytes = 0;
-                {
-                    LOCK(pnode->cs_hSocket);
-                    if (pnode->hSocket == INVALID_SOCKET)
-                        continue;
-                    nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-                }
-                if (nBytes > 0)
-                {
-                    bool notify = false;
-                    if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
-                        pnode->CloseSocketDisconnect();
-                    RecordBytesRecv(nBytes);
-                    if (notify) {
-                        size_t nSizeAdded = 0;
-                        auto it(pnode->vRecvMsg.begin());
-                        for (; it != pnode->vRecvMsg.end(); ++it) {
-                            if (!it->complete())
-                                break;
-                            nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
-                        }
-                        {
-                            LOCK(pnode->cs_vProcessMsg);
-                            pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
-                            pnode->nProcessQueueSize += nSizeAdded;
-                            pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
-                        }
-                        WakeMessageHandler();
-                    }
-                }
-                else if (nBytes == 0)
-                {
-                    // socket closed gracefully
-                    if (!pnode->fDisconnect) {
-                        LogPrint(BCLog::NET, "socket closed\n");
-                    }
-                    pnode->CloseSocketDisconnect();
-                }
-                else if (nBytes < 0)
-                {
-                    // error
-                    int nErr = WSAGetLastError();
-                    if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
-                    {
-                        if (!pnode->fDisconnect)
-                            LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
-                        pnode->CloseSocketDisconnect();
-                    }
-                }
+                SocketRecvData(pnode);
             }
 
             //
@@ -1378,35 +1649,7 @@ void CConnman::ThreadSocketHandler()
             //
             // Inactivity checking
             //
-            int64_t nTime = GetSystemTimeInSeconds();
-            if (nTime - pnode->nTimeConnected > 60)
-            {
-                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
-                {
-                    LogPrint(BCLog::NET, "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->GetId());
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
-                {
-                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
-                {
-                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
-                    pnode->fDisconnect = true;
-                }
-                else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
-                {
-                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
-                    pnode->fDisconnect = true;
-                }
-                else if (!pnode->fSuccessfullyConnected)
-                {
-                    LogPrintf("version handshake timeout from %d\n", pnode->GetId());
-                    pnode->fDisconnect = true;
-                }
-            }
+            InactivityCheck(pnode);
         }
         {
             LOCK(cs_vNodes);
@@ -1415,6 +1658,7 @@ void CConnman::ThreadSocketHandler()
         }
     }
 }
+#endif
 
 void CConnman::WakeMessageHandler()
 {
@@ -1995,6 +2239,8 @@ bool CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         pnode->m_manual_connection = true;
 
     m_msgproc->InitializeNode(pnode);
+    // Registered before the node is published, as from then on the socket handler may disconnect and delete it
+    RegisterNodeSocket(pnode);
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
@@ -2240,6 +2486,10 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) : nSeed0(nSeed0In), nSe
     semAddnode = nullptr;
     flagInterruptMsgProc = false;
     SetTryNewOutboundPeer(false);
+    nPrevNodeCount = 0;
+#ifdef USE_EPOLL
+    hEpoll = -1;
+#endif
 
     Options connOptions;
     Init(connOptions);
@@ -2281,6 +2531,26 @@ bool CConnman::InitBinds(const std::vector<CService>& binds, const std::vector<C
     return fBound;
 }
 
+#ifdef USE_EPOLL
+bool CConnman::InitSocketEvents()
+{
+    if (hEpoll == -1) {
+        hEpoll = epoll_create1(EPOLL_CLOEXEC);
+        if (hEpoll == -1)
+            return false;
+    }
+    // Listen sockets are registered level-triggered without a node, see ThreadSocketHandler
+    for (const ListenSocket& hListenSocket : vhListenSocket) {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;
+        if (epoll_ctl(hEpoll, EPOLL_CTL_ADD, hListenSocket.socket, &event) == SOCKET_ERROR && WSAGetLastError() != EEXIST)
+            return false;
+    }
+    return true;
+}
+#endif
+
 bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 {
     Init(connOptions);
@@ -2299,6 +2569,17 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         return false;
     }
 
+#ifdef USE_EPOLL
+    if (!InitSocketEvents()) {
+        if (clientInterface) {
+            clientInterface->ThreadSafeMessageBox(
+                strprintf(_("Failed to set up the socket event loop: %s"), NetworkErrorString(WSAGetLastError())),
+                "", CClientUIInterface::MSG_ERROR);
+        }
+        return false;
+    }
+#endif
+
     for (const auto& strDest : connOptions.vSeedNodes) {
         AddOneShot(strDest);
     }
@@ -2463,6 +2744,12 @@ void CConnman::Stop()
     vNodes.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
+#ifdef USE_EPOLL
+    if (hEpoll != -1) {
+        close(hEpoll);
+        hEpoll = -1;
+    }
+#endif
     delete semOutbound;
     semOutbound = nullptr;
     delete semAddnode;
@@ -2767,6 +3054,7 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nextSendTimeFeeFilter = 0;
     fPauseRecv = false;
     fPauseSend = false;
+    fRecvReady = false;
     nProcessQueueSize = 0;
 
     for (const std::string &msg : getAllNetMessageTypes())
@@ -2827,19 +3115,31 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
     return pnode && pnode->fSuccessfullyConnected && !pnode->fDisconnect;
 }
 
-void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+CNetMessageBuffer::CNetMessageBuffer(CSerializedNetMsg&& msg) : command(std::move(msg.command)), data(std::move(msg.data))
 {
-    size_t nMessageSize = msg.data.size();
-    size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
-    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->GetId());
-
-    std::vector<unsigned char> serializedHeader;
-    serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
-    uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
-    CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), nMessageSize);
+    header.reserve(CMessageHeader::HEADER_SIZE);
+    uint256 hash = Hash(data.data(), data.data() + data.size());
+    CMessageHeader hdr(Params().MessageStart(), command.c_str(), data.size());
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
-    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
+    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, header, 0, hdr};
+}
+
+CSharedNetMsg MakeSharedNetMsg(CSerializedNetMsg&& msg)
+{
+    return std::make_shared<const CNetMessageBuffer>(std::move(msg));
+}
+
+void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+{
+    PushMessage(pnode, MakeSharedNetMsg(std::move(msg)));
+}
+
+void CConnman::PushMessage(CNode* pnode, const CSharedNetMsg& msg)
+{
+    size_t nMessageSize = msg->data.size();
+    size_t nTotalSize = msg->size();
+    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg->command.c_str()), nMessageSize, pnode->GetId());
 
     size_t nBytesSent = 0;
     {
@@ -2847,14 +3147,12 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         bool optimisticSend(pnode->vSendMsg.empty());
 
         //log total amount of bytes per command
-        pnode->mapSendBytesPerMsgCmd[msg.command] += nTotalSize;
+        pnode->mapSendBytesPerMsgCmd[msg->command] += nTotalSize;
         pnode->nSendSize += nTotalSize;
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+        pnode->vSendMsg.push_back(msg);
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
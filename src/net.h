@@ -115,6 +115,25 @@ struct CSerializedNetMsg
     std::string command;
 };
 
+/** A message as it goes on the wire: header with checksum, followed by the payload.
+ *  It never changes once built, so one instance can be queued for any number of peers. */
+struct CNetMessageBuffer
+{
+    explicit CNetMessageBuffer(CSerializedNetMsg&& msg);
+    CNetMessageBuffer(const CNetMessageBuffer&) = delete;
+    CNetMessageBuffer& operator=(const CNetMessageBuffer&) = delete;
+
+    size_t size() const { return header.size() + data.size(); }
+
+    std::string command;
+    std::vector<unsigned char> header;
+    std::vector<unsigned char> data;
+};
+typedef std::shared_ptr<const CNetMessageBuffer> CSharedNetMsg;
+
+/** Serialize a message once, to be sent to several peers with CConnman::PushMessage */
+CSharedNetMsg MakeSharedNetMsg(CSerializedNetMsg&& msg);
+
 class NetEventsInterface;
 class CConnman
 {
@@ -177,6 +196,7 @@ public:
     bool ForNode(NodeId id, std::function<bool(CNode* pnode)> func);
 
     void PushMessage(CNode* pnode, CSerializedNetMsg&& msg);
+    void PushMessage(CNode* pnode, const CSharedNetMsg& msg);
 
     template<typename Callable>
     void ForEachNode(Callable&& func)
@@ -325,6 +345,16 @@ private:
     void ThreadOpenConnections();
     void ThreadMessageHandler();
     void AcceptConnection(const ListenSocket& hListenSocket);
+    void DisconnectNodes();
+    void NotifyNumConnectionsChanged();
+    void InactivityCheck(CNode *pnode);
+    /** Read once from the node's socket. Returns false when there is nothing more to read for now. */
+    bool SocketRecvData(CNode *pnode);
+    /** Start watching a new node's socket in the socket handler's event loop (epoll only). */
+    void RegisterNodeSocket(CNode *pnode);
+#ifdef USE_EPOLL
+    bool InitSocketEvents();
+#endif
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
 
@@ -381,6 +411,10 @@ private:
     unsigned int nReceiveFloodSize;
 
     std::vector<ListenSocket> vhListenSocket;
+#ifdef USE_EPOLL
+    /** epoll instance of the socket handler, with the listen sockets and every node socket registered */
+    int hEpoll;
+#endif
     std::atomic<bool> fNetworkActive;
     banmap_t setBanned;
     CCriticalSection cs_setBanned;
@@ -394,6 +428,7 @@ private:
     std::vector<CNode*> vNodes;
     std::list<CNode*> vNodesDisconnected;
     mutable CCriticalSection cs_vNodes;
+    unsigned int nPrevNodeCount;
     std::atomic<NodeId> nLastNodeId;
 
     /** Services this instance offers */
@@ -606,7 +641,7 @@ public:
     size_t nSendSize; // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<std::vector<unsigned char>> vSendMsg;
+    std::deque<CSharedNetMsg> vSendMsg;
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
     CCriticalSection cs_vRecv;
@@ -658,6 +693,8 @@ public:
     const uint64_t nKeyedNetGroup;
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+    // Socket is readable but not drained yet (epoll socket handler only)
+    bool fRecvReady;
 protected:
 
     mapMsgCmdSize mapSendBytesPerMsgCmd;
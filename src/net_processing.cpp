@@ -8,6 +8,7 @@
 #include "addrman.h"
 #include "arith_uint256.h"
 #include "blockencodings.h"
+#include "blockrelaycache.h"
 #include "chainparams.h"
 #include "consensus/validation.h"
 #include "hash.h"
@@ -837,6 +838,76 @@ static std::shared_ptr<const CBlock> most_recent_block;
 static std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_block;
 static uint256 most_recent_block_hash;
 static bool fWitnessesPresentInMostRecentCompactBlock;
+// Wire messages for the most recent block, serialized on first use and then shared by every
+// peer they are sent to. Indexed by whether witness data is included.
+static CSharedNetMsg most_recent_block_msg[2];
+static CSharedNetMsg most_recent_compact_block_msg[2];
+// A headers message announcing just the most recent header
+static CSharedNetMsg most_recent_headers_msg;
+static uint256 most_recent_headers_hash;
+
+/** block message for the most recent block, or nullptr if hashBlock is not the most recent block */
+static CSharedNetMsg GetRecentBlockMsg(const uint256& hashBlock, bool fWitness)
+{
+    LOCK(cs_most_recent_block);
+    if (!most_recent_block || most_recent_block_hash != hashBlock)
+        return nullptr;
+    CSharedNetMsg& msg = most_recent_block_msg[fWitness];
+    if (!msg) {
+        int nSendFlags = fWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
+        msg = MakeSharedNetMsg(CNetMsgMaker(PROTOCOL_VERSION).Make(nSendFlags, NetMsgType::BLOCK, *most_recent_block));
+    }
+    return msg;
+}
+
+/** cmpctblock message for the most recent block, or nullptr if hashBlock is not the most recent block
+ *  or the cached compact block does not match the witness preference. */
+static CSharedNetMsg GetRecentCompactBlockMsg(const uint256& hashBlock, bool fWitness)
+{
+    LOCK(cs_most_recent_block);
+    if (!most_recent_compact_block || most_recent_block_hash != hashBlock)
+        return nullptr;
+    // the cached compact block is built with witnesses, which only suits peers without them if there are none
+    if (!fWitness && fWitnessesPresentInMostRecentCompactBlock)
+        return nullptr;
+    CSharedNetMsg& msg = most_recent_compact_block_msg[fWitness];
+    if (!msg) {
+        int nSendFlags = fWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
+        msg = MakeSharedNetMsg(CNetMsgMaker(PROTOCOL_VERSION).Make(nSendFlags, NetMsgType::CMPCTBLOCK, *most_recent_compact_block));
+    }
+    return msg;
+}
+
+/** headers message announcing a single header, shared while it is the latest one announced */
+static CSharedNetMsg GetHeaderMsg(const CBlock& header)
+{
+    uint256 hash = header.GetHash();
+    LOCK(cs_most_recent_block);
+    if (!most_recent_headers_msg || most_recent_headers_hash != hash) {
+        std::vector<CBlock> vHeaders(1, header);
+        most_recent_headers_msg = MakeSharedNetMsg(CNetMsgMaker(PROTOCOL_VERSION).Make(NetMsgType::HEADERS, vHeaders));
+        most_recent_headers_hash = hash;
+    }
+    return most_recent_headers_msg;
+}
+
+// Serialized recent blocks, so that peers catching up near the tip are served without
+// reading and deserializing the same blocks over and over
+static CBlockRelayCache blockRelayCache(BLOCK_RELAY_CACHE_SIZE);
+
+/** Make sure a recent block is in blockRelayCache. Returns false for blocks too deep to be cached. */
+static bool LoadRelayCache(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    if (pindex->nHeight < chainActive.Height() - BLOCK_RELAY_CACHE_DEPTH)
+        return false;
+    if (blockRelayCache.Contains(pindex->GetBlockHash()))
+        return true;
+    std::vector<unsigned char> vBlock;
+    if (!ReadRawBlockFromDisk(vBlock, pindex, Params().MessageStart()))
+        return false;
+    return blockRelayCache.Insert(pindex->GetBlockHash(), std::move(vBlock));
+}
 
 void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) {
     std::shared_ptr<const CBlockHeaderAndShortTxIDs> pcmpctblock = std::make_shared<const CBlockHeaderAndShortTxIDs> (*pblock, true);
@@ -858,10 +929,15 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
         most_recent_block = pblock;
         most_recent_compact_block = pcmpctblock;
         fWitnessesPresentInMostRecentCompactBlock = fWitnessEnabled;
+        for (CSharedNetMsg& msg : most_recent_block_msg)
+            msg.reset();
+        for (CSharedNetMsg& msg : most_recent_compact_block_msg)
+            msg.reset();
     }
 
-    connman->ForEachNode([this, &pcmpctblock, pindex, &msgMaker, fWitnessEnabled, &hashBlock](CNode* pnode) {
-        // TODO: Avoid the repeated-serialization here
+    // Serialized once and shared by all peers it is announced to, and with later getdata requests
+    CSharedNetMsg msgCmpctBlock;
+    connman->ForEachNode([this, &pcmpctblock, pindex, &msgMaker, fWitnessEnabled, &hashBlock, &msgCmpctBlock](CNode* pnode) {
         if (pnode->nVersion < INVALID_CB_NO_BAN_VERSION || pnode->fDisconnect)
             return;
         ProcessBlockAvailability(pnode->GetId());
@@ -873,7 +949,11 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
 
             LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", "PeerLogicValidation::NewPoWValidBlock",
                     hashBlock.ToString(), pnode->GetId());
-            connman->PushMessage(pnode, msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+            if (!msgCmpctBlock)
+                msgCmpctBlock = GetRecentCompactBlockMsg(hashBlock, true);
+            if (!msgCmpctBlock)
+                msgCmpctBlock = MakeSharedNetMsg(msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+            connman->PushMessage(pnode, msgCmpctBlock);
             state.pindexBestHeaderSent = pindex;
         }
     });
@@ -1100,8 +1180,29 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 // it's available before trying to send.
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
                 {
+                    // Recent blocks are sent straight from their serialized form when possible
+                    const uint256& hashBlock = mi->second->GetBlockHash();
+                    CSharedNetMsg msgCached;
+                    if (inv.type == MSG_BLOCK || inv.type == MSG_WITNESS_BLOCK) {
+                        msgCached = GetRecentBlockMsg(hashBlock, inv.type == MSG_WITNESS_BLOCK);
+                        if (!msgCached && LoadRelayCache(mi->second))
+                            msgCached = blockRelayCache.GetBlockMsg(hashBlock, inv.type == MSG_WITNESS_BLOCK);
+                    } else if (inv.type == MSG_CMPCT_BLOCK) {
+                        // Same choice between a compact and a full block as below
+                        bool fPeerWantsWitness = State(pfrom->GetId())->fWantsCmpctWitness;
+                        if (CanDirectFetch(consensusParams) && mi->second->nHeight >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH) {
+                            msgCached = GetRecentCompactBlockMsg(hashBlock, fPeerWantsWitness);
+                            if (!msgCached && LoadRelayCache(mi->second))
+                                msgCached = blockRelayCache.GetCompactBlockMsg(hashBlock, fPeerWantsWitness);
+                        } else if (LoadRelayCache(mi->second)) {
+                            msgCached = blockRelayCache.GetBlockMsg(hashBlock, fPeerWantsWitness);
+                        }
+                    }
+
                     std::shared_ptr<const CBlock> pblock;
-                    if (a_recent_block && a_recent_block->GetHash() == (*mi).second->GetBlockHash()) {
+                    if (msgCached) {
+                        // The block itself is not needed
+                    } else if (a_recent_block && a_recent_block->GetHash() == (*mi).second->GetBlockHash()) {
                         pblock = a_recent_block;
                     } else {
                         // Send block from disk
@@ -1110,7 +1211,9 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                             assert(!"cannot load block from disk");
                         pblock = pblockRead;
                     }
-                    if (inv.type == MSG_BLOCK)
+                    if (msgCached)
+                        connman->PushMessage(pfrom, msgCached);
+                    else if (inv.type == MSG_BLOCK)
                         connman->PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, *pblock));
                     else if (inv.type == MSG_WITNESS_BLOCK)
                         connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
@@ -2003,6 +2106,17 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             return true;
         }
 
+        CSharedNetMsg msgBlockTxn;
+        if (LoadRelayCache(it->second) && blockRelayCache.GetBlockTxnMsg(req, State(pfrom->GetId())->fWantsCmpctWitness, msgBlockTxn)) {
+            if (!msgBlockTxn) {
+                Misbehaving(pfrom->GetId(), 100);
+                LogPrintf("Peer %d sent us a getblocktxn with out-of-bounds tx indices", pfrom->GetId());
+                return true;
+            }
+            connman->PushMessage(pfrom, msgBlockTxn);
+            return true;
+        }
+
         CBlock block;
         bool ret = ReadBlockFromDisk(block, it->second, chainparams.GetConsensus());
         assert(ret);
@@ -3307,7 +3421,11 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                     int nSendFlags = state.fWantsCmpctWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
 
                     bool fGotBlockFromCache = false;
-                    {
+                    CSharedNetMsg msgRecentCompactBlock = GetRecentCompactBlockMsg(pBestIndex->GetBlockHash(), state.fWantsCmpctWitness);
+                    if (msgRecentCompactBlock) {
+                        connman->PushMessage(pto, msgRecentCompactBlock);
+                        fGotBlockFromCache = true;
+                    } else {
                         LOCK(cs_most_recent_block);
                         if (most_recent_block_hash == pBestIndex->GetBlockHash()) {
                             if (state.fWantsCmpctWitness || !fWitnessesPresentInMostRecentCompactBlock)
@@ -3337,7 +3455,10 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                         LogPrint(BCLog::NET, "%s: sending header %s to peer=%d\n", __func__,
                                 vHeaders.front().GetHash().ToString(), pto->GetId());
                     }
-                    connman->PushMessage(pto, msgMaker.Make(NetMsgType::HEADERS, vHeaders));
+                    if (vHeaders.size() == 1)
+                        connman->PushMessage(pto, GetHeaderMsg(vHeaders.front()));
+                    else
+                        connman->PushMessage(pto, msgMaker.Make(NetMsgType::HEADERS, vHeaders));
                     state.pindexBestHeaderSent = pBestIndex;
                 } else
                     fRevertToInv = true;
@@ -38,6 +38,10 @@ static constexpr int64_t STALE_CHECK_INTERVAL = 10 * 60; // 10 minutes
 static constexpr int64_t EXTRA_PEER_CHECK_INTERVAL = 45;
 /** Minimum time an outbound-peer-eviction candidate must be connected for, in order to evict, in seconds */
 static constexpr int64_t MINIMUM_CONNECT_TIME = 30;
+/** Memory used by serialized recent blocks kept for serving them to peers, in bytes */
+static const size_t BLOCK_RELAY_CACHE_SIZE = 64 * 1024 * 1024;
+/** Blocks deeper than this below the tip are read from disk each time they are requested */
+static const int BLOCK_RELAY_CACHE_DEPTH = 500;
 
 class PeerLogicValidation : public CValidationInterface, public NetEventsInterface {
 private:
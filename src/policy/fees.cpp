@@ -523,6 +523,10 @@ bool CBlockPolicyEstimator::removeTx(uint256 hash, bool inBlock)
         feeStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
         shortStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
         longStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
+        if (pos->second.gasClass >= 0) {
+            gasShortStats[pos->second.gasClass]->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.gasBucketIndex, inBlock);
+            gasStats[pos->second.gasClass]->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.gasBucketIndex, inBlock);
+        }
         mapMemPoolTxs.erase(hash);
         return true;
     } else {
@@ -546,6 +550,21 @@ CBlockPolicyEstimator::CBlockPolicyEstimator()
     feeStats = new TxConfirmStats(buckets, bucketMap, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE);
     shortStats = new TxConfirmStats(buckets, bucketMap, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE);
     longStats = new TxConfirmStats(buckets, bucketMap, LONG_BLOCK_PERIODS, LONG_DECAY, LONG_SCALE);
+
+    static_assert(MIN_BUCKET_GASPRICE > 0, "Min gas price must be nonzero");
+    bucketIndex = 0;
+    for (double bucketBoundary = MIN_BUCKET_GASPRICE; bucketBoundary <= MAX_BUCKET_GASPRICE; bucketBoundary *= FEE_SPACING, bucketIndex++) {
+        gasBuckets.push_back(bucketBoundary);
+        gasBucketMap[bucketBoundary] = bucketIndex;
+    }
+    gasBuckets.push_back(INF_FEERATE);
+    gasBucketMap[INF_FEERATE] = bucketIndex;
+    assert(gasBucketMap.size() == gasBuckets.size());
+
+    for (unsigned int i = 0; i < GAS_LIMIT_CLASSES; i++) {
+        gasShortStats.emplace_back(new TxConfirmStats(gasBuckets, gasBucketMap, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE));
+        gasStats.emplace_back(new TxConfirmStats(gasBuckets, gasBucketMap, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
+    }
 }
 
 CBlockPolicyEstimator::~CBlockPolicyEstimator()
@@ -592,6 +611,16 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
     assert(bucketIndex == bucketIndex2);
     unsigned int bucketIndex3 = longStats->NewTx(txHeight, (double)feeRate.GetFeePerK());
     assert(bucketIndex == bucketIndex3);
+
+    // Contract transactions are also tracked by the lowest gas price of their contract outputs
+    if (entry.GetMinGasPrice() > 0) {
+        unsigned int gasClass = GasLimitClass(entry.GetGasLimit());
+        mapMemPoolTxs[hash].gasClass = gasClass;
+        unsigned int gasBucketIndex = gasStats[gasClass]->NewTx(txHeight, (double)entry.GetMinGasPrice());
+        mapMemPoolTxs[hash].gasBucketIndex = gasBucketIndex;
+        unsigned int gasBucketIndex2 = gasShortStats[gasClass]->NewTx(txHeight, (double)entry.GetMinGasPrice());
+        assert(gasBucketIndex == gasBucketIndex2);
+    }
 }
 
 bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry)
@@ -618,6 +647,12 @@ bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
     feeStats->Record(blocksToConfirm, (double)feeRate.GetFeePerK());
     shortStats->Record(blocksToConfirm, (double)feeRate.GetFeePerK());
     longStats->Record(blocksToConfirm, (double)feeRate.GetFeePerK());
+
+    if (entry->GetMinGasPrice() > 0) {
+        unsigned int gasClass = GasLimitClass(entry->GetGasLimit());
+        gasShortStats[gasClass]->Record(blocksToConfirm, (double)entry->GetMinGasPrice());
+        gasStats[gasClass]->Record(blocksToConfirm, (double)entry->GetMinGasPrice());
+    }
     return true;
 }
 
@@ -643,11 +678,19 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
     feeStats->ClearCurrent(nBlockHeight);
     shortStats->ClearCurrent(nBlockHeight);
     longStats->ClearCurrent(nBlockHeight);
+    for (unsigned int i = 0; i < GAS_LIMIT_CLASSES; i++) {
+        gasShortStats[i]->ClearCurrent(nBlockHeight);
+        gasStats[i]->ClearCurrent(nBlockHeight);
+    }
 
     // Decay all exponential averages
     feeStats->UpdateMovingAverages();
     shortStats->UpdateMovingAverages();
     longStats->UpdateMovingAverages();
+    for (unsigned int i = 0; i < GAS_LIMIT_CLASSES; i++) {
+        gasShortStats[i]->UpdateMovingAverages();
+        gasStats[i]->UpdateMovingAverages();
+    }
 
     unsigned int countedTxs = 0;
     // Update averages with data points from current block
@@ -904,6 +947,96 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
     return CFeeRate(median);
 }
 
+unsigned int CBlockPolicyEstimator::GasLimitClass(uint64_t gasLimit)
+{
+    if (gasLimit <= GAS_LIMIT_CLASS_SMALL) return 0;
+    if (gasLimit <= GAS_LIMIT_CLASS_MEDIUM) return 1;
+    return 2;
+}
+
+/** Return a gas price estimate from the shortest time horizon which tracks the
+ * target, or from the highest target of the short horizon if that is lower */
+double CBlockPolicyEstimator::estimateCombinedGasPrice(unsigned int gasClass, unsigned int confTarget, double successThreshold, EstimationResult *result) const
+{
+    const TxConfirmStats& shortGasStats = *gasShortStats[gasClass];
+    const TxConfirmStats& medGasStats = *gasStats[gasClass];
+    double estimate = -1;
+    if (confTarget >= 1 && confTarget <= medGasStats.GetMaxConfirms()) {
+        if (confTarget <= shortGasStats.GetMaxConfirms()) {
+            estimate = shortGasStats.EstimateMedianVal(confTarget, SUFFICIENT_TXS_SHORT, successThreshold, true, nBestSeenHeight, result);
+        } else {
+            estimate = medGasStats.EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, successThreshold, true, nBestSeenHeight, result);
+            EstimationResult tempResult;
+            double shortMax = shortGasStats.EstimateMedianVal(shortGasStats.GetMaxConfirms(), SUFFICIENT_TXS_SHORT, successThreshold, true, nBestSeenHeight, &tempResult);
+            if (shortMax > 0 && (estimate == -1 || shortMax < estimate)) {
+                estimate = shortMax;
+                if (result) *result = tempResult;
+            }
+        }
+    }
+    return estimate;
+}
+
+/** estimateGasPrice works like an economical estimateSmartFee on the gas price
+ * data of the gas limit class: the max of the gas prices calculated with a 60%
+ * threshold required at target / 2, an 85% threshold required at target and a
+ * 95% threshold required at 2 * target.
+ */
+CAmount CBlockPolicyEstimator::estimateGasPrice(int confTarget, uint64_t gasLimit, FeeCalculation *feeCalc) const
+{
+    LOCK(cs_feeEstimator);
+
+    if (feeCalc) {
+        feeCalc->desiredTarget = confTarget;
+        feeCalc->returnedTarget = confTarget;
+    }
+
+    unsigned int gasClass = GasLimitClass(gasLimit);
+
+    // Return failure if trying to analyze a target we're not tracking
+    if (confTarget <= 0 || (unsigned int)confTarget > gasStats[gasClass]->GetMaxConfirms()) {
+        return 0;
+    }
+
+    // It's not possible to get reasonable estimates for confTarget of 1
+    if (confTarget == 1) confTarget = 2;
+
+    unsigned int maxUsableEstimate = MaxUsableEstimate();
+    if ((unsigned int)confTarget > maxUsableEstimate) {
+        confTarget = maxUsableEstimate;
+    }
+    if (feeCalc) feeCalc->returnedTarget = confTarget;
+
+    if (confTarget <= 1) return 0; // error condition
+
+    EstimationResult tempResult;
+    double median = estimateCombinedGasPrice(gasClass, confTarget/2, HALF_SUCCESS_PCT, &tempResult);
+    if (feeCalc) {
+        feeCalc->est = tempResult;
+        feeCalc->reason = FeeReason::HALF_ESTIMATE;
+    }
+    double actualEst = estimateCombinedGasPrice(gasClass, confTarget, SUCCESS_PCT, &tempResult);
+    if (actualEst > median) {
+        median = actualEst;
+        if (feeCalc) {
+            feeCalc->est = tempResult;
+            feeCalc->reason = FeeReason::FULL_ESTIMATE;
+        }
+    }
+    double doubleEst = estimateCombinedGasPrice(gasClass, 2 * confTarget, DOUBLE_SUCCESS_PCT, &tempResult);
+    if (doubleEst > median) {
+        median = doubleEst;
+        if (feeCalc) {
+            feeCalc->est = tempResult;
+            feeCalc->reason = FeeReason::DOUBLE_ESTIMATE;
+        }
+    }
+
+    if (median < 0) return 0; // error condition
+
+    return CAmount(median);
+}
+
 
 bool CBlockPolicyEstimator::Write(CAutoFile& fileout) const
 {
@@ -922,6 +1055,11 @@ bool CBlockPolicyEstimator::Write(CAutoFile& fileout) const
         feeStats->Write(fileout);
         shortStats->Write(fileout);
         longStats->Write(fileout);
+        fileout << gasBuckets;
+        for (unsigned int i = 0; i < GAS_LIMIT_CLASSES; i++) {
+            gasShortStats[i]->Write(fileout);
+            gasStats[i]->Write(fileout);
+        }
     }
     catch (const std::exception&) {
         LogPrintf("CBlockPolicyEstimator::Write(): unable to write policy estimator data (non-fatal)\n");
@@ -1007,6 +1145,8 @@ bool CBlockPolicyEstimator::Read(CAutoFile& filein)
             nBestSeenHeight = nFileBestSeenHeight;
             historicalFirst = nFileHistoricalFirst;
             historicalBest = nFileHistoricalBest;
+
+            ReadGasStats(filein, nVersionThatWrote);
         }
     }
     catch (const std::exception& e) {
@@ -1016,6 +1156,39 @@ bool CBlockPolicyEstimator::Read(CAutoFile& filein)
     return true;
 }
 
+void CBlockPolicyEstimator::ReadGasStats(CAutoFile& filein, int nFileVersion)
+{
+    // Files written before gas prices were tracked end after the feerate data,
+    // so failing to read the gas price data leaves the feerate data intact
+    try {
+        std::vector<double> fileGasBuckets;
+        filein >> fileGasBuckets;
+        size_t numBuckets = fileGasBuckets.size();
+        if (numBuckets <= 1 || numBuckets > 1000)
+            throw std::runtime_error("Corrupt estimates file. Must have between 2 and 1000 gas price buckets");
+
+        std::vector<std::unique_ptr<TxConfirmStats>> fileGasShortStats;
+        std::vector<std::unique_ptr<TxConfirmStats>> fileGasStats;
+        for (unsigned int i = 0; i < GAS_LIMIT_CLASSES; i++) {
+            fileGasShortStats.emplace_back(new TxConfirmStats(gasBuckets, gasBucketMap, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE));
+            fileGasShortStats.back()->Read(filein, nFileVersion, numBuckets);
+            fileGasStats.emplace_back(new TxConfirmStats(gasBuckets, gasBucketMap, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
+            fileGasStats.back()->Read(filein, nFileVersion, numBuckets);
+        }
+
+        gasBuckets = fileGasBuckets;
+        gasBucketMap.clear();
+        for (unsigned int i = 0; i < gasBuckets.size(); i++) {
+            gasBucketMap[gasBuckets[i]] = i;
+        }
+        gasShortStats.swap(fileGasShortStats);
+        gasStats.swap(fileGasStats);
+    }
+    catch (const std::exception& e) {
+        LogPrint(BCLog::ESTIMATEFEE, "CBlockPolicyEstimator::Read(): no gas price estimates read, starting from scratch: %s\n", e.what());
+    }
+}
+
 void CBlockPolicyEstimator::FlushUnconfirmed(CTxMemPool& pool) {
     int64_t startclear = GetTimeMicros();
     std::vector<uint256> txids;
@@ -12,6 +12,7 @@
 #include "sync.h"
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -185,6 +186,20 @@ private:
      */
     static constexpr double FEE_SPACING = 1.05;
 
+    /** Minimum and Maximum values for tracking gas prices of contract transactions,
+     * in satoshis per gas. The spacing is the same as for feerates.
+     */
+    static constexpr double MIN_BUCKET_GASPRICE = 10;
+    static constexpr double MAX_BUCKET_GASPRICE = 1e5;
+
+    /** Contract transactions are tracked separately by the total gas limit of their
+     * contract outputs, as larger gas limits are harder to fit into a block.
+     * Gas limits up to each of these values form a class, larger ones the last class.
+     */
+    static constexpr uint64_t GAS_LIMIT_CLASS_SMALL = 250000;
+    static constexpr uint64_t GAS_LIMIT_CLASS_MEDIUM = 2500000;
+    static constexpr unsigned int GAS_LIMIT_CLASSES = 3;
+
 public:
     /** Create new BlockPolicyEstimator and initialize stats tracking classes with default values */
     CBlockPolicyEstimator();
@@ -228,6 +243,13 @@ public:
     /** Calculation of highest target that estimates are tracked for */
     unsigned int HighestTargetTracked(FeeEstimateHorizon horizon) const;
 
+    /** Estimate the gas price (in satoshis per gas) needed for a contract transaction
+     *  with the given total gas limit to be included in a block within confTarget blocks.
+     *  Estimates are made the same way as economical estimateSmartFee estimates, from
+     *  the short and medium time horizons. Returns 0 if no estimate can be given.
+     */
+    CAmount estimateGasPrice(int confTarget, uint64_t gasLimit, FeeCalculation *feeCalc) const;
+
 private:
     unsigned int nBestSeenHeight;
     unsigned int firstRecordedHeight;
@@ -238,7 +260,10 @@ private:
     {
         unsigned int blockHeight;
         unsigned int bucketIndex;
-        TxStatsInfo() : blockHeight(0), bucketIndex(0) {}
+        // Gas limit class and gas price bucket of contract transactions, gasClass is -1 for others
+        int gasClass;
+        unsigned int gasBucketIndex;
+        TxStatsInfo() : blockHeight(0), bucketIndex(0), gasClass(-1), gasBucketIndex(0) {}
     };
 
     // map of txids to information about that transaction
@@ -255,6 +280,13 @@ private:
     std::vector<double> buckets;              // The upper-bound of the range for the bucket (inclusive)
     std::map<double, unsigned int> bucketMap; // Map of bucket upper-bound to index into all vectors by bucket
 
+    /** Gas price confirmation data of contract transactions, one per gas limit class */
+    std::vector<std::unique_ptr<TxConfirmStats>> gasShortStats;
+    std::vector<std::unique_ptr<TxConfirmStats>> gasStats;
+
+    std::vector<double> gasBuckets;              // Same as buckets, for gas prices
+    std::map<double, unsigned int> gasBucketMap;
+
     mutable CCriticalSection cs_feeEstimator;
 
     /** Process a transaction confirmed in a block*/
@@ -264,6 +296,12 @@ private:
     double estimateCombinedFee(unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const;
     /** Helper for estimateSmartFee */
     double estimateConservativeFee(unsigned int doubleTarget, EstimationResult *result) const;
+    /** Helper for estimateGasPrice, estimateCombinedFee for one gas limit class */
+    double estimateCombinedGasPrice(unsigned int gasClass, unsigned int confTarget, double successThreshold, EstimationResult *result) const;
+    /** Gas limit class of a contract transaction */
+    static unsigned int GasLimitClass(uint64_t gasLimit);
+    /** Read the gas price data following the feerate data in the estimates file */
+    void ReadGasStats(CAutoFile& filein, int nFileVersion);
     /** Number of blocks of data recorded while fee estimates have been running */
     unsigned int BlockSpan() const;
     /** Number of blocks of recorded fee estimate data represented in saved data file */
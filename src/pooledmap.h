@@ -0,0 +1,390 @@
+// Copyright (c) 2018 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_POOLEDMAP_H
+#define BITCOIN_POOLEDMAP_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <iterator>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/* Hash map with open addressing, whose entries live in a pool of nodes.
+ *
+ * Implements the subset of std::unordered_map used for the coins cache.
+ * Entries are constructed in place in nodes that are carved out of large
+ * chunks, rather than being allocated one by one. The hash table itself only
+ * holds 32 bits of each key's hash and the index of its node, and is probed
+ * linearly, so a lookup touches one or two cache lines of the table plus the
+ * node of the matching key.
+ *
+ * Differences from std::unordered_map:
+ * - Iteration walks the nodes in the order of their chunks, not the table.
+ *   Erasing entries while iterating is fine; inserting while iterating may
+ *   or may not visit the new entry.
+ * - Nodes never move, so iterators and references stay valid until the
+ *   entry is erased or the map is cleared, also when the table grows.
+ * - clear() releases all memory, and the exact amount of memory held is
+ *   known (see memusage::DynamicUsage).
+ */
+template <class K, class T, class Hash>
+class pooledmap
+{
+public:
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef std::pair<const K, T> value_type;
+    typedef size_t size_type;
+
+private:
+    struct node
+    {
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type storage;
+        //! low 32 bits of the key's hash when used, next free node + 1 when not
+        uint32_t hash;
+        bool used;
+
+        value_type& value() { return *reinterpret_cast<value_type*>(&storage); }
+    };
+
+    struct slot
+    {
+        uint32_t hash;
+        //! index of the node + 1, 0 for an empty slot
+        uint32_t node;
+    };
+
+    struct chunk
+    {
+        node* nodes;
+        uint32_t capacity;
+    };
+
+    //! The first chunk holds 2^MIN_CHUNK_SHIFT nodes, every next one twice as many, up to 2^MAX_CHUNK_SHIFT.
+    static const int MIN_CHUNK_SHIFT = 4;
+    static const int MAX_CHUNK_SHIFT = 14;
+    static const uint32_t MIN_TABLE_SIZE = 16;
+
+    std::vector<chunk> chunks;
+    //! number of nodes handed out from the last chunk
+    uint32_t last_used;
+    //! first node on the free list + 1, or 0
+    uint32_t free_list;
+    std::vector<slot> table;
+    size_type entries;
+    Hash hasher;
+
+    static uint32_t chunk_size(size_t index)
+    {
+        return uint32_t(1) << (index < MAX_CHUNK_SHIFT - MIN_CHUNK_SHIFT ? MIN_CHUNK_SHIFT + index : MAX_CHUNK_SHIFT);
+    }
+
+    //! Number of nodes before chunk index
+    static uint32_t chunk_start(size_t index)
+    {
+        if (index <= MAX_CHUNK_SHIFT - MIN_CHUNK_SHIFT) {
+            return (uint32_t(1) << (MIN_CHUNK_SHIFT + index)) - (uint32_t(1) << MIN_CHUNK_SHIFT);
+        }
+        return (uint32_t(1) << MAX_CHUNK_SHIFT) - (uint32_t(1) << MIN_CHUNK_SHIFT) + (index - (MAX_CHUNK_SHIFT - MIN_CHUNK_SHIFT)) * (uint32_t(1) << MAX_CHUNK_SHIFT);
+    }
+
+    //! Chunk and position within it of node index
+    static void locate(uint32_t index, size_t& c, uint32_t& pos)
+    {
+        const uint32_t grown = (uint32_t(1) << MAX_CHUNK_SHIFT) - (uint32_t(1) << MIN_CHUNK_SHIFT);
+        if (index >= grown) {
+            index -= grown;
+            c = MAX_CHUNK_SHIFT - MIN_CHUNK_SHIFT + (index >> MAX_CHUNK_SHIFT);
+            pos = index & ((uint32_t(1) << MAX_CHUNK_SHIFT) - 1);
+            return;
+        }
+        // Chunk c starts at 2^(MIN+c) - 2^MIN, so it follows from the highest bit of index + 2^MIN.
+        uint32_t shifted = index + (uint32_t(1) << MIN_CHUNK_SHIFT);
+        int bit = 31 - __builtin_clz(shifted);
+        c = bit - MIN_CHUNK_SHIFT;
+        pos = shifted - (uint32_t(1) << bit);
+    }
+
+    node* get_node(uint32_t index) const
+    {
+        size_t c;
+        uint32_t pos;
+        locate(index, c, pos);
+        return chunks[c].nodes + pos;
+    }
+
+    uint32_t allocate_node()
+    {
+        if (free_list) {
+            uint32_t index = free_list - 1;
+            free_list = get_node(index)->hash;
+            return index;
+        }
+        if (chunks.empty() || last_used == chunks.back().capacity) {
+            chunk c;
+            c.capacity = chunk_size(chunks.size());
+            c.nodes = static_cast<node*>(::operator new(sizeof(node) * c.capacity));
+            chunks.push_back(c);
+            last_used = 0;
+        }
+        uint32_t index = chunk_start(chunks.size() - 1) + last_used;
+        chunks.back().nodes[last_used].used = false;
+        last_used++;
+        return index;
+    }
+
+    void free_node(uint32_t index)
+    {
+        node* n = get_node(index);
+        n->used = false;
+        n->hash = free_list;
+        free_list = index + 1;
+    }
+
+    //! Position of the slot referring to node index, or of the empty slot ending its probe sequence.
+    size_t find_slot(uint32_t hash, const K& key) const
+    {
+        size_t mask = table.size() - 1;
+        for (size_t pos = hash & mask; ; pos = (pos + 1) & mask) {
+            const slot& s = table[pos];
+            if (s.node == 0 || (s.hash == hash && get_node(s.node - 1)->value().first == key)) {
+                return pos;
+            }
+        }
+    }
+
+    void grow()
+    {
+        std::vector<slot> old;
+        old.swap(table);
+        table.assign(old.empty() ? MIN_TABLE_SIZE : old.size() * 2, slot{0, 0});
+        size_t mask = table.size() - 1;
+        for (const slot& s : old) {
+            if (s.node) {
+                size_t pos = s.hash & mask;
+                while (table[pos].node) {
+                    pos = (pos + 1) & mask;
+                }
+                table[pos] = s;
+            }
+        }
+    }
+
+    //! Remove the slot at pos, moving later entries of the same probe sequence back.
+    void erase_slot(size_t pos)
+    {
+        size_t mask = table.size() - 1;
+        size_t next = pos;
+        while (true) {
+            next = (next + 1) & mask;
+            if (table[next].node == 0) break;
+            size_t ideal = table[next].hash & mask;
+            // Move the entry back if its ideal position is not in (pos, next].
+            if ((next > pos && (ideal <= pos || ideal > next)) || (next < pos && (ideal <= pos && ideal > next))) {
+                table[pos] = table[next];
+                pos = next;
+            }
+        }
+        table[pos] = slot{0, 0};
+    }
+
+    template <bool Const>
+    class iter
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename pooledmap::value_type value_type;
+        typedef ptrdiff_t difference_type;
+        typedef typename std::conditional<Const, const value_type*, value_type*>::type pointer;
+        typedef typename std::conditional<Const, const value_type&, value_type&>::type reference;
+
+        iter() : map(nullptr), c(0), pos(0) {}
+        // Converts an iterator into a const_iterator.
+        template <bool C, typename = typename std::enable_if<Const && !C>::type>
+        iter(const iter<C>& other) : map(other.map), c(other.c), pos(other.pos) {}
+
+        reference operator*() const { return map->chunks[c].nodes[pos].value(); }
+        pointer operator->() const { return &map->chunks[c].nodes[pos].value(); }
+
+        iter& operator++() { pos++; skip(); return *this; }
+        iter operator++(int) { iter copy(*this); ++*this; return copy; }
+
+        template <bool C>
+        bool operator==(const iter<C>& other) const { return c == other.c && pos == other.pos; }
+        template <bool C>
+        bool operator!=(const iter<C>& other) const { return !(*this == other); }
+
+    private:
+        friend class pooledmap;
+        template <bool> friend class iter;
+
+        const pooledmap* map;
+        size_t c;
+        uint32_t pos;
+
+        iter(const pooledmap* m, size_t chunkIn, uint32_t posIn) : map(m), c(chunkIn), pos(posIn) {}
+
+        //! Advance to the next used node, or to end().
+        void skip()
+        {
+            while (c < map->chunks.size()) {
+                const chunk& ch = map->chunks[c];
+                uint32_t limit = c + 1 == map->chunks.size() ? map->last_used : ch.capacity;
+                while (pos < limit && !ch.nodes[pos].used) {
+                    pos++;
+                }
+                if (pos < limit) return;
+                c++;
+                pos = 0;
+            }
+        }
+    };
+
+    iter<false> make_iterator(uint32_t index) const
+    {
+        size_t c;
+        uint32_t pos;
+        locate(index, c, pos);
+        return iter<false>(this, c, pos);
+    }
+
+public:
+    typedef iter<false> iterator;
+    typedef iter<true> const_iterator;
+
+    pooledmap() : last_used(0), free_list(0), entries(0) {}
+    ~pooledmap() { clear(); }
+
+    pooledmap(const pooledmap&) = delete;
+    pooledmap& operator=(const pooledmap&) = delete;
+
+    iterator begin() { iterator it(this, 0, 0); it.skip(); return it; }
+    const_iterator begin() const { const_iterator it(this, 0, 0); it.skip(); return it; }
+    iterator end() { return iterator(this, chunks.size(), 0); }
+    const_iterator end() const { return const_iterator(this, chunks.size(), 0); }
+
+    size_type size() const { return entries; }
+    bool empty() const { return entries == 0; }
+
+    iterator find(const K& key)
+    {
+        if (entries == 0) return end();
+        size_t pos = find_slot(uint32_t(hasher(key)), key);
+        if (table[pos].node == 0) return end();
+        return make_iterator(table[pos].node - 1);
+    }
+
+    const_iterator find(const K& key) const
+    {
+        return const_cast<pooledmap*>(this)->find(key);
+    }
+
+    size_type count(const K& key) const { return find(key) != end(); }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args)
+    {
+        uint32_t index = allocate_node();
+        node* n = get_node(index);
+        try {
+            new (&n->storage) value_type(std::forward<Args>(args)...);
+        } catch (...) {
+            free_node(index);
+            throw;
+        }
+        const K& key = n->value().first;
+        uint32_t hash = uint32_t(hasher(key));
+        if (!table.empty()) {
+            size_t pos = find_slot(hash, key);
+            if (table[pos].node != 0) {
+                n->value().~value_type();
+                free_node(index);
+                return std::make_pair(make_iterator(table[pos].node - 1), false);
+            }
+        }
+        // Keep the table at most 3/4 full.
+        if ((entries + 1) * 4 > table.size() * 3) {
+            grow();
+        }
+        size_t mask = table.size() - 1;
+        size_t pos = hash & mask;
+        while (table[pos].node) {
+            pos = (pos + 1) & mask;
+        }
+        table[pos] = slot{hash, index + 1};
+        n->hash = hash;
+        n->used = true;
+        entries++;
+        return std::make_pair(make_iterator(index), true);
+    }
+
+    T& operator[](const K& key)
+    {
+        iterator it = find(key);
+        if (it != end()) return it->second;
+        return emplace(std::piecewise_construct, std::forward_as_tuple(key), std::tuple<>()).first->second;
+    }
+
+    iterator erase(const_iterator it)
+    {
+        node* n = &chunks[it.c].nodes[it.pos];
+        assert(n->used);
+        uint32_t index = chunk_start(it.c) + it.pos;
+        size_t mask = table.size() - 1;
+        size_t pos = n->hash & mask;
+        while (table[pos].node != index + 1) {
+            pos = (pos + 1) & mask;
+        }
+        erase_slot(pos);
+        n->value().~value_type();
+        free_node(index);
+        entries--;
+        iterator next(this, it.c, it.pos);
+        ++next;
+        return next;
+    }
+
+    size_type erase(const K& key)
+    {
+        iterator it = find(key);
+        if (it == end()) return 0;
+        erase(it);
+        return 1;
+    }
+
+    void clear()
+    {
+        for (size_t c = 0; c < chunks.size(); c++) {
+            uint32_t limit = c + 1 == chunks.size() ? last_used : chunks[c].capacity;
+            for (uint32_t pos = 0; pos < limit; pos++) {
+                if (chunks[c].nodes[pos].used) {
+                    chunks[c].nodes[pos].value().~value_type();
+                }
+            }
+            ::operator delete(chunks[c].nodes);
+        }
+        std::vector<chunk>().swap(chunks);
+        std::vector<slot>().swap(table);
+        last_used = 0;
+        free_list = 0;
+        entries = 0;
+    }
+
+    /** Memory held, as the sizes of the individual allocations. Used by memusage::DynamicUsage. */
+    size_t bucket_count() const { return table.capacity(); }
+    static size_t bucket_size() { return sizeof(slot); }
+    size_t chunk_count() const { return chunks.capacity(); }
+    static size_t chunk_header_size() { return sizeof(chunk); }
+    size_t chunk_nodes(size_t index) const { return chunks[index].capacity; }
+    size_t allocated_chunks() const { return chunks.size(); }
+    static size_t node_size() { return sizeof(node); }
+};
+
+#endif // BITCOIN_POOLEDMAP_H
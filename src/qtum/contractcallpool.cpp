@@ -0,0 +1,274 @@
+#include "contractcallpool.h"
+#include <chainparams.h>
+#include <util.h>
+#include <utilstrencodings.h>
+#include <validation.h>
+#include <functional>
+
+ContractCallPool contractCallPool;
+
+void ContractCallPool::Start(int threads, size_t maxQueueSize, size_t maxCachedResultsIn){
+    Stop();
+    std::unique_lock<std::mutex> lock(cs);
+    fStop = false;
+    maxQueue = maxQueueSize;
+    maxCachedResults = maxCachedResultsIn;
+    for(int i = 0; i < threads; i++){
+        workers.emplace_back(&TraceThread<std::function<void()>>, "contractcall", std::function<void()>(std::bind(&ContractCallPool::ThreadWorker, this)));
+    }
+    LogPrintf("Contract call pool started with %d threads\n", threads);
+}
+
+void ContractCallPool::Stop(){
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        fStop = true;
+        cond.notify_all();
+    }
+    for(std::thread& worker : workers){
+        if(worker.joinable()){
+            worker.join();
+        }
+    }
+    std::unique_lock<std::mutex> lock(cs);
+    workers.clear();
+    //fail calls nobody picked up. Their snapshot reference is dropped first so the snapshot goes away with tip
+    for(auto& call : queue){
+        call->tip.reset();
+        call->error = "Contract call pool is shutting down";
+        call->done.set_value(false);
+    }
+    queue.clear();
+    tip.reset();
+}
+
+bool ContractCallPool::IsRunning(){
+    std::unique_lock<std::mutex> lock(cs);
+    return !workers.empty();
+}
+
+void ContractCallPool::UpdateTip(const CBlockIndex* pindex, const DeltaDB* database, QtumState* state){
+    if(!IsRunning()){
+        return;
+    }
+    std::shared_ptr<TipSnapshot> newTip;
+    if(pindex != nullptr && database != nullptr && state != nullptr){
+        newTip = std::make_shared<TipSnapshot>();
+        newTip->pindex = pindex;
+        newTip->pos = pindex->GetBlockPos();
+        newTip->snapshot.reset(new CDBSnapshot(*database));
+        newTip->evmState.reset(new QtumState(*state, uintToh256(pindex->GetHashStateRoot()), uintToh256(pindex->GetHashUTXORoot())));
+        //the gas limit contract may have to be executed, which is only possible on the validation thread
+        QtumDGP qtumDGP(state, fGettingValuesDGP);
+        newTip->evmBlockGasLimit = qtumDGP.getBlockGasLimit(pindex->nHeight + 1);
+    }
+    std::unique_lock<std::mutex> lock(cs);
+    if(newTip){
+        newTip->results = std::make_shared<CallResults>();
+        newTip->results->maxResults = maxCachedResults;
+    }
+    //calls already running keep the previous snapshot alive until they are done
+    tip = newTip;
+}
+
+std::shared_ptr<ContractCallPool::TipSnapshot> ContractCallPool::GetTip(std::string& strError){
+    std::unique_lock<std::mutex> lock(cs);
+    if(workers.empty() || fStop){
+        strError = "Contract call pool is not running";
+        return nullptr;
+    }
+    if(!tip){
+        strError = "Contract call pool has no chain tip yet";
+        return nullptr;
+    }
+    return tip;
+}
+
+bool ContractCallPool::Enqueue(const std::shared_ptr<Call>& call, size_t maxSize, std::string& strError){
+    std::unique_lock<std::mutex> lock(cs);
+    if(workers.empty() || fStop){
+        strError = "Contract call pool is not running";
+        return false;
+    }
+    if(queue.size() >= maxSize){
+        strError = "Contract call queue is full";
+        return false;
+    }
+    queue.push_back(call);
+    cond.notify_one();
+    return true;
+}
+
+bool ContractCallPool::Submit(std::shared_ptr<TipSnapshot>&& snapshot, Job job, std::string& strError){
+    std::shared_ptr<Call> call = std::make_shared<Call>();
+    call->job = std::move(job);
+    call->tip = std::move(snapshot);
+    std::future<bool> done = call->done.get_future();
+    if(!Enqueue(call, maxQueue, strError)){
+        return false;
+    }
+    if(!done.get()){
+        strError = call->error;
+        return false;
+    }
+    return true;
+}
+
+static std::string CallKey(const ContractOutput& output, uint64_t blockGasLimit){
+    VersionVM version = output.version;
+    return strprintf("%d/%d/%d%s/%d%s/%d/%d/%d/%d/%s", output.OpCreate, version.toRaw(), (int)output.address.version, HexStr(output.address.data),
+                     (int)output.sender.version, HexStr(output.sender.data), output.value, output.gasPrice, output.gasLimit, blockGasLimit, HexStr(output.data));
+}
+
+static std::string CallKey(const dev::Address& address, const std::vector<unsigned char>& data, const dev::Address& sender, uint64_t gasLimit){
+    return strprintf("%s/%s/%d/%s", address.hex(), sender.hex(), gasLimit, HexStr(data));
+}
+
+bool ContractCallPool::Execute(const ContractOutput& output, uint64_t blockGasLimit, ContractExecutionResult& result, std::string& strError){
+    std::shared_ptr<TipSnapshot> snapshot = GetTip(strError);
+    if(!snapshot){
+        return false;
+    }
+    std::shared_ptr<CallResults> results = snapshot->results;
+    std::string key = CallKey(output, blockGasLimit);
+    if(results->Lookup(results->x86, key, result)){
+        return true;
+    }
+    Job job = [this, &output, blockGasLimit, &result](TipSnapshot& s, dev::eth::SealEngineFace&, std::string& error){
+        return RunX86(s, output, blockGasLimit, result, error);
+    };
+    if(!Submit(std::move(snapshot), std::move(job), strError)){
+        return false;
+    }
+    results->Store(results->x86, key, result);
+    return true;
+}
+
+bool ContractCallPool::ExecuteEVM(const dev::Address& address, const std::vector<unsigned char>& data, const dev::Address& sender, uint64_t gasLimit,
+                                  std::vector<ResultExecute>& results, std::string& strError){
+    std::shared_ptr<TipSnapshot> snapshot = GetTip(strError);
+    if(!snapshot){
+        return false;
+    }
+    std::shared_ptr<CallResults> cache = snapshot->results;
+    std::string key = CallKey(address, data, sender, gasLimit);
+    if(cache->Lookup(cache->evm, key, results)){
+        return true;
+    }
+    Job job = [this, &address, &data, &sender, gasLimit, &results](TipSnapshot& s, dev::eth::SealEngineFace& sealEngine, std::string& error){
+        return RunEVM(s, sealEngine, address, data, sender, gasLimit, results, error);
+    };
+    if(!Submit(std::move(snapshot), std::move(job), strError)){
+        return false;
+    }
+    cache->Store(cache->evm, key, results);
+    return true;
+}
+
+bool ContractCallPool::ExecuteAsync(const std::vector<ContractOutput>& outputs, ExecutionCallback done, std::string& strError){
+    std::shared_ptr<TipSnapshot> snapshot = GetTip(strError);
+    if(!snapshot){
+        return false;
+    }
+    std::shared_ptr<Call> call = std::make_shared<Call>();
+    //nobody waits for the promise, the results are handed to done instead
+    call->job = [this, outputs, done](TipSnapshot& s, dev::eth::SealEngineFace&, std::string& error){
+        std::vector<ContractExecutionResult> results(outputs.size());
+        std::vector<std::vector<std::string>> readKeys(outputs.size());
+        for(size_t i = 0; i < outputs.size(); i++){
+            if(!RunX86(s, outputs[i], s.evmBlockGasLimit, results[i], error, &readKeys[i])){
+                return false;
+            }
+        }
+        done(s.pindex, results, readKeys);
+        return true;
+    };
+    call->tip = std::move(snapshot);
+    return Enqueue(call, maxQueue / 2, strError);
+}
+
+void ContractCallPool::ThreadWorker(){
+    //deleteAddresses of a seal engine is changed by every execution, so each worker has its own
+    dev::eth::ChainParams cp((dev::eth::genesisInfo(dev::eth::Network::qtumMainNetwork)));
+    std::unique_ptr<dev::eth::SealEngineFace> sealEngine(cp.createSealEngine());
+
+    std::unique_lock<std::mutex> lock(cs);
+    while(true){
+        while(!fStop && queue.empty()){
+            cond.wait(lock);
+        }
+        if(fStop){
+            return;
+        }
+        std::shared_ptr<Call> call = queue.front();
+        queue.pop_front();
+
+        lock.unlock();
+        bool success;
+        try{
+            success = call->job(*call->tip, *sealEngine, call->error);
+        }catch(const std::exception& e){
+            call->error = e.what();
+            success = false;
+        }catch(...){
+            call->error = "Unknown error while executing contract";
+            success = false;
+        }
+        //release the snapshot before waking the caller, so Stop never outlives it
+        call->tip.reset();
+        call->done.set_value(success);
+        call.reset();
+        lock.lock();
+    }
+}
+
+bool ContractCallPool::RunX86(TipSnapshot& snapshot, const ContractOutput& output, uint64_t blockGasLimit, ContractExecutionResult& result, std::string& strError,
+                              std::vector<std::string>* readKeys){
+    {
+        std::unique_lock<std::mutex> lock(snapshot.cs);
+        if(!snapshot.loaded){
+            if(!ReadBlockFromDisk(snapshot.block, snapshot.pos, Params().GetConsensus()) ||
+                    snapshot.block.GetHash() != snapshot.pindex->GetBlockHash()){
+                strError = "Block not found on disk";
+                return false;
+            }
+            BuildContractEnvironment(snapshot.env, snapshot.pindex, snapshot.block, blockGasLimit);
+            snapshot.loaded = true;
+        }
+    }
+    if(!output.OpCreate){
+        //leave calls to missing contracts to the caller, so they are reported the same way as before
+        DeltaDBWrapper db(pdeltaDB, snapshot.snapshot.get());
+        std::vector<uint8_t> bytecode;
+        if(!db.readByteCode(output.address, bytecode)){
+            strError = "Contract does not exist at that address";
+            return false;
+        }
+    }
+    ContractEnvironment env = snapshot.env;
+    env.gasLimit = blockGasLimit;
+    ContractExecutor exec(snapshot.block, output, blockGasLimit, env, *snapshot.snapshot);
+    exec.recordReads(readKeys);
+    if(!exec.execute(result, false)){
+        strError = "Only x86 contracts can be executed by the contract call pool";
+        return false;
+    }
+    return true;
+}
+
+bool ContractCallPool::RunEVM(TipSnapshot& snapshot, dev::eth::SealEngineFace& sealEngine, const dev::Address& address, const std::vector<unsigned char>& data,
+                              const dev::Address& sender, uint64_t gasLimit, std::vector<ResultExecute>& results, std::string& strError){
+    QtumState state(*snapshot.evmState, snapshot.evmState->rootHash(), snapshot.evmState->rootHashUTXO());
+    //leave calls to missing contracts to the caller, so they are reported the same way as before
+    if(!state.addressInUse(address)){
+        strError = "Address does not exist";
+        return false;
+    }
+    try{
+        results = CallContract(state, sealEngine, snapshot.pindex, snapshot.evmBlockGasLimit, address, data, sender, gasLimit);
+    }catch(...){
+        sealEngine.deleteAddresses.clear();
+        throw;
+    }
+    return true;
+}
@@ -0,0 +1,145 @@
+#ifndef QTUM_CONTRACTCALLPOOL_H
+#define QTUM_CONTRACTCALLPOOL_H
+
+#include <chain.h>
+#include <dbwrapper.h>
+#include <primitives/block.h>
+#include "qtumtransaction.h"
+#include "qtumstate.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//number of worker threads, 0 runs read-only calls on the RPC thread under cs_main
+static const int DEFAULT_CONTRACTCALL_THREADS = 0;
+static const int MAX_CONTRACTCALL_THREADS = 16;
+//maximum number of calls waiting for a worker before new calls are turned away
+static const int DEFAULT_CONTRACTCALL_QUEUE = 256;
+//number of call results kept for the current tip, 0 disables caching
+static const int DEFAULT_CONTRACTCALL_CACHE = 1000;
+
+//Worker pool for read-only contract calls (callcontract, executecontract and gas estimation)
+//Whenever the active chain tip changes, the validation thread takes a LevelDB snapshot of DeltaDB, pins a copy
+//of the EVM state to the tip's state roots and remembers the tip's index entry and block position while it still
+//holds cs_main. Calls handed to the pool run on the pool's threads against the newest snapshot, so they never take
+//cs_main and never observe a partially connected block. The tip block itself is read from disk by the first x86
+//call that needs it.
+//The EVM state trie is content-addressed and its nodes are never removed from disk, so the pinned roots stay
+//readable while new blocks are connected. Every EVM call executes on its own copy of the pinned state with the
+//worker's own seal engine, and nothing it does is committed.
+//Results are cached per tip, so repeating a call before the next block is connected doesn't execute it again.
+class ContractCallPool{
+public:
+    ContractCallPool() : fStop(false), maxQueue(DEFAULT_CONTRACTCALL_QUEUE), maxCachedResults(DEFAULT_CONTRACTCALL_CACHE) {}
+    ~ContractCallPool() { Stop(); }
+
+    void Start(int threads, size_t maxQueueSize, size_t maxCachedResultsIn = DEFAULT_CONTRACTCALL_CACHE);
+    //stops the workers and releases the snapshot. Must be called before the DeltaDB and globalState are deleted
+    void Stop();
+    bool IsRunning();
+
+    //snapshots database and state for the new tip. Must be called with cs_main held, while state is at tip
+    void UpdateTip(const CBlockIndex* tip, const DeltaDB* database, QtumState* state);
+
+    //executes output without committing against the newest tip and waits for the result
+    //returns false and sets strError if the call could not be executed by the pool
+    bool Execute(const ContractOutput& output, uint64_t blockGasLimit, ContractExecutionResult& result, std::string& strError);
+
+    //same as CallContract, against the EVM state of the newest tip
+    bool ExecuteEVM(const dev::Address& address, const std::vector<unsigned char>& data, const dev::Address& sender, uint64_t gasLimit,
+                    std::vector<ResultExecute>& results, std::string& strError);
+
+    //gets the tip the outputs were executed on, their results and the DeltaDB keys each of them read
+    typedef std::function<void(const CBlockIndex* tip, const std::vector<ContractExecutionResult>& results,
+                               const std::vector<std::vector<std::string>>& readKeys)> ExecutionCallback;
+    //queues outputs to be executed one by one against the newest tip with its block gas limit, without waiting
+    //done is called on a worker thread if all of them could be executed, and not at all otherwise. Calls that
+    //wait for their result are given precedence, so this is turned away once half of the queue is in use
+    //returns false and sets strError if the outputs could not be queued
+    bool ExecuteAsync(const std::vector<ContractOutput>& outputs, ExecutionCallback done, std::string& strError);
+
+private:
+    //results of the calls made against one tip
+    struct CallResults{
+        std::mutex cs;
+        size_t maxResults = 0;
+        std::map<std::string, ContractExecutionResult> x86;
+        std::map<std::string, std::vector<ResultExecute>> evm;
+
+        template<typename T>
+        bool Lookup(const std::map<std::string, T>& results, const std::string& key, T& result){
+            std::unique_lock<std::mutex> lock(cs);
+            auto it = results.find(key);
+            if(it == results.end()){
+                return false;
+            }
+            //ResultExecute can only be copy constructed
+            result = T(it->second);
+            return true;
+        }
+        template<typename T>
+        void Store(std::map<std::string, T>& results, const std::string& key, const T& result){
+            std::unique_lock<std::mutex> lock(cs);
+            if(x86.size() + evm.size() < maxResults){
+                results.emplace(key, result);
+            }
+        }
+    };
+    struct TipSnapshot{
+        //index entries are never freed, and the fields read from them don't change once they are in the chain
+        const CBlockIndex* pindex;
+        CDiskBlockPos pos;
+        std::unique_ptr<CDBSnapshot> snapshot;
+        //only copied from, never executed on
+        std::unique_ptr<QtumState> evmState;
+        uint64_t evmBlockGasLimit = 0;
+        //kept apart, so callers can use it without holding on to the snapshot
+        std::shared_ptr<CallResults> results;
+
+        //filled in by the first call using this tip
+        std::mutex cs;
+        bool loaded = false;
+        CBlock block;
+        ContractEnvironment env;
+    };
+    //runs on a worker thread with that worker's seal engine
+    typedef std::function<bool(TipSnapshot& snapshot, dev::eth::SealEngineFace& sealEngine, std::string& error)> Job;
+    struct Call{
+        Job job;
+        std::shared_ptr<TipSnapshot> tip;
+        std::string error;
+        std::promise<bool> done;
+    };
+
+    std::shared_ptr<TipSnapshot> GetTip(std::string& strError);
+    //queues call unless the queue holds maxSize calls or more
+    bool Enqueue(const std::shared_ptr<Call>& call, size_t maxSize, std::string& strError);
+    //the snapshot reference is handed over, so only the worker keeps the snapshot alive while the call runs
+    bool Submit(std::shared_ptr<TipSnapshot>&& snapshot, Job job, std::string& strError);
+    void ThreadWorker();
+    bool RunX86(TipSnapshot& snapshot, const ContractOutput& output, uint64_t blockGasLimit, ContractExecutionResult& result, std::string& strError,
+                std::vector<std::string>* readKeys = nullptr);
+    bool RunEVM(TipSnapshot& snapshot, dev::eth::SealEngineFace& sealEngine, const dev::Address& address, const std::vector<unsigned char>& data,
+                const dev::Address& sender, uint64_t gasLimit, std::vector<ResultExecute>& results, std::string& strError);
+
+    std::mutex cs;
+    std::condition_variable cond;
+    std::vector<std::thread> workers;
+    std::deque<std::shared_ptr<Call>> queue;
+    std::shared_ptr<TipSnapshot> tip;
+    bool fStop;
+    size_t maxQueue;
+    size_t maxCachedResults;
+};
+
+extern ContractCallPool contractCallPool;
+
+#endif
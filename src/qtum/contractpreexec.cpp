@@ -0,0 +1,182 @@
+#include "contractpreexec.h"
+#include "contractcallpool.h"
+#include "storageprefetch.h"
+#include "templateoptimizer.h"
+#include <txmempool.h>
+#include <util.h>
+#include <validation.h>
+
+#include <algorithm>
+
+ContractPreExecutor contractPreExecutor;
+
+void ContractPreExecutor::Start(const CBlockIndex* pindex){
+    AssertLockHeld(cs_main);
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        if(fRunning){
+            return;
+        }
+        fRunning = true;
+        tip = pindex != nullptr ? pindex->GetBlockHash() : uint256();
+        Clear();
+    }
+    RegisterValidationInterface(this);
+    LogPrintf("Contract pre-execution started\n");
+}
+
+void ContractPreExecutor::Stop(){
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        if(!fRunning){
+            return;
+        }
+        fRunning = false;
+        Clear();
+    }
+    UnregisterValidationInterface(this);
+}
+
+bool ContractPreExecutor::Lookup(const uint256& txid, Result& result){
+    std::unique_lock<std::mutex> lock(cs);
+    auto it = results.find(txid);
+    if(it == results.end()){
+        return false;
+    }
+    result = it->second;
+    return true;
+}
+
+void ContractPreExecutor::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload){
+    std::unique_lock<std::mutex> lock(cs);
+    tip = pindexNew->GetBlockHash();
+    Clear();
+}
+
+void ContractPreExecutor::TransactionAddedToMempool(const CTransactionRef &ptx){
+    const CTransaction& tx = *ptx;
+    if(!tx.HasCreateOrCall()){
+        return;
+    }
+    AssertLockHeld(cs_main);
+    //the sender is taken from the first spent output, which may belong to a transaction that is still in the mempool
+    std::vector<CTransactionRef> parents;
+    CTransactionRef parent = mempool.get(tx.vin[0].prevout.hash);
+    if(parent){
+        parents.push_back(parent);
+    }
+    std::vector<ContractOutput> outputs;
+    for(uint32_t nvout = 0; nvout < tx.vout.size(); nvout++){
+        if(!tx.vout[nvout].scriptPubKey.HasOpCall() && !tx.vout[nvout].scriptPubKey.HasOpCreate()){
+            continue;
+        }
+        ContractOutputParser parser(tx, nvout, pcoinsTip, &parents);
+        ContractOutput output;
+        //only x86 contracts can be executed off the validation thread, and a partial result is of no use
+        if(!parser.parseOutput(output) || output.version.rootVM != ROOT_VM_X86){
+            return;
+        }
+        outputs.push_back(output);
+    }
+    if(outputs.empty()){
+        return;
+    }
+
+    uint256 txid = tx.GetHash();
+    auto done = [this, txid, outputs](const CBlockIndex* pindex, const std::vector<ContractExecutionResult>& execResults,
+                                      const std::vector<std::vector<std::string>>& readKeys){
+        Result result;
+        result.tip = pindex->GetBlockHash();
+        result.success = true;
+        uint64_t gasFeeSum = 0, qtumUsedSum = 0;
+        for(size_t i = 0; i < outputs.size(); i++){
+            const ContractExecutionResult& execResult = execResults[i];
+            result.gasUsed += execResult.usedGas;
+            gasFeeSum += outputs[i].gasPrice * outputs[i].gasLimit;
+            qtumUsedSum += execResult.usedGas * outputs[i].gasPrice;
+            if(execResult.status.getCode() != 0){
+                result.success = false;
+            }
+            storagePrefetcher.RecordAccess(outputs[i].address, readKeys[i]);
+            result.readKeys.insert(result.readKeys.end(), readKeys[i].begin(), readKeys[i].end());
+            for(const auto& delta : execResult.modifiedData.deltas){
+                result.writeKeys.push_back(delta.first);
+            }
+        }
+        result.refund = (CAmount)(gasFeeSum - qtumUsedSum);
+
+        for(std::vector<std::string>* keys : {&result.readKeys, &result.writeKeys}){
+            std::sort(keys->begin(), keys->end());
+            keys->erase(std::unique(keys->begin(), keys->end()), keys->end());
+        }
+        Store(txid, std::move(result));
+    };
+    std::string strError;
+    if(!contractCallPool.ExecuteAsync(outputs, done, strError)){
+        LogPrint(BCLog::MEMPOOL, "Not pre-executing %s: %s\n", txid.ToString(), strError);
+    }
+}
+
+void ContractPreExecutor::Store(const uint256& txid, Result&& result){
+    std::unique_lock<std::mutex> lock(cs);
+    //executed on a tip that isn't the newest anymore
+    if(!fRunning || result.tip != tip){
+        return;
+    }
+    Erase(txid);
+    //transactions that read what this one writes may see different values once both are in a block
+    for(const std::string& key : result.writeKeys){
+        auto it = readers.find(key);
+        if(it == readers.end()){
+            continue;
+        }
+        std::set<uint256> stale = it->second;
+        for(const uint256& other : stale){
+            Erase(other);
+        }
+    }
+    //and this one may read what a transaction executed before it writes
+    for(const std::string& key : result.readKeys){
+        if(writers.count(key)){
+            return;
+        }
+    }
+    if(results.size() >= MAX_PREEXEC_RESULTS){
+        return;
+    }
+    for(const std::string& key : result.readKeys){
+        readers[key].insert(txid);
+    }
+    for(const std::string& key : result.writeKeys){
+        writers[key].insert(txid);
+    }
+    contractGasEstimates.RecordExecution(txid, result.gasUsed, result.refund);
+    results.emplace(txid, std::move(result));
+}
+
+void ContractPreExecutor::Erase(const uint256& txid){
+    auto it = results.find(txid);
+    if(it == results.end()){
+        return;
+    }
+    for(auto index : {std::make_pair(&readers, &it->second.readKeys), std::make_pair(&writers, &it->second.writeKeys)}){
+        for(const std::string& key : *index.second){
+            auto entry = index.first->find(key);
+            if(entry == index.first->end()){
+                continue;
+            }
+            entry->second.erase(txid);
+            if(entry->second.empty()){
+                index.first->erase(entry);
+            }
+        }
+    }
+    contractGasEstimates.ForgetExecution(txid, it->second.gasUsed, it->second.refund);
+    results.erase(it);
+}
+
+void ContractPreExecutor::Clear(){
+    results.clear();
+    readers.clear();
+    writers.clear();
+}
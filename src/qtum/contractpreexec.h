@@ -0,0 +1,79 @@
+#ifndef QTUM_CONTRACTPREEXEC_H
+#define QTUM_CONTRACTPREEXEC_H
+
+#include <amount.h>
+#include <uint256.h>
+#include <validationinterface.h>
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class CBlockIndex;
+
+static const bool DEFAULT_CONTRACT_PREEXEC = false;
+//maximum number of transactions with a remembered pre-execution result
+static const size_t MAX_PREEXEC_RESULTS = 5000;
+
+//Executes the contract outputs of transactions entering the mempool in the background
+//When a transaction is accepted, its x86 contract outputs are handed to the contract call pool and executed without
+//committing against the tip it was accepted on. What comes out is recorded before a block has to be assembled:
+// - the keys read by each contract go to the storage prefetcher, so validating the block finds them in its cache
+// - the result itself is kept for the tip it was executed on, together with the keys read and written
+// - gas used and refund of a kept result go to contractGasEstimates, so the template optimizer has them for the first block
+//A kept result is only right as long as nothing executed before it changes what it read. Results are forgotten
+//when the tip changes, and when another transaction writes a key they read. A result forgotten for a conflicting
+//write takes its gas estimate with it, the estimate of a result forgotten for a new tip is kept.
+//Results depend on the block they end up in, so they are never used in place of executing the transaction.
+class ContractPreExecutor : public CValidationInterface{
+public:
+    struct Result{
+        //block the transaction was executed on top of
+        uint256 tip;
+        uint64_t gasUsed = 0;
+        //gas stipend that would be refunded to the sender
+        CAmount refund = 0;
+        //false if any of the outputs ended with an error
+        bool success = false;
+        //DeltaDB keys read and written by all outputs, sorted
+        std::vector<std::string> readKeys;
+        std::vector<std::string> writeKeys;
+    };
+
+    ContractPreExecutor() : fRunning(false) {}
+
+    //starts executing transactions added to the mempool on top of tip. Must be called with cs_main held
+    void Start(const CBlockIndex* tip);
+    //stops and forgets all results. Executions still running on the contract call pool are discarded
+    void Stop();
+
+    //returns false if txid has no result for the current tip
+    bool Lookup(const uint256& txid, Result& result);
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
+    void TransactionAddedToMempool(const CTransactionRef &ptx) override;
+
+    //keeps result unless it was executed on an old tip or reads a key written by a kept result
+    void Store(const uint256& txid, Result&& result);
+
+private:
+    //these must be called with cs held
+    void Erase(const uint256& txid);
+    void Clear();
+
+    std::mutex cs;
+    bool fRunning;
+    uint256 tip;
+    std::map<uint256, Result> results;
+    //key -> transactions with a result that read or wrote it
+    std::unordered_map<std::string, std::set<uint256>> readers;
+    std::unordered_map<std::string, std::set<uint256>> writers;
+};
+
+extern ContractPreExecutor contractPreExecutor;
+
+#endif
@@ -0,0 +1,120 @@
+#include "contracttrace.h"
+#include "qtumtransaction.h"
+#include <util.h>
+#include <string.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+ContractTraceLog contractTrace;
+
+bool ContractTraceLog::Open(const fs::path& path, size_t size){
+    LOCK(cs);
+#ifdef WIN32
+    LogPrintf("Contract trace file is not supported on this platform\n");
+    return false;
+#else
+    if(map != nullptr){
+        return true;
+    }
+    size_t capacity = (size - sizeof(ContractTraceHeader)) / sizeof(ContractTraceRecord);
+    if(size <= sizeof(ContractTraceHeader) || capacity == 0){
+        LogPrintf("Contract trace file size %u is too small\n", size);
+        return false;
+    }
+    size = sizeof(ContractTraceHeader) + capacity * sizeof(ContractTraceRecord);
+    fd = open(path.string().c_str(), O_RDWR | O_CREAT, 0644);
+    if(fd < 0){
+        LogPrintf("Unable to open contract trace file %s\n", path.string());
+        return false;
+    }
+    struct stat st;
+    bool fresh = fstat(fd, &st) != 0 || (size_t)st.st_size != size;
+    if(fresh && ftruncate(fd, size) != 0){
+        LogPrintf("Unable to resize contract trace file %s\n", path.string());
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(map == MAP_FAILED){
+        LogPrintf("Unable to map contract trace file %s\n", path.string());
+        map = nullptr;
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    mapSize = size;
+    header = (ContractTraceHeader*) map;
+    records = (ContractTraceRecord*) ((uint8_t*)map + sizeof(ContractTraceHeader));
+    if(fresh || header->magic != CONTRACTTRACE_MAGIC || header->version != CONTRACTTRACE_VERSION ||
+            header->recordSize != sizeof(ContractTraceRecord) || header->capacity != capacity){
+        //unknown or resized ring, so start over
+        memset(map, 0, size);
+        header->magic = CONTRACTTRACE_MAGIC;
+        header->version = CONTRACTTRACE_VERSION;
+        header->recordSize = sizeof(ContractTraceRecord);
+        header->capacity = capacity;
+        header->sequence = 0;
+    }
+    LogPrintf("Contract trace file %s opened with room for %u records\n", path.string(), capacity);
+    return true;
+#endif
+}
+
+void ContractTraceLog::Close(){
+    LOCK(cs);
+#ifndef WIN32
+    if(map != nullptr){
+        msync(map, mapSize, MS_ASYNC);
+        munmap(map, mapSize);
+    }
+    if(fd >= 0){
+        close(fd);
+    }
+#endif
+    fd = -1;
+    map = nullptr;
+    mapSize = 0;
+    header = nullptr;
+    records = nullptr;
+}
+
+void ContractTraceLog::Write(const ContractExecutionResult& result, uint32_t height, const uint256& blockHash){
+    LOCK(cs);
+    if(map == nullptr){
+        return;
+    }
+    WriteRecord(result, height, blockHash, 0);
+}
+
+void ContractTraceLog::WriteRecord(const ContractExecutionResult& result, uint32_t height, const uint256& blockHash, uint32_t depth){
+    ContractTraceRecord& r = records[header->sequence % header->capacity];
+    r.sequence = header->sequence;
+    r.blockHeight = height;
+    r.depth = depth;
+    memcpy(r.blockHash, blockHash.begin(), sizeof(r.blockHash));
+    memcpy(r.txid, result.tx.hash.begin(), sizeof(r.txid));
+    r.vout = result.tx.n;
+    result.address.toAbi(r.address);
+    r.usedGas = result.usedGas;
+    r.refundSender = result.refundSender;
+    r.statusCode = result.status.getCode();
+    r.commitState = result.commitState;
+    memset(r.reserved, 0, sizeof(r.reserved));
+    r.eventCount = result.events.size();
+    r.callCount = result.callResults.size();
+    r.deltaCount = result.modifiedData.deltas.size();
+    r.spentVinCount = result.modifiedData.spentVins.size();
+    r.balanceCount = result.modifiedData.balances.size();
+    //readers use the header sequence to know which records are complete
+    __atomic_store_n(&header->sequence, header->sequence + 1, __ATOMIC_RELEASE);
+
+    for(auto& call : result.callResults){
+        WriteRecord(call, height, blockHash, depth + 1);
+    }
+}
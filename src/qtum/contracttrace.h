@@ -0,0 +1,83 @@
+#ifndef QTUM_CONTRACTTRACE_H
+#define QTUM_CONTRACTTRACE_H
+
+#include <fs.h>
+#include <sync.h>
+#include <uint256.h>
+#include <stdint.h>
+#include "shared-x86.h"
+
+struct ContractExecutionResult;
+
+static const unsigned int DEFAULT_CONTRACTTRACE_SIZE = 64; //in MiB
+
+//Binary contract execution trace
+//Each contract execution result (and each of its nested call results) is written as a fixed size
+//record into a memory-mapped ring file, so that external tools can follow executions without
+//the node having to build and write JSON to debug.log.
+//Layout: ContractTraceHeader, followed by `capacity` ContractTraceRecords.
+//Records are written at index (sequence % capacity); the header's sequence is bumped after the record is complete
+//Only executions of blocks that were connected to the chain are written, never those of blocks that are just checked
+
+static const uint32_t CONTRACTTRACE_MAGIC = 0x43525451; //"QTRC"
+static const uint32_t CONTRACTTRACE_VERSION = 2;
+
+struct ContractTraceHeader{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t reserved;
+    uint64_t capacity;
+    uint64_t sequence; //total number of records ever written
+};
+
+struct ContractTraceRecord{
+    uint64_t sequence;
+    uint32_t blockHeight;
+    uint32_t depth; //0 for the origin execution, >0 for nested calls
+    uint8_t blockHash[32]; //tells apart executions of competing blocks at the same height
+    uint8_t txid[32];
+    uint32_t vout;
+    UniversalAddressABI address;
+    uint64_t usedGas;
+    uint64_t refundSender;
+    int32_t statusCode;
+    uint8_t commitState;
+    uint8_t reserved[3];
+    uint32_t eventCount;
+    uint32_t callCount;
+    uint32_t deltaCount;
+    uint32_t spentVinCount;
+    uint32_t balanceCount;
+} __attribute__((__packed__));
+
+class ContractTraceLog{
+public:
+    ContractTraceLog() : fd(-1), map(nullptr), mapSize(0), header(nullptr), records(nullptr) {}
+    ~ContractTraceLog() { Close(); }
+
+    //maps (and creates if needed) the ring file. size is the total file size in bytes
+    bool Open(const fs::path& path, size_t size);
+    void Close();
+
+    bool IsOpen() const{
+        return map != nullptr;
+    }
+
+    //appends the result and all nested call results
+    void Write(const ContractExecutionResult& result, uint32_t height, const uint256& blockHash);
+
+private:
+    void WriteRecord(const ContractExecutionResult& result, uint32_t height, const uint256& blockHash, uint32_t depth);
+
+    CCriticalSection cs;
+    int fd;
+    void* map;
+    size_t mapSize;
+    ContractTraceHeader* header;
+    ContractTraceRecord* records;
+};
+
+extern ContractTraceLog contractTrace;
+
+#endif
@@ -20,12 +20,21 @@ QtumState::QtumState() : dev::eth::State(dev::Invalid256, dev::OverlayDB(), dev:
     stateUTXO = SecureTrieDB<Address, OverlayDB>(&dbUTXO);
 }
 
+QtumState::QtumState(QtumState const& _base, h256 const& _root, h256 const& _rootUTXO) :
+        State(_base), dbUTXO(_base.dbUTXO) {
+    stateUTXO = SecureTrieDB<Address, OverlayDB>(&dbUTXO);
+    setRoot(_root);
+    setRootUTXO(_rootUTXO);
+}
+
 ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const& _sealEngine, QtumTransaction const& _t, Permanence _p, OnOpFunc const& _onOp){
 
     assert(_t.getVersion().toRaw() == VersionVM::GetEVMDefault().toRaw());
 
     addBalance(_t.sender(), _t.value() + (_t.gas() * _t.gasPrice()));
     newAddress = _t.isCreation() ? createQtumAddress(_t.getHashWith(), _t.getNVout()) : dev::Address();
+    createdAccounts.clear();
+    currentSealEngine = &_sealEngine;
 
     _sealEngine.deleteAddresses.insert({_t.sender(), _envInfo.author()});
 
@@ -151,7 +160,7 @@ ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const&
         res.excepted = dev::eth::toTransactionException(_e);
         res.gasUsed = _t.gas();
         const Consensus::Params& consensusParams = Params().GetConsensus();
-        if(chainActive.Height() < consensusParams.nFixUTXOCacheHFHeight  && _p != Permanence::Reverted){
+        if(_p != Permanence::Reverted && chainActive.Height() < consensusParams.nFixUTXOCacheHFHeight){
             deleteAccounts(_sealEngine.deleteAddresses);
             commit(CommitBehaviour::RemoveEmptyAccounts);
         } else {
@@ -164,6 +173,7 @@ ResultExecute QtumState::execute(EnvInfo const& _envInfo, SealEngineFace const&
         res.newAddress = _t.receiveAddress();
     newAddress = dev::Address();
     transfers.clear();
+    currentSealEngine = nullptr;
     if(voutLimit){
         //use old and empty states to create virtual Out Of Gas exception
         LogEntries logs;
@@ -203,7 +213,8 @@ std::unordered_map<dev::Address, Vin> QtumState::vins() const // temp
 
 bool QtumState::addressIsPubKeyHash(dev::Address const &a) {
     //pubkeyhash inserted addresses will not have any code
-    return globalSealEngine.get()->deleteAddresses.count(a); // && !addressInUse(a);
+    dev::eth::SealEngineFace const* sealEngine = currentSealEngine ? currentSealEngine : globalSealEngine.get();
+    return sealEngine->deleteAddresses.count(a); // && !addressInUse(a);
 }
 
 void QtumState::transferBalance(dev::Address const& _from, dev::Address const& _to, dev::u256 const& _value) {
@@ -314,6 +325,7 @@ void QtumState::addBalance(dev::Address const& _id, dev::u256 const& _amount)
             newAddress = dev::Address();
         }
         createAccount(_id, {requireAccountStartNonce(), _amount});
+        createdAccounts.push_back(_id);
     }
 
     if (_amount)
@@ -124,6 +124,10 @@ public:
 
     QtumState(dev::u256 const& _accountStartNonce, dev::OverlayDB const& _db, const std::string& _path, dev::eth::BaseState _bs = dev::eth::BaseState::PreExisting);
 
+    //copy of _base reading from the same databases, pinned to the given roots
+    //the copy can be executed on by another thread, as long as it is never committed to
+    QtumState(QtumState const& _base, dev::h256 const& _root, dev::h256 const& _rootUTXO);
+
     ResultExecute execute(dev::eth::EnvInfo const& _envInfo, dev::eth::SealEngineFace const& _sealEngine, QtumTransaction const& _t, dev::eth::Permanence _p = dev::eth::Permanence::Committed, dev::eth::OnOpFunc const& _onOp = OnOpFunc());
 
     void setRootUTXO(dev::h256 const& _r) { cacheUTXO.clear(); stateUTXO.setRoot(_r); }
@@ -168,6 +172,12 @@ private:
 
     dev::Address newAddress;
 
+    //seal engine of the execute in progress
+    dev::eth::SealEngineFace const* currentSealEngine = nullptr;
+
+    //accounts created during the last execute, including contracts created by other contracts
+    std::vector<dev::Address> createdAccounts;
+
     std::vector<AccountTransfer> transfers;
 
     dev::OverlayDB dbUTXO;
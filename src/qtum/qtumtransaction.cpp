@@ -9,10 +9,13 @@
 #include <pubkey.h>
 #include "qtumtransaction.h"
 #include <qtum/qtumx86.h>
+#include <qtum/storageprefetch.h>
 #include <vector>
+#include <algorithm>
 #include <streams.h>
 #include <serialize.h>
 #include <uint256.h>
+#include <crypto/common.h>
 #include <string>
 
 #include <x86lib.h>
@@ -184,14 +187,13 @@ UniversalAddress ContractOutputParser::getSenderAddress(){
     return UniversalAddress();
 }
 
-ContractEnvironment ContractExecutor::buildEnv() {
-    ContractEnvironment env;
-    CBlockIndex* tip = chainActive.Tip();
+void BuildContractEnvironment(ContractEnvironment& env, const CBlockIndex* tip, const CBlock& block, uint64_t blockGasLimit){
     //assert(*tip->phashBlock == block.hashPrevBlock); //TODO, currently blockNumber and hashes will be wrong
     env.blockNumber = tip-> nHeight + 1;
     env.blockTime = block.nTime;
     env.difficulty = block.nBits;
     env.gasLimit = blockGasLimit;
+    env.blockHashes.clear();
     env.blockHashes.resize(256);
     for(int i = 0 ; i < 256; i++){
         if(!tip)
@@ -205,6 +207,14 @@ ContractEnvironment ContractExecutor::buildEnv() {
     }else {
         env.blockCreator = UniversalAddress::FromScript(block.vtx[0]->vout[0].scriptPubKey);
     }
+}
+
+ContractEnvironment ContractExecutor::buildEnv() {
+    if(fixedEnv != nullptr){
+        return *fixedEnv;
+    }
+    ContractEnvironment env;
+    BuildContractEnvironment(env, chainActive.Tip(), block, blockGasLimit);
     return env;
 }
 
@@ -223,15 +233,30 @@ UniversalAddress UniversalAddress::FromScript(const CScript& script){
 }
 
 ContractExecutor::ContractExecutor(const CBlock &_block, ContractOutput _output, uint64_t _blockGasLimit)
-: block(_block), output(_output), blockGasLimit(_blockGasLimit)
+: block(_block), output(_output), blockGasLimit(_blockGasLimit), fixedEnv(nullptr), snapshot(nullptr), readKeys(nullptr)
+{
+
+}
+
+ContractExecutor::ContractExecutor(const CBlock &_block, ContractOutput _output, uint64_t _blockGasLimit,
+                                   const ContractEnvironment& _env, const CDBSnapshot& _snapshot)
+: block(_block), output(_output), blockGasLimit(_blockGasLimit), fixedEnv(&_env), snapshot(&_snapshot), readKeys(nullptr)
 {
 
 }
 
 bool ContractExecutor::execute(ContractExecutionResult &result, bool commit)
 {
-    DeltaDBWrapper wrapper(pdeltaDB);
+    if(snapshot != nullptr){
+        //the EVM runs against globalState, which has no snapshots
+        if(output.version.rootVM != ROOT_VM_X86){
+            return false;
+        }
+        commit = false;
+    }
+    DeltaDBWrapper wrapper(pdeltaDB, snapshot);
     ContractEnvironment env=buildEnv();
+    wrapper.setFixState(env.blockNumber >= (uint32_t)Params().GetConsensus().nFixX86StateHFHeight);
     if(result.blockHash == uint256()){
         result.blockHash = block.GetHash();
     }
@@ -239,10 +264,18 @@ bool ContractExecutor::execute(ContractExecutionResult &result, bool commit)
         EVMContractVM evm(wrapper, env, blockGasLimit);
         evm.execute(output, result, commit);
     }else if(output.version.rootVM == ROOT_VM_X86){
+        bool prefetch = snapshot == nullptr && storagePrefetcher.IsRunning(pdeltaDB);
+        wrapper.setRecordReads(prefetch || readKeys != nullptr);
         wrapper.setInitialCoins(output.address, output.vout, output.value);
         x86ContractVM x86(wrapper, env, blockGasLimit);
         x86.execute(output, result, commit);
         result.transferTx = CMutableTransaction(wrapper.createCondensingTx());
+        if(prefetch){
+            storagePrefetcher.RecordAccess(output.address, wrapper.getReadKeys());
+        }
+        if(readKeys != nullptr){
+            *readKeys = wrapper.getReadKeys();
+        }
     }else{
         return false;
     }
@@ -254,6 +287,23 @@ bool ContractExecutor::execute(ContractExecutionResult &result, bool commit)
 }
 
 
+void PrefetchContractStorage(const CTransaction& tx){
+    if(!storagePrefetcher.IsRunning(pdeltaDB) || !tx.HasCreateOrCall()){
+        return;
+    }
+    for(uint32_t nvout = 0; nvout < tx.vout.size(); nvout++){
+        if(!tx.vout[nvout].scriptPubKey.HasOpCall()){
+            continue;
+        }
+        //the sender isn't needed to find the called address, so no view is given
+        ContractOutputParser parser(tx, nvout);
+        ContractOutput output;
+        if(parser.parseOutput(output) && output.address.version == AddressVersion::X86){
+            storagePrefetcher.Prefetch(output.address);
+        }
+    }
+}
+
 bool EVMContractVM::execute(ContractOutput &output, ContractExecutionResult &result, bool commit) {
     dev::eth::EnvInfo envInfo(buildEthEnv());
     if (output.address.version != AddressVersion::UNKNOWN &&
@@ -282,6 +332,14 @@ bool EVMContractVM::execute(ContractOutput &output, ContractExecutionResult &res
     result.usedGas = (uint64_t) ethres.execRes.gasUsed;
 
     result.transferTx = ethres.tx;
+    if(commit){
+        //created accounts that are left after the execution are new contracts, the rest were only touched
+        for(const dev::Address& a : globalState->createdAccounts){
+            if(globalState->addressInUse(a) && !globalSealEngine->deleteAddresses.count(a)){
+                result.newContracts.push_back(UniversalAddress(AddressVersion::EVM, a.asBytes()));
+            }
+        }
+    }
     /*
     for(auto& vout : ethres.tx.vout){
         tx.vout.push_back(vout);
@@ -360,21 +418,95 @@ bool DeltaDBWrapper::Write(valtype K, valtype V){
     return true;
     //return db->Write(K, V);
 }
+bool DeltaDBWrapper::findDelta(const std::string& k, valtype& V){
+    if(fixState){
+        //newest checkpoint first, so a sub execution sees what its callers wrote before calling it
+        for(auto check = checkpoints.rbegin(); check != checkpoints.rend(); ++check){
+            auto it = check->deltas.find(k);
+            if(it != check->deltas.end()){
+                V = it->second;
+                return true;
+            }
+        }
+        return false;
+    }
+    //before the fork only the newest checkpoint is checked, so a sub execution doesn't see what its callers wrote
+    //before calling it and reads the database instead. This is what blocks were validated with, so it is consensus
+    auto it = current->deltas.find(k);
+    if(it != current->deltas.end()){
+        V = it->second;
+        return true;
+    }
+    return false;
+}
 bool DeltaDBWrapper::Read(valtype K, valtype& V){
     std::string k(K.begin(), K.end());
-    //check from the latest checkpoint to the oldest before giving up and going to database
-    for(int i = checkpoints.size() - 1; i >= 0; i--){
-        auto *check = &checkpoints[i];
-        if(current->deltas.find(k) != current->deltas.end()){
-            V = current->deltas[k];
-            return true;
-        }
+    if(recordReads){
+        readKeys.push_back(k);
+    }
+    if(findDelta(k, V)){
+        return true;
+    }
+    if(snapshot != nullptr){
+        //prefetched values follow the live database, so they can't be used here
+        return snapshot->Read(K, V);
     }
     if(db == nullptr){
         return false;
     }
+    if(storagePrefetcher.IsRunning(db)){
+        bool found;
+        if(storagePrefetcher.Lookup(k, V, found)){
+            return found;
+        }
+    }
     return db->Read(K, V);
 }
+void DeltaDBWrapper::ReadMany(const std::vector<valtype>& keys, std::vector<valtype>& values, std::vector<bool>& found){
+    values.assign(keys.size(), valtype());
+    found.assign(keys.size(), false);
+    //same lookup order as Read, with everything that has to go to the database read at once
+    std::vector<valtype> dbKeys;
+    std::vector<size_t> dbIndexes;
+    for(size_t n = 0; n < keys.size(); n++){
+        std::string k(keys[n].begin(), keys[n].end());
+        if(recordReads){
+            readKeys.push_back(k);
+        }
+        if(findDelta(k, values[n])){
+            found[n] = true;
+            continue;
+        }
+        if(snapshot != nullptr){
+            found[n] = snapshot->Read(keys[n], values[n]);
+            continue;
+        }
+        if(db == nullptr){
+            continue;
+        }
+        if(storagePrefetcher.IsRunning(db)){
+            bool prefetched;
+            if(storagePrefetcher.Lookup(k, values[n], prefetched)){
+                found[n] = prefetched;
+                continue;
+            }
+        }
+        dbKeys.push_back(keys[n]);
+        dbIndexes.push_back(n);
+    }
+    if(dbKeys.empty()){
+        return;
+    }
+    std::vector<valtype> dbValues;
+    std::vector<bool> dbFound;
+    db->ReadMany(dbKeys, dbValues, dbFound);
+    for(size_t i = 0; i < dbIndexes.size(); i++){
+        if(dbFound[i]){
+            values[dbIndexes[i]] = std::move(dbValues[i]);
+            found[dbIndexes[i]] = true;
+        }
+    }
+}
 bool DeltaDBWrapper::Write(valtype K, uint64_t V){
     std::vector<uint8_t> v(sizeof(uint64_t));
     memcpy(v.data(), (void*) &V, sizeof(V));
@@ -388,8 +520,8 @@ bool DeltaDBWrapper::Read(valtype K, uint64_t& V){
 }
 
 void DeltaDBWrapper::commit() {
-    if(db == nullptr){
-        //only possible in unit tests
+    if(db == nullptr || snapshot != nullptr){
+        //only possible in unit tests or for read-only executions
         throw new std::exception();
     }
     CDBBatch b(*db);
@@ -403,16 +535,24 @@ void DeltaDBWrapper::commit() {
     }
 
     db->WriteBatch(b, true); //need fSync?
+    if(storagePrefetcher.IsRunning(db)){
+        //keep prefetched values in line with the database
+        for(auto& kv : current->deltas){
+            storagePrefetcher.Update(kv.first, kv.second);
+        }
+    }
 
     //clear data stored and reinit
     checkpoints.clear();
     checkpoints.push_back(DeltaCheckpoint());
     current = &checkpoints[0];
-    hasNoAAL.clear();
+    aal.clear();
+    aal.checkpoint();
 }
 int DeltaDBWrapper::checkpoint() {
     checkpoints.push_back(DeltaCheckpoint());
     current = &checkpoints[checkpoints.size() - 1];
+    aal.checkpoint();
     return checkpoints.size() - 1;
 }
 int DeltaDBWrapper::revertCheckpoint() {
@@ -421,99 +561,145 @@ int DeltaDBWrapper::revertCheckpoint() {
     }
     checkpoints.pop_back();
     current = &checkpoints[checkpoints.size() - 1];
+    aal.revertCheckpoint();
     return checkpoints.size() - 1;
 }
 
-uint64_t DeltaDBWrapper::getBalance(UniversalAddress a) {
-    for(int i=checkpoints.size() - 1; i >= 0; i--){
-        if(checkpoints[i].balances.find(a) !=checkpoints[i].balances.end()){
-            return checkpoints[i].balances[a];
+DeltaCheckpoint DeltaDBWrapper::getLatestModifiedState(bool loadRecords){
+    if(loadRecords){
+        loadAal();
+    }
+    DeltaCheckpoint state;
+    state.deltas = current->deltas;
+    for(auto& e : aal.getEntries()){
+        //until its record is loaded, the balance of a receiver only holds the coins it received
+        if(e.modified && e.loaded){
+            state.balances.push_back(std::make_pair(e.address, e.balance));
         }
     }
-    //not found in modified balances, so go to database
-    uint256 txid;
-    unsigned int vout;
-    uint64_t balance = 0;
-    if(readAalData(a, txid, vout, balance)){
-        return balance;
+    std::vector<COutPoint> vins = aal.getSpentVins();
+    state.spentVins.insert(vins.begin(), vins.end());
+    return state;
+}
+
+//parses a stored AAL record. Removed records are written as empty values, which are no record
+static bool parseAalData(const valtype& V, uint256 &txid, unsigned int &vout, uint64_t &balance){
+    if(V.empty()){
+        return false;
+    }
+    CDataStream dsValue(V, SER_DISK, 0);
+    dsValue >> txid;
+    dsValue >> vout;
+    dsValue >> balance;
+    return true;
+}
+
+std::vector<uint8_t> getAalKey(UniversalAddress address){
+    std::vector<uint8_t> K;
+    K.insert(K.end(), DELTADB_PREFIX_STATE.begin(), DELTADB_PREFIX_STATE.end());
+    K.insert(K.end(), address.version);
+    K.insert(K.end(), address.data.begin(), address.data.end());
+    K.insert(K.end(), DELTADB_STATE_AAL);
+    return K;
+}
+
+AalAccumulator::Entry& DeltaDBWrapper::getAal(const UniversalAddress& address){
+    AalAccumulator::Entry& e = aal.get(address);
+    if(!e.loaded){
+        uint256 txid;
+        unsigned int vout = 0;
+        uint64_t balance = 0;
+        bool hasRecord = readAalData(address, txid, vout, balance);
+        aal.load(e, hasRecord, COutPoint(txid, vout), balance);
     }
-    return 0;
+    return e;
+}
+
+void DeltaDBWrapper::loadAal(){
+    std::vector<valtype> keys;
+    std::vector<size_t> indexes;
+    const std::vector<AalAccumulator::Entry>& entries = aal.getEntries();
+    for(size_t i = 0; i < entries.size(); i++){
+        if(!entries[i].loaded){
+            keys.push_back(getAalKey(entries[i].address));
+            indexes.push_back(i);
+        }
+    }
+    if(keys.empty()){
+        return;
+    }
+    std::vector<valtype> values;
+    std::vector<bool> found;
+    ReadMany(keys, values, found);
+    for(size_t i = 0; i < indexes.size(); i++){
+        uint256 txid;
+        unsigned int vout = 0;
+        uint64_t balance = 0;
+        bool hasRecord = found[i] && parseAalData(values[i], txid, vout, balance);
+        //loading doesn't insert entries, so the indexes stay valid
+        aal.load(aal.get(entries[indexes[i]].address), hasRecord, COutPoint(txid, vout), balance);
+    }
+}
+
+uint64_t DeltaDBWrapper::getBalance(UniversalAddress a) {
+    return getAal(a).currentBalance();
 }
 
 bool DeltaDBWrapper::transfer(UniversalAddress from, UniversalAddress to, uint64_t value) {
     /*Operation:
-     * Look up from and to balances
-     * If they are in any checkpoint balance map, then simply use that and put the new balances in the latest checkpoint
-     * If either are not located in the checkpoints, then lookup the utxo info from disk
-     *      After lookup, add previous utxo to spentVin list and then put new balances into latest checkpoint
-     * In this way, spentVin only needs to be touched if the address balance was previously unmodified
-     * If the address balance was modified, then the utxo will already be placed into spentVin
+     * Look up from and to balances in the AAL accumulator, which reads the utxo info from disk the first time an address is seen
+     * If the balance of an address was not yet modified in this execution, then its previous utxo is spent
+     * In this way, the utxo only needs to be spent if the address balance was previously unmodified
+     * If the address balance was modified, then the utxo will already be marked as spent
      * This works independently of if the outputs are contracts, pubkeyhash, or anything else
      */
 
     if(value == 0) { return true; }
 
-    uint64_t fromOldBalance = 0;
-    bool foundFromBalance = false;
-    for (int i = checkpoints.size() - 1; i >= 0; i--) {
-        if (checkpoints[i].balances.find(from) != checkpoints[i].balances.end()) {
-            fromOldBalance = checkpoints[i].balances[from];
-            foundFromBalance = true;
-            break;
-        }
-    }
-    uint256 txid;
-    unsigned int vout;
-    uint64_t balance;
-    if(!foundFromBalance){
-        //hasn't been touched in this execution, so lookup from database
-        if(readAalData(from, txid, vout, balance)){
-            fromOldBalance = balance;
-            //since there is a vout being used, we should spend it
-            current->spentVins.insert(COutPoint(txid, vout));
-        }
+    //note: entries are looked up again after each get, since inserting can move them
+    AalAccumulator::Entry* e = &getAal(from);
+    uint64_t fromOldBalance = e->currentBalance();
+    if(!fixState && !e->modified){
+        //before the fork the previous utxo of an untouched sender is spent before its balance is checked,
+        //so it stays spent even if the transfer fails. This is consensus
+        //after the fork it is only spent below, once the transfer succeeds
+        aal.spend(*e);
     }
     if (value > fromOldBalance) {
         //not enough balance to cover transfer
         return false;
     }
-    current->balances[from] = fromOldBalance - value;
+    e = &aal.get(from);
+    aal.setBalance(*e, fromOldBalance - value);
 
     if(initialCoinsReceiver == from){
         //if initial coins receiver, then just spend that vin
-        //result is either initialCoins is already in currentVins and there is no oldvout
-        //OR that both initialCoins and oldvout is already in currentVins
-        //OR that initialCoins is not in currentvins and there is no oldvout
-        //either way, we don't need to go to database and we must spend the initialCoins vout
-        current->spentVins.insert(initialCoins);
-    }else{
+        //result is either initialCoins is already spent and there is no oldvout
+        //OR that both initialCoins and oldvout are already spent
+        //OR that initialCoins is not spent and there is no oldvout
+        //either way, we must spend the initialCoins vout
+        aal.spendInitialCoins();
+    }else if(e->hasRecord){
         //coins are normal, not from initial coins receiver
-        if(readAalData(from, txid, vout, balance)){
-            current->spentVins.insert(COutPoint(txid, vout));
-        }
-        //if readAalData is false, then no previous vout to spend
+        aal.spend(*e);
+        //if there is no record, then no previous vout to spend
         //So it must be "virtual" transfers without an associated UTXO
         //This can happen when transfering coins from A -> B -> C where B had no UTXO before A's execution
     }
-    uint64_t toOldBalance = 0;
-    bool foundToBalance = false;
-    //now spend the 'to' utxo if it has one so that both from and to UTXOs are spent for condensing
-    for (int i = checkpoints.size() - 1; i >= 0; i--) {
-        if (checkpoints[i].balances.find(to) != checkpoints[i].balances.end()) {
-            toOldBalance = checkpoints[i].balances[to];
-            foundToBalance = true;
-            break;
-        }
+
+    //the receiver's record is only needed for condensing, so it's left to the batched read in loadAal
+    e = &aal.get(to);
+    if(!e->loaded){
+        aal.credit(*e, value);
+        return true;
     }
-    if(!foundToBalance){
-        //hasn't been touched in this execution, so lookup from database
-        if(readAalData(to, txid, vout, balance)){
-            toOldBalance = balance;
-            //this vout will need to be spent and condensed into a new single vout
-            current->spentVins.insert(COutPoint(txid, vout));
-        }
+    //now spend the 'to' utxo if it has one so that both from and to UTXOs are spent for condensing
+    uint64_t toOldBalance = e->currentBalance();
+    if(!e->modified && e->hasRecord){
+        //this vout will need to be spent and condensed into a new single vout
+        aal.spend(*e);
     }
-    current->balances[to] = toOldBalance + value;
+    aal.setBalance(*e, toOldBalance + value);
     return true;
 }
 
@@ -524,22 +710,20 @@ void DeltaDBWrapper::setInitialCoins(UniversalAddress a, COutPoint vout, uint64_
     if(checkpoints.size() != 1){
         return; //this shouldn't be called other than at the very beginning
     }
-    uint256 oldtxid;
-    unsigned int oldvout;
-    uint64_t oldbalance;
-    if(readAalData(a, oldtxid, oldvout, oldbalance)){
+    aal.setInitialCoins(vout);
+    AalAccumulator::Entry& e = getAal(a);
+    if(e.hasRecord){
         //need to spend old vout and sum balance+value
-        current->balances[a] = oldbalance + value;
+        aal.setBalance(e, e.recordBalance + value);
         //need to spend both old vout and new vout to condense into a single vout
-        current->spentVins.insert(COutPoint(oldtxid, oldvout));
-        current->spentVins.insert(vout);
+        aal.spend(e);
+        aal.spendInitialCoins();
     }else{
         //no previous record, so just set balance, no need to spend vin
-        current->balances[a] = value;
+        aal.setBalance(e, value);
         //if the contract exec causes a spend, this AAL record will be overwritten
         writeAalData(a, vout.hash, vout.n, value);
     }
-    initialCoins = vout;
     initialCoinsReceiver = a;
 }
 
@@ -556,16 +740,9 @@ void DeltaDBWrapper::condenseAllCheckpoints() {
         for(auto &kv : check->deltas){
             current->deltas[kv.first] = kv.second;
         }
-        for(auto &kv : check->balances){
-            current->balances[kv.first] = check->balances[kv.first];
-        }
-        for(auto &v : check->spentVins){
-            current->spentVins.insert(v);
-        }
-    }
-    for(int i=1;i<checkpoints.size();i++){
-        checkpoints.pop_back();
     }
+    checkpoints.resize(1);
+    aal.condenseAllCheckpoints();
 }
 
 void DeltaDBWrapper::condenseSingleCheckpoint() {
@@ -577,54 +754,55 @@ void DeltaDBWrapper::condenseSingleCheckpoint() {
     for(auto &kv : check->deltas){
         current->deltas[kv.first] = kv.second;
     }
-    for(auto &kv : check->balances){
-        current->balances[kv.first] = check->balances[kv.first];
-    }
-    for(auto &v : check->spentVins){
-        current->spentVins.insert(v);
-    }
     checkpoints.pop_back(); //remove latest
+    aal.condenseSingleCheckpoint();
 }
 
 CTransaction DeltaDBWrapper::createCondensingTx() {
     //note: this is the new AAL support
     //see qtumstate.cpp for legacy EVM support for the AAL
     condenseAllCheckpoints();
-    if(current->spentVins.size() == 0){
-        return CTransaction();
-    }
-
+    loadAal();
 
     //sort vouts and vins so that the consensus critical order is easy to verify and implementation details can be changed easily
-    //vouts are sorted by address
+    //vouts are sorted by address, with UniversalAddress::operator< before the fork and UniversalAddressLess after it
     //vins are sorted by txid + vout number
-
-    std::vector<COutPoint> sortedVins(current->spentVins.begin(), current->spentVins.end());
-    std::sort(sortedVins.begin(), sortedVins.end());
-
-    std::vector<UniversalAddress> sortedVoutTargets;
-    for(auto& t : current->balances){
-        sortedVoutTargets.push_back(t.first);
+    std::vector<COutPoint> sortedVins = aal.getSpentVins();
+    if(sortedVins.size() == 0){
+        return CTransaction();
     }
-    std::sort(sortedVoutTargets.begin(), sortedVoutTargets.end());
-
 
     CMutableTransaction tx;
+    tx.vin.reserve(sortedVins.size());
     //first, spend all vins
     for(auto& v : sortedVins){
         //op_spend, AAL version 2
         tx.vin.push_back(CTxIn(v.hash, v.n, CScript() << valtype{2} << OP_SPEND));
     }
 
+    std::vector<const AalAccumulator::Entry*> sortedVoutTargets;
+    for(auto &e : aal.getEntries()){
+        if(e.modified){
+            sortedVoutTargets.push_back(&e);
+        }
+    }
+    if(!fixState){
+        std::sort(sortedVoutTargets.begin(), sortedVoutTargets.end(), [](const AalAccumulator::Entry* a, const AalAccumulator::Entry* b){
+            return a->address < b->address;
+        });
+    }
+    //otherwise the entries are already in UniversalAddressLess order
+
     //now set vouts to modified balances
     int n=0;
-    for(auto &dest : sortedVoutTargets) {
-        if (current->balances[dest] == 0) {
+    for(auto *target : sortedVoutTargets) {
+        const AalAccumulator::Entry& e = *target;
+        if (e.balance == 0) {
             //no need for 0 coin outputs
             continue;
         }
+        const UniversalAddress& dest = e.address;
         CScript script;
-        CScriptBase c;
         if (dest.version == AddressVersion::PUBKEYHASH) {
             script = CScript() << OP_DUP << OP_HASH160 << dest.data << OP_EQUALVERIFY << OP_CHECKSIG;
         } else if (dest.version == AddressVersion::SCRIPTHASH) {
@@ -634,7 +812,7 @@ CTransaction DeltaDBWrapper::createCondensingTx() {
             CBitcoinAddress btc = dest.asBitcoinAddress();
             script = CScript() << VersionVM::GetNoExecVersion2().toRaw() << valtype{0} << valtype{0} << valtype{0} << btc.getData() << OP_CALL;
         }
-        tx.vout.push_back(CTxOut(current->balances[dest], script));
+        tx.vout.push_back(CTxOut(e.balance, script));
         if (n + 1 > MAX_CONTRACT_VOUTS) {
             LogPrintf("AAL Transaction has exceeded MAX_CONTRACT_VOUTS!");
             return CTransaction();
@@ -651,18 +829,141 @@ CTransaction DeltaDBWrapper::createCondensingTx() {
     }
     auto txid = tx.GetHash();
     n = 0;
-    for(auto &dest : sortedVoutTargets){
-        if (current->balances[dest] == 0) {
-            removeAalData(dest);
+    for(auto *target : sortedVoutTargets){
+        const AalAccumulator::Entry& e = *target;
+        if (e.balance == 0) {
+            removeAalData(e.address);
             continue;
         }
-        writeAalData(dest, txid, n, current->balances[dest]);
+        writeAalData(e.address, txid, n, e.balance);
         n++;
     }
 
     return CTransaction(tx);
 }
 
+AalAccumulator::Entry& AalAccumulator::get(const UniversalAddress& address){
+    auto it = std::lower_bound(entries.begin(), entries.end(), address, [](const Entry& e, const UniversalAddress& a){
+        return UniversalAddressLess()(e.address, a);
+    });
+    if(it == entries.end() || it->address != address){
+        it = entries.insert(it, Entry());
+        it->address = address;
+    }
+    return *it;
+}
+
+void AalAccumulator::journal(const Entry& e){
+    undo.push_back(JournalEntry{e.address, e.balance, e.modified, e.spent});
+}
+
+void AalAccumulator::setBalance(Entry& e, uint64_t balance){
+    journal(e);
+    e.balance = balance;
+    e.modified = true;
+}
+
+void AalAccumulator::spend(Entry& e){
+    if(e.spent || !e.hasRecord){
+        return;
+    }
+    journal(e);
+    e.spent = true;
+}
+
+void AalAccumulator::credit(Entry& e, uint64_t value){
+    journal(e);
+    e.balance += value;
+    e.modified = true;
+}
+
+void AalAccumulator::load(Entry& e, bool hasRecord, const COutPoint& recordVout, uint64_t recordBalance){
+    e.loaded = true;
+    e.hasRecord = hasRecord;
+    if(hasRecord){
+        e.recordVout = recordVout;
+        e.recordBalance = recordBalance;
+    }else{
+        e.recordBalance = 0;
+    }
+    if(!e.modified){
+        return;
+    }
+    //the entry received coins before its record was known. Had it been loaded then, its balance would have
+    //included the record's and its record would have been spent, so bring the entry and its journal there
+    e.balance += e.recordBalance;
+    e.spent = hasRecord;
+    for(JournalEntry& j : undo){
+        if(j.modified && j.address == e.address){
+            j.balance += e.recordBalance;
+            j.spent = hasRecord;
+        }
+    }
+}
+
+void AalAccumulator::spendInitialCoins(){
+    initialCoinsSpent = true;
+}
+
+void AalAccumulator::checkpoint(){
+    marks.push_back(Mark{undo.size(), initialCoinsSpent});
+}
+
+void AalAccumulator::revertCheckpoint(){
+    if(marks.empty()){
+        return;
+    }
+    const Mark& m = marks.back();
+    //undo in reverse so that each entry ends at the state it had when the checkpoint was made
+    while(undo.size() > m.journalSize){
+        const JournalEntry& j = undo.back();
+        Entry& e = get(j.address);
+        e.balance = j.balance;
+        e.modified = j.modified;
+        e.spent = j.spent;
+        undo.pop_back();
+    }
+    initialCoinsSpent = m.initialCoinsSpent;
+    marks.pop_back();
+}
+
+void AalAccumulator::condenseSingleCheckpoint(){
+    //the journal of the latest checkpoint now belongs to the previous one
+    if(marks.size() > 1){
+        marks.pop_back();
+    }
+}
+
+void AalAccumulator::condenseAllCheckpoints(){
+    if(marks.size() > 1){
+        marks.resize(1);
+    }
+}
+
+void AalAccumulator::clear(){
+    entries.clear();
+    undo.clear();
+    marks.clear();
+    initialCoins = COutPoint();
+    initialCoinsSpent = false;
+}
+
+std::vector<COutPoint> AalAccumulator::getSpentVins() const{
+    std::vector<COutPoint> vins;
+    vins.reserve(entries.size() + 1);
+    for(auto& e : entries){
+        if(e.spent){
+            vins.push_back(e.recordVout);
+        }
+    }
+    if(initialCoinsSpent){
+        vins.push_back(initialCoins);
+    }
+    std::sort(vins.begin(), vins.end());
+    vins.erase(std::unique(vins.begin(), vins.end()), vins.end());
+    return vins;
+}
+
 std::vector<uint8_t> getBytecodeKey(UniversalAddress address){
     std::vector<uint8_t> K;
     K.insert(K.end(), DELTADB_PREFIX_STATE.begin(), DELTADB_PREFIX_STATE.end());
@@ -691,6 +992,49 @@ std::vector<uint8_t> getStateKey(UniversalAddress address, std::vector<uint8_t>
     return K;
 }
 
+std::vector<UniversalAddress> DeltaDB::readByteCodeAddresses(){
+    std::vector<UniversalAddress> addresses;
+    //all bytecode keys have the same length, and sort together with the AAL keys of that length
+    std::string start = DELTADB_PREFIX_STATE + std::string(1 + ADDRESS_DATA_SIZE + 1, '\0');
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    for(pcursor->Seek(start); pcursor->Valid(); pcursor->Next()){
+        std::string k;
+        if(!pcursor->GetKey(k) || k.size() != start.size() || k.compare(0, DELTADB_PREFIX_STATE.size(), DELTADB_PREFIX_STATE) != 0){
+            break;
+        }
+        if(k.back() == DELTADB_STATE_BYTECODE){
+            const unsigned char* data = (const unsigned char*) &k[DELTADB_PREFIX_STATE.size() + 1];
+            addresses.push_back(UniversalAddress((AddressVersion) k[DELTADB_PREFIX_STATE.size()], data, data + ADDRESS_DATA_SIZE));
+        }
+    }
+    return addresses;
+}
+
+bool DeltaDB::readStorage(const UniversalAddress& address, const std::string& after, size_t count, std::vector<std::pair<std::string, valtype>>& entries){
+    std::string header = DELTADB_PREFIX_STATE + std::string(1, (char) address.version) + std::string(address.data.begin(), address.data.end()) + DELTADB_STATE_KEY;
+    //keys are stored with their length in front, so each key length is a range of its own. One iterator reads them all from the same state
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    for(size_t len = std::max<size_t>(after.size(), 1); len <= 32 && entries.size() < count; len++){
+        std::string start = header + (len == after.size() ? after : std::string(len, '\0'));
+        for(pcursor->Seek(start); pcursor->Valid() && entries.size() < count; pcursor->Next()){
+            std::string k;
+            if(!pcursor->GetKey(k) || k.size() != header.size() + len || k.compare(0, header.size(), header) != 0){
+                break;
+            }
+            std::string key = k.substr(header.size());
+            if(key == after){
+                continue;
+            }
+            valtype value;
+            if(!pcursor->GetValue(value)){
+                return false;
+            }
+            entries.emplace_back(std::move(key), std::move(value));
+        }
+    }
+    return true;
+}
+
 //live state key format: state_%address%_%key%
 
 //live bytecode: state_%address%c
@@ -728,26 +1072,10 @@ bool DeltaDBWrapper::removeAalData(UniversalAddress address){
     return Write(K, V);
 }
 
+//note: only called once per address by getAal, which caches the result. loadAal reads many at once
 bool DeltaDBWrapper:: readAalData(UniversalAddress address, uint256 &txid, unsigned int &vout, uint64_t &balance){
-    if(hasNoAAL.find(address) != hasNoAAL.end()){
-        return false;
-    }
-	std::vector<uint8_t> K;
 	std::vector<uint8_t> V;
-    K.insert(K.end(), DELTADB_PREFIX_STATE.begin(), DELTADB_PREFIX_STATE.end());
-	K.insert(K.end(), address.version);
-	K.insert(K.end(), address.data.begin(), address.data.end());
-	K.insert(K.end(), DELTADB_STATE_AAL);	
-	if(Read(K, V)){
-		CDataStream dsValue(V,SER_DISK,0);
-		dsValue>>txid;	
-		dsValue>>vout;
-		dsValue>>balance;
-		return true;
-	}else{
-        hasNoAAL.insert(address);
-        return false;
-	}
+	return Read(getAalKey(address), V) && parseAalData(V, txid, vout, balance);
 }
 
 bool DeltaDBWrapper:: writeState(UniversalAddress address, valtype key, valtype value){
@@ -1041,6 +1369,38 @@ std::vector<uint8_t> createResultKey(uint32_t blockheight, COutPoint vout = COut
     return k;
 }
 
+//size of result keys written by commit: prefix, height, txid and output index byte
+static const size_t EVENTDB_RESULT_KEY_SIZE = 2 + 4 + 32 + 1;
+
+bool EventDB::readResults(uint32_t minheight, uint32_t maxheight, const std::string& after, size_t count, std::vector<std::pair<std::string, std::string>>& results){
+    std::vector<uint8_t> tmp = createResultKey(minheight);
+    std::string start(tmp.begin(), tmp.end());
+    start.resize(EVENTDB_RESULT_KEY_SIZE, '\0');
+    if(after.size() == EVENTDB_RESULT_KEY_SIZE - EVENTDB_PREFIX_RESULT.size() && EVENTDB_PREFIX_RESULT + after > start){
+        start = EVENTDB_PREFIX_RESULT + after;
+    }
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    for(pcursor->Seek(start); pcursor->Valid() && results.size() < count; pcursor->Next()){
+        std::string k;
+        if(!pcursor->GetKey(k) || k.size() != EVENTDB_RESULT_KEY_SIZE || k.compare(0, EVENTDB_PREFIX_RESULT.size(), EVENTDB_PREFIX_RESULT) != 0){
+            break;
+        }
+        if(ReadBE32((const unsigned char*) &k[EVENTDB_PREFIX_RESULT.size()]) > maxheight){
+            break;
+        }
+        std::string key = k.substr(EVENTDB_PREFIX_RESULT.size());
+        if(key == after){
+            continue;
+        }
+        std::string value;
+        if(!pcursor->GetValue(value)){
+            return false;
+        }
+        results.emplace_back(std::move(key), std::move(value));
+    }
+    return true;
+}
+
 bool EventDB::commit(uint32_t height){
     auto map = buildAddressMap();
     CDBBatch b(*this);
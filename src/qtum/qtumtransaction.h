@@ -16,6 +16,8 @@
 #include "shared-x86.h"
 #include "qtumstate.h"
 
+class CBlockIndex;
+
 std::string parseABIToString(std::string abidata);
 
 struct VersionVM{
@@ -310,6 +312,12 @@ public:
     //returns results in descending order, ie, results are ordered from maxheight to minheight
     std::vector<std::string> getDescendingResults(UniversalAddress address, int minheight, int maxheight, int maxresults);
 
+    //reads up to count results from minheight to maxheight as (key, JSON) in the order they are stored,
+    //starting after the result with key after (empty to start at minheight)
+    //keys are the block height (big endian), txid and output index byte, as in the database without prefix
+    //returns false on database errors
+    bool readResults(uint32_t minheight, uint32_t maxheight, const std::string& after, size_t count, std::vector<std::pair<std::string, std::string>>& results);
+
     //returns true and sets result if a result is found for the specified vout
     //bool getResult(COutPoint vout, ContractExecutionResult &result);
 };
@@ -321,33 +329,148 @@ public:
 	DeltaDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "deltaDB", nCacheSize, fMemory, fWipe) { }	
 	DeltaDB() : CDBWrapper(GetDataDir() / "deltaDB", 4, false, false) { }
 	~DeltaDB() {    }
+
+	//addresses of all contracts that have bytecode stored, found by walking the bytecode keys
+	std::vector<UniversalAddress> readByteCodeAddresses();
+
+	//reads up to count storage entries of address as (key, value), where key is '_' followed by the storage key
+	//for keys of up to 31 bytes, or the SHA256 of longer keys, as in the database
+	//entries are ordered by key length and then key, starting after the entry with key after (empty to start at the first)
+	//returns false on database errors
+	bool readStorage(const UniversalAddress& address, const std::string& after, size_t count, std::vector<std::pair<std::string, valtype>>& entries);
 };
 
 struct DeltaCheckpoint{
     //all state changes in current checkpoint
     std::unordered_map<std::string, std::vector<uint8_t>> deltas;
-    //all vins spent in transfers within the current checkpoint
+    //the following are only filled in by DeltaDBWrapper::getLatestModifiedState for reporting
+    //balance tracking during execution is done by AalAccumulator
+    //all vins spent by the AAL so far
     std::set<COutPoint> spentVins;
-    //all addresses with modified balances in the current checkpoint
-    //note: do not use this as a cache. It should only be used to track modified balances
-    std::map<UniversalAddress, uint64_t> balances;
+    //all addresses with modified balances so far, sorted by address
+    std::vector<std::pair<UniversalAddress, uint64_t>> balances;
 
     UniValue toJSON();
 };
 
+//Strict ordering of addresses by version and then data, for looking addresses up in sorted containers
+//UniversalAddress::operator< is not a strict weak ordering, but the condensing transaction orders its vouts with it
+//until nFixX86StateHFHeight
+struct UniversalAddressLess{
+    bool operator()(const UniversalAddress& a, const UniversalAddress& b) const{
+        return a.version < b.version || (a.version == b.version && a.data < b.data);
+    }
+};
+
+//Flat accumulator of all AAL balance changes made during a contract execution
+//Every touched address has one entry in a vector sorted by address, holding its newest balance,
+//whether its previous AAL output has been spent, and its AAL record as read from the database.
+//The database record of an address is looked up at most once per execution. Addresses that only receive coins
+//don't need their record until the condensing transaction is built, so their records are read together in one batch.
+//Checkpoints are handled with an undo journal, so lookups never have to walk the checkpoint list.
+class AalAccumulator{
+public:
+    struct Entry{
+        UniversalAddress address;
+        uint64_t balance = 0;
+        bool modified = false; //balance has been changed in this execution
+        bool spent = false; //the record's output must be spent by the condensing tx
+
+        bool loaded = false; //record has been looked up, until then a modified balance only holds coins received
+        bool hasRecord = false;
+        COutPoint recordVout;
+        uint64_t recordBalance = 0;
+
+        uint64_t currentBalance() const{
+            return modified ? balance : recordBalance;
+        }
+    };
+
+    //returns the entry for the address, inserting an unloaded entry if needed
+    //note: this can invalidate references to other entries
+    Entry& get(const UniversalAddress& address);
+    void setBalance(Entry& e, uint64_t balance);
+    void spend(Entry& e);
+    //adds coins to an entry whose record is not loaded yet
+    void credit(Entry& e, uint64_t value);
+    //sets the record of an entry. Coins received before are added to the record's balance, which is then spent
+    void load(Entry& e, bool hasRecord, const COutPoint& recordVout, uint64_t recordBalance);
+
+    void setInitialCoins(const COutPoint& vout){
+        initialCoins = vout;
+    }
+    void spendInitialCoins();
+
+    void checkpoint();
+    void revertCheckpoint();
+    void condenseSingleCheckpoint();
+    void condenseAllCheckpoints();
+    void clear();
+
+    const std::vector<Entry>& getEntries() const{
+        return entries;
+    }
+    //all outputs spent so far, in consensus order (txid + vout number)
+    std::vector<COutPoint> getSpentVins() const;
+
+private:
+    struct JournalEntry{
+        UniversalAddress address;
+        uint64_t balance;
+        bool modified;
+        bool spent;
+    };
+    struct Mark{
+        size_t journalSize;
+        bool initialCoinsSpent;
+    };
+    void journal(const Entry& e);
+
+    std::vector<Entry> entries;
+    std::vector<JournalEntry> undo;
+    std::vector<Mark> marks;
+    COutPoint initialCoins;
+    bool initialCoinsSpent = false;
+};
+
 class DeltaDBWrapper{
     DeltaDB* db;
     //0 is 0th checkpoint, 1 is 1st checkpoint etc
     std::vector<DeltaCheckpoint> checkpoints;
     DeltaCheckpoint *current;
 
-    std::set<UniversalAddress> hasNoAAL; //a cache to keep track of which addresses have no AAL data in the disk-database
-    COutPoint initialCoins; //initial coins sent by origin tx
+    AalAccumulator aal;
     UniversalAddress initialCoinsReceiver;
+
+    //all keys read, used to build the storage access list of the executed contract
+    bool recordReads;
+    std::vector<std::string> readKeys;
+
+    //when set, database reads are made against this snapshot of db and commit is not allowed
+    const CDBSnapshot* snapshot;
+
+    //consensus fixes activated at nFixX86StateHFHeight
+    bool fixState;
 public:
-    DeltaDBWrapper(DeltaDB* db_) : db(db_){
+    DeltaDBWrapper(DeltaDB* db_) : db(db_), recordReads(false), snapshot(nullptr), fixState(false){
         checkpoint(); //this will add the initial "0" checkpoint and set all pointers
     }
+    DeltaDBWrapper(DeltaDB* db_, const CDBSnapshot* snapshot_) : db(db_), recordReads(false), snapshot(snapshot_), fixState(false){
+        checkpoint();
+    }
+
+    //after the fork, reads see the writes of all checkpoints, a failed transfer doesn't spend the sender's AAL output
+    //and the vouts of the condensing transaction are ordered with UniversalAddressLess
+    void setFixState(bool fix){
+        fixState = fix;
+    }
+
+    void setRecordReads(bool record){
+        recordReads = record;
+    }
+    const std::vector<std::string>& getReadKeys() const{
+        return readKeys;
+    }
 
     void commit(); //commits everything to disk
     int checkpoint(); //advanced to next checkpoint; returns new checkpoint number
@@ -359,9 +482,9 @@ public:
     uint64_t getBalance(UniversalAddress a);
     bool transfer(UniversalAddress from, UniversalAddress to, uint64_t value);
 
-    DeltaCheckpoint getLatestModifiedState(){
-        return *current;
-    }
+    //modified state for reporting. The AAL records of receivers are read in one batch first if loadRecords is set,
+    //which top level executions do once they are done. Sub executions report the balances of loaded records only
+    DeltaCheckpoint getLatestModifiedState(bool loadRecords = false);
 
     CTransaction createCondensingTx();
 
@@ -403,16 +526,26 @@ public:
 
 
 private:
+    //returns the accumulator entry of the address with its AAL record loaded
+    AalAccumulator::Entry& getAal(const UniversalAddress& address);
+    //loads the AAL records of all entries that don't have theirs yet with one batched read
+    void loadAal();
     //AAL is more complicated, so don't allow direct access
     bool writeAalData(UniversalAddress address, uint256 txid, unsigned int vout, uint64_t balance);
     bool readAalData(UniversalAddress address, uint256 &txid, unsigned int &vout, uint64_t &balance);
     bool removeAalData(UniversalAddress address);
     bool Write(valtype K, valtype V);
     bool Read(valtype K, valtype& V);
+    //looks k up in the checkpoints
+    bool findDelta(const std::string& k, valtype& V);
+    void ReadMany(const std::vector<valtype>& keys, std::vector<valtype>& values, std::vector<bool>& found);
     bool Write(valtype K, uint64_t V);
     bool Read(valtype K, uint64_t& V);
 };
 
+//queues background reads of the storage used by the x86 contracts called by tx
+void PrefetchContractStorage(const CTransaction& tx);
+
 class ContractStatus{
     int status;
     std::string statusString;
@@ -422,7 +555,7 @@ class ContractStatus{
 
     public:
 
-    int getCode(){
+    int getCode() const{
         return status;
     }
     bool isError(){
@@ -473,6 +606,8 @@ struct ContractExecutionResult{
     std::map<std::string, std::string> events;
     std::vector<ContractExecutionResult> callResults;
     UniversalAddress address;
+    //contracts created by this execution, only filled in when it is committed
+    std::vector<UniversalAddress> newContracts;
 
     UniValue toJSON(){
         UniValue result(UniValue::VOBJ);
@@ -532,15 +667,29 @@ private:
     QtumTransaction buildQtumTx(const ContractOutput &output);
 };
 
+//fills in the environment of a block building on tip. block provides the time, difficulty and creator
+void BuildContractEnvironment(ContractEnvironment& env, const CBlockIndex* tip, const CBlock& block, uint64_t blockGasLimit);
+
 class ContractExecutor{
 public:
     ContractExecutor(const CBlock& _block, ContractOutput _output, uint64_t _blockGasLimit);
+    //read-only execution against a snapshot of DeltaDB, with an environment built beforehand
+    //neither chainActive nor the live DeltaDB are touched, so cs_main isn't needed. Only x86 is supported
+    ContractExecutor(const CBlock& _block, ContractOutput _output, uint64_t _blockGasLimit,
+                     const ContractEnvironment& _env, const CDBSnapshot& _snapshot);
     bool execute(ContractExecutionResult &result, bool commit);
+    //when set, the DeltaDB keys read by an x86 execution are stored in keys
+    void recordReads(std::vector<std::string>* keys){
+        readKeys = keys;
+    }
 private:
     ContractEnvironment buildEnv();
     const CBlock& block;
     ContractOutput output;
     const uint64_t blockGasLimit;
+    const ContractEnvironment* fixedEnv;
+    const CDBSnapshot* snapshot;
+    std::vector<std::string>* readKeys;
 };
 
 class QtumTransaction : public dev::eth::Transaction{
@@ -104,7 +104,7 @@ bool x86ContractVM::execute(ContractOutput &output, ContractExecutionResult &res
 
     if(!qtumhv->initVM(bytecode, blockdata, txdata)){
         LogPrintf("Error initializing x86 VM environment\n");
-        result.modifiedData = db.getLatestModifiedState();
+        result.modifiedData = db.getLatestModifiedState(true);
         result.status = ContractStatus::InternalError("Error initializing x86 VM environment for this contract");
         result.usedGas = output.gasLimit;
         result.refundSender = output.value;
@@ -120,7 +120,7 @@ bool x86ContractVM::execute(ContractOutput &output, ContractExecutionResult &res
     catch(CPUFaultException err){
         std::string msg;
         msg = tfm::format("CPU Panic! Message: %s, code: %x, opcode: %s, hex: %x, location: %x\n", err.desc, err.code, qtumhv->cpu.GetLastOpcodeName(), qtumhv->cpu.GetLastOpcode(), qtumhv->cpu.GetLocation());
-        result.modifiedData = db.getLatestModifiedState();
+        result.modifiedData = db.getLatestModifiedState(true);
         result.status = ContractStatus::CodeError(msg);
         result.usedGas = output.gasLimit;
         result.refundSender = output.value;
@@ -132,7 +132,7 @@ bool x86ContractVM::execute(ContractOutput &output, ContractExecutionResult &res
     catch(MemoryException *err){
         std::string msg;
         msg = tfm::format("Memory error! address: %x, opcode: %s, hex: %x, location: %x\n", err->address, qtumhv->cpu.GetLastOpcodeName(), qtumhv->cpu.GetLastOpcode(), qtumhv->cpu.GetLocation());
-        result.modifiedData = db.getLatestModifiedState();
+        result.modifiedData = db.getLatestModifiedState(true);
         result.status = ContractStatus::CodeError(msg);
         result.usedGas = output.gasLimit;
         result.refundSender = output.value;
@@ -141,16 +141,17 @@ bool x86ContractVM::execute(ContractOutput &output, ContractExecutionResult &res
         delete qtumhv;
         return false;
     }
-    HypervisorEffect effects = qtumhv->getEffects();
+    const HypervisorEffect& effects = qtumhv->getEffects();
     result.address = output.address;
-    result.modifiedData = db.getLatestModifiedState();
+    result.modifiedData = db.getLatestModifiedState(true);
     result.usedGas = (uint64_t)qtumhv->cpu.getGasUsed();
     result.refundSender = 0;
-    result.events = qtumhv->getEffects().events;
-    result.callResults = qtumhv->getEffects().callResults;
+    result.events = effects.events;
+    //the hypervisor is discarded after this, so take its call results instead of copying them
+    result.callResults = std::move(qtumhv->effects.callResults);
 
     if(qtumhv->cpu.gasExceeded()){
-        LogPrintf("Execution ended due to OutOfGas. Gas used: %i\n", qtumhv->cpu.getGasUsed());
+        LogPrint(BCLog::CONTRACT, "Execution ended due to OutOfGas. Gas used: %i\n", qtumhv->cpu.getGasUsed());
         result.status = ContractStatus::OutOfGas();
         result.refundSender = output.value;
         result.commitState = false;
@@ -160,20 +161,23 @@ bool x86ContractVM::execute(ContractOutput &output, ContractExecutionResult &res
         return false;
     }
     if(effects.exitCode == 0) {
-        LogPrintf("Execution successful!\n");
+        LogPrint(BCLog::CONTRACT, "Execution successful!\n");
         if (output.OpCreate) {
             //no error, so save to database
             db.writeByteCode(output.address, output.data);
+            if (commit) {
+                result.newContracts.push_back(output.address);
+            }
         } else {
             //later, store a receipt or something
         }
         result.status = ContractStatus::Success();
         result.commitState = true;
-        result.modifiedData = db.getLatestModifiedState();
+        result.modifiedData = db.getLatestModifiedState(true);
         delete qtumhv;
         return true;
     }else{
-        LogPrintf("Execution ended with error: %i\n", effects.exitCode);
+        LogPrint(BCLog::CONTRACT, "Execution ended with error: %i\n", effects.exitCode);
         result.usedGas = output.gasLimit;
         result.refundSender = output.value; //refund all
         result.status = ContractStatus::ReturnedError(std::to_string(effects.exitCode));
@@ -184,7 +188,7 @@ bool x86ContractVM::execute(ContractOutput &output, ContractExecutionResult &res
     return false;
 }
 
-void x86ContractVM::pushArguments(QtumHypervisor& hv, std::vector<uint8_t> args){
+void x86ContractVM::pushArguments(QtumHypervisor& hv, const std::vector<uint8_t>& args){
     for(size_t i=0;i<args.size();){
         uint32_t size=0;
         std::vector<uint8_t> buffer;
@@ -316,12 +320,14 @@ void QtumHypervisor::HandleInt(int number, x86Lib::x86CPU &vm)
         return;
     }
     uint32_t syscall = vm.Reg32(EAX);
-    if(qsc_syscalls.find(syscall) == qsc_syscalls.end()){
+    const std::map<uint32_t, QtumSyscall>& syscalls = getSyscalls();
+    auto it = syscalls.find(syscall);
+    if(it == syscalls.end()){
         LogPrintf("Invalid Qtum syscall received");
         vm.Int(QTUM_SYSTEM_ERROR_INT);
         return;
     }
-    QtumSyscall s = qsc_syscalls[syscall];
+    const QtumSyscall& s = it->second;
     vm.addGasUsed(s.gasCost);
     vm.SetReg32(EAX, (this->*s.function)(syscall, vm));
     return;
@@ -462,58 +468,72 @@ uint32_t QtumHypervisor::UsedGas(uint32_t syscall, x86Lib::x86CPU &vm){
 }
 
 uint32_t QtumHypervisor::SCCSItemCount(uint32_t syscall, x86Lib::x86CPU& vm){
-    return sccs.size();
+    return sccs->size();
 }
 uint32_t QtumHypervisor::SCCSSize(uint32_t syscall, x86Lib::x86CPU& vm){
-    return sccsSize;
+    //this has always returned 0, and contracts may depend on it, so it stays that way
+    return 0;
 }
 uint32_t QtumHypervisor::SCCSItemSize(uint32_t syscall, x86Lib::x86CPU& vm){
-    return sccs.top().size();
+    if(sccs->empty()){
+        return 0;
+    }
+    return sccs->topSize();
 }
 uint32_t QtumHypervisor::SCCSPop(uint32_t syscall, x86Lib::x86CPU& vm){
     //EBX = output buffer
     //ECX = buffer size
     //returns actual size
-    if(sccs.size() == 0){
+    if(sccs->empty()){
         return 0;
     }
-    uint32_t actual = sccs.top().size();
+    uint32_t actual = sccs->topSize();
     uint32_t size = std::min(actual, (uint32_t)vm.Reg32(ECX));
-    vm.WriteMemory(vm.Reg32(EBX), size, sccs.top().data(), Syscall);
-    sccs.pop();
+    vm.WriteMemory(vm.Reg32(EBX), size, sccs->topData(), Syscall);
+    sccs->pop();
     return actual;
 }
 uint32_t QtumHypervisor::SCCSPeek(uint32_t syscall, x86Lib::x86CPU& vm){
     //EBX = output buffer
     //ECX = buffer size
     //returns actual size
-    if(sccs.size() == 0){
+    if(sccs->empty()){
         return 0;
     }
-    uint32_t actual = sccs.top().size();
+    uint32_t actual = sccs->topSize();
     uint32_t size = std::min(actual, (uint32_t)vm.Reg32(ECX));
-    vm.WriteMemory(vm.Reg32(EBX), size, sccs.top().data(), Syscall);
+    vm.WriteMemory(vm.Reg32(EBX), size, sccs->topData(), Syscall);
     return actual;
 }
 uint32_t QtumHypervisor::SCCSPush(uint32_t syscall, x86Lib::x86CPU& vm){
     //EBX = output buffer
     //ECX = buffer size
     //EAX = success
-    std::vector<uint8_t> tmp;
-    tmp.resize(vm.Reg32(ECX));
-    vm.ReadMemory(vm.Reg32(EBX), vm.Reg32(ECX), tmp.data(), Syscall);
-    sccs.push(tmp);
+    //check the buffer before making space for it, so a bad size can't grow the stack
+    if(!vm.Memory->IsMapped(vm.Reg32(EBX), vm.Reg32(ECX))){
+        throw MemoryException(vm.Reg32(EBX));
+    }
+    //read straight into the stack's arena
+    uint8_t* item = sccs->pushSpace(vm.Reg32(ECX));
+    try{
+        vm.ReadMemory(vm.Reg32(EBX), vm.Reg32(ECX), item, Syscall);
+    }catch(...){
+        sccs->pop();
+        throw;
+    }
     //todo SCCS item and memory limits
     return 0;
 }
 uint32_t QtumHypervisor::SCCSDiscard(uint32_t syscall, x86Lib::x86CPU& vm){
     //EAX = 0
-    sccs.pop();
+    if(!sccs->empty()){
+        sccs->pop();
+    }
     return 0;
 }
 uint32_t QtumHypervisor::SCCSClear(uint32_t syscall, x86Lib::x86CPU& vm){
     //EAX = 0
-    sccs = std::stack<std::vector<uint8_t>>();
+    sccs->clear();
     return 0;
 }
 
@@ -578,10 +598,10 @@ uint32_t QtumHypervisor::CallContract(uint32_t syscall, x86Lib::x86CPU& vm){
     }
     QtumHypervisor *hv = new QtumHypervisor(contractVM, db, exec);
     hv->initSubVM(bytecode, vmdata);
+    //the sub execution works directly on our stack, so nothing is copied in either direction
     hv->sccs = this->sccs;
     db.checkpoint();
     ContractExecutionResult result = hv->execute();
-    this->effects.callResults.push_back(result);
 
     //propogate results from sub execution into this one
     useGas(result.usedGas);
@@ -590,16 +610,15 @@ uint32_t QtumHypervisor::CallContract(uint32_t syscall, x86Lib::x86CPU& vm){
         //Go back to our own checkpoint, carrying the sub execution state with it
         db.condenseSingleCheckpoint();
     }else{
-        hv->sccs = std::stack<std::vector<uint8_t>>(); //clear stack upon error
+        sccs->clear(); //clear stack upon error
         db.revertCheckpoint(); //discard sub state
     }
 
-    this->sccs = hv->sccs;
-    std::vector<uint8_t> ret;
     QtumCallResultABI cr;
     cr.errorCode = hv->effects.exitCode;
     cr.refundedValue = result.refundSender;
     cr.usedGas = result.usedGas;
+    this->effects.callResults.push_back(std::move(result));
 
     cpu.WriteMemory(cpu.Reg32(EDX), std::min(cpu.Reg32(ESI), (uint32_t)sizeof(cr)), &cr, Syscall);
     delete hv;
@@ -643,7 +662,7 @@ ContractExecutionResult QtumHypervisor::execute(){
     result.events = effects.events;
 
     if(cpu.gasExceeded()){
-        LogPrintf("Execution ended due to OutOfGas. Gas used: %i\n", cpu.getGasUsed());
+        LogPrint(BCLog::CONTRACT, "Execution ended due to OutOfGas. Gas used: %i\n", cpu.getGasUsed());
         result.status = ContractStatus::OutOfGas();
         result.refundSender = execData.valueSent;
         result.commitState = false;
@@ -653,28 +672,34 @@ ContractExecutionResult QtumHypervisor::execute(){
     }
 
     if(effects.exitCode & QTUM_EXIT_REVERT){
-        LogPrintf("Execution Reverting!\n");
+        LogPrint(BCLog::CONTRACT, "Execution Reverting!\n");
         result.commitState = false;
         result.refundSender = execData.valueSent; //refund all
         return result;
     }
     if(effects.exitCode == QTUM_EXIT_SUCCESS || effects.exitCode == QTUM_EXIT_USER){
-        LogPrintf("Execution successful!\n");
+        LogPrint(BCLog::CONTRACT, "Execution successful!\n");
         result.status = ContractStatus::Success();
         result.modifiedData = db.getLatestModifiedState();
         result.commitState = true;
         return result;
     }
 
-    LogPrintf("Execution ended with error: %i\n", effects.exitCode);
+    LogPrint(BCLog::CONTRACT, "Execution ended with error: %i\n", effects.exitCode);
     result.status = ContractStatus::ReturnedError(std::to_string(effects.exitCode));
     return result;
 }
 
-std::map<uint32_t, QtumSyscall> QtumHypervisor::qsc_syscalls;
+const std::map<uint32_t, QtumSyscall>& QtumHypervisor::getSyscalls(){
+    //a function-local static is initialized exactly once, even when several threads get here first at the same time
+    static const std::map<uint32_t, QtumSyscall> qsc_syscalls = setupSyscalls();
+    return qsc_syscalls;
+}
+
 #define INSTALL_QSC(func, cap) do {qsc_syscalls[QSC_##func] = QtumSyscall(&QtumHypervisor::func, cap);}while(0)
 #define INSTALL_QSC_COST(func, cap, cost) do {qsc_syscalls[QSC_##func] = QtumSyscall(&QtumHypervisor::func, cap, cost);}while(0)
-void QtumHypervisor::setupSyscalls(){
+std::map<uint32_t, QtumSyscall> QtumHypervisor::setupSyscalls(){
+    std::map<uint32_t, QtumSyscall> qsc_syscalls;
     INSTALL_QSC_COST(AddEvent, QSCCAP_EVENTS, 100);
     INSTALL_QSC(UsedGas, 0);
     INSTALL_QSC_COST(ReadStorage, QSCCAP_READSTATE, 1000);
@@ -699,6 +724,7 @@ void QtumHypervisor::setupSyscalls(){
     INSTALL_QSC_COST(ParseAddress, 0, 10);
 
     INSTALL_QSC_COST(GetBalance, QSCCAP_BLOCKCHAIN, 100);
+    return qsc_syscalls;
 }
 
 
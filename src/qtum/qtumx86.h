@@ -5,6 +5,7 @@
 #include "qtumtransaction.h"
 #include "uint256.h"
 #include <map>
+#include <string.h>
 #include <utility>
 #include <x86lib.h>
 
@@ -27,7 +28,7 @@ private:
     const ContractEnvironment &getEnv();
     const std::vector<uint8_t> buildAdditionalData(ContractOutput &output);
 
-    void pushArguments(QtumHypervisor& hv, std::vector<uint8_t> args);
+    void pushArguments(QtumHypervisor& hv, const std::vector<uint8_t>& args);
 
     friend class QtumHypervisor;
 };
@@ -65,6 +66,49 @@ struct QtumSyscall{
     QtumSyscall(){}
 };
 
+//Smart contract communication stack
+//All items are stored back to back in a single byte arena with a separate index of item offsets.
+//Nested calls share the stack of the origin execution instead of copying it, and clearing or
+//popping only truncates the arena, so its capacity is reused for the whole execution.
+class SCCSStack{
+public:
+    size_t size() const{
+        return offsets.size();
+    }
+    bool empty() const{
+        return offsets.empty();
+    }
+    //reserves space for a new item on top of the stack and returns a pointer to it
+    uint8_t* pushSpace(size_t len){
+        offsets.push_back(arena.size());
+        arena.resize(arena.size() + len);
+        return arena.data() + offsets.back();
+    }
+    void push(const uint8_t* data, size_t len){
+        uint8_t* p = pushSpace(len);
+        if(len > 0){
+            memcpy(p, data, len);
+        }
+    }
+    const uint8_t* topData() const{
+        return arena.data() + offsets.back();
+    }
+    size_t topSize() const{
+        return arena.size() - offsets.back();
+    }
+    void pop(){
+        arena.resize(offsets.back());
+        offsets.pop_back();
+    }
+    void clear(){
+        arena.clear();
+        offsets.clear();
+    }
+private:
+    std::vector<uint8_t> arena;
+    std::vector<size_t> offsets;
+};
+
 struct HypervisorEffect{
     int exitCode = 0;
     int64_t gasUsed = 0;
@@ -90,34 +134,29 @@ class x86VMData{
 
 class QtumHypervisor : public x86Lib::InterruptHypervisor{
     public:
-    QtumHypervisor(x86ContractVM &vm, DeltaDBWrapper& db_, const ExecDataABI& execdata) : contractVM(vm), execData(execdata), db(db_){
-        if(qsc_syscalls.size() == 0){
-            setupSyscalls();
-        }
+    QtumHypervisor(x86ContractVM &vm, DeltaDBWrapper& db_, const ExecDataABI& execdata) : contractVM(vm), execData(execdata), db(db_), sccs(&ownSCCS){
         clearEffects();
     }
     virtual void HandleInt(int number, x86Lib::x86CPU &vm);
-    HypervisorEffect getEffects(){
+    const HypervisorEffect& getEffects() const{
         return effects;
     }
     void clearEffects(){
         effects = HypervisorEffect();
-        sccs = std::stack<std::vector<uint8_t>>();
-        sccsSize = 0;
+        sccs->clear();
     }
-    static void setupSyscalls();
 
 
-    void pushSCCS(std::vector<uint8_t> v){
-        sccs.push(v);
+    void pushSCCS(const std::vector<uint8_t>& v){
+        sccs->push(v.data(), v.size());
     }
     std::vector<uint8_t> popSCCS(){
-        std::vector<uint8_t> tmp = sccs.top();
-        sccs.pop();
+        std::vector<uint8_t> tmp(sccs->topData(), sccs->topData() + sccs->topSize());
+        sccs->pop();
         return tmp;
     }
     size_t sizeofSCCS(){
-        return sccs.size();
+        return sccs->size();
     }
 
     bool initVM(const std::vector<uint8_t> bytecode, const BlockDataABI &block, const TxDataABI &tx);
@@ -135,8 +174,8 @@ private:
     const ExecDataABI &execData;
     DeltaDBWrapper &db;
     HypervisorEffect effects;
-    std::stack<std::vector<uint8_t>> sccs; //smart contract communication stack
-    size_t sccsSize;
+    SCCSStack ownSCCS; //only used when this is the origin execution
+    SCCSStack* sccs; //smart contract communication stack, shared with all nested calls
 
     x86VMData vmdata;
 
@@ -144,7 +183,9 @@ private:
 
     //syscalls map. Key is the syscall number
     //qsc is interrupt 0x40
-    static std::map<uint32_t, QtumSyscall> qsc_syscalls;
+    //built once on first use and never changed, so hypervisors on any thread can read it
+    static const std::map<uint32_t, QtumSyscall>& getSyscalls();
+    static std::map<uint32_t, QtumSyscall> setupSyscalls();
 
     ContractExecutionResult execute(UniversalAddress address, ExecDataABI exec);
 
@@ -0,0 +1,182 @@
+#include "storageprefetch.h"
+#include "qtumtransaction.h"
+#include <util.h>
+#include <algorithm>
+#include <functional>
+
+ContractStoragePrefetcher storagePrefetcher;
+
+static std::string accessListKey(const UniversalAddress& address){
+    std::vector<uint8_t> flat = address.toFlatData();
+    return std::string(flat.begin(), flat.end());
+}
+
+void ContractStoragePrefetcher::Start(DeltaDB* database){
+    Stop();
+    std::unique_lock<std::mutex> lock(cs);
+    db = database;
+    fStop = false;
+    thread = std::thread(&TraceThread<std::function<void()>>, "contractprefetch", std::function<void()>(std::bind(&ContractStoragePrefetcher::ThreadPrefetch, this)));
+}
+
+void ContractStoragePrefetcher::Stop(){
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        fStop = true;
+        cond.notify_all();
+    }
+    if(thread.joinable()){
+        thread.join();
+    }
+    std::unique_lock<std::mutex> lock(cs);
+    db = nullptr;
+    queue.clear();
+    accessLists.clear();
+    accessListOrder.clear();
+    cache.clear();
+    cacheSize = 0;
+    epoch++;
+}
+
+void ContractStoragePrefetcher::RecordAccess(const UniversalAddress& address, const std::vector<std::string>& keys){
+    if(keys.empty()){
+        return;
+    }
+    std::string a = accessListKey(address);
+    std::unique_lock<std::mutex> lock(cs);
+    if(db == nullptr){
+        return;
+    }
+    auto it = accessLists.find(a);
+    if(it == accessLists.end()){
+        if(accessLists.size() >= MAX_ACCESS_LISTS){
+            accessLists.erase(accessListOrder.front());
+            accessListOrder.pop_front();
+        }
+        it = accessLists.emplace(a, std::vector<std::string>()).first;
+        accessListOrder.push_back(a);
+    }
+    //replace the list with the newest execution's keys, without duplicates
+    std::vector<std::string>& list = it->second;
+    list.assign(keys.begin(), keys.end());
+    std::sort(list.begin(), list.end());
+    list.erase(std::unique(list.begin(), list.end()), list.end());
+    if(list.size() > MAX_ACCESS_LIST_KEYS){
+        list.resize(MAX_ACCESS_LIST_KEYS);
+    }
+}
+
+void ContractStoragePrefetcher::Prefetch(const UniversalAddress& address){
+    std::string a = accessListKey(address);
+    std::unique_lock<std::mutex> lock(cs);
+    if(db == nullptr){
+        return;
+    }
+    auto it = accessLists.find(a);
+    if(it == accessLists.end()){
+        return;
+    }
+    size_t queued = 0;
+    for(const std::string& key : it->second){
+        if(cache.count(key) == 0){
+            queue.push_back(key);
+            queued++;
+        }
+    }
+    if(queued > 0){
+        cond.notify_one();
+    }
+}
+
+bool ContractStoragePrefetcher::Lookup(const std::string& key, std::vector<uint8_t>& value, bool& found){
+    std::unique_lock<std::mutex> lock(cs);
+    auto it = cache.find(key);
+    if(it == cache.end()){
+        return false;
+    }
+    found = it->second.found;
+    if(found){
+        value = it->second.value;
+    }
+    return true;
+}
+
+void ContractStoragePrefetcher::Update(const std::string& key, const std::vector<uint8_t>& value){
+    std::unique_lock<std::mutex> lock(cs);
+    auto it = cache.find(key);
+    if(it != cache.end()){
+        cacheSize -= it->first.size() + it->second.value.size();
+        cache.erase(it);
+    }
+    //the written value replaces whatever was cached. A background read of this key that is still in
+    //flight will find the key present (or the epoch bumped) and discard its older value
+    CachedValue entry;
+    entry.found = !value.empty();
+    entry.value = value;
+    Insert(key, std::move(entry));
+}
+
+void ContractStoragePrefetcher::Insert(const std::string& key, CachedValue&& entry){
+    size_t size = key.size() + entry.value.size();
+    if(cacheSize + size > MAX_PREFETCH_CACHE_SIZE){
+        cache.clear();
+        cacheSize = 0;
+        epoch++;
+    }
+    cacheSize += size;
+    cache[key] = std::move(entry);
+}
+
+void ContractStoragePrefetcher::ThreadPrefetch(){
+    std::unique_lock<std::mutex> lock(cs);
+    while(true){
+        while(!fStop && queue.empty()){
+            cond.wait(lock);
+        }
+        if(fStop){
+            return;
+        }
+        //take everything queued so far, the keys of a contract are neighbours in the database
+        std::vector<std::string> keys;
+        while(!queue.empty() && keys.size() < MAX_ACCESS_LIST_KEYS){
+            if(cache.count(queue.front()) == 0){
+                keys.push_back(std::move(queue.front()));
+            }
+            queue.pop_front();
+        }
+        if(keys.empty()){
+            continue;
+        }
+        uint64_t startEpoch = epoch;
+        DeltaDB* database = db;
+
+        lock.unlock();
+        std::vector<std::vector<uint8_t>> dbKeys;
+        dbKeys.reserve(keys.size());
+        for(const std::string& key : keys){
+            dbKeys.emplace_back(key.begin(), key.end());
+        }
+        std::vector<std::vector<uint8_t>> values;
+        std::vector<bool> found;
+        database->ReadMany(dbKeys, values, found, true);
+        lock.lock();
+
+        //a write to a key or a cache reset since the read started makes its value stale
+        if(epoch != startEpoch){
+            continue;
+        }
+        for(size_t i = 0; i < keys.size(); i++){
+            if(cache.count(keys[i]) == 0){
+                CachedValue entry;
+                entry.found = found[i];
+                if(entry.found){
+                    entry.value = std::move(values[i]);
+                }
+                Insert(keys[i], std::move(entry));
+                if(epoch != startEpoch){
+                    break;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef QTUM_STORAGEPREFETCH_H
+#define QTUM_STORAGEPREFETCH_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class DeltaDB;
+struct UniversalAddress;
+
+static const bool DEFAULT_CONTRACT_PREFETCH = false;
+//maximum number of keys remembered for a single contract
+static const size_t MAX_ACCESS_LIST_KEYS = 512;
+//maximum number of contracts with a remembered access list
+static const size_t MAX_ACCESS_LISTS = 8192;
+//maximum size of the prefetched values, in bytes
+static const size_t MAX_PREFETCH_CACHE_SIZE = 64 << 20;
+
+//Storage access lists and background prefetching for DeltaDB
+//After a contract is executed, the DeltaDB keys read by that execution are remembered as its access list.
+//When the contract is about to be executed again, its access list is read from LevelDB on a background
+//thread into a cache of on-disk values, which DeltaDBWrapper::Read consults before going to LevelDB.
+//Every write committed to DeltaDB passes through Update, so the cache always matches the database.
+class ContractStoragePrefetcher{
+public:
+    ContractStoragePrefetcher() : db(nullptr), fStop(false), cacheSize(0), epoch(0) {}
+    ~ContractStoragePrefetcher() { Stop(); }
+
+    //starts the background thread reading from database
+    void Start(DeltaDB* database);
+    //stops the background thread and forgets all cached values
+    void Stop();
+
+    bool IsRunning(const DeltaDB* database) const{
+        return database != nullptr && db == database;
+    }
+
+    //remembers the keys read while executing address
+    void RecordAccess(const UniversalAddress& address, const std::vector<std::string>& keys);
+    //queues the access list of address to be read in the background
+    void Prefetch(const UniversalAddress& address);
+
+    //returns true if the on-disk state of key is cached, setting found and value accordingly
+    bool Lookup(const std::string& key, std::vector<uint8_t>& value, bool& found);
+    //must be called for every key written to the database. An empty value means the key was erased
+    void Update(const std::string& key, const std::vector<uint8_t>& value);
+
+private:
+    struct CachedValue{
+        bool found;
+        std::vector<uint8_t> value;
+    };
+    void ThreadPrefetch();
+    void Insert(const std::string& key, CachedValue&& entry);
+
+    //only changed with cs held, but atomic so that IsRunning can be checked on every read without locking
+    std::atomic<DeltaDB*> db;
+    std::thread thread;
+    std::mutex cs;
+    std::condition_variable cond;
+    bool fStop;
+
+    //address key -> access list, with insertion order for eviction
+    std::unordered_map<std::string, std::vector<std::string>> accessLists;
+    std::deque<std::string> accessListOrder;
+
+    //keys waiting to be read by the background thread
+    std::deque<std::string> queue;
+
+    std::unordered_map<std::string, CachedValue> cache;
+    size_t cacheSize;
+    //bumped whenever the cache is cleared, so reads started before then are not inserted
+    uint64_t epoch;
+};
+
+extern ContractStoragePrefetcher storagePrefetcher;
+
+#endif
@@ -0,0 +1,121 @@
+#include "templateoptimizer.h"
+
+#include <algorithm>
+#include <limits>
+
+ContractGasEstimates contractGasEstimates;
+
+ContractGasEstimates::Estimate& ContractGasEstimates::Insert(const uint256& txid){
+    auto it = estimates.find(txid);
+    if(it != estimates.end()){
+        return it->second;
+    }
+    while(estimates.size() >= MAX_CONTRACT_GAS_ESTIMATES && !order.empty()){
+        estimates.erase(order.front());
+        order.pop_front();
+    }
+    order.push_back(txid);
+    return estimates[txid];
+}
+
+void ContractGasEstimates::RecordExecution(const uint256& txid, uint64_t gasUsed, CAmount refund){
+    std::unique_lock<std::mutex> lock(cs);
+    Estimate& estimate = Insert(txid);
+    estimate.gasUsed = gasUsed;
+    estimate.refund = refund;
+    estimate.failed = false;
+    estimate.failedOn.SetNull();
+}
+
+void ContractGasEstimates::RecordFailure(const uint256& txid, const uint256& hashPrevBlock){
+    std::unique_lock<std::mutex> lock(cs);
+    Estimate& estimate = Insert(txid);
+    estimate.failed = true;
+    estimate.failedOn = hashPrevBlock;
+}
+
+void ContractGasEstimates::ForgetExecution(const uint256& txid, uint64_t gasUsed, CAmount refund){
+    std::unique_lock<std::mutex> lock(cs);
+    auto it = estimates.find(txid);
+    if(it == estimates.end() || it->second.failed || it->second.gasUsed != gasUsed || it->second.refund != refund){
+        return;
+    }
+    estimates.erase(it);
+    order.erase(std::find(order.begin(), order.end(), txid));
+}
+
+bool ContractGasEstimates::Lookup(const uint256& txid, Estimate& estimate){
+    std::unique_lock<std::mutex> lock(cs);
+    auto it = estimates.find(txid);
+    if(it == estimates.end()){
+        return false;
+    }
+    estimate = it->second;
+    return true;
+}
+
+std::vector<size_t> SelectTemplatePackages(const std::vector<TemplateTx>& txs, const std::vector<std::vector<size_t>>& packages, const TemplateLimits& limits){
+    std::vector<size_t> selected;
+    std::vector<bool> txSelected(txs.size(), false);
+    //packages that were chosen or can't be chosen anymore
+    std::vector<bool> done(packages.size(), false);
+    uint64_t weight = 0, gas = 0;
+    int64_t sigOpsCost = 0;
+
+    while(true){
+        size_t best = packages.size();
+        double bestScore = 0;
+        for(size_t i = 0; i < packages.size(); i++){
+            if(done[i]){
+                continue;
+            }
+            //only count what isn't in the block already
+            CAmount value = 0;
+            uint64_t packageWeight = 0, packageGas = 0;
+            int64_t packageSigOpsCost = 0;
+            for(size_t tx : packages[i]){
+                if(!txSelected[tx]){
+                    value += txs[tx].value;
+                    packageWeight += txs[tx].weight;
+                    packageSigOpsCost += txs[tx].sigOpsCost;
+                    packageGas += txs[tx].gas;
+                }
+            }
+            //used room only grows, so a package that doesn't fit now never will
+            if(value <= 0 || weight + packageWeight > limits.weight || sigOpsCost + packageSigOpsCost > limits.sigOpsCost ||
+                    gas + packageGas > limits.gas){
+                done[i] = true;
+                continue;
+            }
+            double cost = 0;
+            if(packageWeight > 0){
+                cost += (double)packageWeight / (limits.weight - weight);
+            }
+            if(packageSigOpsCost > 0){
+                cost += (double)packageSigOpsCost / (limits.sigOpsCost - sigOpsCost);
+            }
+            if(packageGas > 0){
+                cost += (double)packageGas / (limits.gas - gas);
+            }
+            double score = cost > 0 ? value / cost : std::numeric_limits<double>::infinity();
+            if(best == packages.size() || score > bestScore){
+                best = i;
+                bestScore = score;
+            }
+        }
+        if(best == packages.size()){
+            break;
+        }
+        done[best] = true;
+        selected.push_back(best);
+        for(size_t tx : packages[best]){
+            if(!txSelected[tx]){
+                txSelected[tx] = true;
+                weight += txs[tx].weight;
+                sigOpsCost += txs[tx].sigOpsCost;
+                gas += txs[tx].gas;
+            }
+        }
+    }
+    return selected;
+}
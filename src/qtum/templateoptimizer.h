@@ -0,0 +1,71 @@
+#ifndef QTUM_TEMPLATEOPTIMIZER_H
+#define QTUM_TEMPLATEOPTIMIZER_H
+
+#include <amount.h>
+#include <uint256.h>
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
+
+static const bool DEFAULT_STAKER_OPTIMIZE_CONTRACTS = true;
+//maximum number of contract packages the template optimizer chooses from
+static const size_t MAX_TEMPLATE_CONTRACT_PACKAGES = 1000;
+//maximum number of transactions with a remembered gas estimate
+static const size_t MAX_CONTRACT_GAS_ESTIMATES = 10000;
+
+//Gas used by contract transactions when they were last executed, for choosing contracts before executing them
+//Every execution of a mempool transaction by the block assembler is recorded here. A transaction that fails is
+//remembered together with the block it was executed on, so it isn't executed again on top of the same block.
+class ContractGasEstimates{
+public:
+    struct Estimate{
+        uint64_t gasUsed = 0;
+        //gas stipend that was refunded to the sender
+        CAmount refund = 0;
+        bool failed = false;
+        uint256 failedOn;
+    };
+
+    void RecordExecution(const uint256& txid, uint64_t gasUsed, CAmount refund);
+    void RecordFailure(const uint256& txid, const uint256& hashPrevBlock);
+    //forgets the estimate of txid, unless it was recorded by a later execution or failure
+    void ForgetExecution(const uint256& txid, uint64_t gasUsed, CAmount refund);
+    //returns false if txid was never executed
+    bool Lookup(const uint256& txid, Estimate& estimate);
+
+private:
+    Estimate& Insert(const uint256& txid);
+
+    std::mutex cs;
+    std::map<uint256, Estimate> estimates;
+    //txids in the order they were first recorded, the oldest are forgotten first
+    std::deque<uint256> order;
+};
+
+extern ContractGasEstimates contractGasEstimates;
+
+//Resources a transaction takes up in a block, and what including it earns
+struct TemplateTx{
+    CAmount value;
+    uint64_t weight;
+    int64_t sigOpsCost;
+    uint64_t gas;
+};
+
+struct TemplateLimits{
+    uint64_t weight;
+    int64_t sigOpsCost;
+    uint64_t gas;
+};
+
+//Chooses packages to fill the remaining room of a block, as a knapsack over block weight, sigops and gas
+//Each package is a list of indexes into txs, and packages may share transactions (like common ancestors).
+//Shared transactions take up room and earn their value only once. Solving this exactly is NP-hard, so packages are
+//picked greedily by value per cost, where a package's cost is the sum of the parts of each remaining limit it uses.
+//As a limit fills up, packages using much of it become more expensive.
+//Returns the indexes of the chosen packages, in the order they were chosen
+std::vector<size_t> SelectTemplatePackages(const std::vector<TemplateTx>& txs, const std::vector<std::vector<size_t>>& packages, const TemplateLimits& limits);
+
+#endif
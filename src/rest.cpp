@@ -3,14 +3,17 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "base58.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "core_io.h"
+#include "crypto/common.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "validation.h"
 #include "httpserver.h"
 #include "rpc/blockchain.h"
+#include "rpc/jsonstream.h"
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
@@ -23,6 +26,7 @@
 #include <univalue.h>
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const size_t MAX_CONTRACT_ENTRIES = 10000; //allow a max of 10000 contract storage entries or results per request
 
 enum RetFormat {
     RF_UNDEF,
@@ -242,10 +246,10 @@ static bool rest_block(HTTPRequest* req,
     }
 
     case RF_JSON: {
-        UniValue objBlock = blockToJSON(block, pblockindex, showTxDetails);
-        std::string strJSON = objBlock.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        HTTPStreamJSONReply(req, [&](JSONStreamWriter& out) {
+            blockToJSON(block, pblockindex, showTxDetails, out);
+            out.raw("\n");
+        });
         return true;
     }
 
@@ -331,11 +335,10 @@ static bool rest_mempool_contents(HTTPRequest* req, const std::string& strURIPar
 
     switch (rf) {
     case RF_JSON: {
-        UniValue mempoolObject = mempoolToJSON(true);
-
-        std::string strJSON = mempoolObject.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        HTTPStreamJSONReply(req, [](JSONStreamWriter& out) {
+            mempoolToJSON(true, out);
+            out.raw("\n");
+        });
         return true;
     }
     default: {
@@ -586,6 +589,227 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
     return true; // continue to process further HTTP reqs on this cxn
 }
 
+static bool ParseContractAddress(const std::string& strAddress, UniversalAddress& address)
+{
+    CBitcoinAddress a(strAddress);
+    if (!a.IsValid(true))
+        return false;
+    address.fromBitcoinAddress(a);
+    return address.isContract();
+}
+
+static bool ParseEntryCount(const std::string& strCount, size_t& count)
+{
+    long n = strtol(strCount.c_str(), nullptr, 10);
+    if (n < 1 || (size_t)n > MAX_CONTRACT_ENTRIES)
+        return false;
+    count = n;
+    return true;
+}
+
+static bool WriteBinaryReply(HTTPRequest* req, enum RetFormat rf, const CDataStream& ss)
+{
+    switch (rf) {
+    case RF_BINARY: {
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, ss.str());
+        return true;
+    }
+
+    case RF_HEX: {
+        std::string strHex = HexStr(ss.begin(), ss.end()) + "\n";
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, strHex);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+/**
+ * Storage entries of an x86 contract, read straight from DeltaDB.
+ * /rest/contract/storage/<count>/<address>[/<after>].<ext>
+ * Entries are (key, value) pairs with the key as stored, see DeltaDB::readStorage. A full page is followed
+ * by a continuation token, which is passed as <after> (in hex) to get the next page. All entries of one
+ * request come from the same database state.
+ * Binary: vector of (key, value) pairs followed by the continuation token, empty after the last page.
+ */
+static bool rest_contract_storage(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path.size() != 2 && path.size() != 3)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Use /rest/contract/storage/<count>/<address>[/<after>].<ext>.");
+
+    size_t count;
+    if (!ParseEntryCount(path[0], count))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Entry count out of range: " + path[0]);
+
+    UniversalAddress address;
+    if (!ParseContractAddress(path[1], address))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid contract address: " + path[1]);
+
+    std::string after;
+    if (path.size() == 3) {
+        std::vector<unsigned char> vAfter = ParseHex(path[2]);
+        if (!IsHex(path[2]) || vAfter.empty() || vAfter.size() > 32)
+            return RESTERR(req, HTTP_BAD_REQUEST, "Invalid continuation token: " + path[2]);
+        after.assign(vAfter.begin(), vAfter.end());
+    }
+
+    std::vector<std::pair<std::string, std::vector<unsigned char>>> entries;
+    if (!pdeltaDB || !pdeltaDB->readStorage(address, after, count, entries))
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Error reading contract storage");
+    std::string next = entries.size() == count ? entries.back().first : std::string();
+
+    if (rf == RF_JSON) {
+        HTTPStreamJSONReply(req, [&](JSONStreamWriter& out) {
+            out.beginObject();
+            out.pushKV("address", path[1]);
+            out.key("entries");
+            out.beginArray();
+            for (const auto& entry : entries) {
+                out.beginObject();
+                out.pushKV("key", HexStr(entry.first));
+                out.pushKV("value", HexStr(entry.second));
+                out.endObject();
+            }
+            out.endArray();
+            if (!next.empty())
+                out.pushKV("next", HexStr(next));
+            out.endObject();
+            out.raw("\n");
+        });
+        return true;
+    }
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << entries << next;
+    return WriteBinaryReply(req, rf, ss);
+}
+
+/**
+ * Bytecode of an x86 contract.
+ * /rest/contract/bytecode/<address>.<ext>
+ * Binary: the bytecode as stored, without length.
+ */
+static bool rest_contract_bytecode(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+
+    UniversalAddress address;
+    if (!ParseContractAddress(param, address))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid contract address: " + param);
+
+    if (!pdeltaDB)
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Error reading contract bytecode");
+    std::vector<unsigned char> bytecode;
+    DeltaDBWrapper db(pdeltaDB);
+    if (!db.readByteCode(address, bytecode))
+        return RESTERR(req, HTTP_NOT_FOUND, param + " not found");
+
+    if (rf == RF_JSON) {
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("address", param));
+        result.push_back(Pair("bytecode", HexStr(bytecode)));
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, result.write() + "\n");
+        return true;
+    }
+
+    CDataStream ss(bytecode.begin(), bytecode.end(), SER_NETWORK, PROTOCOL_VERSION);
+    return WriteBinaryReply(req, rf, ss);
+}
+
+/**
+ * Contract execution results logged in EventDB (-logevents), by block height.
+ * /rest/contract/events/<count>/<fromheight>/<toheight>[/<after>].<ext>
+ * Results are (key, result) pairs, where the key is the block height (big endian), txid and output index byte
+ * and the result is the JSON stored for it. Continuation works as for /rest/contract/storage.
+ * Binary: vector of (key, result) pairs followed by the continuation token, empty after the last page.
+ */
+static bool rest_contract_events(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path.size() != 3 && path.size() != 4)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Use /rest/contract/events/<count>/<fromheight>/<toheight>[/<after>].<ext>.");
+
+    if (!fLogEvents || !peventdb)
+        return RESTERR(req, HTTP_NOT_FOUND, "Events indexing disabled (-logevents)");
+
+    size_t count;
+    if (!ParseEntryCount(path[0], count))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Result count out of range: " + path[0]);
+
+    int32_t nFromHeight, nToHeight;
+    if (!ParseInt32(path[1], &nFromHeight) || nFromHeight < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height: " + path[1]);
+    if (!ParseInt32(path[2], &nToHeight) || nToHeight < nFromHeight)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height: " + path[2]);
+
+    std::string after;
+    if (path.size() == 4) {
+        std::vector<unsigned char> vAfter = ParseHex(path[3]);
+        if (!IsHex(path[3]) || vAfter.size() != 4 + 32 + 1)
+            return RESTERR(req, HTTP_BAD_REQUEST, "Invalid continuation token: " + path[3]);
+        after.assign(vAfter.begin(), vAfter.end());
+    }
+
+    std::vector<std::pair<std::string, std::string>> results;
+    if (!peventdb->readResults(nFromHeight, nToHeight, after, count, results))
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Error reading contract events");
+    std::string next = results.size() == count ? results.back().first : std::string();
+
+    if (rf == RF_JSON) {
+        HTTPStreamJSONReply(req, [&](JSONStreamWriter& out) {
+            out.beginObject();
+            out.key("results");
+            out.beginArray();
+            for (const auto& result : results) {
+                const unsigned char* key = (const unsigned char*)result.first.data();
+                uint256 txid;
+                memcpy(txid.begin(), key + 4, 32);
+                UniValue value;
+                if (!value.read(result.second))
+                    value = UniValue(result.second);
+                out.beginObject();
+                out.pushKV("height", (int64_t)ReadBE32(key));
+                out.pushKV("txid", txid.GetHex());
+                out.pushKV("n", (int)key[36]);
+                out.pushKV("result", value);
+                out.endObject();
+            }
+            out.endArray();
+            if (!next.empty())
+                out.pushKV("next", HexStr(next));
+            out.endObject();
+            out.raw("\n");
+        });
+        return true;
+    }
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << results << next;
+    return WriteBinaryReply(req, rf, ss);
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -598,6 +822,9 @@ static const struct {
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
+      {"/rest/contract/storage/", rest_contract_storage},
+      {"/rest/contract/bytecode/", rest_contract_bytecode},
+      {"/rest/contract/events/", rest_contract_events},
 };
 
 bool StartREST()
@@ -17,6 +17,7 @@
 #include "policy/feerate.h"
 #include "policy/policy.h"
 #include "primitives/transaction.h"
+#include "rpc/jsonstream.h"
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
@@ -29,6 +30,7 @@
 #include "pos.h"
 #include "txdb.h"
 #include <x86lib.h>
+#include "qtum/contractcallpool.h"
 
 #include <stdint.h>
 
@@ -150,8 +152,8 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     result.push_back(Pair("bits", strprintf("%08x", blockindex->nBits)));
     result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
     result.push_back(Pair("chainwork", blockindex->nChainWork.GetHex()));
-    result.push_back(Pair("hashStateRoot", blockindex->hashStateRoot.GetHex())); // qtum
-    result.push_back(Pair("hashUTXORoot", blockindex->hashUTXORoot.GetHex())); // qtum
+    result.push_back(Pair("hashStateRoot", blockindex->GetHashStateRoot().GetHex())); // qtum
+    result.push_back(Pair("hashUTXORoot", blockindex->GetHashUTXORoot().GetHex())); // qtum
 
     if (blockindex->pprev)
         result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
@@ -160,13 +162,14 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
         result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
 	
     result.push_back(Pair("flags", strprintf("%s", blockindex->IsProofOfStake()? "proof-of-stake" : "proof-of-work")));
-    result.push_back(Pair("proofhash", blockindex->hashProof.GetHex()));
+    result.push_back(Pair("proofhash", blockindex->GetHashProof().GetHex()));
     result.push_back(Pair("modifier", blockindex->nStakeModifier.GetHex()));
 
     return result;
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails)
+/** Fields of blockToJSON that come before the transactions */
+static UniValue blockHeadToJSON(const CBlock& block, const CBlockIndex* blockindex)
 {
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("hash", blockindex->GetBlockHash().GetHex()));
@@ -184,19 +187,22 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     result.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
     result.push_back(Pair("hashStateRoot", block.hashStateRoot.GetHex())); // qtum
     result.push_back(Pair("hashUTXORoot", block.hashUTXORoot.GetHex())); // qtum
-    UniValue txs(UniValue::VARR);
-    for(const auto& tx : block.vtx)
-    {
-        if(txDetails)
-        {
-            UniValue objTx(UniValue::VOBJ);
-            TxToUniv(*tx, uint256(), objTx, true, RPCSerializationFlags());
-            txs.push_back(objTx);
-        }
-        else
-            txs.push_back(tx->GetHash().GetHex());
-    }
-    result.push_back(Pair("tx", txs));
+    return result;
+}
+
+static UniValue blockTxToJSON(const CTransaction& tx, bool txDetails)
+{
+    if (!txDetails)
+        return tx.GetHash().GetHex();
+    UniValue objTx(UniValue::VOBJ);
+    TxToUniv(tx, uint256(), objTx, true, RPCSerializationFlags());
+    return objTx;
+}
+
+/** Fields of blockToJSON that come after the transactions */
+static UniValue blockTailToJSON(const CBlock& block, const CBlockIndex* blockindex)
+{
+    UniValue result(UniValue::VOBJ);
     result.push_back(Pair("time", block.GetBlockTime()));
     result.push_back(Pair("mediantime", (int64_t)blockindex->GetMedianTimePast()));
     result.push_back(Pair("nonce", (uint64_t)block.nNonce));
@@ -211,7 +217,7 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
         result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
 
     result.push_back(Pair("flags", strprintf("%s", blockindex->IsProofOfStake()? "proof-of-stake" : "proof-of-work")));
-    result.push_back(Pair("proofhash", blockindex->hashProof.GetHex()));
+    result.push_back(Pair("proofhash", blockindex->GetHashProof().GetHex()));
     result.push_back(Pair("modifier", blockindex->nStakeModifier.GetHex()));
 
     if (block.IsProofOfStake())
@@ -219,6 +225,30 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool tx
     return result;
 }
 
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails)
+{
+    UniValue result = blockHeadToJSON(block, blockindex);
+    UniValue txs(UniValue::VARR);
+    for(const auto& tx : block.vtx)
+        txs.push_back(blockTxToJSON(*tx, txDetails));
+    result.push_back(Pair("tx", txs));
+    result.pushKVs(blockTailToJSON(block, blockindex));
+    return result;
+}
+
+void blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails, JSONStreamWriter& out)
+{
+    out.beginObject();
+    out.pushKVs(blockHeadToJSON(block, blockindex));
+    out.key("tx");
+    out.beginArray();
+    for(const auto& tx : block.vtx)
+        out.value(blockTxToJSON(*tx, txDetails));
+    out.endArray();
+    out.pushKVs(blockTailToJSON(block, blockindex));
+    out.endObject();
+}
+
 //////////////////////////////////////////////////////////////////////////// // qtum
 UniValue executionResultToJSON(const dev::eth::ExecutionResult& exRes)
 {
@@ -303,6 +333,12 @@ UniValue getblockcount(const JSONRPCRequest& request)
             + HelpExampleRpc("getblockcount", "")
         );
 
+    // Answered from the tip published by RPCNotifyBlockChange, without waiting for cs_main
+    {
+        std::lock_guard<std::mutex> lock(cs_blockchange);
+        if (!latestblock.hash.IsNull())
+            return latestblock.height;
+    }
     LOCK(cs_main);
     return chainActive.Height();
 }
@@ -320,6 +356,11 @@ UniValue getbestblockhash(const JSONRPCRequest& request)
             + HelpExampleRpc("getbestblockhash", "")
         );
 
+    {
+        std::lock_guard<std::mutex> lock(cs_blockchange);
+        if (!latestblock.hash.IsNull())
+            return latestblock.hash.GetHex();
+    }
     LOCK(cs_main);
     return chainActive.Tip()->GetBlockHash().GetHex();
 }
@@ -327,9 +368,16 @@ UniValue getbestblockhash(const JSONRPCRequest& request)
 void RPCNotifyBlockChange(bool ibd, const CBlockIndex * pindex)
 {
     if(pindex) {
-        std::lock_guard<std::mutex> lock(cs_blockchange);
-        latestblock.hash = pindex->GetBlockHash();
-        latestblock.height = pindex->nHeight;
+        // Notifications are sent after cs_main is released, so concurrent callers of ActivateBestChain can
+        // deliver them out of order. The tip is read under cs_main instead, so the last one published is the
+        // newest, and getblockcount and getbestblockhash never fall behind chainActive
+        LOCK(cs_main);
+        const CBlockIndex* tip = chainActive.Tip();
+        if (tip) {
+            std::lock_guard<std::mutex> lock(cs_blockchange);
+            latestblock.hash = tip->GetBlockHash();
+            latestblock.height = tip->nHeight;
+        }
     }
     cond_blockchange.notify_all();
 }
@@ -555,6 +603,33 @@ UniValue mempoolToJSON(bool fVerbose)
     }
 }
 
+void mempoolToJSON(bool fVerbose, JSONStreamWriter& out)
+{
+    if (fVerbose)
+    {
+        LOCK(mempool.cs);
+        out.beginObject();
+        for (const CTxMemPoolEntry& e : mempool.mapTx)
+        {
+            const uint256& hash = e.GetTx().GetHash();
+            UniValue info(UniValue::VOBJ);
+            entryToJSON(info, e);
+            out.pushKV(hash.ToString(), info);
+        }
+        out.endObject();
+    }
+    else
+    {
+        std::vector<uint256> vtxid;
+        mempool.queryHashes(vtxid);
+
+        out.beginArray();
+        for (const uint256& hash : vtxid)
+            out.value(hash.ToString());
+        out.endArray();
+    }
+}
+
 UniValue getrawmempool(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() > 1)
@@ -584,7 +659,9 @@ UniValue getrawmempool(const JSONRPCRequest& request)
     if (!request.params[0].isNull())
         fVerbose = request.params[0].get_bool();
 
-    return mempoolToJSON(fVerbose);
+    return request.StreamResult([fVerbose](JSONStreamWriter& out) {
+        mempoolToJSON(fVerbose, out);
+    });
 }
 
 UniValue getmempoolancestors(const JSONRPCRequest& request)
@@ -850,7 +927,7 @@ UniValue getstorage(const JSONRPCRequest& request)
                 throw JSONRPCError(RPC_INVALID_PARAMS, "Incorrect block number");
 
             if(blockNum != -1)
-                ts.SetRoot(uintToh256(chainActive[blockNum]->hashStateRoot), uintToh256(chainActive[blockNum]->hashUTXORoot));
+                ts.SetRoot(uintToh256(chainActive[blockNum]->GetHashStateRoot()), uintToh256(chainActive[blockNum]->GetHashUTXORoot()));
                 
         } else {
             throw JSONRPCError(RPC_INVALID_PARAMS, "Incorrect block number");
@@ -1038,10 +1115,42 @@ UniValue getblock(const JSONRPCRequest& request)
         return strHex;
     }
 
-    return blockToJSON(block, pblockindex, verbosity >= 2);
+    return request.StreamResult([&](JSONStreamWriter& out) {
+        blockToJSON(block, pblockindex, verbosity >= 2, out);
+    });
 }
 
 ////////////////////////////////////////////////////////////////////// // qtum
+//runs a read-only x86 execution in the contract call pool, without taking cs_main
+//returns false if the pool could not run it, in which case the caller executes it under cs_main instead
+static bool PoolExecuteContract(const ContractOutput& output, UniValue& ret)
+{
+    if(!contractCallPool.IsRunning())
+        return false;
+    ContractExecutionResult result;
+    std::string strError;
+    if(!contractCallPool.Execute(output, 10000000000, result, strError)){
+        LogPrint(BCLog::CONTRACT, "Contract call pool did not execute call: %s\n", strError);
+        return false;
+    }
+    ret = result.toJSON();
+    return true;
+}
+
+//runs a read-only EVM call in the contract call pool, against the EVM state of the newest tip it knows of
+//returns false if the pool could not run it, in which case the caller executes it under cs_main instead
+static bool PoolCallContract(const dev::Address& addrContract, const std::vector<unsigned char>& data, const dev::Address& sender, uint64_t gasLimit, std::vector<ResultExecute>& results)
+{
+    if(!contractCallPool.IsRunning())
+        return false;
+    std::string strError;
+    if(!contractCallPool.ExecuteEVM(addrContract, data, sender, gasLimit, results, strError)){
+        LogPrint(BCLog::CONTRACT, "Contract call pool did not execute call: %s\n", strError);
+        return false;
+    }
+    return true;
+}
+
 UniValue callcontract(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 2)
@@ -1053,9 +1162,7 @@ UniValue callcontract(const JSONRPCRequest& request)
              "3. address              (string, optional) The sender address hex string\n"
              "4. gasLimit             (string, optional) The gas limit for executing the contract\n"
          );
- 
-    LOCK(cs_main);
-    
+
     std::string data = request.params[1].get_str();
 
     std::string contractaddress = request.params[0].get_str();
@@ -1076,9 +1183,6 @@ UniValue callcontract(const JSONRPCRequest& request)
 
     if(address.version == AddressVersion::EVM){
         dev::Address addrAccount(contractaddress);
-        if(!globalState->addressInUse(addrAccount))
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address does not exist");
-    
         dev::Address senderAddress;
         if(request.params.size() == 3){
             CBitcoinAddress qtumSenderAddress(request.params[2].get_str());
@@ -1097,10 +1201,18 @@ UniValue callcontract(const JSONRPCRequest& request)
         }
 
 
-        std::vector<ResultExecute> execResults = CallContract(addrAccount, ParseHex(data), senderAddress, gasLimit);
+        std::vector<ResultExecute> execResults;
+        //opcode logging wants every execution written out, which is done under cs_main
+        if(fRecordLogOpcodes || !PoolCallContract(addrAccount, ParseHex(data), senderAddress, gasLimit, execResults)){
+            LOCK(cs_main);
+            if(!globalState->addressInUse(addrAccount))
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address does not exist");
+
+            execResults = CallContract(addrAccount, ParseHex(data), senderAddress, gasLimit);
 
-        if(fRecordLogOpcodes){
-            writeVMlog(execResults);
+            if(fRecordLogOpcodes){
+                writeVMlog(execResults);
+            }
         }
 
         UniValue result(UniValue::VOBJ);
@@ -1118,6 +1230,25 @@ UniValue callcontract(const JSONRPCRequest& request)
         CBitcoinAddress sendertmp(request.params[2].get_str());
         sender.fromBitcoinAddress(sendertmp);
     }
+    ContractOutput output;
+
+    output.version = VersionVM::Getx86Default();
+    output.value = 0;
+    output.gasPrice = 1;
+    output.gasLimit = 10000000000;
+    output.address = address;
+    output.data = ParseHex(data);
+    //output.sender = 0; //??
+    output.sender = sender;
+    //output.vout = 0; //?
+    output.OpCreate = false;
+
+    UniValue poolResult;
+    if(PoolExecuteContract(output, poolResult)){
+        return poolResult;
+    }
+
+    LOCK(cs_main);
     DeltaDBWrapper db(pdeltaDB);
     std::vector<uint8_t> bytecode;
     if(!db.readByteCode(address, bytecode)){
@@ -1133,19 +1264,6 @@ UniValue callcontract(const JSONRPCRequest& request)
         // blocks, we add the headers to our index, but don't accept the
         // block).
         throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
-    
-    ContractOutput output;
-
-    output.version = VersionVM::Getx86Default();
-    output.value = 0;
-    output.gasPrice = 1;
-    output.gasLimit = 10000000000;
-    output.address = address;
-    output.data = ParseHex(data);
-    //output.sender = 0; //??
-    output.sender = sender;
-    //output.vout = 0; //?
-    output.OpCreate = false;
 
     ContractExecutor exec(block, output, 10000000000);
     ContractExecutionResult result;
@@ -1190,9 +1308,7 @@ UniValue executecontract(const JSONRPCRequest& request)
              "2. address              (string, optional) The sender address hex string\n"
              "3. gasLimit             (string, optional) The gas limit for executing the contract\n"
          );
- 
-    LOCK(cs_main);
-    
+
     std::string bytecodeStr = request.params[0].get_str();
 
     uint64_t gasLimit=0;
@@ -1201,20 +1317,8 @@ UniValue executecontract(const JSONRPCRequest& request)
     }
 
     //other VMs
-    DeltaDBWrapper db(pdeltaDB);
     std::vector<uint8_t> bytecode = x86Lib::qtumCompressPayload(ParseHex(bytecodeStr));
 
-    CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[pcoinsTip->GetBestBlock()];
-
-    if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
-        // Block not found on disk. This could be because we have the block
-        // header in our index but don't have the block (for example if a
-        // non-whitelisted node sends us an unrequested long chain of valid
-        // blocks, we add the headers to our index, but don't accept the
-        // block).
-        throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
-    
     ContractOutput output;
 
     output.version = VersionVM::Getx86Default();
@@ -1228,6 +1332,23 @@ UniValue executecontract(const JSONRPCRequest& request)
     //output.vout = 0; //?
     output.OpCreate = true;
 
+    UniValue poolResult;
+    if(PoolExecuteContract(output, poolResult)){
+        return poolResult;
+    }
+
+    LOCK(cs_main);
+    CBlock block;
+    CBlockIndex* pblockindex = mapBlockIndex[pcoinsTip->GetBestBlock()];
+
+    if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        // Block not found on disk. This could be because we have the block
+        // header in our index but don't have the block (for example if a
+        // non-whitelisted node sends us an unrequested long chain of valid
+        // blocks, we add the headers to our index, but don't accept the
+        // block).
+        throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
+
     ContractExecutor exec(block, output, 10000000000);
     ContractExecutionResult result;
     bool success = exec.execute(result, false);
@@ -1689,56 +1810,56 @@ UniValue searchlogs(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Incorrect params");
     }
 
-    UniValue result(UniValue::VARR);
-
     auto topics = params.topics;
 
-    for(const auto& hashesTx : hashesToBlock)
-    {
-        for(const auto& e : hashesTx)
+    return request.StreamResult([&](JSONStreamWriter& out) {
+        out.beginArray();
+        for(const auto& hashesTx : hashesToBlock)
         {
-            std::vector<TransactionReceiptInfo> receipts = pstorageresult->getResult(uintToh256(e));
+            for(const auto& e : hashesTx)
+            {
+                std::vector<TransactionReceiptInfo> receipts = pstorageresult->getResult(uintToh256(e));
             
-            for(const auto& receipt : receipts) {
-                if(receipt.logs.empty()) {
-                    continue;
-                }
-
-                if (!topics.empty()) {
-                    for (size_t i = 0; i < topics.size(); i++) {
-                        const auto& tc = topics[i];
-
-                        if (!tc) {
-                            continue;
-                        }
+                for(const auto& receipt : receipts) {
+                    if(receipt.logs.empty()) {
+                        continue;
+                    }
 
-                        for (const auto& log: receipt.logs) {
-                            auto filterTopicContent = tc.get();
+                    if (!topics.empty()) {
+                        for (size_t i = 0; i < topics.size(); i++) {
+                            const auto& tc = topics[i];
 
-                            if (i >= log.topics.size()) {
+                            if (!tc) {
                                 continue;
                             }
 
-                            if (filterTopicContent == log.topics[i]) {
-                                goto push;
+                            for (const auto& log: receipt.logs) {
+                                auto filterTopicContent = tc.get();
+
+                                if (i >= log.topics.size()) {
+                                    continue;
+                                }
+
+                                if (filterTopicContent == log.topics[i]) {
+                                    goto push;
+                                }
                             }
                         }
-                    }
 
-                    // Skip the log if none of the topics are matched
-                    continue;
-                }
+                        // Skip the log if none of the topics are matched
+                        continue;
+                    }
 
-            push:
+                push:
 
-                UniValue tri(UniValue::VOBJ);
-                transactionReceiptInfoToJSON(receipt, tri);
-                result.push_back(tri);
+                    UniValue tri(UniValue::VOBJ);
+                    transactionReceiptInfoToJSON(receipt, tri);
+                    out.value(tri);
+                }
             }
         }
-    }
-
-    return result;
+        out.endArray();
+    });
 }
 
 UniValue gettransactionreceipt(const JSONRPCRequest& request)
@@ -1779,14 +1900,14 @@ UniValue listcontracts(const JSONRPCRequest& request)
 {
 	if (request.fHelp)
 		throw std::runtime_error(
-				"listcontracts (start maxDisplay)\n"
+				"listcontracts (start maxDisplay after)\n"
 				"\nArgument:\n"
 				"1. start     (numeric or string, optional) The starting account index, default 1\n"
 				"2. maxDisplay       (numeric or string, optional) Max accounts to list, default 20\n"
+				"3. after     (string, optional) Only list contracts after this one, counting start from there.\n"
+				"             Pass the last contract of a page to get the next page. EVM contracts are given in hex, x86 contracts as base58 address\n"
 		);
 
-	LOCK(cs_main);
-
 	int start=1;
 	if (request.params.size() > 0){
 		start = request.params[0].get_int();
@@ -1801,24 +1922,70 @@ UniValue listcontracts(const JSONRPCRequest& request)
 			throw JSONRPCError(RPC_TYPE_ERROR, "Invalid maxDisplay");
 	}
 
-	UniValue result(UniValue::VOBJ);
-
-	auto map = globalState->addresses();
-	int contractsCount=(int)map.size();
+	CContractIndexKey after;
+	bool fAfter = request.params.size() > 2 && !request.params[2].isNull();
+	if (fAfter){
+		std::string strAfter = request.params[2].get_str();
+		if (strAfter.size() == 40 && IsHex(strAfter)){
+			after = CContractIndexKey(UniversalAddress(AddressVersion::EVM, ParseHex(strAfter)));
+		}else{
+			CBitcoinAddress addressAfter(strAfter);
+			if (!addressAfter.IsValid())
+				throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid contract address for after");
+			UniversalAddress universalAfter(addressAfter);
+			if (universalAfter.version != AddressVersion::X86)
+				throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid contract address for after");
+			after = CContractIndexKey(universalAfter);
+		}
+	}
 
-	if (contractsCount>0 && start > contractsCount)
-		throw JSONRPCError(RPC_TYPE_ERROR, "start greater than max index "+ itostr(contractsCount));
+	LOCK(cs_main);
 
-	int itStartPos=std::min(start-1,contractsCount);
-	int i=0;
-	for (auto it = std::next(map.begin(),itStartPos); it!=map.end(); it++)
-	{
-		result.push_back(Pair(it->first.hex(),ValueFromAmount(CAmount(globalState->balance(it->first)))));
-		i++;
-		if(i==maxDisplay)break;
+	// The index keeps self-destructed EVM contracts, so read on until the page is full.
+	// They are left out before counting, so start counts listed contracts only
+	std::vector<std::pair<UniversalAddress, CAmount>> contracts;
+	DeltaDBWrapper deltaDB(pdeltaDB);
+	size_t skip = start - 1;
+	while ((int)contracts.size() < maxDisplay){
+		std::vector<CContractIndexKey> keys;
+		pblocktree->ReadContractIndex(fAfter ? &after : nullptr, 0, skip + maxDisplay - contracts.size(), keys);
+		if (keys.empty())
+			break;
+		after = keys.back();
+		fAfter = true;
+		for (const CContractIndexKey& key : keys){
+			UniversalAddress address = key.GetUniversalAddress();
+			dev::Address addressEVM;
+			if (address.version == AddressVersion::EVM){
+				addressEVM = dev::Address(address.toChainData());
+				if (!globalState->addressInUse(addressEVM))
+					continue;
+			}
+			if (skip > 0){
+				skip--;
+				continue;
+			}
+			if (address.version == AddressVersion::EVM){
+				contracts.push_back(std::make_pair(address, CAmount(globalState->balance(addressEVM))));
+			}else{
+				contracts.push_back(std::make_pair(address, CAmount(deltaDB.getBalance(address))));
+			}
+		}
 	}
 
-	return result;
+	if (contracts.empty() && start > 1)
+		throw JSONRPCError(RPC_TYPE_ERROR, "start greater than the number of contracts");
+
+	return request.StreamResult([&](JSONStreamWriter& out) {
+		out.beginObject();
+		for (const auto& contract : contracts)
+		{
+			const UniversalAddress& address = contract.first;
+			std::string strAddress = address.version == AddressVersion::EVM ? HexStr(address.toChainData()) : address.asBitcoinAddress().ToString();
+			out.pushKV(strAddress, ValueFromAmount(contract.second));
+		}
+		out.endObject();
+	});
 }
 
 struct CCoinsStats
@@ -2614,7 +2781,7 @@ static const CRPCCommand commands[] =
     { "hidden",             "waitfornewblock",        &waitfornewblock,        true,  {"timeout"} },
     { "hidden",             "waitforblock",           &waitforblock,           true,  {"blockhash","timeout"} },
     { "hidden",             "waitforblockheight",     &waitforblockheight,     true,  {"height","timeout"} },
-    { "blockchain",         "listcontracts",          &listcontracts,          true,  {"start", "maxDisplay"} },
+    { "blockchain",         "listcontracts",          &listcontracts,          true,  {"start", "maxDisplay", "after"} },
     { "blockchain",         "gettransactionreceipt",  &gettransactionreceipt,  true,  {"hash"} },
     { "blockchain",         "searchlogs",             &searchlogs,             true,  {"fromBlock", "toBlock", "address", "topics"} },
     { "blockchain",         "searchevents",           &searchevents,           true,  {"address", "fromBlock", "toBlock", "maxCount"} },
@@ -2626,4 +2793,17 @@ void RegisterBlockchainRPCCommands(CRPCTable &t)
 {
     for (unsigned int vcidx = 0; vcidx < ARRAYLEN(commands); vcidx++)
         t.appendCommand(commands[vcidx].name, &commands[vcidx]);
+
+    // Read from the tip snapshot kept for waitfornewblock
+    t.setExecClass("getblockcount", RPC_EXEC_SNAPSHOT);
+    t.setExecClass("getbestblockhash", RPC_EXEC_SNAPSHOT);
+    // Run on the contract call pool's snapshot if there is one. getstorage, listcontracts and searchlogs
+    // read the contract databases under cs_main, so they stay on the default pool
+    t.setExecClass("callcontract", RPC_EXEC_CONTRACTCALL);
+    t.setExecClass("executecontract", RPC_EXEC_CONTRACTCALL);
+
+    t.setExecClass("waitfornewblock", RPC_EXEC_LONGPOLL);
+    t.setExecClass("waitforblock", RPC_EXEC_LONGPOLL);
+    t.setExecClass("waitforblockheight", RPC_EXEC_LONGPOLL);
+    t.setExecClass("waitforlogs", RPC_EXEC_LONGPOLL);
 }
@@ -0,0 +1,161 @@
+// Copyright (c) 2018 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpc/jsonstream.h"
+
+#include "httpserver.h"
+#include "rpc/protocol.h"
+
+#include <assert.h>
+
+/** Append str as a quoted JSON string, escaped the same way as UniValue does */
+static void WriteJSONString(std::string& out, const std::string& str)
+{
+    static const char hexdigits[] = "0123456789abcdef";
+    out += '"';
+    for (unsigned char ch : str) {
+        switch (ch) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\t': out += "\\t"; break;
+        case '\n': out += "\\n"; break;
+        case '\f': out += "\\f"; break;
+        case '\r': out += "\\r"; break;
+        default:
+            if (ch < 0x20 || ch == 0x7f) {
+                out += "\\u00";
+                out += hexdigits[ch >> 4];
+                out += hexdigits[ch & 0xf];
+            } else {
+                out += ch;
+            }
+        }
+    }
+    out += '"';
+}
+
+JSONStreamWriter::JSONStreamWriter(const Sink& sinkIn, size_t flushSizeIn) : sink(sinkIn), flushSize(flushSizeIn), fAfterKey(false)
+{
+    buf.reserve(flushSize + flushSize / 4);
+}
+
+void JSONStreamWriter::separator()
+{
+    if (fAfterKey) {
+        fAfterKey = false;
+        return;
+    }
+    if (!vNonEmpty.empty()) {
+        if (vNonEmpty.back())
+            buf += ',';
+        vNonEmpty.back() = true;
+    }
+}
+
+void JSONStreamWriter::flushIfFull()
+{
+    if (buf.size() >= flushSize) {
+        sink(buf, false);
+        buf.clear();
+    }
+}
+
+void JSONStreamWriter::beginObject()
+{
+    separator();
+    buf += '{';
+    vNonEmpty.push_back(false);
+}
+
+void JSONStreamWriter::endObject()
+{
+    assert(!vNonEmpty.empty() && !fAfterKey);
+    vNonEmpty.pop_back();
+    buf += '}';
+    flushIfFull();
+}
+
+void JSONStreamWriter::beginArray()
+{
+    separator();
+    buf += '[';
+    vNonEmpty.push_back(false);
+}
+
+void JSONStreamWriter::endArray()
+{
+    assert(!vNonEmpty.empty() && !fAfterKey);
+    vNonEmpty.pop_back();
+    buf += ']';
+    flushIfFull();
+}
+
+void JSONStreamWriter::key(const std::string& name)
+{
+    assert(!fAfterKey);
+    separator();
+    WriteJSONString(buf, name);
+    buf += ':';
+    fAfterKey = true;
+}
+
+void JSONStreamWriter::value(const UniValue& val)
+{
+    separator();
+    if (val.isStr())
+        WriteJSONString(buf, val.get_str());
+    else
+        buf += val.write();
+    flushIfFull();
+}
+
+void JSONStreamWriter::pushKV(const std::string& name, const UniValue& val)
+{
+    key(name);
+    value(val);
+}
+
+void JSONStreamWriter::pushKVs(const UniValue& obj)
+{
+    const std::vector<std::string>& keys = obj.getKeys();
+    const std::vector<UniValue>& values = obj.getValues();
+    for (size_t i = 0; i < keys.size(); i++)
+        pushKV(keys[i], values[i]);
+}
+
+void JSONStreamWriter::raw(const std::string& text)
+{
+    buf += text;
+    flushIfFull();
+}
+
+void JSONStreamWriter::finish()
+{
+    assert(vNonEmpty.empty() && !fAfterKey);
+    sink(buf, true);
+    buf.clear();
+}
+
+std::vector<std::string> WriteJSONPieces(const std::function<void(JSONStreamWriter&)>& writeBody, size_t flushSize)
+{
+    std::vector<std::string> pieces;
+    JSONStreamWriter writer([&pieces](const std::string& data, bool fFinal) {
+        pieces.push_back(data);
+    }, flushSize);
+    writeBody(writer);
+    writer.finish();
+    return pieces;
+}
+
+void HTTPReplyJSONPieces(HTTPRequest* req, std::vector<std::string>&& pieces)
+{
+    req->WriteHeader("Content-Type", "application/json");
+    req->WriteReply(HTTP_OK, std::move(pieces));
+}
+
+void HTTPStreamJSONReply(HTTPRequest* req, const std::function<void(JSONStreamWriter&)>& writeBody)
+{
+    HTTPReplyJSONPieces(req, WriteJSONPieces(writeBody));
+}
@@ -0,0 +1,86 @@
+// Copyright (c) 2018 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPC_JSONSTREAM_H
+#define BITCOIN_RPC_JSONSTREAM_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <univalue.h>
+
+class HTTPRequest;
+
+/** Size of the pieces JSON output is handed out in */
+static const size_t JSON_STREAM_FLUSH_SIZE = 64 * 1024;
+
+/**
+ * Writes JSON straight from the data it describes, handing it to a sink in
+ * pieces, so that large documents never have to be held as a UniValue tree or
+ * copied into a single string.
+ *
+ * Containers are opened and closed explicitly, and parts of the document can
+ * still be built as UniValue and written with value() or pushKVs(). The output
+ * is the same as UniValue::write() without indentation would give.
+ */
+class JSONStreamWriter
+{
+public:
+    /** Receives the output in pieces of about flushSize bytes. fFinal is set on the last one. */
+    typedef std::function<void(const std::string& data, bool fFinal)> Sink;
+
+    explicit JSONStreamWriter(const Sink& sinkIn, size_t flushSizeIn = JSON_STREAM_FLUSH_SIZE);
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    /** Start a member of the current object, its value has to be written next */
+    void key(const std::string& name);
+    void value(const UniValue& val);
+    void pushKV(const std::string& name, const UniValue& val);
+    /** Write all members of obj into the current object */
+    void pushKVs(const UniValue& obj);
+    /** Append text outside of any JSON value, like a trailing newline */
+    void raw(const std::string& text);
+
+    /** Hand the remaining output to the sink */
+    void finish();
+
+private:
+    Sink sink;
+    size_t flushSize;
+    std::string buf;
+    // For each open container, whether anything was written to it yet
+    std::vector<bool> vNonEmpty;
+    bool fAfterKey;
+
+    void separator();
+    void flushIfFull();
+};
+
+/**
+ * Run writeBody and keep its output as the pieces the writer handed out, without
+ * sending anything. Callers serialize while holding cs_main or mempool.cs, and send
+ * the pieces with HTTPReplyJSONPieces once they released them.
+ */
+std::vector<std::string> WriteJSONPieces(const std::function<void(JSONStreamWriter&)>& writeBody, size_t flushSize = JSON_STREAM_FLUSH_SIZE);
+
+/**
+ * Reply to req with pieces from WriteJSONPieces, as one reply with a known length
+ * that keeps the connection open. The pieces are handed to libevent without
+ * copying, and freed once they were written out.
+ */
+void HTTPReplyJSONPieces(HTTPRequest* req, std::vector<std::string>&& pieces);
+
+/**
+ * Reply to req with the JSON written by writeBody. The whole reply is written
+ * before anything is sent, so locks that writeBody takes are released by then.
+ * If writeBody throws, nothing is sent and the caller can still reply with an error.
+ */
+void HTTPStreamJSONReply(HTTPRequest* req, const std::function<void(JSONStreamWriter&)>& writeBody);
+
+#endif // BITCOIN_RPC_JSONSTREAM_H
@@ -949,6 +949,65 @@ UniValue estimatesmartfee(const JSONRPCRequest& request)
     return result;
 }
 
+UniValue estimategasprice(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "estimategasprice conf_target ( gas_limit )\n"
+            "\nEstimates the approximate gas price needed for a contract transaction to begin\n"
+            "confirmation within conf_target blocks if possible and return the number of blocks\n"
+            "for which the estimate is valid. Estimates are based on the lowest gas price among the\n"
+            "contract outputs of recent transactions with a similar total gas limit.\n"
+            "\nArguments:\n"
+            "1. conf_target     (numeric) Confirmation target in blocks (1 - 48)\n"
+            "2. gas_limit       (numeric, optional, default=" + i64tostr(DEFAULT_GAS_LIMIT_OP_SEND) + ") Total gas limit of the contract outputs of the transaction\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"gasprice\" : x.x,    (numeric, optional) estimate gas price (in QTUM per gas)\n"
+            "  \"errors\": [ str... ] (json array of strings, optional) Errors encountered during processing\n"
+            "  \"blocks\" : n         (numeric) block number where estimate was found\n"
+            "}\n"
+            "\n"
+            "The request target will be clamped between 2 and the highest target\n"
+            "fee estimation is able to return based on how long it has been running.\n"
+            "An error is returned if not enough contract transactions and blocks\n"
+            "have been observed to make an estimate for any number of blocks.\n"
+            "\nExample:\n"
+            + HelpExampleCli("estimategasprice", "6")
+            + HelpExampleCli("estimategasprice", "6 2500000")
+            );
+
+    RPCTypeCheck(request.params, {UniValue::VNUM, UniValue::VNUM}, true);
+    RPCTypeCheckArgument(request.params[0], UniValue::VNUM);
+    // Gas prices are tracked up to the medium time horizon only
+    int conf_target = request.params[0].get_int();
+    unsigned int max_target = ::feeEstimator.HighestTargetTracked(FeeEstimateHorizon::MED_HALFLIFE);
+    if (conf_target < 1 || (unsigned int)conf_target > max_target) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Invalid conf_target, must be between %u - %u", 1, max_target));
+    }
+    uint64_t gas_limit = DEFAULT_GAS_LIMIT_OP_SEND;
+    if (!request.params[1].isNull()) {
+        int64_t n = request.params[1].get_int64();
+        if (n <= 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid gas_limit, must be positive");
+        }
+        gas_limit = n;
+    }
+
+    UniValue result(UniValue::VOBJ);
+    UniValue errors(UniValue::VARR);
+    FeeCalculation feeCalc;
+    CAmount gasPrice = ::feeEstimator.estimateGasPrice(conf_target, gas_limit, &feeCalc);
+    if (gasPrice != 0) {
+        result.push_back(Pair("gasprice", ValueFromAmount(gasPrice)));
+    } else {
+        errors.push_back("Insufficient data or no gas price found");
+        result.push_back(Pair("errors", errors));
+    }
+    result.push_back(Pair("blocks", feeCalc.returnedTarget));
+    return result;
+}
+
 UniValue estimaterawfee(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
@@ -1066,6 +1125,7 @@ static const CRPCCommand commands[] =
 
     { "util",               "estimatefee",            &estimatefee,            true,  {"nblocks"} },
     { "util",               "estimatesmartfee",       &estimatesmartfee,       true,  {"conf_target", "estimate_mode"} },
+    { "util",               "estimategasprice",       &estimategasprice,       true,  {"conf_target", "gas_limit"} },
 
     { "hidden",             "estimaterawfee",         &estimaterawfee,         true,  {"conf_target", "threshold"} },
 };
@@ -9,6 +9,7 @@
 #include "fs.h"
 #include "init.h"
 #include "random.h"
+#include "rpc/jsonstream.h"
 #include "sync.h"
 #include "ui_interface.h"
 #include "util.h"
@@ -309,6 +310,23 @@ bool CRPCTable::appendCommand(const std::string& name, const CRPCCommand* pcmd)
     return true;
 }
 
+bool CRPCTable::setExecClass(const std::string& name, RPCExecClass execClass)
+{
+    if (IsRPCRunning())
+        return false;
+
+    mapExecClasses[name] = execClass;
+    return true;
+}
+
+RPCExecClass CRPCTable::execClass(const std::string& name) const
+{
+    std::map<std::string, RPCExecClass>::const_iterator it = mapExecClasses.find(name);
+    if (it == mapExecClasses.end())
+        return RPC_EXEC_DEFAULT;
+    return it->second;
+}
+
 bool StartRPC()
 {
     LogPrint(BCLog::RPC, "Starting RPC\n");
@@ -397,6 +415,33 @@ void JSONRPCRequest::PollReply(const UniValue& result) {
     req->ChunkEnd();
 }
 
+UniValue JSONRPCRequest::StreamResult(const std::function<void(JSONStreamWriter&)>& writeResult) const
+{
+    if (!req || isLongPolling) {
+        std::string strResult;
+        JSONStreamWriter writer([&strResult](const std::string& data, bool fFinal) { strResult += data; });
+        writeResult(writer);
+        writer.finish();
+        UniValue result;
+        if (!result.read(strResult))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Invalid result");
+        return result;
+    }
+
+    vStreamedReply = WriteJSONPieces([this, &writeResult](JSONStreamWriter& out) {
+        // Same layout as JSONRPCReply
+        out.beginObject();
+        out.key("result");
+        writeResult(out);
+        out.pushKV("error", NullUniValue);
+        out.pushKV("id", id);
+        out.endObject();
+        out.raw("\n");
+    });
+    isStreamed = true;
+    return NullUniValue;
+}
+
 void JSONRPCRequest::parse(const UniValue& valRequest)
 {
     // Parse request
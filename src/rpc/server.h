@@ -14,6 +14,7 @@
 #include <map>
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 #include <univalue.h>
 #include <httpserver.h>
@@ -33,6 +34,7 @@ static std::condition_variable cond_blockchange;
 static CUpdatedBlock latestblock;
 
 class CRPCCommand;
+class JSONStreamWriter;
 
 namespace RPCServer
 {
@@ -61,6 +63,10 @@ public:
     std::string authUser;
 
     bool isLongPolling;
+    /** Set once StreamResult has serialized the reply into vStreamedReply */
+    mutable bool isStreamed;
+    /** Reply serialized by StreamResult, sent by the HTTP handler once the RPC method returned */
+    mutable std::vector<std::string> vStreamedReply;
 
     /**
      * If using batch JSON request, this object won't get the underlying HTTPRequest.
@@ -71,6 +77,7 @@ public:
         fHelp = false;
         req = NULL;
         isLongPolling = false;
+        isStreamed = false;
     };
 
     JSONRPCRequest(HTTPRequest *_req);
@@ -100,6 +107,15 @@ public:
      */
     void PollReply(const UniValue& result);
 
+    /**
+     * Generate a large result with writeResult, serializing it straight into the reply
+     * without building a UniValue tree. Returns NullUniValue when the reply was kept
+     * this way. It is sent after the RPC method returned, so locks the method holds are
+     * never held while sending. Batches and the GUI console need the result as a value,
+     * so for them it is collected and returned instead.
+     */
+    UniValue StreamResult(const std::function<void(JSONStreamWriter&)>& writeResult) const;
+
     void parse(const UniValue& valRequest);
 
     // FIXME: make this private?
@@ -183,6 +199,21 @@ void RPCRunLater(const std::string& name, std::function<void(void)> func, int64_
 
 typedef UniValue(*rpcfn_type)(const JSONRPCRequest& jsonRequest);
 
+/** How a method is scheduled by the HTTP server. This only picks the worker pool,
+ *  handlers still take whatever locks they need. */
+enum RPCExecClass
+{
+    /** May lock or change the chain state */
+    RPC_EXEC_DEFAULT,
+    /** Read-only, answered from a chain tip snapshot without cs_main */
+    RPC_EXEC_SNAPSHOT,
+    /** Read-only contract execution. RPC_EXEC_SNAPSHOT while the contract call pool runs,
+     *  otherwise it takes cs_main and is RPC_EXEC_DEFAULT */
+    RPC_EXEC_CONTRACTCALL,
+    /** Waits for new blocks or logs */
+    RPC_EXEC_LONGPOLL
+};
+
 class CRPCCommand
 {
 public:
@@ -200,6 +231,7 @@ class CRPCTable
 {
 private:
     std::map<std::string, const CRPCCommand*> mapCommands;
+    std::map<std::string, RPCExecClass> mapExecClasses;
 public:
     CRPCTable();
     const CRPCCommand* operator[](const std::string& name) const;
@@ -226,6 +258,13 @@ public:
      * Commands cannot be overwritten (returns false).
      */
     bool appendCommand(const std::string& name, const CRPCCommand* pcmd);
+
+    /**
+     * Set how a command is scheduled. Commands are RPC_EXEC_DEFAULT unless set otherwise.
+     * Returns false if RPC server is already running.
+     */
+    bool setExecClass(const std::string& name, RPCExecClass execClass);
+    RPCExecClass execClass(const std::string& name) const;
 };
 
 extern CRPCTable tableRPC;
@@ -0,0 +1,71 @@
+// Copyright (c) 2018 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "arith_uint256.h"
+#include "chain.h"
+#include "test/test_bitcoin.h"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockindexarena_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(blockindex_arena_test)
+{
+    CBlockIndexArena arena;
+
+    CBlockHeader header;
+    header.SetNull();
+    header.nTime = 1234;
+    header.hashStateRoot = InsecureRand256();
+    header.hashUTXORoot = InsecureRand256();
+
+    // Proof-of-work blocks have no stake data
+    CBlockIndex* pow = arena.New(header, arena);
+    BOOST_CHECK(pow->IsProofOfWork());
+    BOOST_CHECK(pow->pStakeData == nullptr);
+    BOOST_CHECK(pow->GetPrevoutStake().IsNull());
+    BOOST_CHECK(pow->GetBlockSig().empty());
+
+    // Proof-of-stake block with the same state roots shares them
+    header.prevoutStake = COutPoint(InsecureRand256(), 3);
+    header.vchBlockSig = std::vector<unsigned char>(72, 0x5a);
+    CBlockIndex* pos = arena.New(header, arena);
+    BOOST_CHECK(pos->IsProofOfStake());
+    BOOST_CHECK(pos->pStateRoots == pow->pStateRoots);
+    BOOST_CHECK(pos->GetHashStateRoot() == header.hashStateRoot);
+    BOOST_CHECK(pos->GetHashUTXORoot() == header.hashUTXORoot);
+    BOOST_CHECK(pos->GetPrevoutStake() == header.prevoutStake);
+    BOOST_CHECK(pos->GetBlockSig() == header.vchBlockSig);
+    uint256 hashProof = InsecureRand256();
+    pos->SetHashProof(hashProof);
+    BOOST_CHECK(pos->GetHashProof() == hashProof);
+
+    // The disk representation carries the out of line fields
+    pos->phashBlock = &hashProof;
+    CDiskBlockIndex diskindex(pos);
+    BOOST_CHECK(diskindex.hashStateRoot == header.hashStateRoot);
+    BOOST_CHECK(diskindex.prevoutStake == header.prevoutStake);
+    BOOST_CHECK(diskindex.vchBlockSig == header.vchBlockSig);
+    BOOST_CHECK(diskindex.hashProof == hashProof);
+
+    // Many entries spanning several chunks stay intact
+    std::vector<CBlockIndex*> vIndex;
+    for (int i = 0; i < 20000; i++) {
+        header.nTime = i;
+        header.hashUTXORoot = ArithToUint256(i / 100);
+        vIndex.push_back(arena.New(header, arena));
+    }
+    for (int i = 0; i < 20000; i++) {
+        BOOST_CHECK_EQUAL(vIndex[i]->nTime, (unsigned int)i);
+        BOOST_CHECK(vIndex[i]->GetHashUTXORoot() == ArithToUint256(i / 100));
+        BOOST_CHECK(vIndex[i]->GetBlockSig() == header.vchBlockSig);
+        if (i % 100)
+            BOOST_CHECK(vIndex[i]->pStateRoots == vIndex[i - 1]->pStateRoots);
+    }
+    arena.Clear();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
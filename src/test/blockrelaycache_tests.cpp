@@ -0,0 +1,161 @@
+// Copyright (c) 2018 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockrelaycache.h"
+#include "blockencodings.h"
+#include "netmessagemaker.h"
+#include "random.h"
+#include "streams.h"
+#include "version.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockrelaycache_tests, BasicTestingSetup)
+
+struct TestHeaderAndShortIDs : public CBlockHeaderAndShortTxIDs {
+    using CBlockHeaderAndShortTxIDs::shorttxids;
+};
+
+// Every other transaction carries witness data
+static CBlock BuildBlockTestCase(size_t nTx)
+{
+    CBlock block;
+    block.nVersion = 42;
+    block.hashPrevBlock = InsecureRand256();
+    block.nBits = 0x207fffff;
+    for (size_t i = 0; i < nTx; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout.hash = InsecureRand256();
+        tx.vin[0].prevout.n = i;
+        tx.vin[0].scriptSig.resize(10);
+        if (i % 2 == 1)
+            tx.vin[0].scriptWitness.stack.push_back(std::vector<unsigned char>(20, i));
+        tx.vout.resize(1);
+        tx.vout[0].nValue = 42;
+        block.vtx.push_back(MakeTransactionRef(tx));
+    }
+    return block;
+}
+
+static std::vector<unsigned char> SerializeBlock(const CBlock& block, int nVersion)
+{
+    std::vector<unsigned char> vBlock;
+    CVectorWriter(SER_NETWORK, nVersion, vBlock, 0, block);
+    return vBlock;
+}
+
+BOOST_AUTO_TEST_CASE(block_messages)
+{
+    CBlock block = BuildBlockTestCase(5);
+    uint256 hash = block.GetHash();
+    CBlockRelayCache cache(1 << 20);
+
+    BOOST_CHECK(!cache.GetBlockMsg(hash, true));
+    BOOST_CHECK(!cache.Insert(InsecureRand256(), SerializeBlock(block, PROTOCOL_VERSION)));
+    std::vector<unsigned char> vTruncated = SerializeBlock(block, PROTOCOL_VERSION);
+    vTruncated.pop_back();
+    BOOST_CHECK(!cache.Insert(hash, std::move(vTruncated)));
+    BOOST_CHECK(cache.Insert(hash, SerializeBlock(block, PROTOCOL_VERSION)));
+    BOOST_CHECK(cache.Contains(hash));
+
+    CSharedNetMsg msg = cache.GetBlockMsg(hash, true);
+    BOOST_CHECK_EQUAL(msg->command, NetMsgType::BLOCK);
+    BOOST_CHECK(msg->data == SerializeBlock(block, PROTOCOL_VERSION));
+    msg = cache.GetBlockMsg(hash, false);
+    BOOST_CHECK(msg->data == SerializeBlock(block, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
+    BOOST_CHECK(cache.GetBlockMsg(hash, false) == msg);
+
+    for (bool fWitness : {true, false}) {
+        msg = cache.GetCompactBlockMsg(hash, fWitness);
+        BOOST_CHECK_EQUAL(msg->command, NetMsgType::CMPCTBLOCK);
+        BOOST_CHECK(cache.GetCompactBlockMsg(hash, fWitness) == msg);
+
+        TestHeaderAndShortIDs cmpctblock;
+        CDataStream ss(msg->data, SER_NETWORK, PROTOCOL_VERSION);
+        ss >> cmpctblock;
+        BOOST_CHECK(cmpctblock.header.GetHash() == hash);
+        BOOST_CHECK_EQUAL(cmpctblock.BlockTxCount(), block.vtx.size());
+        // only the coinbase is prefilled
+        BOOST_CHECK_EQUAL(cmpctblock.shorttxids.size(), block.vtx.size() - 1);
+        for (size_t i = 1; i < block.vtx.size(); i++) {
+            const uint256& txhash = fWitness ? block.vtx[i]->GetWitnessHash() : block.vtx[i]->GetHash();
+            BOOST_CHECK_EQUAL(cmpctblock.shorttxids[i - 1], cmpctblock.GetShortID(txhash));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(blocktxn_messages)
+{
+    CBlock block = BuildBlockTestCase(5);
+    CBlockRelayCache cache(1 << 20);
+    BOOST_CHECK(cache.Insert(block.GetHash(), SerializeBlock(block, PROTOCOL_VERSION)));
+
+    BlockTransactionsRequest req;
+    req.blockhash = InsecureRand256();
+    req.indexes = {1, 2, 4};
+    CSharedNetMsg msg;
+    BOOST_CHECK(!cache.GetBlockTxnMsg(req, true, msg));
+
+    req.blockhash = block.GetHash();
+    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    for (bool fWitness : {true, false}) {
+        BOOST_CHECK(cache.GetBlockTxnMsg(req, fWitness, msg));
+        BOOST_CHECK_EQUAL(msg->command, NetMsgType::BLOCKTXN);
+        BlockTransactions resp(req);
+        for (size_t i = 0; i < req.indexes.size(); i++)
+            resp.txn[i] = block.vtx[req.indexes[i]];
+        BOOST_CHECK(msg->data == msgMaker.Make(fWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCKTXN, resp).data);
+    }
+
+    req.indexes = {1, 5};
+    BOOST_CHECK(cache.GetBlockTxnMsg(req, true, msg));
+    BOOST_CHECK(!msg);
+}
+
+BOOST_AUTO_TEST_CASE(lru_eviction)
+{
+    CBlock blocks[3];
+    for (CBlock& block : blocks)
+        block = BuildBlockTestCase(4);
+
+    size_t nBlockUsage;
+    {
+        CBlockRelayCache cache(1 << 20);
+        BOOST_CHECK(cache.Insert(blocks[0].GetHash(), SerializeBlock(blocks[0], PROTOCOL_VERSION)));
+        nBlockUsage = cache.DynamicMemoryUsage();
+    }
+
+    // A block that does not fit at all is not cached
+    CBlockRelayCache tiny(nBlockUsage - 1);
+    BOOST_CHECK(!tiny.Insert(blocks[0].GetHash(), SerializeBlock(blocks[0], PROTOCOL_VERSION)));
+    BOOST_CHECK_EQUAL(tiny.Size(), 0);
+
+    CBlockRelayCache cache(2 * nBlockUsage);
+    BOOST_CHECK(cache.Insert(blocks[0].GetHash(), SerializeBlock(blocks[0], PROTOCOL_VERSION)));
+    BOOST_CHECK(cache.Insert(blocks[1].GetHash(), SerializeBlock(blocks[1], PROTOCOL_VERSION)));
+    BOOST_CHECK_EQUAL(cache.Size(), 2);
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), 2 * nBlockUsage);
+
+    // Using blocks[0] makes blocks[1] the least recently used one
+    BOOST_CHECK(cache.GetBlockMsg(blocks[0].GetHash(), true));
+    BOOST_CHECK(cache.Insert(blocks[2].GetHash(), SerializeBlock(blocks[2], PROTOCOL_VERSION)));
+    BOOST_CHECK_EQUAL(cache.Size(), 2);
+    BOOST_CHECK(cache.Contains(blocks[0].GetHash()));
+    BOOST_CHECK(!cache.Contains(blocks[1].GetHash()));
+    BOOST_CHECK(cache.Contains(blocks[2].GetHash()));
+
+    // Building another message for the most recent block evicts the other one instead
+    BOOST_CHECK(cache.GetBlockMsg(blocks[2].GetHash(), false));
+    BOOST_CHECK_EQUAL(cache.Size(), 1);
+    BOOST_CHECK(cache.Contains(blocks[2].GetHash()));
+
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.Size(), 0);
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -438,5 +438,42 @@ BOOST_AUTO_TEST_CASE(test_CheckQueueControl_Locks)
         tg.join_all();
     }
 }
+
+/** Test that queues of different check types can share one scheduler */
+BOOST_AUTO_TEST_CASE(test_CheckQueue_SharedScheduler)
+{
+    CCheckScheduler scheduler;
+    Unique_Queue unique_queue(QUEUE_BATCH_SIZE, scheduler);
+    Failing_Queue fail_queue(QUEUE_BATCH_SIZE, scheduler);
+    boost::thread_group tg;
+    for (auto x = 0; x < nScriptCheckThreads; ++x) {
+        tg.create_thread([&]{scheduler.Thread();});
+    }
+
+    UniqueCheck::results.clear();
+    size_t COUNT = 10000;
+    for (size_t round = 0; round < 10; ++round) {
+        {
+            CCheckQueueControl<UniqueCheck> control(&unique_queue);
+            for (size_t total = 0; total < COUNT;) {
+                std::vector<UniqueCheck> vChecks;
+                for (size_t k = 0; k < 100; k++)
+                    vChecks.emplace_back(round * COUNT + total++);
+                control.Add(vChecks);
+            }
+            BOOST_REQUIRE(control.Wait());
+        }
+        {
+            CCheckQueueControl<FailingCheck> control(&fail_queue);
+            std::vector<FailingCheck> vChecks(100, false);
+            vChecks[round] = true;
+            control.Add(vChecks);
+            BOOST_REQUIRE(!control.Wait());
+        }
+    }
+    BOOST_REQUIRE_EQUAL(UniqueCheck::results.size(), COUNT * 10);
+    tg.interrupt_all();
+    tg.join_all();
+}
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -770,6 +770,43 @@ BOOST_AUTO_TEST_CASE(ccoins_add)
     CheckAddCoin(VALUE2, VALUE3, VALUE3, DIRTY|FRESH, DIRTY|FRESH, true );
 }
 
+void CheckCacheFetchedCoin(CAmount cache_value, CAmount fetched_value, CAmount expected_value, char cache_flags, char expected_flags)
+{
+    SingleEntryCacheTest test(ABSENT, cache_value, cache_flags);
+
+    Coin coin;
+    SetCoinsValue(fetched_value, coin);
+    test.cache.CacheFetchedCoin(OUTPOINT, std::move(coin));
+    test.cache.SelfTest();
+
+    CAmount result_value;
+    char result_flags;
+    GetCoinsMapEntry(test.cache.map(), result_value, result_flags);
+    BOOST_CHECK_EQUAL(result_value, expected_value);
+    BOOST_CHECK_EQUAL(result_flags, expected_flags);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_cache_fetched)
+{
+    /* Check CacheFetchedCoin behavior, handing the cache a coin read from its
+     * base view, and checking that it is only cached when the cache has no
+     * entry of its own for the outpoint.
+     *
+     *                    Cache   Fetched Result  Cache        Result
+     *                    Value   Value   Value   Flags        Flags
+     */
+    CheckCacheFetchedCoin(ABSENT, VALUE3, VALUE3, NO_ENTRY   , 0          );
+    CheckCacheFetchedCoin(ABSENT, PRUNED, PRUNED, NO_ENTRY   , FRESH      );
+    CheckCacheFetchedCoin(PRUNED, VALUE3, PRUNED, 0          , 0          );
+    CheckCacheFetchedCoin(PRUNED, VALUE3, PRUNED, FRESH      , FRESH      );
+    CheckCacheFetchedCoin(PRUNED, VALUE3, PRUNED, DIRTY      , DIRTY      );
+    CheckCacheFetchedCoin(PRUNED, VALUE3, PRUNED, DIRTY|FRESH, DIRTY|FRESH);
+    CheckCacheFetchedCoin(VALUE2, VALUE3, VALUE2, 0          , 0          );
+    CheckCacheFetchedCoin(VALUE2, VALUE3, VALUE2, FRESH      , FRESH      );
+    CheckCacheFetchedCoin(VALUE2, VALUE3, VALUE2, DIRTY      , DIRTY      );
+    CheckCacheFetchedCoin(VALUE2, VALUE3, VALUE2, DIRTY|FRESH, DIRTY|FRESH);
+}
+
 void CheckWriteCoins(CAmount parent_value, CAmount child_value, CAmount expected_value, char parent_flags, char child_flags, char expected_flags)
 {
     SingleEntryCacheTest test(ABSENT, parent_value, parent_flags);
@@ -77,6 +77,91 @@ BOOST_AUTO_TEST_CASE(dbwrapper_batch)
     }
 }
 
+// Test that a snapshot keeps returning the values it was taken at
+BOOST_AUTO_TEST_CASE(dbwrapper_snapshot)
+{
+    // Perform tests both obfuscated and non-obfuscated.
+    for (bool obfuscate : {false, true}) {
+        fs::path ph = fs::temp_directory_path() / fs::unique_path();
+        CDBWrapper dbw(ph, (1 << 20), true, false, obfuscate);
+
+        char key = 'i';
+        uint256 in = InsecureRand256();
+        char key2 = 'j';
+        uint256 in2 = InsecureRand256();
+        char key3 = 'k';
+        uint256 in3 = InsecureRand256();
+
+        uint256 res;
+        BOOST_CHECK(dbw.Write(key, in));
+        BOOST_CHECK(dbw.Write(key2, in2));
+        {
+            CDBSnapshot snapshot(dbw);
+
+            // Overwrite key, remove key2 and add key3 after the snapshot
+            BOOST_CHECK(dbw.Write(key, in3));
+            BOOST_CHECK(dbw.Erase(key2));
+            BOOST_CHECK(dbw.Write(key3, in3));
+
+            BOOST_CHECK(snapshot.Read(key, res));
+            BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+            BOOST_CHECK(snapshot.Read(key2, res));
+            BOOST_CHECK_EQUAL(res.ToString(), in2.ToString());
+            BOOST_CHECK(!snapshot.Read(key3, res));
+        }
+
+        BOOST_CHECK(dbw.Read(key, res));
+        BOOST_CHECK_EQUAL(res.ToString(), in3.ToString());
+        BOOST_CHECK(!dbw.Read(key2, res));
+    }
+}
+
+// Test reading several keys at once, with and without the read pool
+BOOST_AUTO_TEST_CASE(dbwrapper_readmany)
+{
+    for (bool obfuscate : {false, true}) {
+        fs::path ph = fs::temp_directory_path() / fs::unique_path();
+        CDBWrapper dbw(ph, (1 << 20), true, false, obfuscate);
+
+        // Every third key is missing
+        std::vector<uint256> values(300);
+        std::vector<std::pair<char, uint32_t>> keys;
+        for (uint32_t i = 0; i < values.size(); i++) {
+            values[i] = InsecureRand256();
+            if (i % 3 != 0)
+                BOOST_CHECK(dbw.Write(std::make_pair('r', i), values[i]));
+            keys.emplace_back('r', i);
+        }
+        // Look them up out of order, with a duplicate
+        std::reverse(keys.begin(), keys.end());
+        keys.push_back(keys.front());
+
+        for (int threads : {0, 3}) {
+            dbReadPool.Start(threads);
+            for (bool fSeek : {false, true}) {
+                std::vector<uint256> res;
+                std::vector<bool> found;
+                BOOST_CHECK_EQUAL(dbw.ReadMany(keys, res, found, fSeek), 201U);
+                BOOST_REQUIRE_EQUAL(res.size(), keys.size());
+                for (size_t i = 0; i < keys.size(); i++) {
+                    uint32_t n = keys[i].second;
+                    BOOST_CHECK_EQUAL(found[i], n % 3 != 0);
+                    if (found[i])
+                        BOOST_CHECK_EQUAL(res[i].ToString(), values[n].ToString());
+                }
+            }
+
+            uint256 res1, res2;
+            std::future<bool> read1 = dbw.ReadAsync(std::make_pair('r', (uint32_t)1), res1);
+            std::future<bool> read2 = dbw.ReadAsync(std::make_pair('r', (uint32_t)3), res2);
+            BOOST_CHECK(read1.get());
+            BOOST_CHECK_EQUAL(res1.ToString(), values[1].ToString());
+            BOOST_CHECK(!read2.get());
+            dbReadPool.Stop();
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
 {
     // Perform tests both obfuscated and non-obfuscated.
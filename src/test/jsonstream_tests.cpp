@@ -0,0 +1,131 @@
+// Copyright (c) 2018 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpc/jsonstream.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(jsonstream_tests, BasicTestingSetup)
+
+static UniValue BuildTestObject()
+{
+    UniValue inner(UniValue::VOBJ);
+    inner.push_back(Pair("quote\"back\\slash", "tab\there\nnew\x01\x1f\x7f"));
+    inner.push_back(Pair("num", 42));
+    inner.push_back(Pair("real", 1.5));
+    inner.push_back(Pair("flag", false));
+    inner.push_back(Pair("none", NullUniValue));
+    inner.push_back(Pair("empty", UniValue(UniValue::VARR)));
+
+    UniValue arr(UniValue::VARR);
+    arr.push_back(inner);
+    arr.push_back("\xc3\xa9t\xc3\xa9");
+    arr.push_back(UniValue(UniValue::VOBJ));
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("arr", arr));
+    obj.push_back(Pair("inner", inner));
+    return obj;
+}
+
+// Write val with explicit containers down to scalars
+static void WriteRecursive(JSONStreamWriter& out, const UniValue& val)
+{
+    if (val.isObject()) {
+        out.beginObject();
+        for (size_t i = 0; i < val.size(); i++) {
+            out.key(val.getKeys()[i]);
+            WriteRecursive(out, val[i]);
+        }
+        out.endObject();
+    } else if (val.isArray()) {
+        out.beginArray();
+        for (size_t i = 0; i < val.size(); i++)
+            WriteRecursive(out, val[i]);
+        out.endArray();
+    } else {
+        out.value(val);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(matches_univalue)
+{
+    UniValue obj = BuildTestObject();
+    std::string strOut;
+    int nPieces = 0;
+    JSONStreamWriter::Sink sink = [&](const std::string& data, bool fFinal) {
+        BOOST_CHECK(fFinal);
+        strOut += data;
+        nPieces++;
+    };
+
+    JSONStreamWriter out(sink);
+    WriteRecursive(out, obj);
+    out.finish();
+    BOOST_CHECK_EQUAL(nPieces, 1);
+    BOOST_CHECK_EQUAL(strOut, obj.write());
+
+    // Mixing explicit containers with prebuilt values gives the same result
+    strOut.clear();
+    JSONStreamWriter mixed(sink);
+    mixed.beginObject();
+    mixed.pushKV("arr", obj["arr"]);
+    mixed.key("inner");
+    mixed.beginObject();
+    mixed.pushKVs(obj["inner"]);
+    mixed.endObject();
+    mixed.endObject();
+    mixed.raw("\n");
+    mixed.finish();
+    BOOST_CHECK_EQUAL(strOut, obj.write() + "\n");
+}
+
+BOOST_AUTO_TEST_CASE(flushes_in_pieces)
+{
+    UniValue arr(UniValue::VARR);
+    for (int i = 0; i < 1000; i++)
+        arr.push_back(BuildTestObject());
+
+    std::string strOut;
+    std::vector<bool> vFinal;
+    JSONStreamWriter out([&](const std::string& data, bool fFinal) {
+        BOOST_CHECK(!data.empty() || fFinal);
+        strOut += data;
+        vFinal.push_back(fFinal);
+    }, 1024);
+    WriteRecursive(out, arr);
+    out.finish();
+
+    BOOST_CHECK(vFinal.size() > 100);
+    for (size_t i = 0; i + 1 < vFinal.size(); i++)
+        BOOST_CHECK(!vFinal[i]);
+    BOOST_CHECK(vFinal.back());
+    BOOST_CHECK_EQUAL(strOut, arr.write());
+}
+
+BOOST_AUTO_TEST_CASE(write_pieces)
+{
+    UniValue arr(UniValue::VARR);
+    for (int i = 0; i < 1000; i++)
+        arr.push_back(BuildTestObject());
+
+    std::vector<std::string> pieces = WriteJSONPieces([&](JSONStreamWriter& out) {
+        WriteRecursive(out, arr);
+    }, 1024);
+    BOOST_CHECK(pieces.size() > 100);
+    std::string strOut;
+    for (const std::string& piece : pieces)
+        strOut += piece;
+    BOOST_CHECK_EQUAL(strOut, arr.write());
+
+    // Errors are passed on before anything could have been sent
+    BOOST_CHECK_THROW(WriteJSONPieces([](JSONStreamWriter& out) {
+        out.beginArray();
+        throw std::runtime_error("failed");
+    }), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
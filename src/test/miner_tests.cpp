@@ -489,7 +489,7 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     // Create an actual 209999-long block chain (without valid blocks).
     while (chainActive.Tip()->nHeight < 990499) {
         CBlockIndex* prev = chainActive.Tip();
-        CBlockIndex* next = new CBlockIndex();
+        CBlockIndex* next = blockIndexArena.New();
         next->phashBlock = new uint256(InsecureRand256());
         pcoinsTip->SetBestBlock(next->GetBlockHash());
         next->pprev = prev;
@@ -503,7 +503,7 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     // Extend to a 210000-long block chain.
     while (chainActive.Tip()->nHeight < 990501) {
         CBlockIndex* prev = chainActive.Tip();
-        CBlockIndex* next = new CBlockIndex();
+        CBlockIndex* next = blockIndexArena.New();
         next->phashBlock = new uint256(InsecureRand256());
         pcoinsTip->SetBestBlock(next->GetBlockHash());
         next->pprev = prev;
@@ -519,8 +519,8 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
         CBlockIndex* del = chainActive.Tip();
         chainActive.SetTip(del->pprev);
         pcoinsTip->SetBestBlock(del->pprev->GetBlockHash());
+        // the entry itself is released with blockIndexArena
         delete del->phashBlock;
-        delete del;
     }
 
     // non-final txs in mempool
@@ -0,0 +1,93 @@
+// Copyright (c) 2018 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "mpmcqueue.h"
+
+#include "test/test_bitcoin.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(mpmcqueue_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(fifo_and_bounds)
+{
+    MPMCQueue<std::unique_ptr<int>> queue(3);
+    std::unique_ptr<int> item;
+    BOOST_CHECK(!queue.TryPop(item));
+
+    // Go around the ring a few times
+    for (int lap = 0; lap < 4; lap++) {
+        for (int i = 0; i < 3; i++) {
+            std::unique_ptr<int> p(new int(lap * 10 + i));
+            BOOST_CHECK(queue.TryPush(std::move(p)));
+            BOOST_CHECK(!p);
+        }
+        BOOST_CHECK_EQUAL(queue.Size(), 3);
+
+        // A failed push leaves the item with the caller
+        std::unique_ptr<int> extra(new int(-1));
+        BOOST_CHECK(!queue.TryPush(std::move(extra)));
+        BOOST_CHECK(extra && *extra == -1);
+
+        for (int i = 0; i < 3; i++) {
+            BOOST_CHECK(queue.TryPop(item));
+            BOOST_CHECK_EQUAL(*item, lap * 10 + i);
+        }
+        BOOST_CHECK(!queue.TryPop(item));
+        BOOST_CHECK_EQUAL(queue.Size(), 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_producers_consumers)
+{
+    static const int PRODUCERS = 4;
+    static const int CONSUMERS = 4;
+    static const int ITEMS = 20000;
+
+    MPMCQueue<int> queue(64);
+    std::atomic<int> nConsumed(0);
+    std::atomic<long> nSum(0);
+    std::vector<std::atomic<int>> vSeen(PRODUCERS * ITEMS);
+    for (std::atomic<int>& seen : vSeen)
+        seen = 0;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < PRODUCERS; p++) {
+        threads.emplace_back([&queue, p] {
+            for (int i = 0; i < ITEMS; i++) {
+                int value = p * ITEMS + i;
+                while (!queue.TryPush(std::move(value)))
+                    std::this_thread::yield();
+            }
+        });
+    }
+    for (int c = 0; c < CONSUMERS; c++) {
+        threads.emplace_back([&] {
+            int value;
+            while (nConsumed < PRODUCERS * ITEMS) {
+                if (!queue.TryPop(value)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                vSeen[value]++;
+                nSum += value;
+                nConsumed++;
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    long n = PRODUCERS * ITEMS;
+    BOOST_CHECK_EQUAL(nSum, n * (n - 1) / 2);
+    for (std::atomic<int>& seen : vSeen)
+        BOOST_CHECK_EQUAL(seen, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -10,6 +10,7 @@
 #include "streams.h"
 #include "net.h"
 #include "netbase.h"
+#include "netmessagemaker.h"
 #include "chainparams.h"
 #include "util.h"
 
@@ -185,4 +186,69 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+#ifndef WIN32
+static void ReadAvailable(int fd, std::vector<unsigned char>& received)
+{
+    unsigned char buf[0x10000];
+    ssize_t nBytes;
+    while ((nBytes = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+        received.insert(received.end(), buf, buf + nBytes);
+}
+
+BOOST_AUTO_TEST_CASE(cnode_shared_message_send)
+{
+    int sockets[2];
+    BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+
+    in_addr ipv4Addr;
+    ipv4Addr.s_addr = 0xa0b0c001;
+    CAddress addr = CAddress(CService(ipv4Addr, 7777), NODE_NETWORK);
+    CNode node(0, NODE_NETWORK, 0, sockets[0], addr, 0, 0, CAddress(), "", false);
+    CConnman connman(0x1337, 0x1337);
+
+    // Larger than the socket buffer, so the next messages queue up behind it
+    std::vector<unsigned char> payload(4000000);
+    for (size_t i = 0; i < payload.size(); i++)
+        payload[i] = i * 7;
+    CSharedNetMsg msgBlock = MakeSharedNetMsg(CNetMsgMaker(PROTOCOL_VERSION).Make(NetMsgType::BLOCK, payload));
+    CSharedNetMsg msgPing = MakeSharedNetMsg(CNetMsgMaker(PROTOCOL_VERSION).Make(NetMsgType::PING, (uint64_t)42));
+
+    connman.PushMessage(&node, msgBlock);
+    BOOST_CHECK(!node.vSendMsg.empty());
+    connman.PushMessage(&node, msgPing);
+    connman.PushMessage(&node, msgBlock);
+    BOOST_CHECK_EQUAL(node.vSendMsg.size(), 3U);
+    BOOST_CHECK_EQUAL(node.nSendSize, 2 * msgBlock->size() + msgPing->size());
+    BOOST_CHECK(node.nSendOffset > 0);
+
+    std::vector<unsigned char> received;
+    while (!node.vSendMsg.empty()) {
+        ReadAvailable(sockets[1], received);
+        CConnmanTest::SocketSendData(connman, node);
+    }
+    ReadAvailable(sockets[1], received);
+    BOOST_CHECK_EQUAL(node.nSendSize, 0U);
+    BOOST_CHECK_EQUAL(node.nSendOffset, 0U);
+    BOOST_CHECK_EQUAL(msgBlock.use_count(), 1);
+
+    std::vector<unsigned char> expected;
+    for (const CSharedNetMsg& msg : {msgBlock, msgPing, msgBlock}) {
+        expected.insert(expected.end(), msg->header.begin(), msg->header.end());
+        expected.insert(expected.end(), msg->data.begin(), msg->data.end());
+    }
+    BOOST_CHECK(received == expected);
+
+    CMessageHeader hdr(Params().MessageStart());
+    CDataStream ss(received, SER_NETWORK, PROTOCOL_VERSION);
+    ss >> hdr;
+    BOOST_CHECK(hdr.IsValid(Params().MessageStart()));
+    BOOST_CHECK_EQUAL(hdr.GetCommand(), NetMsgType::BLOCK);
+    BOOST_CHECK_EQUAL(hdr.nMessageSize, msgBlock->data.size());
+    uint256 hash = Hash(msgBlock->data.begin(), msgBlock->data.end());
+    BOOST_CHECK(memcmp(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE) == 0);
+
+    close(sockets[1]);
+}
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -179,4 +179,68 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
     }
 }
 
+BOOST_AUTO_TEST_CASE(GasPriceEstimates)
+{
+    CBlockPolicyEstimator feeEst;
+    CTxMemPool mpool(&feeEst);
+    TestMemPoolEntryHelper entry;
+    CAmount baseGasPrice(40);
+    uint64_t gasLimit(100000);
+
+    std::vector<uint256> txHashes[10];
+
+    CScript garbage;
+    for (unsigned int i = 0; i < 128; i++)
+        garbage.push_back('X');
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = garbage;
+    tx.vout.resize(1);
+    tx.vout[0].nValue=0LL;
+
+    std::vector<CTransactionRef> block;
+    int blocknum = 0;
+
+    // Same fee on every tx, higher gas prices are included more often
+    while (blocknum < 200) {
+        for (int j = 0; j < 10; j++) {
+            for (int k = 0; k < 4; k++) {
+                tx.vin[0].prevout.n = 10000*blocknum+100*j+k;
+                uint256 hash = tx.GetHash();
+                mpool.addUnchecked(hash, entry.Fee(20000).Time(GetTime()).Height(blocknum).GasPrice(baseGasPrice * (j+1)).GasLimit(gasLimit).FromTx(tx));
+                txHashes[j].push_back(hash);
+            }
+        }
+        for (int h = 0; h <= blocknum%10; h++) {
+            while (txHashes[9-h].size()) {
+                CTransactionRef ptx = mpool.get(txHashes[9-h].back());
+                if (ptx)
+                    block.push_back(ptx);
+                txHashes[9-h].pop_back();
+            }
+        }
+        mpool.removeForBlock(block, ++blocknum);
+        block.clear();
+    }
+
+    FeeCalculation feeCalc;
+    CAmount gasPrice = feeEst.estimateGasPrice(2, gasLimit, &feeCalc);
+    BOOST_CHECK_EQUAL(feeCalc.returnedTarget, 2);
+    BOOST_CHECK(gasPrice > 4 * baseGasPrice);
+    BOOST_CHECK(gasPrice <= 10 * baseGasPrice);
+
+    // Gas price estimates should be monotonically decreasing
+    CAmount lastGasPrice = gasPrice;
+    for (int i = 3; i <= 12; i++) {
+        gasPrice = feeEst.estimateGasPrice(i, gasLimit, nullptr);
+        BOOST_CHECK(gasPrice > 0);
+        BOOST_CHECK(gasPrice <= lastGasPrice);
+        lastGasPrice = gasPrice;
+    }
+
+    // Nothing was seen with a large gas limit, and targets beyond the medium horizon aren't tracked
+    BOOST_CHECK_EQUAL(feeEst.estimateGasPrice(2, 10000000, nullptr), 0);
+    BOOST_CHECK_EQUAL(feeEst.estimateGasPrice(49, gasLimit, nullptr), 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,102 @@
+// Copyright (c) 2018 The Qtum Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "pooledmap.h"
+#include "memusage.h"
+
+#include "test/test_bitcoin.h"
+
+#include <string>
+#include <unordered_map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pooledmap_tests, BasicTestingSetup)
+
+namespace {
+struct BadHasher
+{
+    // Few distinct hashes, so that probe sequences collide and wrap around the table.
+    size_t operator()(uint32_t key) const { return key % 37; }
+};
+}
+
+BOOST_AUTO_TEST_CASE(pooledmap_random)
+{
+    pooledmap<uint32_t, std::string, BadHasher> map;
+    std::unordered_map<uint32_t, std::string> ref;
+    for (int i = 0; i < 20000; i++) {
+        uint32_t key = InsecureRandRange(1000);
+        switch (InsecureRandRange(4)) {
+        case 0: {
+            auto ret = map.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::to_string(i)));
+            BOOST_CHECK_EQUAL(ret.second, ref.emplace(key, std::to_string(i)).second);
+            BOOST_CHECK_EQUAL(ret.first->first, key);
+            break;
+        }
+        case 1:
+            map[key] += "x";
+            ref[key] += "x";
+            break;
+        case 2: {
+            auto it = map.find(key);
+            BOOST_CHECK_EQUAL(it != map.end(), ref.count(key) == 1);
+            if (it != map.end()) {
+                map.erase(it);
+                ref.erase(key);
+            }
+            break;
+        }
+        default: {
+            auto it = map.find(key);
+            BOOST_CHECK_EQUAL(it != map.end(), ref.count(key) == 1);
+            if (it != map.end()) {
+                BOOST_CHECK_EQUAL(it->second, ref[key]);
+            }
+        }
+        }
+    }
+    BOOST_CHECK_EQUAL(map.size(), ref.size());
+    size_t count = 0;
+    for (auto it = map.begin(); it != map.end(); ++it) {
+        BOOST_CHECK_EQUAL(it->second, ref[it->first]);
+        count++;
+    }
+    BOOST_CHECK_EQUAL(count, ref.size());
+
+    // Erasing while iterating, as CCoinsView::BatchWrite implementations do.
+    for (auto it = map.begin(); it != map.end();) {
+        BOOST_CHECK_EQUAL(ref.erase(it->first), 1U);
+        map.erase(it++);
+    }
+    BOOST_CHECK(ref.empty());
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.begin() == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(pooledmap_stable_references)
+{
+    pooledmap<uint32_t, std::string, BadHasher> map;
+    std::string& first = map[0];
+    first = "first";
+    // Growing the table and the pool must not move existing entries.
+    for (uint32_t i = 1; i < 5000; i++) {
+        map[i] = std::to_string(i);
+    }
+    BOOST_CHECK(&first == &map[0]);
+    BOOST_CHECK_EQUAL(first, "first");
+
+    // Freed nodes are reused, so the memory held does not grow.
+    size_t usage = memusage::DynamicUsage(map);
+    for (uint32_t i = 1; i < 5000; i++) {
+        map.erase(i);
+        map[i + 5000] = "";
+    }
+    BOOST_CHECK_EQUAL(memusage::DynamicUsage(map), usage);
+
+    map.clear();
+    BOOST_CHECK_EQUAL(memusage::DynamicUsage(map), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,107 @@
+#include <boost/test/unit_test.hpp>
+#include <qtum/contractpreexec.h>
+#include <qtum/templateoptimizer.h>
+#include <chain.h>
+#include <validation.h>
+#include <test/test_bitcoin.h>
+
+namespace contractPreExecTest{
+
+class TestPreExecutor : public ContractPreExecutor{
+public:
+    using ContractPreExecutor::Store;
+    using ContractPreExecutor::UpdatedBlockTip;
+};
+
+ContractPreExecutor::Result makeResult(uint64_t gasUsed, std::vector<std::string> readKeys, std::vector<std::string> writeKeys){
+    ContractPreExecutor::Result result;
+    result.gasUsed = gasUsed;
+    result.refund = 100;
+    result.success = true;
+    result.readKeys = readKeys;
+    result.writeKeys = writeKeys;
+    return result;
+}
+
+void startPreExecutor(TestPreExecutor& preExecutor){
+    LOCK(cs_main);
+    preExecutor.Start(nullptr);
+}
+
+BOOST_FIXTURE_TEST_SUITE(contractpreexec_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(reader_erased_by_later_writer){
+    TestPreExecutor preExecutor;
+    startPreExecutor(preExecutor);
+    uint256 reader = uint256S("a1");
+    uint256 writer = uint256S("a2");
+    ContractPreExecutor::Result result;
+    ContractGasEstimates::Estimate estimate;
+
+    preExecutor.Store(reader, makeResult(30000, {"key"}, {}));
+    BOOST_CHECK(preExecutor.Lookup(reader, result));
+    BOOST_CHECK(contractGasEstimates.Lookup(reader, estimate));
+    BOOST_CHECK_EQUAL(estimate.gasUsed, 30000);
+
+    //the reader may see a different value once the writer is in the block first
+    preExecutor.Store(writer, makeResult(40000, {}, {"key"}));
+    BOOST_CHECK(!preExecutor.Lookup(reader, result));
+    BOOST_CHECK(!contractGasEstimates.Lookup(reader, estimate));
+    BOOST_CHECK(preExecutor.Lookup(writer, result));
+    BOOST_CHECK(contractGasEstimates.Lookup(writer, estimate));
+    preExecutor.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(reader_refused_after_writer){
+    TestPreExecutor preExecutor;
+    startPreExecutor(preExecutor);
+    uint256 writer = uint256S("b1");
+    uint256 reader = uint256S("b2");
+    uint256 other = uint256S("b3");
+    ContractPreExecutor::Result result;
+    ContractGasEstimates::Estimate estimate;
+
+    preExecutor.Store(writer, makeResult(40000, {}, {"key"}));
+    preExecutor.Store(reader, makeResult(30000, {"key"}, {}));
+    BOOST_CHECK(!preExecutor.Lookup(reader, result));
+    BOOST_CHECK(!contractGasEstimates.Lookup(reader, estimate));
+    BOOST_CHECK(preExecutor.Lookup(writer, result));
+
+    //reading other keys doesn't conflict
+    preExecutor.Store(other, makeResult(25000, {"other"}, {}));
+    BOOST_CHECK(preExecutor.Lookup(other, result));
+    BOOST_CHECK(contractGasEstimates.Lookup(other, estimate));
+    preExecutor.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(tip_change_clears_results){
+    TestPreExecutor preExecutor;
+    startPreExecutor(preExecutor);
+    uint256 txid = uint256S("c1");
+    uint256 blockHash = uint256S("c2");
+    CBlockIndex block;
+    block.phashBlock = &blockHash;
+    ContractPreExecutor::Result result;
+    ContractGasEstimates::Estimate estimate;
+
+    preExecutor.Store(txid, makeResult(30000, {"key"}, {}));
+    BOOST_CHECK(preExecutor.Lookup(txid, result));
+
+    preExecutor.UpdatedBlockTip(&block, nullptr, false);
+    BOOST_CHECK(!preExecutor.Lookup(txid, result));
+    //the gas used is still the best estimate on the new tip
+    BOOST_CHECK(contractGasEstimates.Lookup(txid, estimate));
+
+    //results executed on the old tip are refused, results on the new one are kept
+    preExecutor.Store(txid, makeResult(30000, {"key"}, {}));
+    BOOST_CHECK(!preExecutor.Lookup(txid, result));
+    ContractPreExecutor::Result newTip = makeResult(30000, {"key"}, {});
+    newTip.tip = blockHash;
+    preExecutor.Store(txid, std::move(newTip));
+    BOOST_CHECK(preExecutor.Lookup(txid, result));
+    preExecutor.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
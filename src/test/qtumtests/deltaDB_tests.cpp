@@ -2,6 +2,7 @@
 #include <qtumtests/test_utils.h>
 #include <script/standard.h>
 #include <qtum/qtumtransaction.h>
+#include <txdb.h>
 
 
 namespace deltaDBTest{
@@ -78,6 +79,219 @@ BOOST_AUTO_TEST_CASE(change_log_read_write_test){
     delete pDeltaDB;
 }
 
+BOOST_AUTO_TEST_CASE(aal_condensing_tx_test){
+	DeltaDBWrapper wrapper(nullptr);
+	//the contract's data sorts after the others, so UniversalAddress::operator< orders these addresses consistently
+	UniversalAddress contract(X86,valtype(ParseHex("4c4c1d7375918557df2ef8f1d1f0b2329cb248a1")));
+	UniversalAddress a(PUBKEYHASH,valtype(ParseHex("1111111111111111111111111111111111111111")));
+	UniversalAddress b(PUBKEYHASH,valtype(ParseHex("2222222222222222222222222222222222222222")));
+	COutPoint initial(uint256S("0c4c1d7375918557df2ef8f1d1f0b2329cb248a10c4c1d7370c4c1d73748a148"), 1);
+
+	wrapper.setInitialCoins(contract, initial, 1000);
+	BOOST_CHECK(wrapper.getBalance(contract) == 1000);
+
+	//reverted transfers leave no trace
+	wrapper.checkpoint();
+	BOOST_CHECK(wrapper.transfer(contract, a, 400));
+	BOOST_CHECK(wrapper.getBalance(a) == 400);
+	wrapper.revertCheckpoint();
+	BOOST_CHECK(wrapper.getBalance(contract) == 1000);
+	BOOST_CHECK(wrapper.getBalance(a) == 0);
+	BOOST_CHECK(wrapper.getLatestModifiedState().spentVins.size() == 0);
+
+	wrapper.checkpoint();
+	BOOST_CHECK(wrapper.transfer(contract, b, 300));
+	BOOST_CHECK(!wrapper.transfer(contract, b, 800));
+	wrapper.condenseSingleCheckpoint();
+	BOOST_CHECK(wrapper.transfer(contract, a, 200));
+
+	CTransaction tx = wrapper.createCondensingTx();
+	BOOST_CHECK(tx.vin.size() == 1);
+	BOOST_CHECK(tx.vin[0].prevout == initial);
+	//vouts are ordered by address
+	BOOST_CHECK(tx.vout.size() == 3);
+	BOOST_CHECK(tx.vout[0].nValue == 200);
+	BOOST_CHECK(tx.vout[1].nValue == 300);
+	BOOST_CHECK(tx.vout[2].nValue == 500);
+}
+
+BOOST_AUTO_TEST_CASE(aal_batched_receiver_test){
+	DeltaDB* pDeltaDB = new DeltaDB(8, true, false);
+	UniversalAddress contract(X86,valtype(ParseHex("4c4c1d7375918557df2ef8f1d1f0b2329cb248a1")));
+	UniversalAddress a(PUBKEYHASH,valtype(ParseHex("1111111111111111111111111111111111111111")));
+	UniversalAddress b(PUBKEYHASH,valtype(ParseHex("2222222222222222222222222222222222222222")));
+	UniversalAddress c(PUBKEYHASH,valtype(ParseHex("3333333333333333333333333333333333333333")));
+	COutPoint initial(uint256S("0c4c1d7375918557df2ef8f1d1f0b2329cb248a10c4c1d7370c4c1d73748a148"), 1);
+	COutPoint recordA(uint256S("1111111111111111111111111111111111111111111111111111111111111111"), 0);
+	COutPoint recordB(uint256S("2222222222222222222222222222222222222222222222222222222222222222"), 3);
+	COutPoint recordC(uint256S("3333333333333333333333333333333333333333333333333333333333333333"), 2);
+	{
+		//give a, b and c AAL records
+		DeltaDBWrapper setup(pDeltaDB);
+		setup.setInitialCoins(a, recordA, 50);
+		setup.commit();
+		DeltaDBWrapper setup2(pDeltaDB);
+		setup2.setInitialCoins(b, recordB, 70);
+		setup2.commit();
+		DeltaDBWrapper setup3(pDeltaDB);
+		setup3.setInitialCoins(c, recordC, 20);
+		setup3.commit();
+	}
+
+	DeltaDBWrapper wrapper(pDeltaDB);
+	wrapper.setInitialCoins(contract, initial, 1000);
+	//receivers are credited without reading their records, which are loaded when the balance is needed
+	wrapper.checkpoint();
+	BOOST_CHECK(wrapper.transfer(contract, a, 100));
+	BOOST_CHECK(wrapper.transfer(contract, a, 10));
+	wrapper.checkpoint();
+	BOOST_CHECK(wrapper.transfer(contract, b, 200));
+	BOOST_CHECK(wrapper.getBalance(a) == 160);
+	//reverting after the record was loaded keeps the record's balance
+	wrapper.revertCheckpoint();
+	BOOST_CHECK(wrapper.getBalance(b) == 70);
+	BOOST_CHECK(wrapper.transfer(contract, b, 30));
+	wrapper.revertCheckpoint();
+	BOOST_CHECK(wrapper.getBalance(a) == 50);
+	BOOST_CHECK(wrapper.transfer(contract, a, 100));
+	BOOST_CHECK(wrapper.transfer(contract, b, 300));
+	//c's record is only read by the batched read when condensing
+	BOOST_CHECK(wrapper.transfer(contract, c, 40));
+
+	CTransaction tx = wrapper.createCondensingTx();
+	BOOST_CHECK(tx.vin.size() == 4);
+	BOOST_CHECK(std::count(tx.vin.begin(), tx.vin.end(), CTxIn(recordA, CScript() << valtype{2} << OP_SPEND)) == 1);
+	BOOST_CHECK(std::count(tx.vin.begin(), tx.vin.end(), CTxIn(recordB, CScript() << valtype{2} << OP_SPEND)) == 1);
+	BOOST_CHECK(std::count(tx.vin.begin(), tx.vin.end(), CTxIn(recordC, CScript() << valtype{2} << OP_SPEND)) == 1);
+	BOOST_CHECK(tx.vout.size() == 4);
+	BOOST_CHECK(tx.vout[0].nValue == 150);
+	BOOST_CHECK(tx.vout[1].nValue == 370);
+	BOOST_CHECK(tx.vout[2].nValue == 60);
+	BOOST_CHECK(tx.vout[3].nValue == 560);
+	delete pDeltaDB;
+}
+
+BOOST_AUTO_TEST_CASE(fix_state_read_test){
+	UniversalAddress contract(X86,valtype(ParseHex("4c4c1d7375918557df2ef8f1d1f0b2329cb248a1")));
+	valtype key = valtype(ParseHex("01"));
+	valtype v1 = valtype(ParseHex("aa"));
+	valtype v2 = valtype(ParseHex("bb"));
+	valtype read;
+	for(bool fix : {false, true}){
+		DeltaDBWrapper wrapper(nullptr);
+		wrapper.setFixState(fix);
+		BOOST_CHECK(wrapper.writeState(contract, key, v1));
+		wrapper.checkpoint();
+		//before the fork a sub execution only sees its own writes
+		BOOST_CHECK(wrapper.readState(contract, key, read) == fix);
+		if(fix){
+			BOOST_CHECK(read == v1);
+		}
+		wrapper.checkpoint();
+		BOOST_CHECK(wrapper.writeState(contract, key, v2));
+		BOOST_CHECK(wrapper.readState(contract, key, read));
+		BOOST_CHECK(read == v2);
+		wrapper.revertCheckpoint();
+		BOOST_CHECK(wrapper.readState(contract, key, read) == fix);
+		if(fix){
+			BOOST_CHECK(read == v1);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(fix_state_failed_transfer_test){
+	DeltaDB* pDeltaDB = new DeltaDB(8, true, false);
+	UniversalAddress contract(X86,valtype(ParseHex("4c4c1d7375918557df2ef8f1d1f0b2329cb248a1")));
+	UniversalAddress a(PUBKEYHASH,valtype(ParseHex("1111111111111111111111111111111111111111")));
+	UniversalAddress b(PUBKEYHASH,valtype(ParseHex("2222222222222222222222222222222222222222")));
+	COutPoint recordA(uint256S("1111111111111111111111111111111111111111111111111111111111111111"), 0);
+	{
+		DeltaDBWrapper setup(pDeltaDB);
+		setup.setInitialCoins(a, recordA, 50);
+		setup.commit();
+	}
+	for(bool fix : {false, true}){
+		DeltaDBWrapper wrapper(pDeltaDB);
+		wrapper.setFixState(fix);
+		BOOST_CHECK(!wrapper.transfer(a, b, 60));
+		BOOST_CHECK(wrapper.getBalance(a) == 50);
+		//before the fork the sender's output is spent even though the transfer failed
+		BOOST_CHECK(wrapper.getLatestModifiedState(true).spentVins.size() == (fix ? 0 : 1));
+		BOOST_CHECK(wrapper.transfer(a, b, 20));
+		DeltaCheckpoint state = wrapper.getLatestModifiedState(true);
+		BOOST_CHECK(state.spentVins.size() == 1);
+		BOOST_CHECK(state.spentVins.count(recordA) == 1);
+	}
+	delete pDeltaDB;
+}
+
+BOOST_AUTO_TEST_CASE(fix_state_vout_order_test){
+	//UniversalAddress::operator< orders this contract both before and after a and b, as its version is higher but its data lower
+	UniversalAddress contract(X86,valtype(ParseHex("0c4c1d7375918557df2ef8f1d1f0b2329cb248a1")));
+	UniversalAddress a(PUBKEYHASH,valtype(ParseHex("1111111111111111111111111111111111111111")));
+	UniversalAddress b(PUBKEYHASH,valtype(ParseHex("2222222222222222222222222222222222222222")));
+	COutPoint initial(uint256S("0c4c1d7375918557df2ef8f1d1f0b2329cb248a10c4c1d7370c4c1d73748a148"), 1);
+	BOOST_CHECK(contract < a && a < contract);
+
+	DeltaDBWrapper wrapper(nullptr);
+	wrapper.setFixState(true);
+	wrapper.setInitialCoins(contract, initial, 1000);
+	BOOST_CHECK(wrapper.transfer(contract, b, 300));
+	BOOST_CHECK(wrapper.transfer(contract, a, 200));
+	CTransaction tx = wrapper.createCondensingTx();
+	BOOST_CHECK(tx.vin.size() == 1);
+	//after the fork vouts are ordered by version and then data
+	BOOST_CHECK(tx.vout.size() == 3);
+	BOOST_CHECK(tx.vout[0].nValue == 200);
+	BOOST_CHECK(tx.vout[1].nValue == 300);
+	BOOST_CHECK(tx.vout[2].nValue == 500);
+}
+
+BOOST_AUTO_TEST_CASE(contract_index_test){
+	DeltaDB* pDeltaDB = new DeltaDB(8, true, false);
+	DeltaDBWrapper wrapper(pDeltaDB);
+	UniversalAddress x1(X86,valtype(ParseHex("0c4c1d7375918557df2ef8f1d1f0b2329cb248a1")));
+	UniversalAddress x2(X86,valtype(ParseHex("01ac1d7375918557df2ef8f1d1f0b2329cb248a1")));
+	UniversalAddress e1(EVM,valtype(ParseHex("ffac1d7375918557df2ef8f1d1f0b2329cb248a1")));
+	BOOST_CHECK(wrapper.writeByteCode(x1, valtype(ParseHex("bf5f"))));
+	BOOST_CHECK(wrapper.writeByteCode(x2, valtype(ParseHex("bf5f"))));
+	//storage keys of the same length as bytecode keys are not contracts
+	BOOST_CHECK(wrapper.writeState(e1, valtype(), valtype(ParseHex("01"))));
+	wrapper.commit();
+
+	std::vector<UniversalAddress> addresses = pDeltaDB->readByteCodeAddresses();
+	BOOST_CHECK(addresses.size() == 2);
+	BOOST_CHECK(std::count(addresses.begin(), addresses.end(), x1) == 1);
+	BOOST_CHECK(std::count(addresses.begin(), addresses.end(), x2) == 1);
+	delete pDeltaDB;
+
+	//the index is ordered by version and then address, so EVM contracts come first
+	BOOST_CHECK(pblocktree->WriteContractIndex({CContractIndexKey(x1), CContractIndexKey(e1)}, 0, false));
+	BOOST_CHECK(pblocktree->WriteContractIndex({CContractIndexKey(x2)}, 10, true));
+	std::vector<CContractIndexKey> keys;
+	BOOST_CHECK(pblocktree->ReadContractIndex(nullptr, 0, 10, keys));
+	BOOST_CHECK(keys.size() == 3);
+	BOOST_CHECK(keys[0].GetUniversalAddress() == e1);
+	BOOST_CHECK(keys[1].GetUniversalAddress() == x2);
+	BOOST_CHECK(keys[2].GetUniversalAddress() == x1);
+
+	keys.clear();
+	CContractIndexKey after(e1);
+	BOOST_CHECK(pblocktree->ReadContractIndex(&after, 1, 10, keys));
+	BOOST_CHECK(keys.size() == 1 && keys[0] == CContractIndexKey(x1));
+	keys.clear();
+	BOOST_CHECK(pblocktree->ReadContractIndex(nullptr, 1, 1, keys));
+	BOOST_CHECK(keys.size() == 1 && keys[0] == CContractIndexKey(x2));
+
+	//only contracts written for a block are erased with it
+	BOOST_CHECK(pblocktree->EraseContractIndex(10));
+	BOOST_CHECK(pblocktree->EraseContractIndex(0));
+	keys.clear();
+	BOOST_CHECK(pblocktree->ReadContractIndex(nullptr, 0, 10, keys));
+	BOOST_CHECK(keys.size() == 2);
+	BOOST_CHECK(keys[0] == CContractIndexKey(e1) && keys[1] == CContractIndexKey(x1));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 
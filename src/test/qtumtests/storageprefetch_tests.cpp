@@ -0,0 +1,130 @@
+#include <boost/test/unit_test.hpp>
+#include <qtum/storageprefetch.h>
+#include <qtum/qtumtransaction.h>
+#include <test/test_bitcoin.h>
+#include <utiltime.h>
+
+namespace storagePrefetchTest{
+
+//the values are read on the background thread, so wait for them to show up
+bool waitForLookup(const std::string& key, valtype& value, bool& found){
+    for(int i = 0; i < 500; i++){
+        if(storagePrefetcher.Lookup(key, value, found)){
+            return true;
+        }
+        MilliSleep(10);
+    }
+    return false;
+}
+
+BOOST_FIXTURE_TEST_SUITE(storageprefetch_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(prefetch_lookup_test){
+    DeltaDB db(8, true, false);
+    DeltaDB other(8, true, false);
+    UniversalAddress contract(X86, valtype(ParseHex("4c4c1d7375918557df2ef8f1d1f0b2329cb248a1")));
+    UniversalAddress unknown(X86, valtype(ParseHex("1c4c1d7375918557df2ef8f1d1f0b2329cb248a1")));
+    std::string stored = "stored";
+    std::string missing = "missing";
+    valtype v1 = ParseHex("aabb");
+    BOOST_CHECK(db.Write(valtype(stored.begin(), stored.end()), v1));
+
+    storagePrefetcher.Start(&db);
+    BOOST_CHECK(storagePrefetcher.IsRunning(&db));
+    BOOST_CHECK(!storagePrefetcher.IsRunning(&other));
+    BOOST_CHECK(!storagePrefetcher.IsRunning(nullptr));
+
+    valtype value;
+    bool found;
+    BOOST_CHECK(!storagePrefetcher.Lookup(stored, value, found));
+    //nothing is known about a contract before it was executed
+    storagePrefetcher.Prefetch(contract);
+    storagePrefetcher.RecordAccess(contract, {stored, missing, stored});
+    storagePrefetcher.Prefetch(unknown);
+    storagePrefetcher.Prefetch(contract);
+
+    BOOST_CHECK(waitForLookup(stored, value, found));
+    BOOST_CHECK(found);
+    BOOST_CHECK(value == v1);
+    //keys that are not in the database are cached as missing
+    BOOST_CHECK(waitForLookup(missing, value, found));
+    BOOST_CHECK(!found);
+
+    //stopping forgets everything
+    storagePrefetcher.Stop();
+    BOOST_CHECK(!storagePrefetcher.IsRunning(&db));
+    BOOST_CHECK(!storagePrefetcher.Lookup(stored, value, found));
+    storagePrefetcher.RecordAccess(contract, {stored});
+    storagePrefetcher.Start(&db);
+    storagePrefetcher.Prefetch(contract);
+    MilliSleep(50);
+    BOOST_CHECK(!storagePrefetcher.Lookup(stored, value, found));
+    storagePrefetcher.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(prefetch_update_test){
+    DeltaDB db(8, true, false);
+    UniversalAddress contract(X86, valtype(ParseHex("4c4c1d7375918557df2ef8f1d1f0b2329cb248a1")));
+    std::string key = "key";
+    valtype v1 = ParseHex("aa");
+    valtype v2 = ParseHex("bbcc");
+    BOOST_CHECK(db.Write(valtype(key.begin(), key.end()), v1));
+
+    storagePrefetcher.Start(&db);
+    valtype value;
+    bool found;
+    storagePrefetcher.RecordAccess(contract, {key});
+    storagePrefetcher.Prefetch(contract);
+    BOOST_CHECK(waitForLookup(key, value, found));
+    BOOST_CHECK(value == v1);
+
+    //written values replace the cached ones, erased keys are cached as missing
+    storagePrefetcher.Update(key, v2);
+    BOOST_CHECK(storagePrefetcher.Lookup(key, value, found));
+    BOOST_CHECK(found);
+    BOOST_CHECK(value == v2);
+    storagePrefetcher.Update(key, valtype());
+    BOOST_CHECK(storagePrefetcher.Lookup(key, value, found));
+    BOOST_CHECK(!found);
+
+    //a prefetch doesn't bring back the older value on disk
+    storagePrefetcher.Prefetch(contract);
+    MilliSleep(50);
+    BOOST_CHECK(storagePrefetcher.Lookup(key, value, found));
+    BOOST_CHECK(!found);
+    storagePrefetcher.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(prefetch_wrapper_test){
+    DeltaDB db(8, true, false);
+    UniversalAddress contract(X86, valtype(ParseHex("4c4c1d7375918557df2ef8f1d1f0b2329cb248a1")));
+    valtype key = ParseHex("01");
+    valtype v1 = ParseHex("aa");
+    valtype v2 = ParseHex("bb");
+    valtype value;
+
+    storagePrefetcher.Start(&db);
+    {
+        DeltaDBWrapper wrapper(&db);
+        BOOST_CHECK(wrapper.writeState(contract, key, v1));
+        wrapper.commit();
+    }
+    //reads see what was committed, whether it comes from the cache or the database
+    {
+        DeltaDBWrapper wrapper(&db);
+        BOOST_CHECK(wrapper.readState(contract, key, value));
+        BOOST_CHECK(value == v1);
+        BOOST_CHECK(wrapper.writeState(contract, key, v2));
+        wrapper.commit();
+    }
+    storagePrefetcher.Stop();
+    {
+        DeltaDBWrapper wrapper(&db);
+        BOOST_CHECK(wrapper.readState(contract, key, value));
+        BOOST_CHECK(value == v2);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
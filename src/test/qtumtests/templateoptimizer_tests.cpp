@@ -0,0 +1,94 @@
+#include <boost/test/unit_test.hpp>
+#include <qtum/templateoptimizer.h>
+#include <test/test_bitcoin.h>
+
+#include <algorithm>
+
+namespace templateOptimizerTest{
+
+BOOST_FIXTURE_TEST_SUITE(templateoptimizer_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(select_by_value_per_gas){
+    //the first package pays the most but uses all the gas, the other two together pay more
+    std::vector<TemplateTx> txs = {
+        {3000, 1000, 4, 1000000},
+        {2000, 1000, 4, 500000},
+        {2000, 1000, 4, 500000},
+    };
+    std::vector<std::vector<size_t>> packages = {{0}, {1}, {2}};
+    TemplateLimits limits = {100000, 1000, 1000000};
+
+    std::vector<size_t> selected = SelectTemplatePackages(txs, packages, limits);
+    BOOST_CHECK_EQUAL(selected.size(), 2);
+    BOOST_CHECK(std::find(selected.begin(), selected.end(), 0) == selected.end());
+}
+
+BOOST_AUTO_TEST_CASE(shared_ancestors_counted_once){
+    //both packages include tx 0, which only fits once
+    std::vector<TemplateTx> txs = {
+        {1000, 3000, 0, 0},
+        {1000, 500, 4, 100000},
+        {900, 500, 4, 100000},
+    };
+    std::vector<std::vector<size_t>> packages = {{0, 1}, {0, 2}};
+    TemplateLimits limits = {4000, 1000, 1000000};
+
+    std::vector<size_t> selected = SelectTemplatePackages(txs, packages, limits);
+    BOOST_CHECK_EQUAL(selected.size(), 2);
+    BOOST_CHECK_EQUAL(selected[0], 0);
+}
+
+BOOST_AUTO_TEST_CASE(limits_and_worthless_packages){
+    std::vector<TemplateTx> txs = {
+        {1000, 1000, 4, 100000},
+        {1000, 1000, 2000, 100000},
+        {-10, 1000, 4, 100000},
+    };
+    std::vector<std::vector<size_t>> packages = {{0}, {1}, {2}};
+    TemplateLimits limits = {100000, 1000, 1000000};
+
+    //tx 1 uses too many sigops, tx 2 earns nothing after its refund
+    std::vector<size_t> selected = SelectTemplatePackages(txs, packages, limits);
+    BOOST_CHECK_EQUAL(selected.size(), 1);
+    BOOST_CHECK_EQUAL(selected[0], 0);
+}
+
+BOOST_AUTO_TEST_CASE(gas_estimates_record_and_lookup){
+    ContractGasEstimates estimates;
+    uint256 txid = uint256S("01");
+    uint256 block = uint256S("02");
+    ContractGasEstimates::Estimate estimate;
+
+    BOOST_CHECK(!estimates.Lookup(txid, estimate));
+    estimates.RecordExecution(txid, 21000, 400);
+    BOOST_CHECK(estimates.Lookup(txid, estimate));
+    BOOST_CHECK_EQUAL(estimate.gasUsed, 21000);
+    BOOST_CHECK_EQUAL(estimate.refund, 400);
+    BOOST_CHECK(!estimate.failed);
+
+    estimates.RecordFailure(txid, block);
+    BOOST_CHECK(estimates.Lookup(txid, estimate));
+    BOOST_CHECK(estimate.failed);
+    BOOST_CHECK(estimate.failedOn == block);
+}
+
+BOOST_AUTO_TEST_CASE(gas_estimates_forget_execution){
+    ContractGasEstimates estimates;
+    uint256 txid = uint256S("01");
+    ContractGasEstimates::Estimate estimate;
+
+    //an estimate recorded by a later execution is kept
+    estimates.RecordExecution(txid, 21000, 400);
+    estimates.ForgetExecution(txid, 30000, 400);
+    BOOST_CHECK(estimates.Lookup(txid, estimate));
+
+    estimates.ForgetExecution(txid, 21000, 400);
+    BOOST_CHECK(!estimates.Lookup(txid, estimate));
+    estimates.RecordExecution(txid, 25000, 300);
+    BOOST_CHECK(estimates.Lookup(txid, estimate));
+    BOOST_CHECK_EQUAL(estimate.gasUsed, 25000);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -114,6 +114,31 @@ BOOST_AUTO_TEST_CASE(x86_hypervisor_SCCS){
     delete fake;
 }
 
+BOOST_AUTO_TEST_CASE(x86_hypervisor_SCCS_arena){
+    FakeVMContainer *fake = new FakeVMContainer();
+    fake->hv.pushSCCS(std::vector<uint8_t>(4, 0x11));
+    fake->hv.pushSCCS(std::vector<uint8_t>(6, 0x22));
+
+    fake->cpu.SetReg32(EAX, QSC_SCCSSize);
+    fake->hv.HandleInt(QtumSystem, fake->cpu);
+    BOOST_CHECK(fake->cpu.Reg32(EAX) == 10); //total size of all items
+
+    fake->cpu.SetReg32(EAX, QSC_SCCSItemSize);
+    fake->hv.HandleInt(QtumSystem, fake->cpu);
+    BOOST_CHECK(fake->cpu.Reg32(EAX) == 6);
+
+    fake->cpu.SetReg32(EAX, QSC_SCCSDiscard);
+    fake->hv.HandleInt(QtumSystem, fake->cpu);
+    BOOST_CHECK(fake->hv.sizeofSCCS() == 1);
+    BOOST_CHECK(fake->hv.popSCCS() == std::vector<uint8_t>(4, 0x11));
+
+    //discarding an empty stack is harmless
+    fake->cpu.SetReg32(EAX, QSC_SCCSDiscard);
+    fake->hv.HandleInt(QtumSystem, fake->cpu);
+    BOOST_CHECK(fake->hv.sizeofSCCS() == 0);
+    delete fake;
+}
+
 BOOST_AUTO_TEST_CASE(x86_hypervisor_storage){
     FakeVMContainer *fake = new FakeVMContainer();
     std::vector<uint8_t> key1;
@@ -36,6 +36,12 @@ void CConnmanTest::ClearNodes()
     g_connman->vNodes.clear();
 }
 
+size_t CConnmanTest::SocketSendData(CConnman& connman, CNode& node)
+{
+    LOCK(node.cs_vSend);
+    return connman.SocketSendData(&node);
+}
+
 uint256 insecure_rand_seed = GetRandHash();
 FastRandomContext insecure_rand_ctx(insecure_rand_seed);
 
@@ -190,5 +196,5 @@ CTxMemPoolEntry TestMemPoolEntryHelper::FromTx(const CMutableTransaction &tx) {
 
 CTxMemPoolEntry TestMemPoolEntryHelper::FromTx(const CTransaction &txn) {
     return CTxMemPoolEntry(MakeTransactionRef(txn), nFee, nTime, nHeight,
-                           spendsCoinbase, sigOpCost, lp);
+                           spendsCoinbase, sigOpCost, lp, nMinGasPrice, nGasLimit);
 }
@@ -37,6 +37,7 @@ public:
 class VersionBitsTester
 {
     // A fake blockchain
+    CBlockIndexArena arena;
     std::vector<CBlockIndex*> vpblock;
 
     // 6 independent checkers for the same bit.
@@ -51,9 +52,7 @@ public:
     VersionBitsTester() : num(0) {}
 
     VersionBitsTester& Reset() {
-        for (unsigned int i = 0; i < vpblock.size(); i++) {
-            delete vpblock[i];
-        }
+        arena.Clear();
         for (unsigned int  i = 0; i < CHECKERS; i++) {
             checker[i] = TestConditionChecker();
         }
@@ -67,7 +66,7 @@ public:
 
     VersionBitsTester& Mine(unsigned int height, int32_t nTime, int32_t nVersion) {
         while (vpblock.size() < height) {
-            CBlockIndex* pindex = new CBlockIndex();
+            CBlockIndex* pindex = arena.New();
             pindex->nHeight = vpblock.size();
             pindex->pprev = vpblock.size() > 0 ? vpblock.back() : nullptr;
             pindex->nTime = nTime;
@@ -16,6 +16,10 @@
 
 #include <stdint.h>
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 #include <boost/thread.hpp>
 
 static const char DB_COIN = 'C';
@@ -27,6 +31,8 @@ static const char DB_BLOCK_INDEX = 'b';
 ////////////////////////////////////////// // qtum
 static const char DB_HEIGHTINDEX = 'h';
 static const char DB_STAKEINDEX = 's';
+static const char DB_CONTRACTINDEX = 'x';
+static const char DB_CONTRACTHEIGHTINDEX = 'X';
 //////////////////////////////////////////
 
 static const char DB_BEST_BLOCK = 'B';
@@ -71,6 +77,16 @@ bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
     return db.Exists(CoinEntry(&outpoint));
 }
 
+size_t CCoinsViewDB::GetCoins(const std::vector<COutPoint> &outpoints, std::vector<Coin> &coins, std::vector<bool> &found) const {
+    std::vector<CoinEntry> keys;
+    keys.reserve(outpoints.size());
+    for (const COutPoint& outpoint : outpoints) {
+        keys.emplace_back(&outpoint);
+    }
+    // Spent outputs are spread over the whole database, so use point lookups
+    return db.ReadMany(keys, coins, found);
+}
+
 uint256 CCoinsViewDB::GetBestBlock() const {
     uint256 hashBestChain;
     if (!db.Read(DB_BEST_BLOCK, hashBestChain))
@@ -245,6 +261,15 @@ bool CBlockTreeDB::ReadTxIndex(const uint256 &txid, CDiskTxPos &pos) {
     return Read(std::make_pair(DB_TXINDEX, txid), pos);
 }
 
+size_t CBlockTreeDB::ReadTxIndex(const std::vector<uint256> &txids, std::vector<CDiskTxPos> &pos, std::vector<bool> &found) {
+    std::vector<std::pair<char, uint256>> keys;
+    keys.reserve(txids.size());
+    for (const uint256& txid : txids) {
+        keys.emplace_back(DB_TXINDEX, txid);
+    }
+    return ReadMany(keys, pos, found);
+}
+
 bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> >&vect) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<uint256,CDiskTxPos> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
@@ -435,61 +460,167 @@ bool CBlockTreeDB::EraseStakeIndex(unsigned int height) {
 
     return WriteBatch(batch);
 }
-///////////////////////////////////////////////////////
 
-bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
-{
+bool CBlockTreeDB::WriteContractIndex(const std::vector<CContractIndexKey> &contracts, unsigned int height, bool fErasable) {
+    CDBBatch batch(*this);
+    for (const CContractIndexKey& key : contracts)
+        batch.Write(std::make_pair(DB_CONTRACTINDEX, key), height);
+    // Remember which contracts a block created, so they can be removed when it is disconnected
+    if (fErasable)
+        batch.Write(std::make_pair(DB_CONTRACTHEIGHTINDEX, height), contracts);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadContractIndex(const CContractIndexKey* after, size_t skip, size_t count, std::vector<CContractIndexKey> &contracts) {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
+    if (after)
+        pcursor->Seek(std::make_pair(DB_CONTRACTINDEX, *after));
+    else
+        pcursor->Seek(DB_CONTRACTINDEX);
 
-    // Load mapBlockIndex
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nMoneySupply   = diskindex.nMoneySupply; // QTUM_INSERT_LINE
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
-                pindexNew->hashStateRoot  = diskindex.hashStateRoot; // qtum
-                pindexNew->hashUTXORoot   = diskindex.hashUTXORoot; // qtum
-                pindexNew->nStakeModifier = diskindex.nStakeModifier;
-                pindexNew->prevoutStake   = diskindex.prevoutStake;
-                pindexNew->vchBlockSig    = diskindex.vchBlockSig; // qtum
-
-                if (!CheckIndexProof(*pindexNew, Params().GetConsensus()))
-                    return error("%s: CheckIndexProof failed: %s", __func__, pindexNew->ToString());
-
-                // NovaCoin: build setStakeSeen
-                if (pindexNew->IsProofOfStake())
-                    setStakeSeen.insert(std::make_pair(pindexNew->prevoutStake, pindexNew->nTime));
-
-                pcursor->Next();
-            } else {
-                return error("%s: failed to read value", __func__);
-            }
-        } else {
+    for (; pcursor->Valid() && contracts.size() < count; pcursor->Next()) {
+        std::pair<char, CContractIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_CONTRACTINDEX) {
             break;
         }
+        if (after && key.second == *after) {
+            continue;
+        }
+        if (skip > 0) {
+            skip--;
+            continue;
+        }
+        contracts.push_back(key.second);
     }
 
     return true;
 }
 
+bool CBlockTreeDB::EraseContractIndex(unsigned int height) {
+    std::vector<CContractIndexKey> contracts;
+    if (!Read(std::make_pair(DB_CONTRACTHEIGHTINDEX, height), contracts))
+        return true;
+
+    CDBBatch batch(*this);
+    for (const CContractIndexKey& key : contracts)
+        batch.Erase(std::make_pair(DB_CONTRACTINDEX, key));
+    batch.Erase(std::make_pair(DB_CONTRACTHEIGHTINDEX, height));
+    return WriteBatch(batch);
+}
+///////////////////////////////////////////////////////
+
+bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, int nThreads)
+{
+    // Entries are deserialized and hashed by the reading threads, and handed over in batches
+    // to be inserted while holding csInsert
+    static const size_t BATCH_SIZE = 1024;
+    std::mutex csInsert;
+    std::atomic<bool> fFailed(false);
+    // Set when the calling thread is interrupted, so the other readers stop as well
+    std::atomic<bool> fInterrupted(false);
+    std::string strFailure;
+
+    auto insertBatch = [&](std::vector<std::pair<uint256, CDiskBlockIndex>>& batch) {
+        std::lock_guard<std::mutex> lock(csInsert);
+        for (const std::pair<uint256, CDiskBlockIndex>& entry : batch) {
+            const CDiskBlockIndex& diskindex = entry.second;
+            // Construct block index object
+            CBlockIndex* pindexNew = insertBlockIndex(entry.first);
+            pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight        = diskindex.nHeight;
+            pindexNew->nFile          = diskindex.nFile;
+            pindexNew->nDataPos       = diskindex.nDataPos;
+            pindexNew->nUndoPos       = diskindex.nUndoPos;
+            pindexNew->nVersion       = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            pindexNew->nMoneySupply   = diskindex.nMoneySupply; // QTUM_INSERT_LINE
+            pindexNew->nStatus        = diskindex.nStatus;
+            pindexNew->nTx            = diskindex.nTx;
+            pindexNew->nStakeModifier = diskindex.nStakeModifier;
+            pindexNew->SetStateRoots(blockIndexArena, diskindex.hashStateRoot, diskindex.hashUTXORoot); // qtum
+            pindexNew->SetStakeData(blockIndexArena, diskindex.prevoutStake, diskindex.vchBlockSig); // qtum
+            pindexNew->SetHashProof(diskindex.hashProof);
+
+            if (!CheckIndexProof(*pindexNew, Params().GetConsensus())) {
+                strFailure = strprintf("LoadBlockIndexGuts: CheckIndexProof failed: %s", pindexNew->ToString());
+                return false;
+            }
+
+            // NovaCoin: build setStakeSeen
+            if (pindexNew->IsProofOfStake())
+                setStakeSeen.insert(std::make_pair(pindexNew->GetPrevoutStake(), pindexNew->nTime));
+        }
+        batch.clear();
+        return true;
+    };
+
+    // Keys are (DB_BLOCK_INDEX, hash), and hashes are spread evenly over their first byte,
+    // so range i holds the hashes whose first byte is in [256*i/nThreads, 256*(i+1)/nThreads)
+    nThreads = std::max(1, std::min(nThreads, MAX_BLOCK_INDEX_LOAD_THREADS));
+    auto loadRange = [&](int nRange) {
+        int nBegin = 256 * nRange / nThreads;
+        int nEnd = 256 * (nRange + 1) / nThreads;
+        uint256 hashBegin;
+        *hashBegin.begin() = nBegin;
+
+        std::unique_ptr<CDBIterator> pcursor(NewIterator());
+        pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, hashBegin));
+
+        std::vector<std::pair<uint256, CDiskBlockIndex>> batch;
+        batch.reserve(BATCH_SIZE);
+        while (pcursor->Valid() && !fFailed && !fInterrupted) {
+            // Only the calling thread can be interrupted, the other readers are std::threads
+            if (nRange == 0) {
+                try {
+                    boost::this_thread::interruption_point();
+                } catch (const boost::thread_interrupted&) {
+                    fInterrupted = true;
+                    break;
+                }
+            }
+            std::pair<char, uint256> key;
+            if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX || *key.second.begin() >= nEnd)
+                break;
+            CDiskBlockIndex diskindex;
+            if (!pcursor->GetValue(diskindex)) {
+                std::lock_guard<std::mutex> lock(csInsert);
+                strFailure = "LoadBlockIndexGuts: failed to read value";
+                fFailed = true;
+                return;
+            }
+            uint256 hash = diskindex.GetBlockHash();
+            batch.emplace_back(hash, std::move(diskindex));
+            if (batch.size() >= BATCH_SIZE && !insertBatch(batch)) {
+                fFailed = true;
+                return;
+            }
+            pcursor->Next();
+        }
+        if (!fFailed && !fInterrupted && !insertBatch(batch))
+            fFailed = true;
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < nThreads; i++)
+        threads.emplace_back(loadRange, i);
+    loadRange(0);
+    for (std::thread& thread : threads)
+        thread.join();
+
+    // Rethrown once the readers are joined
+    if (fInterrupted)
+        throw boost::thread_interrupted();
+    boost::this_thread::interruption_point();
+
+    if (fFailed)
+        return error("%s", strFailure);
+    return true;
+}
+
 namespace {
 
 //! Legacy class to deserialize pre-pertxout database entries without reindex.
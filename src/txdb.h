@@ -41,6 +41,8 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxBlockDBAndTxIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! Max number of threads reading the block index at startup
+static const int MAX_BLOCK_INDEX_LOAD_THREADS = 8;
 
 struct CDiskTxPos : public CDiskBlockPos
 {
@@ -77,6 +79,8 @@ public:
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
+    //! Read several coins at once, see CDBWrapper::ReadMany. Returns the number found.
+    size_t GetCoins(const std::vector<COutPoint> &outpoints, std::vector<Coin> &coins, std::vector<bool> &found) const;
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
@@ -124,10 +128,16 @@ public:
     bool WriteReindexing(bool fReindex);
     bool ReadReindexing(bool &fReindex);
     bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
+    //! Read the positions of several transactions at once. Returns the number found.
+    size_t ReadTxIndex(const std::vector<uint256> &txids, std::vector<CDiskTxPos> &pos, std::vector<bool> &found);
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &list);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
-    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+    /**
+     * Load all block index entries. The key space is split into nThreads ranges which are read
+     * and deserialized in parallel; insertBlockIndex is only ever called by one thread at a time.
+     */
+    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, int nThreads = 1);
 
     ////////////////////////////////////////////////////////////////////////////// // qtum
     bool WriteHeightIndex(const CHeightTxIndexKey &heightIndex, const std::vector<uint256>& hash);
@@ -155,6 +165,18 @@ public:
     bool ReadStakeIndex(unsigned int high, unsigned int low, std::vector<uint160> addresses);
     bool EraseStakeIndex(unsigned int height);
 
+    /**
+     * Add contracts to the contract address index. With fErasable, they are also
+     * recorded under height so that EraseContractIndex(height) removes them again.
+     */
+    bool WriteContractIndex(const std::vector<CContractIndexKey> &contracts, unsigned int height, bool fErasable);
+    /**
+     * Read up to count contracts in index order, starting after the contract after
+     * (or from the beginning if it is null) and leaving out the first skip ones.
+     */
+    bool ReadContractIndex(const CContractIndexKey* after, size_t skip, size_t count, std::vector<CContractIndexKey> &contracts);
+    bool EraseContractIndex(unsigned int height);
+
     //////////////////////////////////////////////////////////////////////////////
 
 };
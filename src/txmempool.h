@@ -6,6 +6,7 @@
 #ifndef BITCOIN_TXMEMPOOL_H
 #define BITCOIN_TXMEMPOOL_H
 
+#include <algorithm>
 #include <memory>
 #include <set>
 #include <map>
@@ -16,6 +17,7 @@
 #include "amount.h"
 #include "coins.h"
 #include "indirectmap.h"
+#include "memusage.h"
 #include "policy/feerate.h"
 #include "primitives/transaction.h"
 #include "sync.h"
@@ -49,6 +51,30 @@ struct LockPoints
 };
 
 class CTxMemPool;
+class CTxMemPoolEntry;
+
+/** In-mempool parents or children of a transaction, kept inside its
+ *  CTxMemPoolEntry and sorted by txid. Transactions rarely have more than a
+ *  few, and a sorted vector takes a fraction of the memory of a std::set.
+ */
+class CTxMemPoolEntryLinks
+{
+private:
+    std::vector<const CTxMemPoolEntry*> entries;
+
+public:
+    typedef std::vector<const CTxMemPoolEntry*>::const_iterator const_iterator;
+    const_iterator begin() const { return entries.begin(); }
+    const_iterator end() const { return entries.end(); }
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+
+    //! Returns false if entry was already linked
+    bool insert(const CTxMemPoolEntry* entry);
+    //! Returns false if entry wasn't linked
+    bool erase(const CTxMemPoolEntry* entry);
+    size_t DynamicMemoryUsage() const { return memusage::DynamicUsage(entries); }
+};
 
 /** \class CTxMemPoolEntry
  *
@@ -65,36 +91,41 @@ class CTxMemPool;
 class CTxMemPoolEntry
 {
 private:
+    // Fields are ordered by size, so the entry (kept in every node of mapTx)
+    // has no padding between them. Weights, usage, heights and transaction
+    // counts all fit in 32 bits.
     CTransactionRef tx;
     CAmount nFee;              //!< Cached to avoid expensive parent-transaction lookups
-    size_t nTxWeight;          //!< ... and avoid recomputing tx weight (also used for GetTxSize())
-    size_t nUsageSize;         //!< ... and total memory usage
     int64_t nTime;             //!< Local time when entering the mempool
-    unsigned int entryHeight;  //!< Chain height when entering the mempool
-    bool spendsCoinbase;       //!< keep track of transactions that spend a coinbase
     int64_t sigOpCost;         //!< Total sigop cost
     int64_t feeDelta;          //!< Used for determining the priority of the transaction for mining in a block
     LockPoints lockPoints;     //!< Track the height and time at which tx was final
     CAmount nMinGasPrice;      //!< The minimum gas price among the contract outputs of the tx
+    uint64_t nGasLimit;        //!< Total gas limit of the contract outputs of the tx
 
     // Information about descendants of this transaction that are in the
     // mempool; if we remove this transaction we must remove all of these
     // descendants as well.
-    uint64_t nCountWithDescendants;  //!< number of descendant transactions
-    uint64_t nSizeWithDescendants;   //!< ... and size
+    uint64_t nSizeWithDescendants;   //!< size of descendant transactions
     CAmount nModFeesWithDescendants; //!< ... and total fees (all including us)
 
     // Analogous statistics for ancestor transactions
-    uint64_t nCountWithAncestors;
     uint64_t nSizeWithAncestors;
     CAmount nModFeesWithAncestors;
     int64_t nSigOpCostWithAncestors;
 
+    uint32_t nTxWeight;        //!< Cached to avoid recomputing tx weight (also used for GetTxSize())
+    uint32_t nUsageSize;       //!< ... and total memory usage
+    uint32_t entryHeight;      //!< Chain height when entering the mempool
+    uint32_t nCountWithDescendants;  //!< number of descendant transactions (including us)
+    uint32_t nCountWithAncestors;    //!< number of ancestor transactions (including us)
+    bool spendsCoinbase;       //!< keep track of transactions that spend a coinbase
+
 public:
     CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                     int64_t _nTime, unsigned int _entryHeight,
                     bool spendsCoinbase,
-                    int64_t nSigOpsCost, LockPoints lp, CAmount _nMinGasPrice = 0);
+                    int64_t nSigOpsCost, LockPoints lp, CAmount _nMinGasPrice = 0, uint64_t _nGasLimit = 0);
 
     CTxMemPoolEntry(const CTxMemPoolEntry& other);
 
@@ -110,6 +141,7 @@ public:
     size_t DynamicMemoryUsage() const { return nUsageSize; }
     const LockPoints& GetLockPoints() const { return lockPoints; }
     const CAmount& GetMinGasPrice() const { return nMinGasPrice; }
+    uint64_t GetGasLimit() const { return nGasLimit; }
 
     // Adjusts the descendant state.
     void UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
@@ -132,7 +164,13 @@ public:
     CAmount GetModFeesWithAncestors() const { return nModFeesWithAncestors; }
     int64_t GetSigOpCostWithAncestors() const { return nSigOpCostWithAncestors; }
 
-    mutable size_t vTxHashesIdx; //!< Index in mempool's vTxHashes
+    mutable uint32_t vTxHashesIdx; //!< Index in mempool's vTxHashes
+
+    // Links to the in-mempool parents and children of this transaction. They
+    // live in the entry, so mapTx nodes link to each other directly, and are
+    // only changed by CTxMemPool.
+    mutable CTxMemPoolEntryLinks parents;
+    mutable CTxMemPoolEntryLinks children;
 };
 
 // Helpers for modifying CTxMemPool::mapTx, which is a boost multi_index.
@@ -416,7 +454,7 @@ public:
  *
  * In order for the feerate sort to remain correct, we must update transactions
  * in the mempool when new descendants arrive.  To facilitate this, we track
- * the set of in-mempool direct parents and direct children in mapLinks.  Within
+ * the set of in-mempool direct parents and direct children in each entry.  Within
  * each CTxMemPoolEntry, we track the size and fees of all descendants.
  *
  * Usually when a new transaction is added to the mempool, it has no in-mempool
@@ -449,7 +487,7 @@ public:
  * state, to account for in-mempool, out-of-block descendants for all the
  * in-block transactions by calling UpdateTransactionsFromBlock().  Note that
  * until this is called, the mempool state is not consistent, and in particular
- * mapLinks may not be correct (and therefore functions like
+ * the entries' links may not be correct (and therefore functions like
  * CalculateMemPoolAncestors() and CalculateDescendants() that rely
  * on them to walk the mempool are not generally safe to use).
  *
@@ -532,18 +570,48 @@ public:
     };
     typedef std::set<txiter, CompareIteratorByHash> setEntries;
 
-    const setEntries & GetMemPoolParents(txiter entry) const;
-    const setEntries & GetMemPoolChildren(txiter entry) const;
-private:
-    typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
-
-    struct TxLinks {
-        setEntries parents;
-        setEntries children;
+    /** Parents or children of a mempool entry, iterated as txiters in the
+     *  same order as setEntries. Only valid until the entry's links change. */
+    class linkEntries
+    {
+    private:
+        const indexed_transaction_set& mapTx;
+        const CTxMemPoolEntryLinks& links;
+
+    public:
+        class const_iterator
+        {
+        private:
+            const indexed_transaction_set* mapTx;
+            CTxMemPoolEntryLinks::const_iterator it;
+
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef txiter value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const txiter* pointer;
+            typedef txiter reference;
+
+            const_iterator(const indexed_transaction_set* _mapTx, CTxMemPoolEntryLinks::const_iterator _it) : mapTx(_mapTx), it(_it) {}
+            txiter operator*() const { return mapTx->iterator_to(**it); }
+            const_iterator& operator++() { ++it; return *this; }
+            const_iterator operator++(int) { const_iterator prev = *this; ++it; return prev; }
+            bool operator==(const const_iterator& other) const { return it == other.it; }
+            bool operator!=(const const_iterator& other) const { return it != other.it; }
+        };
+
+        linkEntries(const indexed_transaction_set& _mapTx, const CTxMemPoolEntryLinks& _links) : mapTx(_mapTx), links(_links) {}
+        const_iterator begin() const { return const_iterator(&mapTx, links.begin()); }
+        const_iterator end() const { return const_iterator(&mapTx, links.end()); }
+        size_t size() const { return links.size(); }
+        bool empty() const { return links.empty(); }
+        setEntries ToSet() const { return setEntries(begin(), end()); }
     };
 
-    typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
-    txlinksMap mapLinks;
+    linkEntries GetMemPoolParents(txiter entry) const;
+    linkEntries GetMemPoolChildren(txiter entry) const;
+private:
+    typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
 
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
@@ -626,7 +694,7 @@ public:
      *  limitDescendantSize = max size of descendants any ancestor can have
      *  errString = populated with error reason if any limits are hit
      *  fSearchForParents = whether to search a tx's vin for in-mempool parents, or
-     *    look up parents from mapLinks. Must be true for entries not in the mempool
+     *    look up parents from the entry's links. Must be true for entries not in the mempool
      */
     bool CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntries &setAncestors, uint64_t limitAncestorCount, uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize, std::string &errString, bool fSearchForParents = true) const;
 
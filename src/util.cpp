@@ -260,6 +260,7 @@ const CLogCategoryDesc LogCategories[] =
     {BCLog::LEVELDB, "leveldb"},
     {BCLog::COINSTAKE, "coinstake"},
     {BCLog::HTTPPOLL, "http-poll"},
+    {BCLog::CONTRACT, "contract"},
     {BCLog::ALL, "1"},
     {BCLog::ALL, "all"},
 };
@@ -48,7 +48,9 @@
 #include "wallet/wallet.h"
 
 #include <atomic>
+#include <numeric>
 #include <sstream>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/join.hpp>
@@ -67,6 +69,9 @@
 #include <bitset>
 #include "pubkey.h"
 #include <univalue.h>
+#include "qtum/contracttrace.h"
+#include "qtum/storageprefetch.h"
+#include "qtum/contractcallpool.h"
 
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
 
@@ -80,6 +85,7 @@ bool fGettingValuesDGP = false;
 CCriticalSection cs_main;
 
 BlockMap mapBlockIndex;
+CBlockIndexArena blockIndexArena;
 std::set<std::pair<COutPoint, unsigned int>> setStakeSeen;
 CChain chainActive;
 CBlockIndex *pindexBestHeader = nullptr;
@@ -724,6 +730,25 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
                 return state.DoS(100, false, REJECT_INVALID, "bad-txns-incorrect-format");
         }
         */
+        uint64_t txGasLimit = 0;
+        if(tx.HasCreateOrCall()){
+            //the gas price and limit only order contract transactions and feed gas price estimation,
+            //so outputs that can't be parsed are left out here
+            for(uint32_t nvout = 0; nvout < tx.vout.size(); nvout++){
+                if(!(tx.vout[nvout].scriptPubKey.HasOpCall() || tx.vout[nvout].scriptPubKey.HasOpCreate())){
+                    continue;
+                }
+                ContractOutputParser parser(tx, nvout);
+                ContractOutput output;
+                if(!parser.parseOutput(output)){
+                    continue;
+                }
+                if(txMinGasPrice == 0 || dev::u256(output.gasPrice) < txMinGasPrice){
+                    txMinGasPrice = output.gasPrice;
+                }
+                txGasLimit += std::min<uint64_t>(output.gasLimit, UINT32_MAX);
+            }
+        }
         ////////////////////////////////////////////////////////////
 
         // nModifiedFees includes any fee deltas from PrioritiseTransaction
@@ -742,7 +767,7 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         }
 
         CTxMemPoolEntry entry(ptx, nFees, nAcceptTime, chainActive.Height(),
-                              fSpendsCoinbase, nSigOpsCost, lp, CAmount(txMinGasPrice));
+                              fSpendsCoinbase, nSigOpsCost, lp, CAmount(txMinGasPrice), txGasLimit);
         unsigned int nSize = entry.GetTxSize();
 
         // Check that the transaction doesn't have an excessive number of
@@ -1142,7 +1167,7 @@ bool CheckIndexProof(const CBlockIndex& block, const Consensus::Params& consensu
 {
     // Get the hash of the proof
     // After validating the PoS block the computed hash proof is saved in the block index, which is used to check the index
-    uint256 hashProof = block.IsProofOfWork() ? block.GetBlockHash() : block.hashProof;
+    uint256 hashProof = block.IsProofOfWork() ? block.GetBlockHash() : block.GetHashProof();
     // Check for proof after the hash proof is computed
     if(block.IsProofOfStake()){
         //blocks are loaded out of order, so checking PoS kernels here is not practical
@@ -1217,6 +1242,35 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
     return true;
 }
 
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart)
+{
+    CDiskBlockPos pos = pindex->GetBlockPos();
+    if (pos.nPos < 8)
+        return error("%s: Invalid block position %s", __func__, pos.ToString());
+    // Step back to the index header written by WriteBlockToDisk
+    pos.nPos -= 8;
+
+    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+
+    try {
+        CMessageHeader::MessageStartChars blockStart;
+        unsigned int nSize;
+        filein >> FLATDATA(blockStart) >> nSize;
+        if (memcmp(blockStart, messageStart, CMessageHeader::MESSAGE_START_SIZE) != 0)
+            return error("%s: Block magic mismatch at %s", __func__, pos.ToString());
+        if (nSize > dgpMaxBlockSerSize)
+            return error("%s: Block size %u too large at %s", __func__, nSize, pos.ToString());
+        block.resize(nSize);
+        filein.read((char*)block.data(), nSize);
+    }
+    catch (const std::exception& e) {
+        return error("%s: Read from block file failed: %s at %s", __func__, e.what(), pos.ToString());
+    }
+    return true;
+}
+
 bool ReadFromDisk(CBlockHeader& block, unsigned int nFile, unsigned int nBlockPos)
 {
     return ReadBlockFromDisk(block, CDiskBlockPos(nFile, nBlockPos), Params().GetConsensus());
@@ -1748,14 +1802,17 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
-    //globalState->setRoot(uintToh256(pindex->pprev->hashStateRoot)); // qtum
-    globalState->setRootUTXO(uintToh256(pindex->pprev->hashUTXORoot)); // qtum
+    //globalState->setRoot(uintToh256(pindex->pprev->GetHashStateRoot())); // qtum
+    globalState->setRootUTXO(uintToh256(pindex->pprev->GetHashUTXORoot())); // qtum
 
     if(pfClean == NULL && fLogEvents){
         pstorageresult->deleteResults(block.vtx);
         pblocktree->EraseHeightIndex(pindex->nHeight);
         peventdb->eraseBlock(pindex->nHeight);
     }
+    if(pfClean == NULL){
+        pblocktree->EraseContractIndex(pindex->nHeight);
+    }
     pblocktree->EraseStakeIndex(pindex->nHeight);
 
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
@@ -1786,11 +1843,63 @@ void static FlushBlockFile(bool fFinalize = false)
 
 static bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigned int nAddSize);
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+/** Worker threads running the parallel parts of block validation */
+static CCheckScheduler checkscheduler;
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128, checkscheduler);
 
 void ThreadScriptCheck() {
     RenameThread("bitcoin-scriptch");
-    scriptcheckqueue.Thread();
+    checkscheduler.Thread();
+}
+
+/**
+ * Read the coins spent by block that are not in pcoinsTip yet from the coins
+ * database on the database read pool, and add them to pcoinsTip as clean
+ * entries, so that connecting the block (including the stake and contract
+ * sender lookups) finds them in memory instead of doing one database read at
+ * a time.
+ * Read errors are not reported here; the coins are then read again, and the
+ * error handled, when the block is connected.
+ */
+static unsigned int PrefetchBlockInputs(const CBlock& block)
+{
+    AssertLockHeld(cs_main);
+    if (dbReadPool.Concurrency() <= 1)
+        return 0;
+
+    std::set<uint256> setBlockTxids;
+    for (const auto& tx : block.vtx) {
+        setBlockTxids.insert(tx->GetHash());
+    }
+    std::vector<COutPoint> vOutpoints;
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase())
+            continue;
+        for (const CTxIn& txin : tx->vin) {
+            if (setBlockTxids.count(txin.prevout.hash) || pcoinsTip->HaveCoinInCache(txin.prevout))
+                continue;
+            vOutpoints.push_back(txin.prevout);
+        }
+    }
+    if (vOutpoints.empty())
+        return 0;
+
+    std::vector<Coin> vCoins;
+    std::vector<bool> vFound;
+    try {
+        pcoinsdbview->GetCoins(vOutpoints, vCoins, vFound);
+    } catch (const std::runtime_error&) {
+        return 0;
+    }
+
+    unsigned int nFetched = 0;
+    for (size_t i = 0; i < vOutpoints.size(); i++) {
+        if (vFound[i]) {
+            pcoinsTip->CacheFetchedCoin(vOutpoints[i], std::move(vCoins[i]));
+            nFetched++;
+        }
+    }
+    return nFetched;
 }
 
 // Protected by cs_main
@@ -1891,12 +2000,17 @@ bool CheckSenderScript(const CCoinsViewCache& view, const CTransaction& tx){
 }
 
 std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::vector<unsigned char> opcode, const dev::Address& sender, uint64_t gasLimit){
-    CBlock block;
-    CMutableTransaction tx;
-
     QtumDGP qtumDGP(globalState.get(), fGettingValuesDGP);
     uint64_t blockGasLimit = qtumDGP.getBlockGasLimit(chainActive.Tip()->nHeight + 1);
 
+    return CallContract(*globalState, *globalSealEngine, chainActive.Tip(), blockGasLimit, addrContract, opcode, sender, gasLimit);
+}
+
+std::vector<ResultExecute> CallContract(QtumState& state, dev::eth::SealEngineFace& sealEngine, const CBlockIndex* tip, uint64_t blockGasLimit,
+                                        const dev::Address& addrContract, std::vector<unsigned char> opcode, const dev::Address& sender, uint64_t gasLimit){
+    CBlock block;
+    CMutableTransaction tx;
+
     if(gasLimit == 0){
         gasLimit = blockGasLimit - 1;
     }
@@ -1909,7 +2023,7 @@ std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::v
     callTransaction.setVersion(VersionVM::GetEVMDefault());
 
     
-    ByteCodeExec exec(block, std::vector<QtumTransaction>(1, callTransaction), blockGasLimit);
+    ByteCodeExec exec(block, std::vector<QtumTransaction>(1, callTransaction), blockGasLimit, state, sealEngine, tip);
     exec.performByteCode(dev::eth::Permanence::Reverted);
     return exec.getResult();
 }
@@ -2112,17 +2226,20 @@ bool ByteCodeExec::performByteCode(dev::eth::Permanence type){
             return false;
         }
         dev::eth::EnvInfo envInfo(BuildEVMEnvironment());
-        if(!tx.isCreation() && !globalState->addressInUse(tx.receiveAddress())){
+        if(!tx.isCreation() && !state.addressInUse(tx.receiveAddress())){
             dev::eth::ExecutionResult execRes;
             execRes.excepted = dev::eth::TransactionException::Unknown;
             result.push_back(ResultExecute{execRes, dev::eth::TransactionReceipt(dev::h256(), dev::u256(), dev::eth::LogEntries()), CTransaction()});
             continue;
         }
-        result.push_back(globalState->execute(envInfo, *globalSealEngine.get(), tx, type, OnOpFunc()));
+        result.push_back(state.execute(envInfo, sealEngine, tx, type, OnOpFunc()));
     }
-    globalState->db().commit();
-    globalState->dbUtxo().commit();
-    globalSealEngine.get()->deleteAddresses.clear();
+    //a pinned copy of the state shares the databases of globalState, which only the validation thread writes to
+    if(&state == globalState.get()){
+        state.db().commit();
+        state.dbUtxo().commit();
+    }
+    sealEngine.deleteAddresses.clear();
     return true;
 }
 
@@ -2167,18 +2284,18 @@ bool ByteCodeExec::processingResults(ByteCodeExecResult& resultBCE){
 
 dev::eth::EnvInfo ByteCodeExec::BuildEVMEnvironment(){
     dev::eth::EnvInfo env;
-    CBlockIndex* tip = chainActive.Tip();
-    env.setNumber(dev::u256(tip->nHeight + 1));
+    const CBlockIndex* pindex = tip;
+    env.setNumber(dev::u256(pindex->nHeight + 1));
     env.setTimestamp(dev::u256(block.nTime));
     env.setDifficulty(dev::u256(block.nBits));
 
     dev::eth::LastHashes lh;
     lh.resize(256);
     for(int i=0;i<256;i++){
-        if(!tip)
+        if(!pindex)
             break;
-        lh[i]= uintToh256(*tip->phashBlock);
-        tip = tip->pprev;
+        lh[i]= uintToh256(*pindex->phashBlock);
+        pindex = pindex->pprev;
     }
     env.setLastHashes(std::move(lh));
     env.setGasLimit(blockGasLimit);
@@ -2314,7 +2431,8 @@ QtumTransaction QtumTxConverter::createEthTX(const EthTransactionParams& etp, ui
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
 static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
-                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false)
+                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false,
+                  std::vector<ContractExecutionResult>* pvContractResults = nullptr)
 {
     AssertLockHeld(cs_main);
     assert(pindex);
@@ -2464,6 +2582,9 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
     ///////////////////////////////////////////////////////// // qtum
     std::map<dev::Address, std::pair<CHeightTxIndexKey, std::vector<uint256>>> heightIndexes;
+    std::vector<CContractIndexKey> vNewContracts;
+    //written to the contract trace once the block is connected
+    std::vector<ContractExecutionResult> vTraceResults;
     /////////////////////////////////////////////////////////
 
     std::vector<PrecomputedTransactionData> txdata;
@@ -2479,6 +2600,13 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         peventdb->revert();
     }
 
+    //start reading the storage of called x86 contracts in the background while inputs and scripts are checked
+    if(storagePrefetcher.IsRunning(pdeltaDB)){
+        for(const auto& tx : block.vtx){
+            PrefetchContractStorage(*tx);
+        }
+    }
+
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
         const CTransaction &tx = *(block.vtx[i]);
@@ -2635,7 +2763,14 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
                 if(fLogEvents){
                     peventdb->addResult(result);
                 }
-                LogPrintf("contract exec:\n %s\n\n", result.toJSON().write(1, 2)); //todo: find better way of logging this
+                for(const UniversalAddress& address : result.newContracts){
+                    vNewContracts.push_back(CContractIndexKey(address));
+                }
+                //arguments are only evaluated when the contract category is enabled
+                LogPrint(BCLog::CONTRACT, "contract exec:\n %s\n\n", result.toJSON().write(1, 2));
+                if(contractTrace.IsOpen() && !fJustCheck){
+                    vTraceResults.push_back(result);
+                }
                 blockGasUsed += result.usedGas;
                 if(blockGasUsed > blockGasLimit){
                     return state.DoS(1000, error("ConnectBlock(): Block exceeds gas limit"), REJECT_INVALID, "bad-blk-gaslimit");
@@ -2658,6 +2793,9 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
                 if(fRecordLogOpcodes && !fJustCheck){
                     //TODO writeVMlog(resultExec, tx, block);
                 }
+                if(pvContractResults){
+                    pvContractResults->push_back(std::move(result));
+                }
 
 
             }
@@ -2941,9 +3079,9 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     {
         dev::h256 prevHashStateRoot(dev::sha3(dev::rlp("")));
         dev::h256 prevHashUTXORoot(dev::sha3(dev::rlp("")));
-        if(pindex->pprev->hashStateRoot != uint256() && pindex->pprev->hashUTXORoot != uint256()){
-            prevHashStateRoot = uintToh256(pindex->pprev->hashStateRoot);
-            prevHashUTXORoot = uintToh256(pindex->pprev->hashUTXORoot);
+        if(pindex->pprev->GetHashStateRoot() != uint256() && pindex->pprev->GetHashUTXORoot() != uint256()){
+            prevHashStateRoot = uintToh256(pindex->pprev->GetHashStateRoot());
+            prevHashUTXORoot = uintToh256(pindex->pprev->GetHashUTXORoot());
         }
         globalState->setRoot(prevHashStateRoot);
         globalState->setRootUTXO(prevHashUTXORoot);
@@ -2989,6 +3127,8 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         }
         peventdb->commit(pindex->nHeight);
     }    
+    if (!vNewContracts.empty() && !pblocktree->WriteContractIndex(vNewContracts, pindex->nHeight, true))
+        return AbortNode(state, "Failed to write contract index");
     if(block.IsProofOfStake()){
         // Read the public key from the second output
         std::vector<unsigned char> vchPubKey;
@@ -3010,6 +3150,10 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
+    for(const ContractExecutionResult& result : vTraceResults){
+        contractTrace.Write(result, pindex->nHeight, pindex->GetBlockHash());
+    }
+
     int64_t nTime5 = GetTimeMicros(); nTimeIndex += nTime5 - nTime4;
     LogPrint(BCLog::BENCH, "    - Index writing: %.2fms [%.2fs]\n", 0.001 * (nTime5 - nTime4), nTimeIndex * 0.000001);
 
@@ -3269,6 +3413,7 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetch = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
@@ -3278,6 +3423,7 @@ struct PerBlockConnectTrace {
     CBlockIndex* pindex = nullptr;
     std::shared_ptr<const CBlock> pblock;
     std::shared_ptr<std::vector<CTransactionRef>> conflictedTxs;
+    std::vector<ContractExecutionResult> contractResults;
     PerBlockConnectTrace() : conflictedTxs(std::make_shared<std::vector<CTransactionRef>>()) {}
 };
 /**
@@ -3310,12 +3456,13 @@ public:
         pool.NotifyEntryRemoved.disconnect(boost::bind(&ConnectTrace::NotifyEntryRemoved, this, _1, _2));
     }
 
-    void BlockConnected(CBlockIndex* pindex, std::shared_ptr<const CBlock> pblock) {
+    void BlockConnected(CBlockIndex* pindex, std::shared_ptr<const CBlock> pblock, std::vector<ContractExecutionResult>&& contractResults) {
         assert(!blocksConnected.back().pindex);
         assert(pindex);
         assert(pblock);
         blocksConnected.back().pindex = pindex;
         blocksConnected.back().pblock = std::move(pblock);
+        blocksConnected.back().contractResults = std::move(contractResults);
         blocksConnected.emplace_back();
     }
 
@@ -3364,13 +3511,18 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
+    unsigned int nPrefetched = PrefetchBlockInputs(blockConnecting);
+    int64_t nTimePrefetched = GetTimeMicros(); nTimePrefetch += nTimePrefetched - nTime2;
+    LogPrint(BCLog::BENCH, "  - Prefetch %u inputs: %.2fms [%.2fs]\n", nPrefetched, (nTimePrefetched - nTime2) * 0.001, nTimePrefetch * 0.000001);
+    nTime2 = nTimePrefetched;
+    std::vector<ContractExecutionResult> vContractResults;
     {
         CCoinsViewCache view(pcoinsTip);
 
         dev::h256 oldHashStateRoot(globalState->rootHash()); // qtum
         dev::h256 oldHashUTXORoot(globalState->rootHashUTXO()); // qtum
 
-        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
+        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams, false, &vContractResults);
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
             if (state.IsInvalid())
@@ -3403,7 +3555,7 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     LogPrint(BCLog::BENCH, "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime6 - nTime5) * 0.001, nTimePostConnect * 0.000001);
     LogPrint(BCLog::BENCH, "- Connect block: %.2fms [%.2fs]\n", (nTime6 - nTime1) * 0.001, nTimeTotal * 0.000001);
 
-    connectTrace.BlockConnected(pindexNew, std::move(pthisBlock));
+    connectTrace.BlockConnected(pindexNew, std::move(pthisBlock), std::move(vContractResults));
     return true;
 }
 
@@ -3628,11 +3780,14 @@ bool ActivateBestChain(CValidationState &state, const CChainParams& chainparams,
             }
             pindexNewTip = chainActive.Tip();
             pindexFork = chainActive.FindFork(pindexOldTip);
+            // Read-only contract calls see the contract state as of the new tip from here on
+            contractCallPool.UpdateTip(pindexNewTip, pdeltaDB, globalState.get());
             fInitialDownload = IsInitialBlockDownload();
 
             for (const PerBlockConnectTrace& trace : connectTrace.GetBlocksConnected()) {
                 assert(trace.pblock && trace.pindex);
                 GetMainSignals().BlockConnected(trace.pblock, trace.pindex, *trace.conflictedTxs);
+                GetMainSignals().ContractsExecuted(trace.pindex, trace.contractResults);
             }
         }
         // When we reach this point, we switched to a new tip (stored in pindexNewTip).
@@ -3792,7 +3947,7 @@ static CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
         return it->second;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
+    CBlockIndex* pindexNew = blockIndexArena.New(block, blockIndexArena);
     assert(pindexNew);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
@@ -3800,7 +3955,7 @@ static CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
     pindexNew->nSequenceId = 0;
     BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
     if (pindexNew->IsProofOfStake())
-        setStakeSeen.insert(std::make_pair(pindexNew->prevoutStake, pindexNew->nTime));
+        setStakeSeen.insert(std::make_pair(pindexNew->GetPrevoutStake(), pindexNew->nTime));
     pindexNew->phashBlock = &((*mi).first);
     BlockMap::iterator miPrev = mapBlockIndex.find(block.hashPrevBlock);
     if (miPrev != mapBlockIndex.end())
@@ -4411,7 +4566,7 @@ static bool UpdateHashProof(const CBlock& block, CValidationState& state, const
     }
     
     // Record proof hash value
-    pindex->hashProof = hashProof;
+    pindex->SetHashProof(hashProof);
     return true;
 }
 
@@ -4913,9 +5068,7 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
-    if (!pindexNew)
-        throw std::runtime_error(std::string(__func__) + ": new CBlockIndex failed");
+    CBlockIndex* pindexNew = blockIndexArena.New();
     mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
 
@@ -4924,24 +5077,51 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
 
 bool static LoadBlockIndexDB(const CChainParams& chainparams)
 {
-    if (!pblocktree->LoadBlockIndexGuts(chainparams.GetConsensus(), InsertBlockIndex))
+    int nThreads = std::max(1, std::min(GetNumCores(), MAX_BLOCK_INDEX_LOAD_THREADS));
+    if (!pblocktree->LoadBlockIndexGuts(chainparams.GetConsensus(), InsertBlockIndex, nThreads))
         return false;
 
     boost::this_thread::interruption_point();
 
-    // Calculate nChainWork
-    std::vector<std::pair<int, CBlockIndex*> > vSortedByHeight;
-    vSortedByHeight.reserve(mapBlockIndex.size());
+    std::vector<CBlockIndex*> vIndex;
+    vIndex.reserve(mapBlockIndex.size());
+    int nMaxHeight = 0;
     for (const std::pair<uint256, CBlockIndex*>& item : mapBlockIndex)
     {
-        CBlockIndex* pindex = item.second;
-        vSortedByHeight.push_back(std::make_pair(pindex->nHeight, pindex));
+        vIndex.push_back(item.second);
+        nMaxHeight = std::max(nMaxHeight, item.second->nHeight);
     }
-    sort(vSortedByHeight.begin(), vSortedByHeight.end());
-    for (const std::pair<int, CBlockIndex*>& item : vSortedByHeight)
+
+    // The proof of each block doesn't depend on other blocks, so it is computed in parallel
+    // into nChainWork, leaving only the additions along the chain for the serial pass below
     {
-        CBlockIndex* pindex = item.second;
-        pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + GetBlockProof(*pindex);
+        std::vector<std::thread> threads;
+        auto computeProof = [&vIndex, nThreads](int nPart) {
+            size_t nEnd = vIndex.size() * (nPart + 1) / nThreads;
+            for (size_t i = vIndex.size() * nPart / nThreads; i < nEnd; i++)
+                vIndex[i]->nChainWork = GetBlockProof(*vIndex[i]);
+        };
+        for (int i = 1; i < nThreads; i++)
+            threads.emplace_back(computeProof, i);
+        computeProof(0);
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+
+    // Order by height so every block comes after its parent. Heights are dense, so a counting sort does it
+    std::vector<size_t> vHeightStart(nMaxHeight + 2, 0);
+    for (const CBlockIndex* pindex : vIndex)
+        vHeightStart[pindex->nHeight + 1]++;
+    std::partial_sum(vHeightStart.begin(), vHeightStart.end(), vHeightStart.begin());
+    std::vector<CBlockIndex*> vSortedByHeight(vIndex.size());
+    for (CBlockIndex* pindex : vIndex)
+        vSortedByHeight[vHeightStart[pindex->nHeight]++] = pindex;
+    std::vector<CBlockIndex*>().swap(vIndex);
+
+    // Calculate nChainWork
+    for (CBlockIndex* pindex : vSortedByHeight)
+    {
+        pindex->nChainWork += (pindex->pprev ? pindex->pprev->nChainWork : 0);
         pindex->nTimeMax = (pindex->pprev ? std::max(pindex->pprev->nTimeMax, pindex->nTime) : pindex->nTime);
         // We can link the chain of blocks for which we've received transactions at some point.
         // Pruned nodes may have deleted the block.
@@ -5367,6 +5547,55 @@ bool RewindBlockIndex(const CChainParams& params)
     return true;
 }
 
+bool BuildContractIndex()
+{
+    bool fBuilt = false;
+    if (pblocktree->ReadFlag("contractindex", fBuilt) && fBuilt)
+        return true;
+
+    LOCK(cs_main);
+    std::set<UniversalAddress, UniversalAddressLess> setContracts;
+    for (const auto& account : globalState->addresses())
+        setContracts.insert(UniversalAddress(AddressVersion::EVM, account.first.asBytes()));
+    for (const UniversalAddress& address : pdeltaDB->readByteCodeAddresses())
+        setContracts.insert(address);
+    LogPrintf("%s: indexing %u existing contracts\n", __func__, setContracts.size());
+
+    // The address of a contract created by a transaction output is derived from that output, so walking the chain
+    // finds the block that created it. It is recorded under that height, so disconnecting the block removes it again
+    for (CBlockIndex* pindex = chainActive.Genesis(); pindex && !setContracts.empty(); pindex = chainActive.Next(pindex)) {
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA))
+            continue;
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus()))
+            return error("%s: failed to read block %s", __func__, pindex->GetBlockHash().ToString());
+        std::vector<CContractIndexKey> contracts;
+        for (const CTransactionRef& tx : block.vtx) {
+            if (!tx->HasCreateOrCall())
+                continue;
+            for (uint32_t nvout = 0; nvout < tx->vout.size(); nvout++) {
+                if (!tx->vout[nvout].scriptPubKey.HasOpCreate())
+                    continue;
+                // the sender isn't needed for the address, so no view is given
+                ContractOutputParser parser(*tx, nvout);
+                ContractOutput output;
+                if (parser.parseOutput(output) && setContracts.erase(output.address))
+                    contracts.push_back(CContractIndexKey(output.address));
+            }
+        }
+        if (!contracts.empty() && !pblocktree->WriteContractIndex(contracts, pindex->nHeight, true))
+            return false;
+    }
+
+    // Contracts created by other contracts, or in pruned blocks, are not tied to a block,
+    // so they stay in the index if the tip is disconnected
+    std::vector<CContractIndexKey> contracts;
+    for (const UniversalAddress& address : setContracts)
+        contracts.push_back(CContractIndexKey(address));
+    unsigned int nHeight = std::max(chainActive.Height(), 0);
+    return pblocktree->WriteContractIndex(contracts, nHeight, false) && pblocktree->WriteFlag("contractindex", true);
+}
+
 // May NOT be used after any connections are up as much
 // of the peer-processing logic assumes a consistent
 // block index state
@@ -5390,10 +5619,8 @@ void UnloadBlockIndex()
         warningcache[b].clear();
     }
 
-    for (BlockMap::value_type& entry : mapBlockIndex) {
-        delete entry.second;
-    }
     mapBlockIndex.clear();
+    blockIndexArena.Clear();
     fHavePruned = false;
 }
 
@@ -5447,7 +5674,7 @@ bool LoadGenesisBlock(const CChainParams& chainparams)
         if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart()))
             return error("%s: writing genesis block to disk failed", __func__);
         CBlockIndex *pindex = AddToBlockIndex(block);
-        pindex->hashProof = chainparams.GetConsensus().hashGenesisBlock;
+        pindex->SetHashProof(chainparams.GetConsensus().hashGenesisBlock);
         if (!ReceivedBlockTransactions(block, state, pindex, blockPos, chainparams.GetConsensus()))
             return error("%s: genesis block not accepted", __func__);
     } catch (const std::runtime_error& e) {
@@ -5926,10 +6153,7 @@ class CMainCleanup
 public:
     CMainCleanup() {}
     ~CMainCleanup() {
-        // block headers
-        BlockMap::iterator it1 = mapBlockIndex.begin();
-        for (; it1 != mapBlockIndex.end(); it1++)
-            delete (*it1).second;
+        // block headers, their memory goes with blockIndexArena
         mapBlockIndex.clear();
     }
 } instance_of_cmaincleanup;
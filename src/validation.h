@@ -107,7 +107,7 @@ static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 
 /** Maximum number of script-checking threads allowed */
-static const int MAX_SCRIPTCHECK_THREADS = 16;
+static const int MAX_SCRIPTCHECK_THREADS = 64;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
 /** Number of blocks that can be requested at any given time from a single peer. */
@@ -198,6 +198,8 @@ extern CBlockPolicyEstimator feeEstimator;
 extern CTxMemPool mempool;
 typedef std::unordered_map<uint256, CBlockIndex*, BlockHasher> BlockMap;
 extern BlockMap mapBlockIndex;
+/** Owns all entries of mapBlockIndex. */
+extern CBlockIndexArena blockIndexArena;
 extern std::set<std::pair<COutPoint, unsigned int>> setStakeSeen;
 extern int64_t nLastCoinStakeSearchInterval;
 extern uint64_t nLastBlockTx;
@@ -311,7 +313,7 @@ bool LoadBlockIndex(const CChainParams& chainparams);
 bool LoadChainTip(const CChainParams& chainparams);
 /** Unload database information */
 void UnloadBlockIndex();
-/** Run an instance of the script checking thread */
+/** Run an instance of the thread running script checks and the other parallel validation work */
 void ThreadScriptCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
@@ -422,6 +424,42 @@ struct CHeightTxIndexKey {
     }
 };
 
+/** Contract address index entry, ordered by address version (EVM before x86) and then by address */
+struct CContractIndexKey {
+    uint8_t version;
+    uint160 address;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(version);
+        READWRITE(address);
+    }
+
+    CContractIndexKey() {
+        SetNull();
+    }
+
+    explicit CContractIndexKey(const UniversalAddress& _address) {
+        version = _address.version;
+        memcpy(address.begin(), _address.data.data(), address.size());
+    }
+
+    UniversalAddress GetUniversalAddress() const {
+        return UniversalAddress((AddressVersion)version, address.begin(), address.end());
+    }
+
+    void SetNull() {
+        version = AddressVersion::UNKNOWN;
+        address.SetNull();
+    }
+
+    friend bool operator==(const CContractIndexKey& a, const CContractIndexKey& b) {
+        return a.version == b.version && a.address == b.address;
+    }
+};
+
 ////////////////////////////////////////////////////////////
 
 /** Get the numerical statistics for the BIP9 state for a given deployment at the current tip. */
@@ -510,6 +548,8 @@ void InitScriptExecutionCache();
 template <typename Block>
 bool ReadBlockFromDisk(Block& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Read a block as it is stored on disk, without deserializing it */
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadFromDisk(CBlockHeader& block, unsigned int nFile, unsigned int nBlockPos);
 bool ReadFromDisk(CMutableTransaction& tx, CDiskTxPos& txindex, CBlockTreeDB& txdb, COutPoint prevout);
 bool CheckIndexProof(const CBlockIndex& block, const Consensus::Params& consensusParams);
@@ -530,6 +570,9 @@ bool IsWitnessEnabled(const CBlockIndex* pindexPrev, const Consensus::Params& pa
 /** When there are blocks in the active chain with missing data, rewind the chainstate and remove them from the block index */
 bool RewindBlockIndex(const CChainParams& params);
 
+/** Fill the contract address index from the current contract state, if this was not done yet */
+bool BuildContractIndex();
+
 /** Update uncommitted block structures (currently: only the witness nonce). This is safe for submitted blocks. */
 void UpdateUncommittedBlockStructures(CBlock& block, const CBlockIndex* pindexPrev, const Consensus::Params& consensusParams);
 
@@ -614,6 +657,11 @@ bool CheckReward(const CBlock& block, CValidationState& state, int nHeight, cons
 //////////////////////////////////////////////////////// qtum
 std::vector<ResultExecute> CallContract(const dev::Address& addrContract, std::vector<unsigned char> opcode, const dev::Address& sender = dev::Address(), uint64_t gasLimit=0);
 
+//same as above, but executes against state as of tip instead of globalState, so cs_main is not needed
+//state must not be used by anything else meanwhile, and blockGasLimit is the one for the block after tip
+std::vector<ResultExecute> CallContract(QtumState& state, dev::eth::SealEngineFace& sealEngine, const CBlockIndex* tip, uint64_t blockGasLimit,
+                                        const dev::Address& addrContract, std::vector<unsigned char> opcode, const dev::Address& sender = dev::Address(), uint64_t gasLimit=0);
+
 bool CheckSenderScript(const CCoinsViewCache& view, const CTransaction& tx);
 
 bool CheckMinGasPrice(std::vector<EthTransactionParams>& etps, const uint64_t& minGasPrice);
@@ -676,7 +724,13 @@ class ByteCodeExec {
 
 public:
 
-    ByteCodeExec(const CBlock& _block, std::vector<QtumTransaction> _txs, const uint64_t _blockGasLimit) : txs(_txs), block(_block), blockGasLimit(_blockGasLimit) {}
+    ByteCodeExec(const CBlock& _block, std::vector<QtumTransaction> _txs, const uint64_t _blockGasLimit) :
+        txs(_txs), block(_block), blockGasLimit(_blockGasLimit), state(*globalState), sealEngine(*globalSealEngine), tip(chainActive.Tip()) {}
+
+    //executes against a state other than globalState, as if the next block was built on _tip
+    //the state's databases are only committed to when _state is globalState
+    ByteCodeExec(const CBlock& _block, std::vector<QtumTransaction> _txs, const uint64_t _blockGasLimit, QtumState& _state, dev::eth::SealEngineFace& _sealEngine, const CBlockIndex* _tip) :
+        txs(_txs), block(_block), blockGasLimit(_blockGasLimit), state(_state), sealEngine(_sealEngine), tip(_tip) {}
 
     bool performByteCode(dev::eth::Permanence type = dev::eth::Permanence::Committed);
 
@@ -698,6 +752,12 @@ private:
 
     const uint64_t blockGasLimit;
 
+    QtumState& state;
+
+    dev::eth::SealEngineFace& sealEngine;
+
+    const CBlockIndex* tip;
+
 };
 ////////////////////////////////////////////////////////
 
@@ -18,6 +18,7 @@ class CConnman;
 class CReserveScript;
 class CValidationInterface;
 class CValidationState;
+struct ContractExecutionResult;
 class uint256;
 class CScheduler;
 
@@ -43,6 +44,11 @@ protected:
     virtual void BlockConnected(const std::shared_ptr<const CBlock> &block, const CBlockIndex *pindex, const std::vector<CTransactionRef> &txnConflicted) {}
     /** Notifies listeners of a block being disconnected */
     virtual void BlockDisconnected(const std::shared_ptr<const CBlock> &block) {}
+    /**
+     * Notifies listeners of the contract executions of a block being connected,
+     * in the order they were executed. Called after BlockConnected for that block.
+     */
+    virtual void ContractsExecuted(const CBlockIndex *pindex, const std::vector<ContractExecutionResult> &results) {}
     /** Notifies listeners of the new active block chain on-disk. */
     virtual void SetBestChain(const CBlockLocator &locator) {}
     /** Notifies listeners about an inventory item being seen on the network. */
@@ -86,6 +92,7 @@ public:
     void TransactionAddedToMempool(const CTransactionRef &);
     void BlockConnected(const std::shared_ptr<const CBlock> &, const CBlockIndex *pindex, const std::vector<CTransactionRef> &);
     void BlockDisconnected(const std::shared_ptr<const CBlock> &);
+    void ContractsExecuted(const CBlockIndex *, const std::vector<ContractExecutionResult> &);
     void SetBestChain(const CBlockLocator &);
     void Inventory(const uint256 &);
     void Broadcast(int64_t nBestBlockTime, CConnman* connman);
@@ -195,6 +195,8 @@ class MemorySystem{
 	int RangeFree(uint32_t low,uint32_t high);
 	void Read(uint32_t address,int count,void *buffer, MemAccessReason reason = Data);
 	void Write(uint32_t address,int count,const void *data, MemAccessReason reason = Data);
+	//! Tells if every byte from address to address+count-1 belongs to a device, without accessing it
+	bool IsMapped(uint32_t address,uint32_t count);
 	//! Tells if memory is locked
 	/*!
 	\return 1 if memory is locked, 0 if not locked.
@@ -118,3 +118,26 @@ TEST_CASE("Memory device manager test", "[Memory]" ){
 
 
 
+
+TEST_CASE("Memory mapped range test", "[Memory]" ){
+	MemorySystem Memory;
+
+	RAMemory m0(0x1000, "m0");
+	RAMemory m1(0x1000, "m1");
+	RAMemory m2(0x1000, "m2");
+
+	Memory.Add(0x1000, 0x1FFF, &m0);
+	Memory.Add(0x2000, 0x2FFF, &m1);
+	Memory.Add(0x10000, 0x10FFF, &m2);
+
+	REQUIRE(Memory.IsMapped(0x1000, 0));
+	REQUIRE(Memory.IsMapped(0x1000, 0x1000));
+	//ranges may span adjacent devices
+	REQUIRE(Memory.IsMapped(0x1800, 0x1800));
+	REQUIRE(Memory.IsMapped(0x1000, 0x2000));
+	REQUIRE(!Memory.IsMapped(0x1000, 0x2001));
+	REQUIRE(!Memory.IsMapped(0xFFF, 2));
+	REQUIRE(!Memory.IsMapped(0x2FFF, 0xE002));
+	REQUIRE(!Memory.IsMapped(0x10000, 0xFFFFFFFF));
+	REQUIRE(Memory.IsMapped(0x10FFF, 1));
+}
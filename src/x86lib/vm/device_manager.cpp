@@ -105,6 +105,36 @@ void MemorySystem::Remove(MemoryDevice *memdev)
 	}
 }
 
+bool MemorySystem::IsMapped(uint32_t address,uint32_t count)
+{
+	//same walk over the device ranges as Read
+	while(count > 0)
+	{
+		bool found = false;
+		for(unsigned int i = 0; i < memorySystemVector.size(); i++)
+		{
+			const DeviceRange_t& device = memorySystemVector[i];
+			if(device.low <= address && device.high >= address)
+			{
+				uint64_t available = (uint64_t)device.high - address + 1;
+				if(available >= count)
+				{
+					return true;
+				}
+				count -= available;
+				address += available;
+				found = true;
+				break;
+			}
+		}
+		if(!found)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 void MemorySystem::Read(uint32_t address,int size,void *b, MemAccessReason reason)
 {
 	uint8_t* buffer=(uint8_t*)b;
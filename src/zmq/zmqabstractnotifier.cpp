@@ -20,3 +20,13 @@ bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyContractsExecuted(const CBlockIndex * /*pindex*/, const std::vector<ContractExecutionResult> &/*results*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyBlockDisconnected(const CBlock &/*block*/)
+{
+    return true;
+}
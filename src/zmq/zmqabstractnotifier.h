@@ -7,8 +7,10 @@
 
 #include "zmqconfig.h"
 
+class CBlock;
 class CBlockIndex;
 class CZMQAbstractNotifier;
+struct ContractExecutionResult;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
@@ -34,6 +36,8 @@ public:
 
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    virtual bool NotifyContractsExecuted(const CBlockIndex *pindex, const std::vector<ContractExecutionResult> &results);
+    virtual bool NotifyBlockDisconnected(const CBlock &block);
 
 protected:
     void *psocket;
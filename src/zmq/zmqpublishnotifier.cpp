@@ -16,6 +16,11 @@ static const char *MSG_HASHBLOCK = "hashblock";
 static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
+static const char *MSG_CONTRACTEVENT = "contractevent";
+
+// First byte of a contractevent message
+static const uint8_t CONTRACTEVENT_CONNECTED    = 0;
+static const uint8_t CONTRACTEVENT_DISCONNECTED = 1;
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -146,6 +151,51 @@ bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* d
     return true;
 }
 
+static void zmq_free_vector(void * /*data*/, void *hint)
+{
+    delete static_cast<std::vector<unsigned char>*>(hint);
+}
+
+bool CZMQAbstractPublishNotifier::SendMessage(const char *command, std::unique_ptr<std::vector<unsigned char>> data)
+{
+    assert(psocket);
+
+    unsigned char msgseq[sizeof(uint32_t)];
+    WriteLE32(&msgseq[0], nSequence);
+
+    if (zmq_send(psocket, command, strlen(command), ZMQ_SNDMORE) == -1)
+    {
+        zmqError("Unable to send ZMQ msg");
+        return false;
+    }
+
+    // From here on the buffer belongs to the message, which frees it with zmq_free_vector
+    zmq_msg_t msg;
+    std::vector<unsigned char> *buf = data.release();
+    if (zmq_msg_init_data(&msg, buf->data(), buf->size(), zmq_free_vector, buf) != 0)
+    {
+        zmqError("Unable to initialize ZMQ msg");
+        delete buf;
+        return false;
+    }
+    if (zmq_msg_send(&msg, psocket, ZMQ_SNDMORE) == -1)
+    {
+        zmqError("Unable to send ZMQ msg");
+        zmq_msg_close(&msg);
+        return false;
+    }
+
+    if (zmq_send(psocket, msgseq, sizeof(uint32_t), 0) == -1)
+    {
+        zmqError("Unable to send ZMQ msg");
+        return false;
+    }
+
+    nSequence++;
+
+    return true;
+}
+
 bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     uint256 hash = pindex->GetBlockHash();
@@ -195,3 +245,59 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+// Events of result and of the contracts it called, each with the address that logged it
+static void WriteContractEvents(CVectorWriter& writer, const ContractExecutionResult& result, const COutPoint& tx, uint32_t& nEvents)
+{
+    for (const auto& event : result.events) {
+        writer << (uint8_t)result.address.version << result.address.data << tx << event.first << event.second;
+        nEvents++;
+    }
+    for (const ContractExecutionResult& sub : result.callResults)
+        WriteContractEvents(writer, sub, tx, nEvents);
+}
+
+bool CZMQPublishContractEventNotifier::NotifyContractsExecuted(const CBlockIndex *pindex, const std::vector<ContractExecutionResult> &results)
+{
+    /* body:
+          * type CONTRACTEVENT_CONNECTED (1 byte)
+          * block hash (32 bytes) and height (LE 4 bytes)
+          * number of events (LE 4 bytes)
+          * per event: address version (1 byte), address data, tx outpoint, key and value,
+            serialized like in a block (length prefixed data, hash and LE 4 byte index)
+    */
+    std::unique_ptr<std::vector<unsigned char>> data(new std::vector<unsigned char>());
+    CVectorWriter writer(SER_NETWORK, PROTOCOL_VERSION, *data, 0);
+    uint32_t nEvents = 0;
+    writer << CONTRACTEVENT_CONNECTED << pindex->GetBlockHash() << (uint32_t)pindex->nHeight << nEvents;
+    size_t nCountPos = data->size() - sizeof(uint32_t);
+    for (const ContractExecutionResult& result : results)
+        WriteContractEvents(writer, result, result.tx, nEvents);
+    if (nEvents == 0)
+        return true;
+    WriteLE32(&(*data)[nCountPos], nEvents);
+
+    LogPrint(BCLog::ZMQ, "zmq: Publish contractevent %s (%u events)\n", pindex->GetBlockHash().GetHex(), nEvents);
+    return SendMessage(MSG_CONTRACTEVENT, std::move(data));
+}
+
+bool CZMQPublishContractEventNotifier::NotifyBlockDisconnected(const CBlock &block)
+{
+    /* body: type CONTRACTEVENT_DISCONNECTED (1 byte), block hash (32 bytes) and height (LE 4 bytes)
+       Subscribers drop the events they got for that block.
+    */
+    uint256 hash = block.GetHash();
+    uint32_t nHeight = 0;
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator it = mapBlockIndex.find(hash);
+        if (it != mapBlockIndex.end())
+            nHeight = it->second->nHeight;
+    }
+    std::unique_ptr<std::vector<unsigned char>> data(new std::vector<unsigned char>());
+    CVectorWriter writer(SER_NETWORK, PROTOCOL_VERSION, *data, 0);
+    writer << CONTRACTEVENT_DISCONNECTED << hash << nHeight;
+
+    LogPrint(BCLog::ZMQ, "zmq: Publish contractevent disconnect %s\n", hash.GetHex());
+    return SendMessage(MSG_CONTRACTEVENT, std::move(data));
+}
@@ -7,6 +7,9 @@
 
 #include "zmqabstractnotifier.h"
 
+#include <memory>
+#include <vector>
+
 class CBlockIndex;
 
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
@@ -24,6 +27,11 @@ public:
     */
     bool SendMessage(const char *command, const void* data, size_t size);
 
+    /* same as above, but the data part is handed to ZMQ instead of copied
+       and freed once it has been sent
+    */
+    bool SendMessage(const char *command, std::unique_ptr<std::vector<unsigned char>> data);
+
     bool Initialize(void *pcontext) override;
     void Shutdown() override;
 };
@@ -52,4 +60,14 @@ public:
     bool NotifyTransaction(const CTransaction &transaction) override;
 };
 
+/* Publishes the events logged by the contracts executed in a connected block
+   as one message per block, and a marker for each disconnected block
+*/
+class CZMQPublishContractEventNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyContractsExecuted(const CBlockIndex *pindex, const std::vector<ContractExecutionResult> &results) override;
+    bool NotifyBlockDisconnected(const CBlock &block) override;
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
@@ -20,6 +20,30 @@ def deser_uint256(f):
         r += t << (i * 32)
     return r
 
+def x86_mov(opcode, value):
+    return bytes([opcode]) + pack(b"<I", value)
+
+def x86_int(number):
+    return bytes([0xcd, number])
+
+X86_EAX, X86_ECX, X86_EDX, X86_EBX, X86_ESI, X86_EDI = 0xb8, 0xb9, 0xba, 0xbb, 0xbe, 0xbf
+X86_DATA_ADDRESS = 0x100000
+
+# An x86 contract that stores "a" = "1", "b" = "2" and "c" = "3", logs the event "k" = "v" and exits successfully
+def storage_contract():
+    data = b"abc123kv"
+    code = b""
+    for i in range(3):
+        # QSC_WriteStorage: ebx = key, ecx = key size, edx = value, esi = value size
+        code += x86_mov(X86_EAX, 0x1001) + x86_mov(X86_EBX, X86_DATA_ADDRESS + i) + x86_mov(X86_ECX, 1)
+        code += x86_mov(X86_EDX, X86_DATA_ADDRESS + 3 + i) + x86_mov(X86_ESI, 1) + x86_int(0x40)
+    # QSC_AddEvent: same as above, edi = key and value type
+    code += x86_mov(X86_EAX, 16) + x86_mov(X86_EBX, X86_DATA_ADDRESS + 6) + x86_mov(X86_ECX, 1)
+    code += x86_mov(X86_EDX, X86_DATA_ADDRESS + 7) + x86_mov(X86_ESI, 1) + x86_mov(X86_EDI, 0) + x86_int(0x40)
+    # exit code 0
+    code += x86_mov(X86_EAX, 0) + x86_int(0xf0)
+    return pack(b"<IIII", 0, len(code), len(data), 0) + code + data
+
 #allows simple http get calls
 def http_get_call(host, port, path, response_object = 0):
     conn = http.client.HTTPConnection(host, port)
@@ -46,6 +70,7 @@ class RESTTest (BitcoinTestFramework):
     def set_test_params(self):
         self.setup_clean_chain = True
         self.num_nodes = 3
+        self.extra_args = [["-logevents"], [], []]
 
     def setup_network(self, split=False):
         super().setup_network()
@@ -322,5 +347,80 @@ class RESTTest (BitcoinTestFramework):
         json_obj = json.loads(json_string)
         assert_equal(json_obj['bestblockhash'], bb_hash)
 
+        self.log.info("Test contract endpoints")
+        bytecode = storage_contract()
+        contracts = [self.nodes[0].createcontract(bytes_to_hex_str(bytecode)) for i in range(2)]
+        self.sync_all()
+        self.nodes[1].generate(1)
+        self.sync_all()
+        height = self.nodes[0].getblockcount()
+        address = contracts[0]['address']
+
+        # storage, paged with a continuation token
+        json_string = http_get_call(url.hostname, url.port, '/rest/contract/storage/2/'+address+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        assert_equal(json_obj['address'], address)
+        # stored keys are "_" followed by the storage key
+        assert_equal(json_obj['entries'], [{'key': '5f61', 'value': '31'}, {'key': '5f62', 'value': '32'}])
+        assert_equal(json_obj['next'], '5f62')
+
+        json_string = http_get_call(url.hostname, url.port, '/rest/contract/storage/2/'+address+'/'+json_obj['next']+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        assert_equal(json_obj['entries'], [{'key': '5f63', 'value': '33'}])
+        assert('next' not in json_obj)
+
+        # binary: the entries followed by an empty continuation token
+        response = http_get_call(url.hostname, url.port, '/rest/contract/storage/10/'+address+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response.status, 200)
+        assert_equal(response.read(), b"\x03" + b"\x02_a\x011" + b"\x02_b\x012" + b"\x02_c\x013" + b"\x00")
+
+        # bytecode
+        json_string = http_get_call(url.hostname, url.port, '/rest/contract/bytecode/'+address+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        assert_equal(json_obj['address'], address)
+        assert_equal(json_obj['bytecode'], bytes_to_hex_str(bytecode))
+        response = http_get_call(url.hostname, url.port, '/rest/contract/bytecode/'+address+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response.status, 200)
+        assert_equal(response.read(), bytecode)
+        hex_string = http_get_call(url.hostname, url.port, '/rest/contract/bytecode/'+address+self.FORMAT_SEPARATOR+'hex')
+        assert_equal(hex_string, bytes_to_hex_str(bytecode) + "\n")
+
+        # events, one result per page
+        txids = []
+        after = ''
+        while True:
+            json_string = http_get_call(url.hostname, url.port, '/rest/contract/events/1/'+str(height)+'/'+str(height)+after+self.FORMAT_SEPARATOR+'json')
+            json_obj = json.loads(json_string)
+            for result in json_obj['results']:
+                assert_equal(result['height'], height)
+                txids.append(result['txid'])
+            if 'next' not in json_obj:
+                break
+            assert_equal(len(json_obj['results']), 1)
+            after = '/' + json_obj['next']
+        assert_equal(sorted(txids), sorted(contract['txid'] for contract in contracts))
+
+        # bad parameters
+        for path in ['/rest/contract/storage/0/'+address,
+                     '/rest/contract/storage/10001/'+address,
+                     '/rest/contract/storage/10/'+self.nodes[0].getnewaddress(),
+                     '/rest/contract/storage/10/'+address+'/zz',
+                     '/rest/contract/storage/10/'+address+'/5f62/5f63',
+                     '/rest/contract/storage/'+address,
+                     '/rest/contract/bytecode/'+self.nodes[0].getnewaddress(),
+                     '/rest/contract/bytecode/notanaddress',
+                     '/rest/contract/events/0/'+str(height)+'/'+str(height),
+                     '/rest/contract/events/1/'+str(height)+'/'+str(height - 1),
+                     '/rest/contract/events/1/-1/'+str(height),
+                     '/rest/contract/events/1/'+str(height)+'/'+str(height)+'/5f62',
+                     '/rest/contract/events/1/'+str(height)]:
+            response = http_get_call(url.hostname, url.port, path+self.FORMAT_SEPARATOR+'json', True)
+            assert_equal(response.status, 400)
+
+        # events need -logevents
+        url1 = urllib.parse.urlparse(self.nodes[1].url)
+        response = http_get_call(url1.hostname, url1.port, '/rest/contract/events/1/'+str(height)+'/'+str(height)+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 404)
+
 if __name__ == '__main__':
     RESTTest ().main ()
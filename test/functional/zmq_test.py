@@ -4,15 +4,33 @@
 # file COPYING or http://www.opensource.org/licenses/mit-license.php.
 """Test the ZMQ API."""
 import configparser
+from io import BytesIO
 import os
 import struct
 
+from test_framework.mininode import deser_string
 from test_framework.test_framework import BitcoinTestFramework, SkipTest
 from test_framework.util import (assert_equal,
                                  bytes_to_hex_str,
                                  hash256,
                                 )
 
+# An x86 contract whose code logs the event "k" = "v" and exits successfully:
+#   mov eax, QSC_AddEvent; mov ebx, key; mov ecx, 1; mov edx, value; mov esi, 1; mov edi, 0; int 0x40
+#   mov eax, 0; int 0xf0
+# The key and value are the data section, loaded at 0x100000.
+EVENT_CONTRACT_CODE = bytes.fromhex("b810000000" "bb00001000" "b901000000" "ba01001000" "be01000000" "bf00000000" "cd40"
+                                    "b800000000" "cdf0")
+EVENT_CONTRACT_DATA = b"kv"
+EVENT_CONTRACT = struct.pack("<IIII", 0, len(EVENT_CONTRACT_CODE), len(EVENT_CONTRACT_DATA), 0) + EVENT_CONTRACT_CODE + EVENT_CONTRACT_DATA
+# The node prefixes event keys and values with their type, 0 here
+EVENT_KEY = b"\x00k"
+EVENT_VALUE = b"\x00v"
+
+CONTRACTEVENT_CONNECTED = 0
+CONTRACTEVENT_DISCONNECTED = 1
+ADDRESS_VERSION_X86 = 4
+
 class ZMQTest (BitcoinTestFramework):
     def set_test_params(self):
         self.num_nodes = 2
@@ -42,8 +60,15 @@ class ZMQTest (BitcoinTestFramework):
         self.zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"rawtx")
         ip_address = "tcp://127.0.0.1:28332"
         self.zmqSubSocket.connect(ip_address)
+        # contract events get their own socket, so the block and tx notifications above don't get in the way
+        self.zmqEventSocket = self.zmqContext.socket(zmq.SUB)
+        self.zmqEventSocket.set(zmq.RCVTIMEO, 60000)
+        self.zmqEventSocket.setsockopt(zmq.SUBSCRIBE, b"contractevent")
+        event_address = "tcp://127.0.0.1:28333"
+        self.zmqEventSocket.connect(event_address)
         self.extra_args = [['-zmqpubhashblock=%s' % ip_address, '-zmqpubhashtx=%s' % ip_address,
-                       '-zmqpubrawblock=%s' % ip_address, '-zmqpubrawtx=%s' % ip_address], []]
+                       '-zmqpubrawblock=%s' % ip_address, '-zmqpubrawtx=%s' % ip_address,
+                       '-zmqpubcontractevent=%s' % event_address], []]
         self.add_nodes(self.num_nodes, self.extra_args)
         self.start_nodes()
 
@@ -149,5 +174,53 @@ class ZMQTest (BitcoinTestFramework):
         assert_equal(hashRPC, hashZMQ)  # txid from sendtoaddress must be equal to the hash received over zmq
         assert_equal(hashRPC, hashedZMQ)
 
+        self._contractevent_test()
+
+    def _recv_contractevent(self):
+        msg = self.zmqEventSocket.recv_multipart()
+        assert_equal(msg[0], b"contractevent")
+        return BytesIO(msg[1]), struct.unpack('<I', msg[-1])[-1]
+
+    def _contractevent_test(self):
+        self.log.info("Wait for contract events of a connected block")
+        # a block without contract events publishes nothing, so the first message is for the contract's block
+        self.nodes[1].generate(1)
+        contract = self.nodes[1].createcontract(bytes_to_hex_str(EVENT_CONTRACT))
+        tx = self.nodes[1].getrawtransaction(contract["txid"], True)
+        nvout = [out["n"] for out in tx["vout"] if out["scriptPubKey"]["asm"].endswith("OP_CREATE")][0]
+        blockhash = self.nodes[1].generate(1)[0]
+        self.sync_all()
+        height = self.nodes[0].getblockcount()
+
+        body, msgSequence = self._recv_contractevent()
+        assert_equal(msgSequence, 0)
+        assert_equal(body.read(1)[0], CONTRACTEVENT_CONNECTED)
+        assert_equal(bytes_to_hex_str(body.read(32)[::-1]), blockhash)
+        assert_equal(struct.unpack('<I', body.read(4))[0], height)
+        assert_equal(struct.unpack('<I', body.read(4))[0], 1)
+        assert_equal(body.read(1)[0], ADDRESS_VERSION_X86)
+        assert_equal(bytes_to_hex_str(deser_string(body)), contract["hexaddress"])
+        assert_equal(bytes_to_hex_str(body.read(32)[::-1]), contract["txid"])
+        assert_equal(struct.unpack('<I', body.read(4))[0], nvout)
+        assert_equal(deser_string(body), EVENT_KEY)
+        assert_equal(deser_string(body), EVENT_VALUE)
+        assert_equal(body.read(), b"")
+
+        self.log.info("Wait for the disconnect of that block")
+        self.nodes[0].invalidateblock(blockhash)
+        body, msgSequence = self._recv_contractevent()
+        assert_equal(msgSequence, 1)
+        assert_equal(body.read(1)[0], CONTRACTEVENT_DISCONNECTED)
+        assert_equal(bytes_to_hex_str(body.read(32)[::-1]), blockhash)
+        assert_equal(struct.unpack('<I', body.read(4))[0], height)
+        assert_equal(body.read(), b"")
+
+        # connecting it again publishes its events again
+        self.nodes[0].reconsiderblock(blockhash)
+        body, msgSequence = self._recv_contractevent()
+        assert_equal(msgSequence, 2)
+        assert_equal(body.read(1)[0], CONTRACTEVENT_CONNECTED)
+        assert_equal(bytes_to_hex_str(body.read(32)[::-1]), blockhash)
+
 if __name__ == '__main__':
     ZMQTest().main()